@@ -16,17 +16,12 @@
 #pragma once
 #include <net/config.h>
 
-#ifdef NET_DO_LOG
-#include <stdio.h>
-#define NET_LOG(...) printf(__VA_ARGS__)
-#else
-#define NET_LOG(...) (void)0
-#endif
+#include <net/log.h>
 
 #ifdef NET_ASSERTIONS
 #include <stdio.h>
 #include <stdlib.h>
-#define NET_ASSERT(n,...) do if(!(n)){ printf("" __VA_ARGS__); abort(); }while(0)
+#define NET_ASSERT(n,...) do if(odp_unlikely(!(n))){ fprintf(stderr,"" __VA_ARGS__); abort(); }while(0)
 #else
 #define NET_ASSERT(...) (void)0
 #endif
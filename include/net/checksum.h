@@ -18,14 +18,107 @@
 #include <net/header/ip.h>
 #include <net/header/ip6.h>
 
-uint16_t fastnet_ipv4_hdr_checksum(odp_packet_t pkt);
+/*
+ * Adds the 16-bit words (native byte order) of 'data' to the unfolded ones-complement sum 'sum'.
+ *
+ * If 'len' is odd, the last byte is padded with a zero byte. The fastest kernel for the CPU
+ * (AVX2, SSE2, NEON or portable C) is selected at runtime.
+ */
+uint64_t fastnet_cksum_sum(const void* data,uint32_t len,uint64_t sum);
+
+/*
+ * Same as fastnet_cksum_sum(), always with the portable C kernel. For benchmarks and tests.
+ */
+uint64_t fastnet_cksum_sum_generic(const void* data,uint32_t len,uint64_t sum);
+
+/*
+ * Copies 'len' bytes from 'src' to 'dst' and adds them to 'sum', like fastnet_cksum_sum(), in a single pass.
+ */
+uint64_t fastnet_cksum_copy(void* dst,const void* src,uint32_t len,uint64_t sum);
+
+/*
+ * Folds an unfolded ones-complement sum into 16 bits (not complemented).
+ */
+static inline
+uint16_t fastnet_cksum_fold(uint64_t sum){
+	sum = (sum>>32) + (sum&0xffffffff);
+	sum = (sum>>32) + (sum&0xffffffff);
+	sum = (sum>>16) + (sum&0xffff);
+	sum = (sum>>16) + (sum&0xffff);
+	return (uint16_t)sum;
+}
+
+/*
+ * Incremental checksum update (RFC 1624, eqn. 3):  HC' = ~(~HC + ~m + m')
+ *
+ * These functions take a checksum field 'cksum' (as stored in the header) and return its new value,
+ * after the checksummed data changed from 'from' to 'to'. All values are in network byte order.
+ */
+static inline
+uint16_t fastnet_cksum_update16(uint16_t cksum,uint16_t from,uint16_t to){
+	uint32_t sum = (uint16_t)~cksum;
+	sum += (uint16_t)~from;
+	sum += to;
+	sum = (sum>>16) + (sum&0xffff);
+	sum = (sum>>16) + (sum&0xffff);
+	return ~((uint16_t)sum);
+}
+
+static inline
+uint16_t fastnet_cksum_update32(uint16_t cksum,uint32_t from,uint32_t to){
+	uint64_t sum = (uint16_t)~cksum;
+	sum += (uint32_t)~from;
+	sum += to;
+	return ~fastnet_cksum_fold(sum);
+}
+
+/*
+ * Same as above, for an arbitrary region of 'len' bytes.
+ */
+static inline
+uint16_t fastnet_cksum_update(uint16_t cksum,const void* from,const void* to,uint32_t len){
+	uint16_t sfrom = fastnet_cksum_fold(fastnet_cksum_sum(from,len,0));
+	uint16_t sto   = fastnet_cksum_fold(fastnet_cksum_sum(to,len,0));
+	return fastnet_cksum_update16(cksum,sfrom,sto);
+}
+
+/*
+ * All checksum functions return 0, if the checksum is offloaded to 'nif' (offload_flags & nif->offload_flags).
+ *
+ * If 'offload_flags' is one of the NIFOFL_RX_* flags, the result of the NIC's validation is returned instead
+ * (0 if valid, non-0 if invalid).
+ */
+uint16_t fastnet_ipv4_hdr_checksum(odp_packet_t pkt,nif_t* nif,uint32_t offload_flags);
 
 uint16_t fastnet_checksum(odp_packet_t pkt,uint32_t offset,uint32_t cksuminit,nif_t* nif,uint32_t offload_flags);
 uint16_t fastnet_ip_ph(ipv4_addr_t src,ipv4_addr_t dst,uint8_t prot);
 uint16_t fastnet_ip6_ph(ipv6_addr_t src,ipv6_addr_t dst,uint8_t prot);
 
-uint16_t fastnet_ip4_checksum(odp_packet_t pkt,ipv4_addr_t src,ipv4_addr_t dst,uint8_t prot);
-uint16_t fastnet_ip6_checksum(odp_packet_t pkt,ipv6_addr_t src,ipv6_addr_t dst,uint8_t prot);
+uint16_t fastnet_ip4_checksum(odp_packet_t pkt,ipv4_addr_t src,ipv4_addr_t dst,uint8_t prot,nif_t* nif,uint32_t offload_flags);
+uint16_t fastnet_ip6_checksum(odp_packet_t pkt,ipv6_addr_t src,ipv6_addr_t dst,uint8_t prot,nif_t* nif,uint32_t offload_flags);
 
 uint16_t fastnet_tcpudp_input_checksum(odp_packet_t pkt,uint8_t prot);
 
+/*
+ * Computes and inserts the checksums, that a NIC with the given offload_flags (NIFOFL_TX_MASK) would insert.
+ *
+ * This is used to emulate checksum offload, and to fix up packets, whose checksum were left to a NIC,
+ * that eventually does not transmit them. Like a NIC, it relies on odp_packet_has_ipv4() etc.
+ */
+void fastnet_checksum_insert(odp_packet_t pkt,uint32_t offload_flags);
+
+/*
+ * Computes the partial checksum of the payload (from 'offset' to the end of the packet),
+ * and caches it in the packet's user area (see fastnet_pkt_uarea_t.psum).
+ */
+void fastnet_pkt_psum_compute(odp_packet_t pkt,uint32_t offset);
+
+/*
+ * Copies application data into a packet, at 'offset', which is the start of the payload,
+ * and caches the payload's partial checksum in the same pass. The payload must end with
+ * the packet (offset+len == odp_packet_len(pkt)), otherwise nothing is cached.
+ *
+ * Returns 0 on success, non-0 if the packet is too short.
+ */
+int fastnet_pkt_copyin_psum(odp_packet_t pkt,uint32_t offset,const void* data,uint32_t len);
+
@@ -0,0 +1,120 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+#include <odp_api.h>
+
+/*
+ * Runtime configuration of the stack's pools and tables.
+ *
+ * Every field, that is 0, is derived by fastnet_conf_finalize(): from 'mem_budget',
+ * if it is set, otherwise from the built-in defaults.
+ *
+ * The compile-time constants NET_MAXTHREAD, NET_NIF_MAX_QUEUE and FASTNET_MAX_BURST
+ * remain the upper limits of 'workers', 'out_queues' and 'burst'.
+ */
+typedef struct {
+	/* Number of worker threads. */
+	uint32_t workers;
+	
+	/* Memory budget in bytes, for the pools and tables. */
+	uint64_t mem_budget;
+	
+	/* Packet pools: buffer size, number of packets. */
+	uint32_t pktin_size;
+	uint32_t pktin_num;
+	uint32_t pktout_size;
+	uint32_t pktout_num;
+	
+	/* Object pools: max. number of elements. */
+	uint32_t tcp_pcbs;
+	uint32_t arp_entries;
+	uint32_t nd6_entries;
+	
+	/* Object pools grow in chunks of this many elements (see slab.h). */
+	uint32_t slab_chunk;
+	
+	/* Hash tables: number of buckets (power of 2). */
+	uint32_t socket_buckets;
+	uint32_t arp_buckets;
+	uint32_t nd6_buckets;
+	uint32_t pmtu_buckets;
+	
+	/* Max. number of events per odp_schedule_multi() call. */
+	uint32_t burst;
+	
+	/* Max. number of output queues per NIF. */
+	uint32_t out_queues;
+	
+	/* Interval of the statistics export in milliseconds (see stats.h). */
+	uint32_t stats_interval;
+	
+	/* Latency sampling: One in 'lat_sample' received packets per worker, 0 = off (see latency.h). */
+	uint32_t lat_sample;
+	
+	/*
+	 * Rate limits of the replies, per worker: messages per second, and the burst (see icmp_limit.h).
+	 * Echo replies, ICMP/ICMPv6 errors, and TCP resets for closed ports.
+	 */
+	uint32_t icmp_echo_rate;
+	uint32_t icmp_echo_burst;
+	uint32_t icmp_err_rate;
+	uint32_t icmp_err_burst;
+	uint32_t tcp_rst_rate;
+	uint32_t tcp_rst_burst;
+	
+	/* Lifetime of the entries of the path MTU cache in seconds (see pmtu.h). */
+	uint32_t pmtu_expire;
+	
+	int finalized;
+} fastnet_conf_t;
+
+#define FASTNET_MAX_BURST 1024
+
+extern fastnet_conf_t fastnet_conf;
+
+/*
+ * Sets a configuration variable by name. Sizes accept the suffixes K, M and G.
+ *
+ * Returns 0 on success, non-0 if the key or the value is invalid.
+ */
+int fastnet_conf_set(fastnet_conf_t* conf,const char* key,const char* value);
+
+/*
+ * Loads a configuration file. Every line has the form "key = value", '#' starts a comment.
+ *
+ * Returns 0 on success, non-0 on failure.
+ */
+int fastnet_conf_load(fastnet_conf_t* conf,const char* path);
+
+/*
+ * Parses command line arguments of the form "--key=value". "--config=file" loads a file.
+ * Arguments of any other form are left alone; an unknown key is an error (eg. a typo).
+ *
+ * Returns 0 on success, non-0 on an unknown key or an invalid value.
+ */
+int fastnet_conf_args(fastnet_conf_t* conf,int argc,char** argv);
+
+/*
+ * Derives all unset fields, and clamps the others to their limits.
+ * Called by fastnet_pools_init() and fastnet_tlp_init(), calling it again has no effect.
+ */
+void fastnet_conf_finalize(fastnet_conf_t* conf);
+
+/*
+ * Prints the configuration.
+ */
+void fastnet_conf_print(fastnet_conf_t* conf);
+
@@ -15,9 +15,63 @@
  */
 #pragma once
 
+/*
+ * Build profile. Override it with eg. -DNET_PROFILE=NET_PROFILE_RELEASE.
+ *
+ *   NET_PROFILE_DEBUG    : Assertions, all log levels.
+ *   NET_PROFILE_DEFAULT  : Assertions, log levels up to INFO.
+ *   NET_PROFILE_RELEASE  : No assertions, log levels up to WARN.
+ *   NET_PROFILE_MAX_PERF : No assertions, no logging at all.
+ *
+ * Log statements above the profile's level are compiled out. The others cost one
+ * predictable branch, while the runtime log level excludes them (see <net/log.h>).
+ */
+#define NET_PROFILE_DEBUG    3
+#define NET_PROFILE_DEFAULT  2
+#define NET_PROFILE_RELEASE  1
+#define NET_PROFILE_MAX_PERF 0
+
+/* The old switch. */
 //#define NET_MAX_PERFORMACE
 
-#define NET_DO_LOG 1
+#ifndef NET_PROFILE
+#ifdef NET_MAX_PERFORMACE
+#define NET_PROFILE NET_PROFILE_MAX_PERF
+#else
+#define NET_PROFILE NET_PROFILE_DEFAULT
+#endif
+#endif
 
+#if NET_PROFILE>=NET_PROFILE_DEFAULT
 #define NET_ASSERTIONS 1
+#endif
+
+#if NET_PROFILE>=NET_PROFILE_DEBUG
+#define NET_LOG_MAX 4 /* NET_LOG_DEBUG */
+#elif NET_PROFILE>=NET_PROFILE_DEFAULT
+#define NET_LOG_MAX 3 /* NET_LOG_INFO */
+#elif NET_PROFILE>=NET_PROFILE_RELEASE
+#define NET_LOG_MAX 2 /* NET_LOG_WARN */
+#else
+#define NET_LOG_MAX 0
+#endif
+
+/*
+ * Cycle accounting of the input and output stages (see <net/prof.h>). It costs two
+ * odp_cpu_cycles() per stage, so it is off by default. Enable it with -DNET_PROF.
+ */
+//#define NET_PROF 1
 
+/*
+ * Lock contention profiling (see <net/lockprof.h>). Every lock operation gets a trylock and
+ * two odp_cpu_cycles(), so it is meant for debug builds. Enable it with -DNET_LOCKPROF.
+ */
+//#define NET_LOCKPROF 1
+
+/*
+ * Every TCP flow is processed by only one worker (see <net/flow_director.h>).
+ * Disable this (or build with -DNET_TCP_NO_FLOW_AFFINITY), to fall back to locking the PCB instead.
+ */
+#ifndef NET_TCP_NO_FLOW_AFFINITY
+#define NET_TCP_FLOW_AFFINITY 1
+#endif
@@ -0,0 +1,65 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+#include <net/types.h>
+
+/*
+ * Software flow director.
+ *
+ * Every flow is owned by exactly one worker, selected by the flow's hash. A worker
+ * receiving a packet of a foreign flow forwards it to the owner over a lock-free
+ * single-producer/single-consumer ring. There is one ring per ordered pair of workers.
+ *
+ * As only the owner ever touches the state of a flow, the per-flow state (eg. the TCP PCB)
+ * needs neither locking nor reference counting on the hot path.
+ */
+
+/*
+ * Initializes the flow director for the given number of workers.
+ */
+void fastnet_flowdir_init(int workers);
+
+/*
+ * Distributes the flows onto the first 'workers' workers only (at most the number given to
+ * fastnet_flowdir_init()). Must not be called while workers are running, as the flows change
+ * their owners, and the rings are reset.
+ */
+void fastnet_flowdir_set_workers(int workers);
+
+/*
+ * Returns the index of the worker owning the flow with the given hash.
+ */
+int fastnet_flowdir_owner(uint32_t hash);
+
+/*
+ * Steers a packet to the owner of its flow.
+ *
+ * Returns NETPP_CONTINUE, if the calling worker owns the flow. Otherwise the packet is
+ * forwarded to the owner, where it is passed to 'cb', and NETPP_CONSUMED is returned.
+ * If the ring to the owner is full, NETPP_DROP is returned.
+ *
+ * Only workers may steer packets (see fastnet_worker_enter()). On any other thread, NETPP_DROP
+ * is returned, unless there is only one worker.
+ */
+netpp_retcode_t fastnet_flowdir_steer(odp_packet_t pkt,uint32_t hash,netpp_cb_t cb);
+
+/*
+ * Processes the packets forwarded to the calling worker.
+ *
+ * Returns the number of packets processed.
+ */
+int fastnet_flowdir_poll();
+
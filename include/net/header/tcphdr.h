@@ -55,3 +55,9 @@ typedef struct ODP_PACKED
 #define FNET_TCP_SGT_ACK            0x10
 #define FNET_TCP_SGT_URG            0x20
 
+/* TCP options (RFC 793). */
+#define FNET_TCP_OPT_EOL            0
+#define FNET_TCP_OPT_NOP            1
+#define FNET_TCP_OPT_MSS            2
+#define FNET_TCP_OPT_MSS_LEN        4
+
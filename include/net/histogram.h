@@ -0,0 +1,62 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+#include <odp_api.h>
+
+/*
+ * Log-linear histograms (HDR-histogram style).
+ *
+ * Values below 8 have a bucket of their own, above, every power of 2 is split into 8
+ * sub-buckets, so the relative error is below 12.5%. Values of 2^32 and above go into
+ * the last bucket.
+ */
+#define FASTNET_HIST_SUB_BITS 3
+#define FASTNET_HIST_MAX_BITS 32
+#define FASTNET_HIST_BUCKETS  ((FASTNET_HIST_MAX_BITS-FASTNET_HIST_SUB_BITS+1)<<FASTNET_HIST_SUB_BITS)
+
+#define FASTNET_HIST_SUB      (1<<FASTNET_HIST_SUB_BITS)
+
+static inline
+uint32_t fastnet_hist_bucket(uint64_t v){
+	uint32_t msb;
+	if(v<FASTNET_HIST_SUB) return v;
+	msb = 63-__builtin_clzll(v);
+	if(odp_unlikely(msb>=FASTNET_HIST_MAX_BITS)) return FASTNET_HIST_BUCKETS-1;
+	return ((msb-FASTNET_HIST_SUB_BITS+1)<<FASTNET_HIST_SUB_BITS) | ((v>>(msb-FASTNET_HIST_SUB_BITS))&(FASTNET_HIST_SUB-1));
+}
+
+/*
+ * The lowest value of a bucket.
+ */
+static inline
+uint64_t fastnet_hist_low(uint32_t b){
+	if(b<FASTNET_HIST_SUB) return b;
+	return ((uint64_t)(FASTNET_HIST_SUB|(b&(FASTNET_HIST_SUB-1))))<<((b>>FASTNET_HIST_SUB_BITS)-1);
+}
+
+/*
+ * Returns the lowest value of the bucket, that contains the percentile 'p' (0..1).
+ */
+static inline
+uint64_t fastnet_hist_percentile(const uint64_t* hist,uint64_t count,double p){
+	uint64_t want = (uint64_t)(count*p),have = 0;
+	uint32_t i;
+	for(i=0;i<FASTNET_HIST_BUCKETS;++i){
+		have += hist[i];
+		if(have>want) return fastnet_hist_low(i);
+	}
+	return fastnet_hist_low(FASTNET_HIST_BUCKETS-1);
+}
@@ -0,0 +1,51 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+#include <net/nif.h>
+#include <net/types.h>
+
+/*
+ * ICMP and ICMPv6 error messages about a received packet.
+ *
+ * The error is built in a packet of its own, quoting as much of the received packet, as fits
+ * into 576 (IPv4, RFC 1812 4.3.2.3) or 1280 (IPv6, RFC 4443 2.4 (c)) bytes. The received packet
+ * stays with the caller; its L3 offset and context NIF (user pointer) must be set.
+ *
+ * No error is sent about packets, that must not be answered with one (RFC 1122 3.2.2,
+ * RFC 4443 2.4 (e)): ICMP errors, broadcasts and multicasts, non-initial fragments, and packets
+ * from addresses, that do not identify a single host. The errors are rate limited per
+ * worker and type (see icmp_limit.h).
+ *
+ * Returns 0, if the error has been sent, non-0 otherwise.
+ */
+
+/*
+ * 'info' goes into the second word of the ICMP header, in host byte order: The next-hop MTU
+ * for FNET_ICMP_UNREACHABLE_NEEDFRAG, the pointer shifted left by 24 for FNET_ICMP_PARAMPROB.
+ */
+int fastnet_icmpv4_error(odp_packet_t pkt,uint8_t type,uint8_t code,uint32_t info);
+
+/*
+ * 'info' goes into the second word of the ICMPv6 header, in host byte order: The MTU for
+ * FNET_ICMP6_TYPE_PACKET_TOOBIG, the pointer for FNET_ICMP6_TYPE_PARAM_PROB.
+ */
+int fastnet_icmpv6_error(odp_packet_t pkt,uint8_t type,uint8_t code,uint32_t info);
+
+/*
+ * Sends a Port Unreachable about a datagram for a closed port, over ICMP or ICMPv6, depending
+ * on the IP version of 'pkt'.
+ */
+int fastnet_icmp_port_unreach(odp_packet_t pkt);
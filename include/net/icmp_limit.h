@@ -0,0 +1,64 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+#include <odp_api.h>
+#include <net/niftable.h>
+#include <net/nethread.h>
+
+/*
+ * Rate limiting of the messages, the stack sends in reply to received packets: ICMP and ICMPv6
+ * echo replies and errors, and TCP resets (RFC 4443 2.4 (f), RFC 1812 4.3.2.8).
+ *
+ * Every worker has a token bucket per class, so a flood of requests can not make the workers
+ * reflect more than 'rate' messages per second each, plus a burst of 'burst' messages. The rates
+ * are set per group of classes (see fastnet_conf_t):
+ *
+ *   icmp_echo_rate, icmp_echo_burst   FASTNET_ICMPL_ECHO
+ *   icmp_err_rate,  icmp_err_burst    FASTNET_ICMPL_UNREACH ... FASTNET_ICMPL_PARAMPROB
+ *   tcp_rst_rate,   tcp_rst_burst     FASTNET_ICMPL_TCP_RST
+ *
+ * The error classes have buckets of their own: A flood of closed-port probes does not use up the
+ * budget of Packet Too Big messages. Threads, that are not workers, share an extra set of buckets,
+ * which they take a lock for.
+ */
+enum {
+	FASTNET_ICMPL_ECHO,       /* Echo reply (ICMP, ICMPv6) */
+	FASTNET_ICMPL_UNREACH,    /* Destination unreachable */
+	FASTNET_ICMPL_TIMXCEED,   /* Time exceeded */
+	FASTNET_ICMPL_TOOBIG,     /* Packet too big, Fragmentation needed */
+	FASTNET_ICMPL_PARAMPROB,  /* Parameter problem */
+	FASTNET_ICMPL_TCP_RST,    /* TCP reset for a closed port */
+	
+	FASTNET_ICMPL_NUM_CLASSES
+};
+
+typedef struct {
+	uint64_t credit;  /* Time credit in ns: Every message costs 1e9/rate ns. */
+	uint64_t last;    /* Time of the last refill in ns. */
+} fastnet_icmp_bucket_t;
+
+typedef struct {
+	fastnet_icmp_bucket_t bucket[FASTNET_ICMPL_NUM_CLASSES];
+} ODP_ALIGNED_CACHE fastnet_icmp_limit_block_t;
+
+extern fastnet_icmp_limit_block_t fastnet_icmp_limit_blocks[FASTNET_THREAD_SLOTS];
+
+/*
+ * Takes a token from the calling worker's bucket of the class 'cls'.
+ *
+ * Returns non-0, if the message may be sent, 0 if it must be suppressed.
+ */
+int fastnet_icmp_allow(int cls);
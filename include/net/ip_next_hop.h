@@ -24,5 +24,10 @@ typedef struct {
 	nif_t*      nif;
 } ip_next_hop_t;
 
+/*
+ * Sends an IPv4 packet.
+ *
+ * If the header checksum is non-0, it must be valid, and it isn't recomputed.
+ */
 netpp_retcode_t fastnet_ip_output(odp_packet_t pkt,ip_next_hop_t* nh);
 
@@ -26,6 +26,7 @@ struct ipv4_nif_struct{
 		subnet,
 		subnetmask,
 		address;
+	uint32_t mtu; /* Link MTU, 0 = FASTNET_PMTU_DEFAULT4 (see pmtu.h). */
 };
 
 void fastnet_ip_set     (struct ipv4_nif_struct *ipv4,ipv4_addr_t addr,ipv4_addr_t subnetmask);
@@ -75,13 +75,12 @@ struct ipv6_nif_struct{
 	ipv6_nif_addr_t          addrs[IPV6_NIF_ADDR_MAX];
 	ipv6_nif_multicast_t     multicasts[IPV6_NIF_MULTCAST_MAX];
 	uint8_t                  hop_limit;
-	uint32_t                 mtu;  /* MTU */
-	uint32_t                 pmtu; /* PMTU (later). */
+	uint32_t                 mtu;  /* Link MTU */
 	uint32_t                 base_reachable_time;
 	uint32_t                 reachable_time;
 	uint32_t                 retrans_timer;
 	unsigned                 disabled : 1; /* < IPv6 is Disabled*/
-	unsigned                 pmtu_on : 1;  /* < IPv6/ICMPv6 PMTU Enabled*/
+	unsigned                 pmtu_on : 1;  /* < IPv6/ICMPv6 PMTU Enabled (see pmtu.h) */
 };
 
 void fastnet_ipv6_init(struct ipv6_nif_struct *ipv6);
@@ -0,0 +1,142 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+#include <stdio.h>
+#include <odp_api.h>
+#include <net/niftable.h>
+#include <net/nethread.h>
+#include <net/requirement.h>
+#include <net/histogram.h>
+#include <net/conf.h>
+
+/*
+ * Packet latency sampling.
+ *
+ * One in 'lat_sample' received packets per worker (see fastnet_conf_t) is stamped at RX,
+ * with the pktio's timestamp, if there is one, and at the stage boundaries: IP input (L3),
+ * transport input (L4) and IP output (OUT). If the stack replies with the same packet (ICMP
+ * echo reply, SYN-ACK, ACK, RST), the sample is finished in fastnet_pkt_output(), when the
+ * reply is enqueued for transmission.
+ *
+ * The latencies (in ns) go into per-worker histograms (see <net/histogram.h>): The total one,
+ * per reply class, and one per segment between the stamps. The threads, that are not workers,
+ * share one block (see fastnet_thread_slot()), which is updated atomically.
+ *
+ * With sampling off (lat_sample=0, the default), every hook costs one predictable branch.
+ */
+
+/* fastnet_pkt_uarea_t.lat_stamp[] */
+enum {
+	FASTNET_LAT_L3,
+	FASTNET_LAT_L4,
+	FASTNET_LAT_OUT,
+};
+
+/* Histograms. */
+enum {
+	/* RX to TX, per reply class */
+	FASTNET_LAT_ICMP,
+	FASTNET_LAT_TCP_SYNACK,
+	FASTNET_LAT_TCP_RST,
+	FASTNET_LAT_TCP,
+	FASTNET_LAT_UDP,
+	FASTNET_LAT_OTHER,
+	
+	/* Segments */
+	FASTNET_LAT_RX_L3,
+	FASTNET_LAT_L3_L4,
+	FASTNET_LAT_L4_OUT,
+	FASTNET_LAT_OUT_TX,
+	
+	FASTNET_LAT_NUM_SERIES
+};
+
+typedef struct {
+	uint32_t countdown;
+	uint64_t count[FASTNET_LAT_NUM_SERIES];
+	uint64_t sum[FASTNET_LAT_NUM_SERIES];
+	uint64_t max[FASTNET_LAT_NUM_SERIES];
+	uint64_t hist[FASTNET_LAT_NUM_SERIES][FASTNET_HIST_BUCKETS];
+} ODP_ALIGNED_CACHE fastnet_lat_block_t;
+
+extern fastnet_lat_block_t fastnet_lat_blocks[FASTNET_THREAD_SLOTS];
+
+/*
+ * Slow paths of the hooks below.
+ */
+void fastnet_lat_start(odp_packet_t pkt);
+void fastnet_lat_rx_nonworker(odp_packet_t pkt);
+void fastnet_lat_output(odp_packet_t pkt);
+void fastnet_lat_finish(odp_packet_t pkt);
+uint32_t fastnet_lat_since(fastnet_pkt_uarea_t* ua);
+
+/*
+ * Called on every received packet, after fastnet_pkt_uarea_init().
+ */
+static inline
+void fastnet_lat_rx(odp_packet_t pkt){
+	fastnet_lat_block_t* b;
+	int slot;
+	if(odp_likely(!fastnet_conf.lat_sample)) return;
+	slot = fastnet_thread_slot();
+	if(odp_unlikely(slot==FASTNET_NONWORKER_SLOT)){
+		fastnet_lat_rx_nonworker(pkt);
+		return;
+	}
+	b = &fastnet_lat_blocks[slot];
+	if(odp_likely(b->countdown>1)){
+		b->countdown--;
+		return;
+	}
+	b->countdown = fastnet_conf.lat_sample;
+	fastnet_lat_start(pkt);
+}
+
+/*
+ * Stamps a stage boundary (FASTNET_LAT_L3 or FASTNET_LAT_L4), if the packet is sampled.
+ */
+static inline
+void fastnet_lat_stamp(odp_packet_t pkt,int stamp){
+	fastnet_pkt_uarea_t* ua;
+	if(odp_likely(!fastnet_conf.lat_sample)) return;
+	ua = FASTNET_PACKET_UAREA(pkt);
+	if(odp_unlikely(ua->flags & FASTNET_PKTF_LAT)) ua->lat_stamp[stamp] = fastnet_lat_since(ua);
+}
+
+/*
+ * Called at the entry of fastnet_ip_output() and fastnet_ip6_output(). Stamps FASTNET_LAT_OUT
+ * and classifies the reply by its IP header.
+ */
+static inline
+void fastnet_lat_out(odp_packet_t pkt){
+	if(odp_likely(!fastnet_conf.lat_sample)) return;
+	if(odp_unlikely(FASTNET_PACKET_UAREA(pkt)->flags & FASTNET_PKTF_LAT)) fastnet_lat_output(pkt);
+}
+
+/*
+ * Called, when a packet is enqueued for transmission.
+ */
+static inline
+void fastnet_lat_tx(odp_packet_t pkt){
+	if(odp_likely(!fastnet_conf.lat_sample)) return;
+	if(odp_unlikely(FASTNET_PACKET_UAREA(pkt)->flags & FASTNET_PKTF_LAT)) fastnet_lat_finish(pkt);
+}
+
+/*
+ * Prints one line per histogram: count, mean, p50, p99, p99.9 and maximum in ns, summed up
+ * over all workers. Histograms without samples are omitted.
+ */
+void fastnet_lat_print(FILE* f);
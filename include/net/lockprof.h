@@ -0,0 +1,186 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+#include <stdio.h>
+#include <odp_api.h>
+#include <net/config.h>
+#include <net/niftable.h>
+#include <net/nethread.h>
+#include <net/histogram.h>
+
+/*
+ * Lock contention profiling (opt-in, see NET_LOCKPROF in <net/config.h>).
+ *
+ * The locks of the stack are taken with FASTNET_SPIN_LOCK() and FASTNET_TICKET_LOCK(), which
+ * name the lock class. With NET_LOCKPROF, every worker counts per class
+ *
+ *  - the acquisitions, and the contended ones (the trylock failed),
+ *  - the cycles spent spinning on contended acquisitions,
+ *  - the cycles the lock was held (into a histogram, see <net/histogram.h>).
+ *
+ * Hold times are measured from the first lock to the last unlock of a class on a worker, so
+ * nested locks of the same class are accounted as one hold.
+ *
+ * Only workers are profiled: The threads, that are not workers, share one slot (see
+ * fastnet_thread_slot()), and would mix up their open holds.
+ *
+ * Without NET_LOCKPROF, the macros are plain odp_spinlock_*() and odp_ticketlock_*() calls.
+ */
+enum {
+	FASTNET_LOCK_SOCKET_TABLE,  /* socket_lookup.c */
+	FASTNET_LOCK_ARP_TABLE,     /* ipv4_mac_cache.c */
+	FASTNET_LOCK_ND6_BUCKET,    /* nd6_cache.c, bucket_locks */
+	FASTNET_LOCK_ND6_INSTANCE,  /* nd6_cache.c, instance_locks */
+	FASTNET_LOCK_ND6_ROUTER,    /* nd6_cache.c, list_lock */
+	FASTNET_LOCK_IPV6_NIF,      /* ipv6_nif_struct */
+	FASTNET_LOCK_TCP_PCB,       /* fastnet_tcp_pcb_t */
+	FASTNET_LOCK_SLAB,          /* fastnet_slab_t */
+	FASTNET_LOCK_NUM_CLASSES
+};
+
+typedef struct {
+	uint64_t acquired;
+	uint64_t contended;
+	uint64_t spin_cycles;
+	uint64_t spin_max;
+	uint64_t holds;       /* Nested acquisitions of a class are one hold. */
+	uint64_t hold_cycles;
+	uint64_t hold_max;
+} fastnet_lockprof_stat_t;
+
+typedef struct {
+	/* Open holds. */
+	uint32_t nest[FASTNET_LOCK_NUM_CLASSES];
+	uint64_t hold_start[FASTNET_LOCK_NUM_CLASSES];
+	
+	fastnet_lockprof_stat_t stat[FASTNET_LOCK_NUM_CLASSES];
+	uint64_t hold_hist[FASTNET_LOCK_NUM_CLASSES][FASTNET_HIST_BUCKETS];
+} ODP_ALIGNED_CACHE fastnet_lockprof_block_t;
+
+#ifdef NET_LOCKPROF
+
+/* One block per worker; the block of FASTNET_NONWORKER_SLOT stays unused. */
+extern fastnet_lockprof_block_t fastnet_lockprof_blocks[FASTNET_THREAD_SLOTS];
+
+/*
+ * 'spin' is the number of cycles spent spinning, non-0 (|1) for every contended acquisition.
+ */
+static inline
+void fastnet_lockprof_acquired(uint32_t cls,uint64_t spin){
+	int slot = fastnet_thread_slot();
+	fastnet_lockprof_block_t* b;
+	if(odp_unlikely(slot==FASTNET_NONWORKER_SLOT)) return;
+	b = &fastnet_lockprof_blocks[slot];
+	b->stat[cls].acquired++;
+	if(spin){
+		b->stat[cls].contended++;
+		b->stat[cls].spin_cycles += spin;
+		if(b->stat[cls].spin_max<spin) b->stat[cls].spin_max = spin;
+	}
+	if(!(b->nest[cls]++)) b->hold_start[cls] = odp_cpu_cycles();
+}
+
+static inline
+void fastnet_lockprof_released(uint32_t cls){
+	int slot = fastnet_thread_slot();
+	fastnet_lockprof_block_t* b;
+	uint64_t hold;
+	
+	if(odp_unlikely(slot==FASTNET_NONWORKER_SLOT)) return;
+	b = &fastnet_lockprof_blocks[slot];
+	
+	/* Unlocked by another worker, than the one, that locked it. */
+	if(odp_unlikely(!b->nest[cls])) return;
+	if(--(b->nest[cls])) return;
+	hold = odp_cpu_cycles_diff(odp_cpu_cycles(),b->hold_start[cls]);
+	b->stat[cls].holds++;
+	b->stat[cls].hold_cycles += hold;
+	if(b->stat[cls].hold_max<hold) b->stat[cls].hold_max = hold;
+	b->hold_hist[cls][fastnet_hist_bucket(hold)]++;
+}
+
+static inline
+void fastnet_lockprof_spin_lock(uint32_t cls,odp_spinlock_t* lock){
+	uint64_t start;
+	if(odp_likely(odp_spinlock_trylock(lock))){
+		fastnet_lockprof_acquired(cls,0);
+		return;
+	}
+	start = odp_cpu_cycles();
+	odp_spinlock_lock(lock);
+	fastnet_lockprof_acquired(cls,odp_cpu_cycles_diff(odp_cpu_cycles(),start)|1);
+}
+
+static inline
+void fastnet_lockprof_spin_unlock(uint32_t cls,odp_spinlock_t* lock){
+	fastnet_lockprof_released(cls);
+	odp_spinlock_unlock(lock);
+}
+
+static inline
+void fastnet_lockprof_ticket_lock(uint32_t cls,odp_ticketlock_t* lock){
+	uint64_t start;
+	if(odp_likely(odp_ticketlock_trylock(lock))){
+		fastnet_lockprof_acquired(cls,0);
+		return;
+	}
+	start = odp_cpu_cycles();
+	odp_ticketlock_lock(lock);
+	fastnet_lockprof_acquired(cls,odp_cpu_cycles_diff(odp_cpu_cycles(),start)|1);
+}
+
+static inline
+void fastnet_lockprof_ticket_unlock(uint32_t cls,odp_ticketlock_t* lock){
+	fastnet_lockprof_released(cls);
+	odp_ticketlock_unlock(lock);
+}
+
+#define FASTNET_SPIN_LOCK(cls,lock)     fastnet_lockprof_spin_lock(cls,lock)
+#define FASTNET_SPIN_UNLOCK(cls,lock)   fastnet_lockprof_spin_unlock(cls,lock)
+#define FASTNET_TICKET_LOCK(cls,lock)   fastnet_lockprof_ticket_lock(cls,lock)
+#define FASTNET_TICKET_UNLOCK(cls,lock) fastnet_lockprof_ticket_unlock(cls,lock)
+
+#else
+
+#define FASTNET_SPIN_LOCK(cls,lock)     odp_spinlock_lock(lock)
+#define FASTNET_SPIN_UNLOCK(cls,lock)   odp_spinlock_unlock(lock)
+#define FASTNET_TICKET_LOCK(cls,lock)   odp_ticketlock_lock(lock)
+#define FASTNET_TICKET_UNLOCK(cls,lock) odp_ticketlock_unlock(lock)
+
+#endif
+
+/*
+ * Sums up the counters of all workers into 'stat[FASTNET_LOCK_NUM_CLASSES]'. Zero without
+ * NET_LOCKPROF.
+ */
+void fastnet_lockprof_sum(fastnet_lockprof_stat_t* stat);
+
+/*
+ * Clears the counters. Must not be called while workers are running.
+ */
+void fastnet_lockprof_reset();
+
+/*
+ * The name of a lock class.
+ */
+const char* fastnet_lockprof_name(uint32_t cls);
+
+/*
+ * Prints one line per lock class: acquisitions, contention rate, spin and hold cycles (mean,
+ * p99 of the hold times, maximum), and the class with the most spin cycles, which is the
+ * one to look at first, when the stack does not scale. Does nothing without NET_LOCKPROF.
+ */
+void fastnet_lockprof_print(FILE* f);
@@ -0,0 +1,84 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+#include <stdio.h>
+#include <odp_api.h>
+#include <net/config.h>
+
+/*
+ * Logging.
+ *
+ * Every worker writes its messages into a ring of its own (single-producer/single-consumer),
+ * without locks. A background thread drains the rings (see fastnet_log_start()). If a ring
+ * is full, the message is dropped and counted.
+ *
+ * Every log statement is rate limited, per worker: At most NET_LOG_BURST messages per
+ * second. The number of suppressed messages is reported with the next message, that passes.
+ *
+ * Levels above NET_LOG_MAX (see <net/config.h>) are compiled out. The other ones cost one
+ * predictable branch, if they are above the runtime level 'fastnet_log_level'.
+ */
+
+#define NET_LOG_ERROR 1
+#define NET_LOG_WARN  2
+#define NET_LOG_INFO  3
+#define NET_LOG_DEBUG 4
+
+#define NET_LOG_BURST 10
+
+/* Maximum length of a message, including the terminating 0. */
+#define NET_LOG_MSG_SZ 112
+
+typedef struct {
+	uint64_t window;     /* start of the current 1-second window (ns) */
+	uint32_t count;      /* messages in the current window */
+	uint32_t suppressed; /* messages suppressed since the last one, that passed */
+} fastnet_log_site_t;
+
+/* Runtime log level, defaults to NET_LOG_MAX. */
+extern int fastnet_log_level;
+
+void fastnet_log_emit(fastnet_log_site_t* site,int level,const char* fmt,...) __attribute__((format(printf,3,4)));
+
+#define NET_LOGL(level,...) do{ \
+	if(odp_unlikely((level)<=NET_LOG_MAX && (level)<=fastnet_log_level)){ \
+		static __thread fastnet_log_site_t _net_log_site; \
+		fastnet_log_emit(&_net_log_site,(level),__VA_ARGS__); \
+	} }while(0)
+
+#define NET_LOG_ERR(...)  NET_LOGL(NET_LOG_ERROR,__VA_ARGS__)
+#define NET_LOG_WRN(...)  NET_LOGL(NET_LOG_WARN,__VA_ARGS__)
+#define NET_LOG_INF(...)  NET_LOGL(NET_LOG_INFO,__VA_ARGS__)
+#define NET_LOG_DBG(...)  NET_LOGL(NET_LOG_DEBUG,__VA_ARGS__)
+
+/* Datapath trace messages. */
+#define NET_LOG(...)      NET_LOG_DBG(__VA_ARGS__)
+
+/*
+ * Writes all pending messages to 'f'. Called by the background thread, or by the main
+ * thread, if there is none.
+ *
+ * Returns the number of messages written.
+ */
+int fastnet_log_drain(FILE* f);
+
+/*
+ * Starts a background thread, that drains the rings into 'f' every 'interval_ms'
+ * milliseconds (see src/net_linux/log_drain.c).
+ *
+ * Returns 0 on success, non-0 on failure.
+ */
+int fastnet_log_start(FILE* f,uint32_t interval_ms);
@@ -0,0 +1,82 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+#include <odp_api.h>
+#include <net/nif.h>
+#include <net/niftable.h>
+
+/*
+ * In-memory devices.
+ *
+ * fastnet_openpktio(table,"mem:N") opens a device without a network: N (0-65535) selects
+ * the MAC address 02:00:00:00:NN:NN. Like a NIC opened by fastnet_openpktio(), the device has
+ *
+ *  - one scheduled receive queue per worker. Frames are injected into them, and the workers
+ *    take them from the scheduler (fastnet_eventlist()), as if the pktio had received them.
+ *    fastnet_mem_inject() selects the queue by a hash over the addresses and ports, like RSS.
+ *  - min(workers, out_queues) transmit queues. What the stack transmits stays there, until
+ *    it is taken out with fastnet_mem_capture().
+ *
+ * There is no checksum offload (see fastnet_nif_offload_emulate()).
+ */
+
+/*
+ * Opens an in-memory device. Called by fastnet_openpktio() for names starting with "mem:".
+ *
+ * Returns the NIF, 0 on failure.
+ */
+nif_t* fastnet_mem_open(nif_table_t* table,const char* dev);
+
+/*
+ * Returns non-0, if 'nif' is an in-memory device.
+ */
+int fastnet_mem_is(nif_t* nif);
+
+/*
+ * The number of receive queues of an in-memory device.
+ */
+int fastnet_mem_rx_queues(nif_t* nif);
+
+/*
+ * Injects an Ethernet frame into the receive queue selected by the hash. The packet's offsets
+ * and flags are set, as the pktio's parser would. The packet is owned by the stack on success.
+ *
+ * Returns 0 on success, non-0 on failure.
+ */
+int fastnet_mem_inject(nif_t* nif,odp_packet_t pkt);
+
+/*
+ * Like fastnet_mem_inject(), into receive queue 'queue'.
+ */
+int fastnet_mem_inject_queue(nif_t* nif,odp_packet_t pkt,int queue);
+
+/*
+ * Copies 'len' octets into a packet of the input pool, and injects it.
+ *
+ * Returns 0 on success, non-0 on failure.
+ */
+int fastnet_mem_inject_frame(nif_t* nif,const void* data,uint32_t len);
+
+/*
+ * Takes up to 'num' transmitted packets out of the transmit queues, and returns their number.
+ * The packets are owned by the caller. Packets from the same transmit queue keep their order.
+ */
+int fastnet_mem_capture(nif_t* nif,odp_packet_t* pkts,int num);
+
+/*
+ * Frees all transmitted packets, and returns their number.
+ */
+uint64_t fastnet_mem_discard(nif_t* nif);
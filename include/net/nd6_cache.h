@@ -126,6 +126,15 @@ enum {
 
 void fastnet_nd6_cache_init();
 
+/*
+ * Sets the link-layer address of an entry. Invalidates cached Ethernet headers, if it changes.
+ */
+static inline
+void fastnet_nd6_nce_set_hwaddr(nd6_nce_t* ptr,uint64_t hwaddr){
+	if(ptr->hwaddr != hwaddr) fastnet_neigh_gen_bump();
+	ptr->hwaddr = hwaddr;
+}
+
 nd6_nce_handle_t fastnet_nd6_nce_alloc();
 
 void fastnet_nd6_nce_grab(nd6_nce_handle_t handle);
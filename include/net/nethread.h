@@ -14,5 +14,42 @@
  *   limitations under the License.
  */
 #pragma once
+#include <net/niftable.h>
 
-int fastnet_eventlist(void *arg);
\ No newline at end of file
+int fastnet_eventlist(void *arg);
+
+/*
+ * Index of the calling worker thread (0 ... workers-1).
+ *
+ * Threads, that never entered fastnet_eventlist(), share the index 0.
+ */
+extern __thread int fastnet_worker_idx;
+
+static inline
+int fastnet_worker_id(){
+	return fastnet_worker_idx;
+}
+
+/*
+ * Slot of the calling thread in per-thread arrays of FASTNET_THREAD_SLOTS entries: the worker
+ * index for workers, FASTNET_NONWORKER_SLOT for all other threads. As those share their slot,
+ * data in it must be updated atomically or under a lock.
+ */
+#define FASTNET_NONWORKER_SLOT NET_MAXTHREAD
+#define FASTNET_THREAD_SLOTS   (NET_MAXTHREAD+1)
+
+extern __thread int fastnet_thread_slot_idx;
+
+static inline
+int fastnet_thread_slot(){
+	return fastnet_thread_slot_idx;
+}
+
+/*
+ * Makes the calling thread the worker 'idx'.
+ */
+static inline
+void fastnet_worker_enter(int idx){
+	fastnet_worker_idx      = idx;
+	fastnet_thread_slot_idx = idx;
+}
@@ -18,9 +18,26 @@
 #include <odp_api.h>
 #include <net/header/ip.h>
 
+/*
+ * Transmit: The NIC inserts the checksum.
+ */
 #define NIFOFL_TCP_CKSUM  1
 #define NIFOFL_UDP_CKSUM  2
 #define NIFOFL_IP4_CKSUM  4
+#define NIFOFL_TX_MASK    7
+
+/*
+ * Receive: The NIC validates the checksum (see odp_packet_has_l3_error() and odp_packet_has_l4_error()).
+ */
+#define NIFOFL_RX_TCP_CKSUM  8
+#define NIFOFL_RX_UDP_CKSUM  16
+#define NIFOFL_RX_IP4_CKSUM  32
+#define NIFOFL_RX_MASK       56
+
+/*
+ * The transmit checksum offload is emulated in software, right before the packet is enqueued.
+ */
+#define NIFOFL_EMULATED   0x100
 
 
 #define NET_NIF_MAX_QUEUE 128
@@ -35,6 +52,9 @@ typedef struct _nif_t {
 	
 	int num_queues;
 	
+	/* Index in the NIF table (used in socket keys). */
+	uint16_t    ifindex;
+	
 	uint32_t    offload_flags;
 	
 	uint64_t    hwaddr;
@@ -42,4 +62,20 @@ typedef struct _nif_t {
 	struct ipv6_nif_struct *ipv6;
 } nif_t;
 
+/*
+ * Generation number of the neighbor caches (ARP and ND6). It is incremented, whenever a
+ * cached hardware address changes or an entry is removed, so that a copy of an Ethernet
+ * header can be validated with a single load.
+ */
+extern odp_atomic_u32_t fastnet_neigh_generation;
+
+static inline
+uint32_t fastnet_neigh_gen(){
+	return odp_atomic_load_u32(&fastnet_neigh_generation);
+}
+
+static inline
+void fastnet_neigh_gen_bump(){
+	odp_atomic_inc_u32(&fastnet_neigh_generation);
+}
 
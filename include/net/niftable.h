@@ -27,6 +27,9 @@ typedef struct {
 	odp_cpumask_t  cpumask;
 	int            workers;
 	odp_instance_t instance;
+	
+	/* Hands out the worker indices. */
+	odp_atomic_u32_t worker_seq;
 } nif_table_t;
 
 void fastnet_tlp_init();
@@ -36,11 +39,29 @@ int fastnet_pools_init(uint32_t pktsize,uint32_t pktnum,uint32_t poutsize,uint32
 int fastnet_niftable_prepare(nif_table_t* table,odp_instance_t instance);
 
 /*
- * Opens a device to include into the given NIF-TABLE.
+ * Opens a device to include into the given NIF-TABLE. "mem:N" opens an in-memory device
+ * (see <net/mem_pktio.h>).
  *
  * Returns non-0 on success, 0 on failure.
  */
 nif_t* fastnet_openpktio(nif_table_t* table,const char* dev);
 
+/*
+ * Replaces the checksum offload of a device with a software emulation, that computes the checksums
+ * right before the packet is enqueued (see NIFOFL_EMULATED).
+ *
+ * This is meant to verify, that the stack leaves the packets in a state, from where a NIC can insert the checksums.
+ */
+void fastnet_nif_offload_emulate(nif_t* nif);
+
 
 void fastnet_runthreads(nif_table_t* table);
+
+/*
+ * Runs 'start(arg)' on 'workers' threads (at most table->workers), and waits for them. The
+ * threads are pinned onto the first 'workers' CPUs of table->cpumask, like the workers of
+ * fastnet_runthreads(), so runs with the same number of workers use the same CPUs.
+ *
+ * table->worker_seq is reset, so the threads can take their index from it.
+ */
+void fastnet_runworkers(nif_table_t* table,int workers,int (*start)(void*),void* arg);
@@ -0,0 +1,111 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+#include <odp_api.h>
+
+/*
+ * NUMA awareness.
+ *
+ * ODP has no notion of NUMA nodes, so the memory of a pool is placed by the kernel's
+ * first-touch policy: the pools of a node are created by a thread, that has been
+ * temporarily pinned onto the CPUs of that node.
+ */
+
+#define NET_MAXNODES 8
+
+/* ---------------- Topology (see src/net_linux/numa.c) ---------------- */
+
+/*
+ * Returns the number of NUMA nodes (at least 1, at most NET_MAXNODES).
+ */
+int fastnet_numa_num_nodes();
+
+/*
+ * Returns the NUMA node of a CPU, 0 if unknown.
+ */
+int fastnet_numa_cpu_node(int cpu);
+
+/*
+ * Returns the NUMA node of a network device, 0 if unknown.
+ */
+int fastnet_numa_dev_node(const char* dev);
+
+/*
+ * Pins the calling thread onto the CPUs of 'node', until fastnet_numa_leave() is called.
+ * Not reentrant, only meant to be used during initialization.
+ */
+void fastnet_numa_enter(int node);
+void fastnet_numa_leave();
+
+/* ---------------- Per-thread node ---------------- */
+
+extern __thread int fastnet_numa_node_idx;
+
+/*
+ * Returns the NUMA node of the calling thread.
+ */
+static inline
+int fastnet_numa_node(){
+	return fastnet_numa_node_idx;
+}
+
+/*
+ * Determines the NUMA node of the calling thread. The thread must be pinned onto one CPU.
+ */
+void fastnet_numa_thread_init();
+
+/* ---------------- Per-node pools ---------------- */
+
+typedef struct {
+	odp_pool_t pool[NET_MAXNODES];
+} fastnet_numa_pool_t;
+
+/*
+ * Creates one pool per NUMA node. The number of elements is divided among the nodes.
+ *
+ * The pool of node 0 is named 'name', the others 'name.<node>'.
+ *
+ * Returns non-0 on success, 0 on failure.
+ */
+int fastnet_numa_pool_create(fastnet_numa_pool_t* pools,const char* name,odp_pool_param_t* params);
+
+/*
+ * Allocates from the pool of the calling thread's node. If it is exhausted, the pools of the
+ * other nodes are tried.
+ */
+odp_buffer_t fastnet_numa_buffer_alloc(fastnet_numa_pool_t* pools);
+odp_packet_t fastnet_numa_packet_alloc(fastnet_numa_pool_t* pools,uint32_t len);
+
+/*
+ * Returns the pool of the calling thread's node.
+ */
+static inline
+odp_pool_t fastnet_numa_local_pool(fastnet_numa_pool_t* pools){
+	return pools->pool[fastnet_numa_node()];
+}
+
+/* ---------------- Statistics ---------------- */
+
+/*
+ * Counts allocations served from the local node, and from a remote node.
+ */
+void fastnet_numa_count(uint64_t local,uint64_t remote);
+
+/*
+ * Sums up the counters of all threads.
+ */
+void fastnet_numa_stats(uint64_t* local,uint64_t* remote);
+
@@ -16,6 +16,19 @@
 #pragma once
 #include <net/nif.h>
 #include <net/types.h>
+#include <net/header/layer4.h>
+
+/*
+ * Sets the protocol flags, a NIC needs for the checksum offload (odp_packet_has_ipv4() etc.).
+ * The stack builds packets without them, or reuses received ones, whose flags are outdated.
+ */
+static inline
+void fastnet_pkt_set_l3l4(odp_packet_t pkt,int is_ipv6,uint8_t prot){
+	odp_packet_has_ipv4_set(pkt,!is_ipv6);
+	odp_packet_has_ipv6_set(pkt,is_ipv6);
+	odp_packet_has_tcp_set(pkt,prot==IP_PROTOCOL_TCP);
+	odp_packet_has_udp_set(pkt,prot==IP_PROTOCOL_UDP);
+}
 
 netpp_retcode_t fastnet_pkt_output(odp_packet_t pkt,nif_t *dest);
 
@@ -0,0 +1,118 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+#include <odp_api.h>
+#include <net/requirement.h>
+#include <net/numa.h>
+
+/*
+ * Per-thread allocation context.
+ *
+ * The pool handles are resolved once, when the pools are created, instead of calling
+ * odp_pool_lookup() on every allocation. Every thread keeps a small cache of packets
+ * from the output pool, which is refilled with odp_packet_alloc_multi().
+ *
+ * The context is bound to the pools of the thread's NUMA node, on first use.
+ */
+
+/* Number of packets cached per thread. */
+#define FASTNET_PKTCACHE_SZ    32
+
+/* Number of packets allocated at once, when the cache is empty. */
+#define FASTNET_PKTCACHE_BURST 16
+
+/* Length the cached packets are allocated with. */
+#define FASTNET_PKTCACHE_LEN   128
+
+typedef struct {
+	odp_pool_t   pktin;
+	odp_pool_t   pktout;
+	int          ready;
+	int          num;
+	odp_packet_t cache[FASTNET_PKTCACHE_SZ];
+} fastnet_alloc_ctx_t;
+
+extern __thread fastnet_alloc_ctx_t fastnet_alloc_ctx;
+
+/*
+ * Registers the pools created by fastnet_pools_init().
+ */
+void fastnet_alloc_set_pools(fastnet_numa_pool_t* pktin,fastnet_numa_pool_t* pktout);
+
+/*
+ * Returns the input pool of the given NUMA node.
+ */
+odp_pool_t fastnet_pool_pktin_node(int node);
+
+/*
+ * Slow paths of fastnet_pktout_alloc() and fastnet_pktout_free().
+ */
+odp_packet_t fastnet_pktout_refill(uint32_t len);
+void fastnet_alloc_ctx_init();
+
+/*
+ * Returns all cached packets to the pool, and the thread's slab magazines to their slabs
+ * (see fastnet_slab_flush_all_thread()). Should be called, before a thread exits.
+ */
+void fastnet_alloc_flush();
+
+static inline
+odp_pool_t fastnet_pool_pktin(){
+	if(odp_unlikely(!fastnet_alloc_ctx.ready)) fastnet_alloc_ctx_init();
+	return fastnet_alloc_ctx.pktin;
+}
+
+static inline
+odp_pool_t fastnet_pool_pktout(){
+	if(odp_unlikely(!fastnet_alloc_ctx.ready)) fastnet_alloc_ctx_init();
+	return fastnet_alloc_ctx.pktout;
+}
+
+/*
+ * Allocates a packet of 'len' bytes from the output pool.
+ * The user area is initialized (see fastnet_pkt_uarea_init()).
+ */
+static inline
+odp_packet_t fastnet_pktout_alloc(uint32_t len){
+	fastnet_alloc_ctx_t* ctx = &fastnet_alloc_ctx;
+	odp_packet_t pkt;
+	
+	if(odp_likely(ctx->num>0)){
+		pkt = ctx->cache[--(ctx->num)];
+		if(odp_likely(odp_packet_reset(pkt,len)==0)){
+			fastnet_pkt_uarea_init(pkt);
+			return pkt;
+		}
+		/* Too long for this packet. */
+		odp_packet_free(pkt);
+	}
+	return fastnet_pktout_refill(len);
+}
+
+/*
+ * Frees a packet. Packets from the output pool go to the cache of the calling thread.
+ */
+static inline
+void fastnet_pktout_free(odp_packet_t pkt){
+	fastnet_alloc_ctx_t* ctx = &fastnet_alloc_ctx;
+	
+	if(odp_likely(ctx->ready && ctx->num<FASTNET_PKTCACHE_SZ && odp_packet_pool(pkt)==ctx->pktout)){
+		ctx->cache[(ctx->num)++] = pkt;
+		return;
+	}
+	odp_packet_free(pkt);
+}
+
@@ -0,0 +1,69 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+#include <odp_api.h>
+#include <net/nif.h>
+#include <net/header/ip.h>
+#include <net/header/ip6.h>
+
+/*
+ * Path MTU cache (RFC 1191, RFC 8201).
+ *
+ * The cache holds the path MTU of destinations, that have been reported by ICMP "fragmentation
+ * needed" or ICMPv6 "packet too big". It is a hash table of 'pmtu_buckets' buckets with two
+ * entries each (see fastnet_conf_t), shared by all workers and lock-free: Every entry has a
+ * sequence number, that is odd while the entry is written. A reader retries, if it changed
+ * meanwhile; a writer, that finds it odd, drops its update (the next ICMP message repeats it).
+ *
+ * An entry expires after 'pmtu_expire' seconds, so the path MTU is raised again, should the
+ * path have changed (RFC 1191 6.3). A destination without an entry has the link MTU.
+ */
+
+/* The link MTU of IPv4 interfaces, that don't set ipv4_nif_struct.mtu (Ethernet). */
+#define FASTNET_PMTU_DEFAULT4 1500
+
+/* The link MTU of IPv6 interfaces, unless lowered by a Router Advertisement (Ethernet, RFC 2464). */
+#define FASTNET_PMTU_DEFAULT6 1500
+
+/* Reported path MTUs are raised to this (RFC 791: Every host must accept 576 byte datagrams). */
+#define FASTNET_PMTU_MIN4     576
+
+void fastnet_pmtu_init();
+
+/*
+ * Returns the cached path MTU towards 'dst', 0 if there is none.
+ */
+uint32_t fastnet_pmtu_lookup4(ipv4_addr_t dst);
+uint32_t fastnet_pmtu_lookup6(const ipv6_addr_t* dst);
+
+/*
+ * Lowers the path MTU towards 'dst' to 'mtu'. A cached path MTU is never raised (RFC 1191 6.3,
+ * RFC 8201 4), except by the expiry of the entry.
+ */
+void fastnet_pmtu_update4(ipv4_addr_t dst,uint32_t mtu);
+void fastnet_pmtu_update6(const ipv6_addr_t* dst,uint32_t mtu);
+
+/*
+ * Returns the link MTU of 'nif'. 'nif' may be NULL, then the default link MTU is assumed.
+ */
+uint32_t fastnet_link_mtu4(nif_t* nif);
+uint32_t fastnet_link_mtu6(nif_t* nif);
+
+/*
+ * Returns the path MTU towards 'dst': The cached one, limited by the link MTU of 'nif'.
+ */
+uint32_t fastnet_pmtu4(nif_t* nif,ipv4_addr_t dst);
+uint32_t fastnet_pmtu6(nif_t* nif,const ipv6_addr_t* dst);
@@ -0,0 +1,166 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+#include <stdio.h>
+#include <odp_api.h>
+#include <net/config.h>
+#include <net/niftable.h>
+#include <net/nethread.h>
+#include <net/header/layer4.h>
+#include <net/histogram.h>
+
+/*
+ * Cycle accounting of the input and output chain (opt-in, see NET_PROF in <net/config.h>).
+ *
+ * The stages are bracketed with FASTNET_PROF_BEGIN() and FASTNET_PROF_END(), which read
+ * odp_cpu_cycles(). Stages nest: Every worker keeps a stack of the open stages, and accounts
+ *
+ *  - the inclusive cycles of every stage into a histogram (see <net/histogram.h>),
+ *  - the exclusive cycles into a table of folded stacks, like "ip_input;tcp_input;tcp_process".
+ *
+ * The root of every stack is the protocol path (ip_input, ip6_input, arp_input, or
+ * flowdir_input for packets forwarded by the flow director). The folded stacks are the
+ * input format of flamegraph.pl.
+ *
+ * Only workers are profiled: The threads, that are not workers, share one slot (see
+ * fastnet_thread_slot()), and would mix up their stacks.
+ *
+ * Without NET_PROF, the macros expand to nothing.
+ */
+enum {
+	FASTNET_PROF_IP_INPUT,
+	FASTNET_PROF_IP6_INPUT,
+	FASTNET_PROF_ARP_INPUT,
+	FASTNET_PROF_FLOWDIR_INPUT,
+	FASTNET_PROF_CKSUM,
+	FASTNET_PROF_TCP_INPUT,
+	FASTNET_PROF_UDP_INPUT,
+	FASTNET_PROF_ICMP_INPUT,
+	FASTNET_PROF_L4_OTHER,
+	FASTNET_PROF_FLOWDIR_STEER,
+	FASTNET_PROF_SOCKET_LOOKUP,
+	FASTNET_PROF_TCP_PROCESS,
+	FASTNET_PROF_IP_OUTPUT,
+	FASTNET_PROF_IP6_OUTPUT,
+	FASTNET_PROF_NEIGH_LOOKUP,
+	FASTNET_PROF_QUEUE_ENQ,
+	FASTNET_PROF_NUM_STAGES
+};
+
+/* A stack is stored in a 64-bit word, 5 bits per stage. */
+#define FASTNET_PROF_STAGE_BITS 5
+#define FASTNET_PROF_MAX_DEPTH  12
+
+/* Folded stacks per worker. Must be power of 2 */
+#define FASTNET_PROF_FOLDED     0x100
+
+typedef struct {
+	uint64_t stack;
+	uint64_t cycles;
+	uint64_t count;
+} fastnet_prof_folded_t;
+
+typedef struct {
+	/* The open stages. */
+	uint64_t stack;
+	uint32_t depth;
+	uint64_t start[FASTNET_PROF_MAX_DEPTH];
+	uint64_t child[FASTNET_PROF_MAX_DEPTH]; /* cycles spent in nested stages */
+	
+	uint64_t count[FASTNET_PROF_NUM_STAGES];
+	uint64_t sum[FASTNET_PROF_NUM_STAGES];
+	uint64_t max[FASTNET_PROF_NUM_STAGES];
+	uint64_t hist[FASTNET_PROF_NUM_STAGES][FASTNET_HIST_BUCKETS];
+	
+	fastnet_prof_folded_t folded[FASTNET_PROF_FOLDED];
+} ODP_ALIGNED_CACHE fastnet_prof_block_t;
+
+#ifdef NET_PROF
+
+/* One block per worker; the block of FASTNET_NONWORKER_SLOT stays unused. */
+extern fastnet_prof_block_t fastnet_prof_blocks[FASTNET_THREAD_SLOTS];
+
+/*
+ * Accounts a finished stage. 'stack' includes the stage itself.
+ */
+void fastnet_prof_account(fastnet_prof_block_t* b,uint64_t stack,uint32_t stage,uint64_t cycles,uint64_t self);
+
+static inline
+void fastnet_prof_begin(uint32_t stage){
+	int slot = fastnet_thread_slot();
+	fastnet_prof_block_t* b;
+	uint32_t d;
+	if(odp_unlikely(slot==FASTNET_NONWORKER_SLOT)) return;
+	b = &fastnet_prof_blocks[slot];
+	d = b->depth++;
+	if(odp_unlikely(d>=FASTNET_PROF_MAX_DEPTH)) return;
+	b->stack    = (b->stack<<FASTNET_PROF_STAGE_BITS) | (stage+1);
+	b->child[d] = 0;
+	b->start[d] = odp_cpu_cycles();
+}
+
+static inline
+void fastnet_prof_end(){
+	uint64_t now = odp_cpu_cycles();
+	int slot = fastnet_thread_slot();
+	fastnet_prof_block_t* b;
+	uint64_t cycles;
+	uint32_t d;
+	if(odp_unlikely(slot==FASTNET_NONWORKER_SLOT)) return;
+	b = &fastnet_prof_blocks[slot];
+	d = --(b->depth);
+	if(odp_unlikely(d>=FASTNET_PROF_MAX_DEPTH)) return;
+	cycles = odp_cpu_cycles_diff(now,b->start[d]);
+	fastnet_prof_account(b,b->stack,(b->stack&((1<<FASTNET_PROF_STAGE_BITS)-1))-1,cycles,cycles-b->child[d]);
+	b->stack >>= FASTNET_PROF_STAGE_BITS;
+	if(d>0) b->child[d-1] += cycles;
+}
+
+#define FASTNET_PROF_BEGIN(stage) fastnet_prof_begin(stage)
+#define FASTNET_PROF_END()        fastnet_prof_end()
+
+#else
+
+#define FASTNET_PROF_BEGIN(stage) do{}while(0)
+#define FASTNET_PROF_END()        do{}while(0)
+
+#endif
+
+/*
+ * The stage of a transport protocol.
+ */
+static inline
+uint32_t fastnet_prof_l4_stage(int protocol){
+	switch(protocol){
+	case IP_PROTOCOL_TCP:   return FASTNET_PROF_TCP_INPUT;
+	case IP_PROTOCOL_UDP:   return FASTNET_PROF_UDP_INPUT;
+	case IP_PROTOCOL_ICMP:
+	case IP_PROTOCOL_ICMP6: return FASTNET_PROF_ICMP_INPUT;
+	}
+	return FASTNET_PROF_L4_OTHER;
+}
+
+/*
+ * Prints one line per stage: count, mean, percentiles (p50, p90, p99, p99.9) and maximum
+ * of the inclusive cycles, summed up over all workers. Does nothing without NET_PROF.
+ */
+void fastnet_prof_print(FILE* f);
+
+/*
+ * Prints the folded stacks with their exclusive cycles, one "stack cycles" pair per line,
+ * summed up over all workers. Does nothing without NET_PROF.
+ */
+void fastnet_prof_folded(FILE* f);
@@ -14,12 +14,63 @@
  *   limitations under the License.
  */
 #pragma once
+#include <net/socket_key.h>
+
+/* Number of stage timestamps of a latency sample. */
+#define FASTNET_LAT_STAMPS 3
 
 typedef union{
 	struct{
 		odp_packet_t next;
+		
+		/*
+		 * Cached partial checksum of the payload (folded, not complemented), and the number of
+		 * payload bytes it covers, which are the last bytes of the packet.
+		 * Valid if (flags & FASTNET_PKTF_PSUM), see fastnet_pkt_psum_clear().
+		 */
+		uint32_t     psum_len;
+		uint16_t     psum;
+		
+		uint16_t     flags;
+		
+		/*
+		 * Socket key of a TCP or UDP packet, and its hash, stored by the IP input.
+		 * Valid if (flags & FASTNET_PKTF_KEY).
+		 */
+		uint32_t     key_hash;
+		socket_key_t key;
+		
+		/*
+		 * Latency sample (see <net/latency.h>): The stage timestamps (ns after lat_rx), the
+		 * reply class, and the RX timestamp (ns). Valid if (flags & FASTNET_PKTF_LAT).
+		 */
+		uint32_t     lat_stamp[FASTNET_LAT_STAMPS];
+		uint8_t      lat_class;
+		uint64_t     lat_rx;
 	};
 } fastnet_pkt_uarea_t;
 
 #define FASTNET_PACKET_UAREA(pkt) ((fastnet_pkt_uarea_t*)odp_packet_user_area(pkt))
 
+/* fastnet_pkt_uarea_t.flags */
+#define FASTNET_PKTF_PSUM 1
+#define FASTNET_PKTF_KEY  2
+#define FASTNET_PKTF_LAT  4
+
+/*
+ * The user area is not initialized by ODP. This must be called on every packet entering the stack.
+ */
+static inline
+void fastnet_pkt_uarea_init(odp_packet_t pkt){
+	FASTNET_PACKET_UAREA(pkt)->flags = 0;
+}
+
+/*
+ * Invalidates the cached partial checksum of the payload. This must be called, after the payload
+ * of a packet has been modified, or its tail has been extended or truncated.
+ */
+static inline
+void fastnet_pkt_psum_clear(odp_packet_t pkt){
+	FASTNET_PACKET_UAREA(pkt)->flags &= ~FASTNET_PKTF_PSUM;
+}
+
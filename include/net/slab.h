@@ -0,0 +1,148 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+#include <odp_api.h>
+
+/*
+ * Slab allocator on top of ODP pools.
+ *
+ * An ODP pool has a fixed size. The slab starts with one small pool (a chunk) per NUMA
+ * node, and adds chunks on demand, up to a limit. A chunk, whose elements are all free,
+ * is destroyed again, if the remaining chunks have enough free elements (reclaim).
+ *
+ * Every thread has a magazine per slab, from which it allocates and to which it frees
+ * without any locking. The chunks are only touched, when a magazine runs empty (refill),
+ * or exceeds its high watermark (flush).
+ *
+ * The elements are regular ODP buffers or packets, so they can be passed around as events.
+ * They must be freed with fastnet_slab_*_free(), not with odp_*_free().
+ */
+
+#define FASTNET_SLAB_MAX         16
+#define FASTNET_SLAB_MAX_CHUNKS  256
+
+/* Magazine size, and the number of elements moved at once on refill and flush. */
+#define FASTNET_MAG_SZ           64
+#define FASTNET_MAG_BATCH        32
+
+typedef struct {
+	odp_pool_t       pool;
+	odp_atomic_u32_t used;     /* Number of elements out of the pool (incl. magazines). */
+	uint32_t         capacity;
+	int              node;
+} fastnet_slab_chunk_t;
+
+typedef struct {
+	const char*      name;
+	odp_pool_param_t params;
+	int              id;
+	uint32_t         chunk_num;   /* Elements per chunk. */
+	uint32_t         max_chunks;
+	uint32_t         seq;         /* For unique pool names. */
+	
+	odp_spinlock_t   lock;        /* Protects growth, refill and reclaim. */
+	odp_atomic_u32_t nchunks;
+	
+	fastnet_slab_chunk_t chunks[FASTNET_SLAB_MAX_CHUNKS];
+} fastnet_slab_t;
+
+typedef struct {
+	uint32_t    num;
+	odp_event_t items[FASTNET_MAG_SZ];
+} fastnet_magazine_t;
+
+extern __thread fastnet_magazine_t fastnet_magazines[FASTNET_SLAB_MAX];
+
+/*
+ * Initializes a slab of ODP_POOL_BUFFER or ODP_POOL_PACKET elements, with up to 'limit'
+ * elements, in chunks of 'chunk_num' elements.
+ *
+ * Returns non-0 on success, 0 on failure.
+ */
+int fastnet_slab_init(fastnet_slab_t* slab,const char* name,odp_pool_param_t* params,uint32_t chunk_num,uint32_t limit);
+
+/*
+ * Slow paths.
+ */
+odp_event_t fastnet_slab_refill(fastnet_slab_t* slab);
+void fastnet_slab_flush(fastnet_slab_t* slab,uint32_t keep);
+
+/*
+ * Returns the thread's magazine of the slab to the chunks.
+ */
+static inline
+void fastnet_slab_flush_thread(fastnet_slab_t* slab){
+	fastnet_slab_flush(slab,0);
+}
+
+/*
+ * Returns the thread's magazines of all slabs to the chunks. Called by fastnet_alloc_flush(),
+ * before a thread exits; otherwise, the elements in the magazines keep their chunks in use.
+ */
+void fastnet_slab_flush_all_thread();
+
+/*
+ * Statistics: number of chunks, total capacity and elements in use (incl. magazines).
+ */
+void fastnet_slab_stats(fastnet_slab_t* slab,uint32_t* chunks,uint64_t* capacity,uint64_t* used);
+
+static inline
+odp_event_t fastnet_slab_alloc_ev(fastnet_slab_t* slab){
+	fastnet_magazine_t* mag = &fastnet_magazines[slab->id];
+	if(odp_likely(mag->num>0)) return mag->items[--(mag->num)];
+	return fastnet_slab_refill(slab);
+}
+
+static inline
+void fastnet_slab_free_ev(fastnet_slab_t* slab,odp_event_t ev){
+	fastnet_magazine_t* mag = &fastnet_magazines[slab->id];
+	if(odp_unlikely(mag->num>=FASTNET_MAG_SZ)) fastnet_slab_flush(slab,FASTNET_MAG_SZ-FASTNET_MAG_BATCH);
+	mag->items[(mag->num)++] = ev;
+}
+
+static inline
+odp_buffer_t fastnet_slab_buffer_alloc(fastnet_slab_t* slab){
+	odp_event_t ev = fastnet_slab_alloc_ev(slab);
+	if(odp_unlikely(ev==ODP_EVENT_INVALID)) return ODP_BUFFER_INVALID;
+	return odp_buffer_from_event(ev);
+}
+
+static inline
+void fastnet_slab_buffer_free(fastnet_slab_t* slab,odp_buffer_t buf){
+	fastnet_slab_free_ev(slab,odp_buffer_to_event(buf));
+}
+
+/*
+ * Packets are reset to the length given in the slab's parameters.
+ */
+static inline
+odp_packet_t fastnet_slab_packet_alloc(fastnet_slab_t* slab){
+	odp_packet_t pkt;
+	odp_event_t ev = fastnet_slab_alloc_ev(slab);
+	if(odp_unlikely(ev==ODP_EVENT_INVALID)) return ODP_PACKET_INVALID;
+	pkt = odp_packet_from_event(ev);
+	if(odp_unlikely(odp_packet_reset(pkt,slab->params.pkt.len))){
+		fastnet_slab_free_ev(slab,ev);
+		return ODP_PACKET_INVALID;
+	}
+	return pkt;
+}
+
+static inline
+void fastnet_slab_packet_free(fastnet_slab_t* slab,odp_packet_t pkt){
+	fastnet_slab_free_ev(slab,odp_packet_to_event(pkt));
+}
+
@@ -16,31 +16,92 @@
 #pragma once
 #include <net/nif.h>
 #include <net/types.h>
+#include <net/header/ip.h>
 #include <net/header/ip6.h>
+#include <net/header/iphdr.h>
+#include <net/header/ip6hdr.h>
+#include <net/slab.h>
 
-typedef struct {
-	ipv6_addr_t src_ip, dst_ip;
+/*
+ * Socket keys.
+ *
+ * IPv4 and IPv6 sockets have keys of their own, and are kept in separate tables. Both keys
+ * begin with the same 8 bytes, so the version can be read through either one. They have no
+ * padding, and are hashed and compared as 64-bit words: The IPv4 key is 16 bytes (one
+ * 128-bit compare), the IPv6 key is 40 bytes.
+ *
+ * Listening sockets have src_ip and src_port set to 0, and layer3_version set to 0x4 or 0x6.
+ * Sockets listening on any address of both versions (IN_ANY) have layer3_version 0, and use
+ * the IPv6 key with all addresses set to 0.
+ */
+/*
+ * The ifindex of packets without a nif. 0 is the first NIF table entry.
+ */
+#define SOCKET_KEY_NO_IFINDEX 0xffff
+
+#define SOCKET_KEY_HEAD \
+	uint8_t  layer3_version; /* 0x44 = IPv4; 0x66 = IPv6 */ \
+	uint8_t  layer4_version; /* next_header or protocol-id */ \
+	uint16_t ifindex;        /* nif_t.ifindex */ \
 	uint16_t src_port,dst_port;
-	nif_t * nif;
-	uint8_t layer3_version; /* 0x44 = IPv4; 0x66 = IPv6 */
-	uint8_t layer4_version; /* next_header or protocol-id */
+
+typedef union {
+	struct {
+		SOCKET_KEY_HEAD
+		ipv4_addr_t src_ip, dst_ip;
+	};
+	uint64_t w[2];
+} socket_key4_t;
+
+typedef union {
+	struct {
+		SOCKET_KEY_HEAD
+		ipv6_addr_t src_ip, dst_ip;
+	};
+	uint64_t w[5];
+} socket_key6_t;
+
+typedef union {
+	struct {
+		SOCKET_KEY_HEAD
+	};
+	socket_key4_t v4;
+	socket_key6_t v6;
 } socket_key_t;
 
+#undef SOCKET_KEY_HEAD
+
+/*
+ * Returns true, if the key belongs into the IPv4 table.
+ */
+static inline
+int fastnet_socket_key_is4(socket_key_t *key){
+	return (key->layer3_version&0xF)==0x4;
+}
+
 typedef odp_buffer_t fastnet_socket_t;
 
 typedef void (*fastnet_socket_finalizer_t)(fastnet_socket_t sock);
 
+/*
+ * The fields read by the socket lookup (and the reference count) come first, and occupy
+ * the first cache line of the socket.
+ */
 typedef struct{
 	fastnet_socket_t next_ht;
 	odp_atomic_u32_t refc;
-	uint32_t         is_ht;
-	
-	socket_key_t key;
 	uint32_t     hash;
+	socket_key_t key;
+	/* ------------------------------------ */
+	
+	uint32_t     is_ht;
 	uint32_t     type_tag;
 	
 	/* Finalizer */
 	fastnet_socket_finalizer_t finalizer;
+	
+	/* The slab, the socket has been allocated from. NULL for plain ODP buffers. */
+	fastnet_slab_t* slab;
 } fastnet_sockstruct_t;
 
 /*
@@ -57,10 +118,50 @@ netpp_retcode_t fastnet_socket_key_obtain_ip(odp_packet_t pkt, socket_key_t *key
  */
 netpp_retcode_t fastnet_socket_key_obtain(odp_packet_t pkt, socket_key_t *key);
 
+/*
+ * Obtains the complete socket key of a TCP or UDP packet, and its hash.
+ *
+ * Uses the key, that fastnet_ip_input()/fastnet_ip6_input() has stored in the packet's user
+ * area (see fastnet_socket_key_parse4()), if any. Otherwise the key is obtained from the packet.
+ */
+netpp_retcode_t fastnet_socket_key_obtain_hash(odp_packet_t pkt, socket_key_t *key, uint8_t layer4_version, uint32_t *hash);
+
+/*
+ * Called by fastnet_ip_input() and fastnet_ip6_input(), once the IP header is validated.
+ *
+ * If 'proto' is TCP, the socket key (addresses, ports) and its hash are stored in the packet's
+ * user area, so the transport layer doesn't need to parse the headers again. Other protocols
+ * don't use the stored key, so it is not computed for them.
+ * The layer 4 offset must be set.
+ */
+void fastnet_socket_key_parse4(odp_packet_t pkt, fnet_ip_header_t *ip, uint8_t proto);
+void fastnet_socket_key_parse6(odp_packet_t pkt, fnet_ip6_header_t *ip6, uint8_t proto);
+
+/*
+ * Compares two socket keys of the same version.
+ */
+static inline
+int fastnet_socket_key4_eq(socket_key4_t *a,socket_key4_t *b){
+	return ((a->w[0]^b->w[0])|(a->w[1]^b->w[1]))==0;
+}
+
+static inline
+int fastnet_socket_key6_eq(socket_key6_t *a,socket_key6_t *b){
+	return ((a->w[0]^b->w[0])|(a->w[1]^b->w[1])|(a->w[2]^b->w[2])|(a->w[3]^b->w[3])|(a->w[4]^b->w[4]))==0;
+}
+
 /*
  * Compares two socket keys.
  */
-int fastnet_socket_key_eq(socket_key_t *a,socket_key_t *b);
+static inline
+int fastnet_socket_key_eq(socket_key_t *a,socket_key_t *b){
+	if(fastnet_socket_key_is4(a)){
+		if(!fastnet_socket_key_is4(b)) return 0;
+		return fastnet_socket_key4_eq(&(a->v4),&(b->v4));
+	}
+	if(fastnet_socket_key_is4(b)) return 0;
+	return fastnet_socket_key6_eq(&(a->v6),&(b->v6));
+}
 
 /*
  * Initializes the socket table.
@@ -82,11 +183,57 @@ void fastnet_socket_grab(fastnet_socket_t sock);
  */
 void fastnet_socket_construct(fastnet_socket_t sock,fastnet_socket_finalizer_t finalizer);
 
+/*
+ * Computes the hash of a socket key.
+ */
+static inline
+uint64_t fastnet_socket_hash_mix(uint64_t h){
+	h ^= h>>33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h>>33;
+	return h;
+}
+
+static inline
+uint32_t fastnet_socket_key4_hash(socket_key4_t *key){
+	return (uint32_t)fastnet_socket_hash_mix(key->w[0] ^ fastnet_socket_hash_mix(key->w[1]));
+}
+
+static inline
+uint32_t fastnet_socket_key6_hash(socket_key6_t *key){
+	uint64_t h = key->w[0];
+	h = fastnet_socket_hash_mix(h) ^ key->w[1];
+	h = fastnet_socket_hash_mix(h) ^ key->w[2];
+	h = fastnet_socket_hash_mix(h) ^ key->w[3];
+	h = fastnet_socket_hash_mix(h) ^ key->w[4];
+	return (uint32_t)fastnet_socket_hash_mix(h);
+}
+
+static inline
+uint32_t fastnet_socket_key_hash(socket_key_t *key){
+	if(fastnet_socket_key_is4(key)) return fastnet_socket_key4_hash(&(key->v4));
+	return fastnet_socket_key6_hash(&(key->v6));
+}
+
 /*
  * Lookup socket.
  */
 fastnet_socket_t fastnet_socket_lookup(socket_key_t *key);
 
+/*
+ * Lookup socket, with a precomputed hash. 'hash' must be fastnet_socket_key_hash(key).
+ */
+fastnet_socket_t fastnet_socket_lookup_hash(socket_key_t *key,uint32_t hash);
+
+/*
+ * Lookup socket, without incrementing the refcount.
+ *
+ * This may only be called by the worker, that owns the flow (see <net/flow_director.h>),
+ * as the owner is the only thread, that may remove the socket. 'hash' must be
+ * fastnet_socket_key_hash(key).
+ */
+fastnet_socket_t fastnet_socket_lookup_owned(socket_key_t *key,uint32_t hash);
+
 /*
  * Insert socket.
  */
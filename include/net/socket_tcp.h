@@ -16,9 +16,21 @@
 #pragma once
 #include <net/socket_key.h>
 
+/*
+ * Size of the header template: Ethernet (14) + VLAN (4) + IPv6 (40) + TCP (20) bytes,
+ * rounded up to 16 bytes, so it can be copied as a whole.
+ */
+#define FASTNET_TCP_TMPL_SZ 80
+
 typedef struct {
 	fastnet_sockstruct_t _head;
 	/* ------------------------------------ */
+	
+	/*
+	 * Hot part: Touched by every segment, sent or received. It follows the socket header,
+	 * so with 64 byte cache lines, a segment touches only the first two cache lines of the
+	 * PCB (see the assertions in fastnet_tcp_sockets.c).
+	 */
 	odp_ticketlock_t lock;
 	
 	uint8_t state;
@@ -49,31 +61,48 @@ typedef struct {
 		uint32_t una; /* send unacknowledged */
 		uint32_t nxt; /* send next */
 		uint32_t wnd; /* send window */
-		uint32_t up;  /* send urgent pointer */
 		uint32_t wl1; /* segment sequence number used for last window update */
 		uint32_t wl2; /* segment acknowledgment number used for last window update */
 	} snd;
 	struct _fastnet_tcp_pcb_t_rcv {
 		uint32_t nxt; /* receive next */
 		uint32_t wnd; /* receive window */
-		uint32_t up;  /* receive urgent pointer */
 	} rcv;
-	uint32_t iss; /* initial send sequence number */
-	uint32_t irs; /* initial receive sequence number */
 	
+	/* Only used during the handshake, they fill up the rest of the hot part's cache line. */
+	uint32_t iss;    /* initial send sequence number */
+	uint32_t irs;    /* initial receive sequence number */
+	
+	/* ------------------------------------ */
+	
+	/*
+	 * Cold part: Touched on output, or only during the handshake. It starts on a cache line
+	 * of its own.
+	 *
+	 * Precomputed TCP/IP header, right-aligned in 'data': The TCP header ends at the end of
+	 * the array, the IP header precedes it, and the Ethernet header (if any) precedes that.
+	 */
 	struct {
-		/* Buffer containing the TCP/IP header. */
-		odp_packet_t buf;
+		uint8_t      data[FASTNET_TCP_TMPL_SZ];
 		
-		/* Lifetime of the Ethernet header (MS); */
-		uint64_t     eth_lifetime;
+		/* Length of the IP header, 0 if the template has not been created. */
+		uint8_t      l3len;
 		
-		/* Time-Stamp of the Ethernet header (in use if eth_lifetime > 0)*/
-		odp_time_t   eth_tstamp;
+		/* Length of the Ethernet header, 0 if there is none. */
+		uint8_t      l2len;
 		
-		/* Is NULL if There is no Ethernet header in the buffer and eth_lifetime > 0 */
+		/* fastnet_neigh_gen() at the time, the Ethernet header has been filled in. */
+		uint32_t     eth_gen;
+		
+		/* Output interface of the connection, NULL if unknown. The Ethernet header is for it. */
 		nif_t*       eth_nif;
-	} tcpiphdr;
+	} tcpiphdr ODP_ALIGNED_CACHE;
+	
+	uint32_t snd_up; /* send urgent pointer */
+	uint32_t rcv_up; /* receive urgent pointer */
+	
+	/* Maximum segment size announced by the peer in its SYN, 0 if unknown. */
+	uint16_t snd_mss;
 	
 } fastnet_tcp_pcb_t;
 
@@ -84,8 +113,6 @@ fastnet_socket_t fastnet_tcp_allocate();
 
 fastnet_socket_t fastnet_tcp_allocate_with_hdr();
 
-void fastnet_tcp_socket_finalize(fastnet_socket_t sock);
-
 netpp_retcode_t fastnet_tcp_process(odp_packet_t pkt,socket_key_t *key,fastnet_socket_t sock);
 
 netpp_retcode_t fastnet_tcp_handshake_listen (odp_packet_t pkt,socket_key_t *key,fastnet_socket_t sock);
@@ -95,11 +122,75 @@ netpp_retcode_t fastnet_tcp_output_flags(odp_packet_t pkt,socket_key_t *key,uint
 netpp_retcode_t fastnet_tcp_output_flags_wnd(odp_packet_t pkt,socket_key_t *key,uint32_t seq,uint32_t ack,uint32_t wnd,uint16_t flags);
 
 /*
- * This function constructs a TCP/IP header in a given buffer (type is odp_packet_t).
- * odp_packet_l4_offset() must be set.
+ * Sends a SYN-ACK, announcing the maximum segment size 'mss' (RFC 879).
+ */
+netpp_retcode_t fastnet_tcp_output_synack(odp_packet_t pkt,socket_key_t *key,uint32_t seq,uint32_t ack,uint32_t wnd,uint16_t mss);
+
+/*
+ * Answers the segment 'pkt' for a closed port with a reset (RFC 793 "Reset Generation"), unless
+ * it is a reset itself, or the rate limit (see icmp_limit.h) is exceeded.
  */
-void fastnet_tcp_segmout_create_header_buf(odp_packet_t pkt,socket_key_t *key);
+netpp_retcode_t fastnet_tcp_output_reset(odp_packet_t pkt,socket_key_t *key);
 
+/*
+ * Sends the payload 'pkt' as a segment of the connection 'sock', with the sequence number 'seq_num'.
+ *
+ * IPv4 segments have DF set (Path MTU Discovery), so the payload must not exceed
+ * fastnet_tcp_snd_mss(). fastnet_tcp_send() splits larger data.
+ */
+netpp_retcode_t fastnet_tcp_output(odp_packet_t pkt,fastnet_socket_t sock,uint32_t seq_num,uint16_t flags);
+
+/*
+ * Sends 'len' bytes of application data as a segment of the connection 'sock', like
+ * fastnet_tcp_output(). The payload's checksum is computed while copying it into the packet.
+ *
+ * The packet is allocated and freed by this function. Returns NETPP_DROP, if it was not sent.
+ */
+netpp_retcode_t fastnet_tcp_output_data(fastnet_socket_t sock,uint32_t seq_num,uint16_t flags,const void* data,uint32_t len);
+
+/*
+ * Sends 'len' bytes of application data, starting at the sequence number 'seq_num', in segments
+ * of at most fastnet_tcp_snd_mss() bytes. PSH and FIN are only set on the last segment.
+ *
+ * Returns the number of bytes sent, which is less than 'len', if a segment could not be sent.
+ */
+uint32_t fastnet_tcp_send(fastnet_socket_t sock,uint32_t seq_num,uint16_t flags,const void* data,uint32_t len);
+
+/*
+ * The MSS assumed by the peer, if it announced none (RFC 1122 4.2.2.6, RFC 2460 8.3).
+ */
+#define FASTNET_TCP_DEFAULT_MSS4 536
+#define FASTNET_TCP_DEFAULT_MSS6 1220
+
+/*
+ * Returns the largest payload of a segment of the connection: The peer's MSS, limited by the
+ * path MTU towards it (see pmtu.h), so a segment does not need to be fragmented.
+ */
+uint32_t fastnet_tcp_snd_mss(fastnet_tcp_pcb_t* pcb);
+
+/*
+ * This function constructs the TCP/IP header template of the PCB. 'nif' is the interface of
+ * the connection (may be NULL).
+ */
+void fastnet_tcp_segmout_create_header(fastnet_tcp_pcb_t* pcb,socket_key_t *key,nif_t* nif);
+
+/*
+ * Adds an Ethernet header to the PCB's template, which stays valid, until the neighbor
+ * caches change. 'gen' is fastnet_neigh_gen(), read before the lookup of 'dst'.
+ */
+void fastnet_tcp_segmout_set_eth(fastnet_tcp_pcb_t* pcb,nif_t* nif,uint64_t src,uint64_t dst,uint32_t gen);
+
+/*
+ * Sends a segment, that has been prepared with fastnet_tcp_add_header().
+ * 'length' is the length of the TCP segment (header + payload).
+ */
 netpp_retcode_t fastnet_tcp_sendout_ll(odp_packet_t pkt,fastnet_tcp_pcb_t* pcb,nif_t* nif,uint16_t length);
 
-int fastnet_tcp_add_header(odp_packet_t pkt,fastnet_tcp_pcb_t* __restrict__ pcb,odp_time_t now,nif_t** nifp);
+/*
+ * Prepends the PCB's header template to the packet. '*nifp' is set to the output interface,
+ * if the template contained a valid Ethernet header, otherwise to NULL. An outdated Ethernet
+ * header is looked up again (see fastnet_tcp_segmout_set_eth()).
+ *
+ * Returns non-0 on failure.
+ */
+int fastnet_tcp_add_header(odp_packet_t pkt,fastnet_tcp_pcb_t* __restrict__ pcb,nif_t** nifp);
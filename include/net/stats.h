@@ -0,0 +1,157 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+#include <stdio.h>
+#include <odp_api.h>
+#include <net/niftable.h>
+#include <net/nethread.h>
+
+/*
+ * Statistics counters.
+ *
+ * Every worker has a block of its own, padded to a cache line. A counter is only ever
+ * written by its worker, without atomics. Threads, that are not workers, share an extra
+ * block, which they update atomically.
+ *
+ * The names follow the SNMP MIBs (RFC 4293 IP-MIB, RFC 4022 TCP-MIB, RFC 4113 UDP-MIB),
+ * where there is an equivalent. The drop_* counters give the reason of every dropped packet.
+ */
+typedef struct {
+	/* IPv4 */
+	uint64_t ip_in_receives;
+	uint64_t ip_in_hdr_errors;
+	uint64_t ip_in_addr_errors;
+	uint64_t ip_in_truncated_pkts;
+	uint64_t ip_in_delivers;
+	uint64_t ip_reasm_fails;
+	uint64_t ip_out_requests;
+	uint64_t ip_out_discards;
+	
+	/* IPv6 */
+	uint64_t ip6_in_receives;
+	uint64_t ip6_in_hdr_errors;
+	uint64_t ip6_in_addr_errors;
+	uint64_t ip6_in_truncated_pkts;
+	uint64_t ip6_in_delivers;
+	uint64_t ip6_out_requests;
+	uint64_t ip6_out_discards;
+	
+	/* TCP */
+	uint64_t tcp_in_segs;
+	uint64_t tcp_in_errs;
+	uint64_t tcp_no_ports;
+	uint64_t tcp_out_segs;
+	uint64_t tcp_passive_opens;
+	uint64_t tcp_out_rsts;
+	uint64_t tcp_rst_ratelimited;
+	
+	/* UDP */
+	uint64_t udp_in_datagrams;
+	uint64_t udp_no_ports;
+	uint64_t udp_out_datagrams;
+	
+	/* ICMP, ICMPv6 */
+	uint64_t icmp_in_msgs;
+	uint64_t icmp_in_errors;
+	uint64_t icmp_out_msgs;
+	uint64_t icmp6_in_msgs;
+	uint64_t icmp6_in_errors;
+	uint64_t icmp6_out_msgs;
+	uint64_t icmp_out_ratelimited;
+	uint64_t icmp6_out_ratelimited;
+	uint64_t pmtu_updates;
+	
+	/* ARP, Neighbor Discovery */
+	uint64_t arp_in_pkts;
+	uint64_t arp_in_errors;
+	uint64_t arp_out_requests;
+	uint64_t arp_out_replies;
+	uint64_t nd6_in_msgs;
+	uint64_t nd6_in_errors;
+	
+	/* Drops by reason */
+	uint64_t drop_ip_checksum;
+	uint64_t drop_ip_header;
+	uint64_t drop_ip_length;
+	uint64_t drop_ip_not_ours;
+	uint64_t drop_ip_fragment;
+	uint64_t drop_ip6_header;
+	uint64_t drop_ip6_length;
+	uint64_t drop_ip6_not_ours;
+	uint64_t drop_tcp_checksum;
+	uint64_t drop_tcp_no_socket;
+	uint64_t drop_tcp_seqcheck;
+	uint64_t drop_udp_no_socket;
+	uint64_t drop_arp_pool;
+	uint64_t drop_arp_unresolved;
+	uint64_t drop_no_protocol;
+	uint64_t drop_flowdir_full;
+	uint64_t drop_flowdir_nonworker;
+	uint64_t drop_tx_queue_full;
+	
+	/* All packets dropped on input, for any reason (including ones not counted above). */
+	uint64_t drop_total;
+} fastnet_stats_t;
+
+typedef struct {
+	fastnet_stats_t s;
+} ODP_ALIGNED_CACHE fastnet_stats_block_t;
+
+/* One block per worker, and one shared by all other threads (see fastnet_thread_slot()). */
+extern fastnet_stats_block_t fastnet_stats_blocks[FASTNET_THREAD_SLOTS];
+
+#define FASTNET_STAT_ADD(field,n) do{ \
+	int _slot = fastnet_thread_slot(); \
+	if(odp_likely(_slot!=FASTNET_NONWORKER_SLOT)) \
+		fastnet_stats_blocks[_slot].s.field += (n); \
+	else \
+		__atomic_fetch_add(&(fastnet_stats_blocks[_slot].s.field),(n),__ATOMIC_RELAXED); \
+}while(0)
+#define FASTNET_STAT_INC(field)   FASTNET_STAT_ADD(field,1)
+
+/*
+ * Sums up the counters of all workers. The sum is not a consistent snapshot, as the
+ * workers keep on counting.
+ */
+void fastnet_stats_sum(fastnet_stats_t* total);
+
+/*
+ * Copies the counters of one worker, or of the threads, that are not workers
+ * (FASTNET_NONWORKER_SLOT).
+ */
+void fastnet_stats_worker(int worker,fastnet_stats_t* stats);
+
+/*
+ * Prints the counters, one "name value" pair per line. Counters, that are 0, are omitted,
+ * unless 'all' is non-0.
+ */
+void fastnet_stats_print(FILE* f,const fastnet_stats_t* stats,int all);
+
+/*
+ * Starts a control thread, that writes the sum of all counters every 'interval_ms'
+ * milliseconds into the file 'path' (see src/net_linux/stats_export.c). A path in /dev/shm
+ * gives a shared-memory segment.
+ *
+ * Returns 0 on success, non-0 on failure.
+ */
+int fastnet_stats_export_start(const char* path,uint32_t interval_ms);
+
+/*
+ * Prints, what fastnet_stats_export_start() writes into its files: The non-0 counters, and
+ * the cycle accounting (NET_PROF), the lock contention (NET_LOCKPROF) and the latency
+ * histograms (lat_sample), if enabled. Used by the benchmarks at the end of a run.
+ */
+void fastnet_stats_report(FILE* f);
@@ -32,3 +32,9 @@ typedef union fastnet_ip_pair{
 
 netpp_retcode_t fastnet_udp_output(odp_packet_t pkt, fastnet_ip_pair_t addrs, uint16_t srcport, uint16_t dstport, odp_bool_t isipv6);
 
+/*
+ * Returns the largest payload of a datagram towards 'addrs', that is not fragmented on the path
+ * (see pmtu.h). 'nif' is the output interface, or NULL.
+ */
+uint32_t fastnet_udp_max_payload(nif_t* nif, fastnet_ip_pair_t addrs, odp_bool_t isipv6);
+
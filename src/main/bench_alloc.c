@@ -0,0 +1,107 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <odp_api.h>
+#include <net/niftable.h>
+#include <net/pkt_alloc.h>
+
+/*
+ * Microbenchmark: Allocation of a short packet (eg. a TCP RST or an ARP request),
+ * with odp_pool_lookup() on every allocation vs. the per-thread allocation context.
+ */
+
+#define EXAMPLE_ABORT(...) do{ printf(__VA_ARGS__); abort(); }while(0)
+
+#define ROUNDS  1000000
+#define PKT_LEN 58
+
+static
+uint64_t bench_lookup(){
+	odp_time_t begin;
+	odp_pool_t pool;
+	odp_packet_t pkt;
+	int i;
+	
+	begin = odp_time_local();
+	for(i=0;i<ROUNDS;++i){
+		pool = odp_pool_lookup("fn_pktout");
+		if(pool == ODP_POOL_INVALID) EXAMPLE_ABORT("Error: pool lookup failed.\n");
+		pkt = odp_packet_alloc(pool,PKT_LEN);
+		if(pkt == ODP_PACKET_INVALID) EXAMPLE_ABORT("Error: packet alloc failed.\n");
+		odp_packet_free(pkt);
+	}
+	return odp_time_to_ns(odp_time_diff(odp_time_local(),begin));
+}
+
+static
+uint64_t bench_cached_pool(){
+	odp_time_t begin;
+	odp_pool_t pool;
+	odp_packet_t pkt;
+	int i;
+	
+	begin = odp_time_local();
+	for(i=0;i<ROUNDS;++i){
+		pool = fastnet_pool_pktout();
+		pkt = odp_packet_alloc(pool,PKT_LEN);
+		if(pkt == ODP_PACKET_INVALID) EXAMPLE_ABORT("Error: packet alloc failed.\n");
+		odp_packet_free(pkt);
+	}
+	return odp_time_to_ns(odp_time_diff(odp_time_local(),begin));
+}
+
+static
+uint64_t bench_ctx(){
+	odp_time_t begin;
+	odp_packet_t pkt;
+	int i;
+	
+	begin = odp_time_local();
+	for(i=0;i<ROUNDS;++i){
+		pkt = fastnet_pktout_alloc(PKT_LEN);
+		if(pkt == ODP_PACKET_INVALID) EXAMPLE_ABORT("Error: packet alloc failed.\n");
+		fastnet_pktout_free(pkt);
+	}
+	return odp_time_to_ns(odp_time_diff(odp_time_local(),begin));
+}
+
+#define REPORT(name,ns) printf("%-32s %8.1f ns/op\n",name,((double)(ns))/ROUNDS)
+
+int main(){
+	odp_instance_t instance;
+	
+	if(odp_init_global(&instance, NULL, NULL))
+		EXAMPLE_ABORT("Error: ODP global init failed.\n");
+	if(odp_init_local(instance, ODP_THREAD_CONTROL))
+		EXAMPLE_ABORT("Error: ODP local init failed.\n");
+	
+	if(!fastnet_pools_init(0,0,0,0))
+		EXAMPLE_ABORT("Error: allocating pools.\n");
+	
+	/* Warm up. */
+	bench_ctx();
+	
+	REPORT("odp_pool_lookup + alloc/free",bench_lookup());
+	REPORT("cached pool + alloc/free",bench_cached_pool());
+	REPORT("per-thread packet cache",bench_ctx());
+	
+	fastnet_alloc_flush();
+	odp_term_local();
+	odp_term_global(instance);
+	return 0;
+}
+
@@ -0,0 +1,155 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <odp_api.h>
+#include <net/checksum.h>
+
+/*
+ * Benchmark: The ones-complement sum kernels (see <net/checksum.h>).
+ *
+ *   bench_checksum [trials]
+ *
+ * First, 'trials' random buffers (length, offset and thereby alignment, initial sum) are summed
+ * with fastnet_cksum_sum() (the SIMD kernel, selected at runtime), fastnet_cksum_sum_generic()
+ * and fastnet_cksum_copy(), and compared with a byte-wise reference. Any mismatch aborts.
+ *
+ * Then, the throughput of every function is reported in GB/s, for a few buffer lengths.
+ */
+
+#define EXAMPLE_ABORT(...) do{ printf(__VA_ARGS__); abort(); }while(0)
+
+#define DEF_TRIALS  1000000
+#define MAX_LEN     9216
+#define MAX_OFFSET  64
+#define BUF_SZ      (65536+MAX_OFFSET)
+#define BENCH_BYTES (1ULL<<30)
+
+static uint8_t* src;
+static uint8_t* dst;
+
+/* Keeps the compiler from dropping the benchmark loops. */
+static volatile uint16_t result;
+
+/*
+ * RFC 1071, one 16-bit word (native byte order) at a time. An odd byte is padded with a zero byte.
+ */
+static uint64_t ref_sum(const uint8_t* p,uint32_t len,uint64_t sum){
+	uint8_t pad[2];
+	uint16_t w;
+	
+	for(;len>=2;p+=2,len-=2){
+		memcpy(&w,p,2);
+		sum += w;
+	}
+	if(len){
+		pad[0] = *p;
+		pad[1] = 0;
+		memcpy(&w,pad,2);
+		sum += w;
+	}
+	return sum;
+}
+
+/* 0x0000 and 0xffff are both zero in ones-complement. */
+static uint16_t norm(uint64_t sum){
+	uint16_t s = fastnet_cksum_fold(sum);
+	return s==0xffff ? 0 : s;
+}
+
+static void verify(uint32_t trials){
+	uint32_t i,len,soff,doff;
+	uint64_t init;
+	uint16_t ref;
+	
+	for(i=0;i<trials;++i){
+		len  = rand()%(MAX_LEN+1);
+		soff = rand()%MAX_OFFSET;
+		doff = rand()%MAX_OFFSET;
+		init = ((uint64_t)rand())<<(rand()%32);
+		
+		ref = norm(ref_sum(src+soff,len,init));
+		if(norm(fastnet_cksum_sum(src+soff,len,init))!=ref)
+			EXAMPLE_ABORT("Error: fastnet_cksum_sum() len=%u offset=%u\n",len,soff);
+		if(norm(fastnet_cksum_sum_generic(src+soff,len,init))!=ref)
+			EXAMPLE_ABORT("Error: fastnet_cksum_sum_generic() len=%u offset=%u\n",len,soff);
+		if(norm(fastnet_cksum_copy(dst+doff,src+soff,len,init))!=ref || memcmp(dst+doff,src+soff,len))
+			EXAMPLE_ABORT("Error: fastnet_cksum_copy() len=%u offset=%u->%u\n",len,soff,doff);
+	}
+}
+
+enum { K_GENERIC, K_DISPATCH, K_COPY, NUM_KERNELS };
+
+static const char* kernel_names[NUM_KERNELS] = {
+	"fastnet_cksum_sum_generic","fastnet_cksum_sum","fastnet_cksum_copy",
+};
+
+static double gbps(int kernel,uint32_t len){
+	odp_time_t begin;
+	uint64_t i,n,sum = 0,ns;
+	
+	n = BENCH_BYTES/len;
+	begin = odp_time_local();
+	for(i=0;i<n;++i){
+		switch(kernel){
+		case K_GENERIC:  sum = fastnet_cksum_sum_generic(src,len,sum); break;
+		case K_DISPATCH: sum = fastnet_cksum_sum(src,len,sum); break;
+		case K_COPY:     sum = fastnet_cksum_copy(dst,src,len,sum); break;
+		}
+	}
+	ns = odp_time_to_ns(odp_time_diff(odp_time_local(),begin));
+	result = fastnet_cksum_fold(sum);
+	return ns ? ((double)(n*len))/ns : 0.0;
+}
+
+int main(int argc,char** argv){
+	static const uint32_t lens[] = { 64, 256, 1460, 9000, 65536 };
+	odp_instance_t instance;
+	uint32_t trials = DEF_TRIALS,i;
+	int k;
+	
+	if(argc>1) trials = atoi(argv[1]);
+	
+	if(odp_init_global(&instance, NULL, NULL))
+		EXAMPLE_ABORT("Error: ODP global init failed.\n");
+	if(odp_init_local(instance, ODP_THREAD_CONTROL))
+		EXAMPLE_ABORT("Error: ODP local init failed.\n");
+	
+	src = malloc(BUF_SZ);
+	dst = malloc(BUF_SZ);
+	if(!src || !dst) EXAMPLE_ABORT("Error: out of memory.\n");
+	srand(1);
+	for(i=0;i<BUF_SZ;++i) src[i] = rand();
+	
+	verify(trials);
+	printf("%u random buffers: all kernels match the reference\n\n",trials);
+	
+	printf("%-26s","length");
+	for(i=0;i<sizeof(lens)/sizeof(lens[0]);++i) printf(" %8u",lens[i]);
+	printf("\n");
+	for(k=0;k<NUM_KERNELS;++k){
+		printf("%-26s",kernel_names[k]);
+		for(i=0;i<sizeof(lens)/sizeof(lens[0]);++i) printf(" %8.2f",gbps(k,lens[i]));
+		printf("  GB/s\n");
+	}
+	
+	free(src);
+	free(dst);
+	odp_term_local();
+	odp_term_global(instance);
+	return 0;
+}
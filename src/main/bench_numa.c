@@ -0,0 +1,112 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <odp_api.h>
+#include <net/numa.h>
+
+/*
+ * Benchmark: Per-node pools.
+ *
+ * For every node, the calling thread moves onto that node, and
+ *  1. touches objects from the local pool and from a remote pool (ns per object),
+ *  2. allocates more objects, than the local pool holds, and reports how many
+ *     allocations were served locally and remotely.
+ */
+
+#define EXAMPLE_ABORT(...) do{ printf(__VA_ARGS__); abort(); }while(0)
+
+#define OBJ_SIZE  1024
+#define OBJ_NUM   4096
+#define TOUCHES   64
+
+static odp_buffer_t bufs[OBJ_NUM*2];
+
+static
+uint64_t touch_pool(odp_pool_t pool){
+	odp_time_t begin;
+	uint64_t ns;
+	int i,j,n;
+	
+	for(n=0;n<OBJ_NUM/2;++n){
+		bufs[n] = odp_buffer_alloc(pool);
+		if(bufs[n]==ODP_BUFFER_INVALID) break;
+	}
+	if(n<1) return 0;
+	
+	begin = odp_time_local();
+	for(j=0;j<TOUCHES;++j)
+		for(i=0;i<n;++i)
+			memset(odp_buffer_addr(bufs[i]),j,OBJ_SIZE);
+	ns = odp_time_to_ns(odp_time_diff(odp_time_local(),begin));
+	
+	for(i=0;i<n;++i)
+		odp_buffer_free(bufs[i]);
+	return ns/((uint64_t)n*TOUCHES);
+}
+
+int main(){
+	odp_instance_t instance;
+	odp_pool_param_t params;
+	fastnet_numa_pool_t pools;
+	uint64_t local0,remote0,local1,remote1;
+	int node,nodes,i,n;
+	
+	if(odp_init_global(&instance, NULL, NULL))
+		EXAMPLE_ABORT("Error: ODP global init failed.\n");
+	if(odp_init_local(instance, ODP_THREAD_CONTROL))
+		EXAMPLE_ABORT("Error: ODP local init failed.\n");
+	
+	nodes = fastnet_numa_num_nodes();
+	printf("NUMA nodes: %d\n",nodes);
+	
+	odp_pool_param_init(&params);
+	params.type      = ODP_POOL_BUFFER;
+	params.buf.num   = OBJ_NUM*nodes;
+	params.buf.size  = OBJ_SIZE;
+	params.buf.align = ODP_CACHE_LINE_SIZE;
+	if(!fastnet_numa_pool_create(&pools,"bench_numa",&params))
+		EXAMPLE_ABORT("Error: allocating pools.\n");
+	
+	for(node=0;node<nodes;++node){
+		fastnet_numa_enter(node);
+		
+		printf("node %d: local  touch %4llu ns/object\n",node,(unsigned long long)touch_pool(pools.pool[node]));
+		if(nodes>1)
+			printf("node %d: remote touch %4llu ns/object\n",node,(unsigned long long)touch_pool(pools.pool[(node+1)%nodes]));
+		
+		fastnet_numa_stats(&local0,&remote0);
+		for(n=0;n<OBJ_NUM*2;++n){
+			bufs[n] = fastnet_numa_buffer_alloc(&pools);
+			if(bufs[n]==ODP_BUFFER_INVALID) break;
+		}
+		fastnet_numa_stats(&local1,&remote1);
+		for(i=0;i<n;++i)
+			odp_buffer_free(bufs[i]);
+		
+		printf("node %d: %d allocations, local %llu, remote %llu\n",node,n,
+			(unsigned long long)(local1-local0),
+			(unsigned long long)(remote1-remote0));
+		
+		fastnet_numa_leave();
+	}
+	
+	odp_term_local();
+	odp_term_global(instance);
+	return 0;
+}
+
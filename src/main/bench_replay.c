@@ -0,0 +1,133 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <odp_api.h>
+#include <odp/helper/linux.h>
+#include <net/niftable.h>
+#include <net/nethread.h>
+#include <net/numa.h>
+#include <net/conf.h>
+#include <net/pkt_alloc.h>
+#include <net/mem_pktio.h>
+#include <net/stats.h>
+#include "pcap_replay.h"
+
+/*
+ * Benchmark: Replays a pcap file through fastnet_classified_input(), without a network.
+ *
+ *   bench_replay <file.pcap> [rounds] [--key=value ...]
+ *
+ * Every worker feeds all frames through the input pipeline 'rounds' times, as if they were
+ * received on an in-memory device ("mem:0", see <net/mem_pktio.h>); see "pcap_replay.h".
+ * The device emulates checksum offload (fastnet_nif_offload_emulate()).
+ *
+ * Reports Mpps, cycles/packet per protocol path, and the counters of <net/stats.h>.
+ * The cycles include the odp_cpu_cycles() overhead, the Mpps include the packet copy.
+ */
+
+#define EXAMPLE_ABORT(...) do{ printf(__VA_ARGS__); abort(); }while(0)
+
+#define DEF_ROUNDS  100
+
+static replay_result_t results[NET_MAXTHREAD];
+static nif_table_t*    table;
+static uint32_t        rounds = DEF_ROUNDS;
+static odp_barrier_t   barrier;
+
+static int worker(void* arg){
+	(void)arg;
+	fastnet_worker_enter(odp_atomic_fetch_inc_u32(&(table->worker_seq)));
+	fastnet_numa_thread_init();
+	
+	replay_run(&results[fastnet_worker_id()],rounds);
+	
+	fastnet_alloc_flush();
+	return 0;
+}
+
+int main(int argc,char** argv){
+	odp_instance_t instance;
+	nif_t* nif;
+	uint64_t cycles[REPLAY_NUM_PATHS],count[REPLAY_NUM_PATHS],packets = 0,tx = 0,no_buffer = 0,ns = 0;
+	int i,k;
+	
+	if(argc<2 || argv[1][0]=='-')
+		EXAMPLE_ABORT("Usage: %s <file.pcap> [rounds] [--key=value ...]\n",argv[0]);
+	if(argc>2 && argv[2][0]!='-') rounds = atoi(argv[2]);
+	if(!rounds) rounds = 1;
+	
+	if(odp_init_global(&instance, NULL, NULL))
+		EXAMPLE_ABORT("Error: ODP global init failed.\n");
+	if(odp_init_local(instance, ODP_THREAD_CONTROL))
+		EXAMPLE_ABORT("Error: ODP local init failed.\n");
+	
+	if(fastnet_conf_args(&fastnet_conf,argc,argv))
+		EXAMPLE_ABORT("Error: invalid configuration.\n");
+	fastnet_conf_finalize(&fastnet_conf);
+	
+	if(replay_load(argv[1]))
+		EXAMPLE_ABORT("Error: can't load '%s' (Ethernet pcap expected).\n",argv[1]);
+	
+	if(!fastnet_pools_init(0,0,0,0))
+		EXAMPLE_ABORT("Error: allocating pools.\n");
+	fastnet_tlp_init();
+	table = calloc(sizeof(*table),1);
+	if(!table || !fastnet_niftable_prepare(table,instance))
+		EXAMPLE_ABORT("Error: nif-table init failed.\n");
+	nif = fastnet_openpktio(table,"mem:0");
+	if(!nif) EXAMPLE_ABORT("Error: can't open mem:0.\n");
+	fastnet_nif_offload_emulate(nif);
+	
+	if(replay_init(nif,&barrier))
+		EXAMPLE_ABORT("Error: replay init failed.\n");
+	
+	printf("%u frames, %u rounds, %d workers\n",replay_frames(),rounds,table->workers);
+	
+	odp_barrier_init(&barrier,table->workers);
+	fastnet_runworkers(table,table->workers,worker,NULL);
+	
+	memset(cycles,0,sizeof cycles);
+	memset(count,0,sizeof count);
+	for(i=0;i<table->workers;++i){
+		for(k=0;k<REPLAY_NUM_PATHS;++k){
+			cycles[k] += results[i].cycles[k];
+			count[k]  += results[i].count[k];
+		}
+		packets   += results[i].packets;
+		tx        += results[i].tx;
+		no_buffer += results[i].no_buffer;
+		if(results[i].ns>ns) ns = results[i].ns;
+	}
+	
+	printf("%-16s %8.3f Mpps (%llu packets in %.3f s)\n","total",
+		ns ? ((double)packets*1000.0)/ns : 0.0,(unsigned long long)packets,ns/1e9);
+	printf("%-16s %llu packets, %llu without buffer\n","sink",
+		(unsigned long long)tx,(unsigned long long)no_buffer);
+	for(k=0;k<REPLAY_NUM_PATHS;++k){
+		if(!count[k]) continue;
+		printf("%-16s %8.1f cycles/packet (%llu packets)\n",replay_path_names[k],
+			((double)cycles[k])/count[k],(unsigned long long)count[k]);
+	}
+	
+	printf("\n");
+	fastnet_stats_report(stdout);
+	
+	odp_term_local();
+	odp_term_global(instance);
+	return 0;
+}
@@ -0,0 +1,540 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <odp_api.h>
+#include <net/niftable.h>
+#include <net/nethread.h>
+#include <net/numa.h>
+#include <net/conf.h>
+#include <net/ipv4.h>
+#include <net/ipv4_mac_cache.h>
+#include <net/nd6_cache.h>
+#include <net/packet_input.h>
+#include <net/packet_output.h>
+#include <net/pkt_alloc.h>
+#include <net/mem_pktio.h>
+#include <net/requirement.h>
+#include <net/flow_director.h>
+#include <net/socket_tcp.h>
+#include <net/fastnet_tcp.h>
+#include <net/lockprof.h>
+#include <net/header/tcphdr.h>
+#include <net/header/layer4.h>
+#include "tcpgen.h"
+#include "pcap_replay.h"
+
+/*
+ * Benchmark: Multi-core scaling of the stack's subsystems.
+ *
+ *   bench_scaling [ops] [flows] [file.pcap] [--key=value ...]
+ *
+ * Every subsystem is driven by 1, 2, 4, ... workers, up to all workers of the configuration
+ * (--workers=N). The workers are started with fastnet_runworkers(), so a run with k workers
+ * always uses the same k CPUs. Every worker performs 'ops' operations:
+ *
+ *   socket_lookup  fastnet_socket_lookup() of established connections.
+ *   arp_cache      fastnet_ipv4_mac_lookup() of resolved entries.
+ *   nd6_cache      Neighbor cache lookups of reachable entries, as in fastnet_ip6_output().
+ *   tcp_state      Data segments of established connections ('flows' per worker) through
+ *                  fastnet_classified_input(), like the data-in phase of bench_tcpgen.
+ *   tx_enqueue     fastnet_pkt_output() into the transmit queues of the device.
+ *   tcp_flows      The workload of bench_tcpgen ('flows' per worker, see "tcpgen.h"): Connect,
+ *                  data in both directions, and reset. An operation is a segment.
+ *   pcap_replay    The workload of bench_replay (see "pcap_replay.h"); only with a pcap file.
+ *                  An operation is a frame.
+ *
+ * The devices are in-memory ones (see <net/mem_pktio.h>), with emulated checksum offload
+ * (fastnet_nif_offload_emulate()): "mem:0" for the subsystems above tcp_flows, "mem:1" for
+ * tcp_flows and "mem:2" for pcap_replay, so their sockets and caches are apart.
+ *
+ * Keys, addresses and segments are the same in every run, so the results are comparable
+ * across releases. The throughput includes the driver's own work (building segments,
+ * draining queues).
+ *
+ * The results are printed as JSON: For every subsystem and number of workers, the throughput
+ * in Mpps (million operations per second), per worker, and the efficiency (the throughput
+ * relative to linear scaling of the single-worker run). The misses of tcp_flows are the
+ * segments without buffer, the bad checksums, and the flows, that did not connect. With NET_LOCKPROF, the contention of
+ * every lock class is included (see <net/lockprof.h>).
+ */
+
+#define EXAMPLE_ABORT(...) do{ fprintf(stderr,__VA_ARGS__); abort(); }while(0)
+
+#define DEF_OPS       1000000
+#define DEF_FLOWS     1024
+#define MAX_FLOWS     TCPGEN_MAX_FLOWS
+#define NEIGHBORS     4096
+#define MAX_RUNS      16
+#define PAYLOAD       TCPGEN_PAYLOAD
+#define BURST         32
+#define SERVER_PORT   80
+#define CLIENT_PORT   1024
+#define CLIENT_ISS    1000
+#define SERVER_ISS    5000
+#define CLIENT_WND    0xffff
+#define RCV_WND       0xffff
+
+typedef struct {
+	uint64_t ops;
+	uint64_t misses;
+	uint64_t ns;
+} ODP_ALIGNED_CACHE result_t;
+
+typedef struct {
+	const char* name;
+	void (*run)(result_t* res,uint32_t me);
+	
+	/* Per run */
+	int      workers[MAX_RUNS];
+	double   mpps[MAX_RUNS];
+	uint64_t misses[MAX_RUNS];
+#ifdef NET_LOCKPROF
+	fastnet_lockprof_stat_t locks[MAX_RUNS][FASTNET_LOCK_NUM_CLASSES];
+#endif
+} subsystem_t;
+
+static result_t        results[NET_MAXTHREAD];
+static tcpgen_result_t tcpgen_results[NET_MAXTHREAD];
+static replay_result_t replay_results[NET_MAXTHREAD];
+static nif_table_t*    table;
+static nif_t*          nif;
+static uint32_t        num_ops = DEF_OPS;
+static uint32_t        num_flows = DEF_FLOWS;
+static uint32_t        replay_rounds;
+static unsigned        num_subsystems;
+static odp_barrier_t   barrier;
+
+static ipv4_addr_t   server_ip;
+
+/* The server side keys of all connections, indexed by worker*num_flows+flow. */
+static socket_key_t* flow_keys;
+
+static inline
+ipv4_addr_t neighbor_ip(uint32_t i){
+	return ipv4_addr_init(10,1,(i>>8)&0xff,i&0xff);
+}
+
+static inline
+ipv6_addr_t neighbor_ip6(uint32_t i){
+	ipv6_addr_t addr;
+	memset(&addr,0,sizeof addr);
+	addr.addr[0]  = 0xfe;
+	addr.addr[1]  = 0x80;
+	addr.addr[14] = (i>>8)&0xff;
+	addr.addr[15] = i&0xff;
+	return addr;
+}
+
+/* ------------------- Setup ------------------- */
+
+/*
+ * Creates an established connection, as if the handshake had been done.
+ */
+static void establish(socket_key_t* key){
+	fastnet_socket_t sock;
+	fastnet_tcp_pcb_t* pcb;
+	
+	sock = fastnet_tcp_allocate_with_hdr();
+	if(sock==ODP_BUFFER_INVALID) EXAMPLE_ABORT("Error: PCB allocation failed (see --tcp_pcbs).\n");
+	pcb = odp_buffer_addr(sock);
+	fastnet_tcp_segmout_create_header(pcb,key,nif);
+	
+	memset(&(pcb->snd),0,sizeof(pcb->snd));
+	memset(&(pcb->rcv),0,sizeof(pcb->rcv));
+	pcb->iss     = SERVER_ISS;
+	pcb->irs     = CLIENT_ISS;
+	pcb->snd.una = SERVER_ISS+1;
+	pcb->snd.nxt = SERVER_ISS+1;
+	pcb->snd.wnd = CLIENT_WND;
+	pcb->rcv.nxt = CLIENT_ISS+1;
+	pcb->rcv.wnd = RCV_WND;
+	
+	((fastnet_sockstruct_t*) pcb)->key = *key;
+	((fastnet_sockstruct_t*) pcb)->type_tag = IP_PROTOCOL_TCP;
+	fastnet_socket_construct(sock,NULL);
+	pcb->state = ESTABLISHED;
+	fastnet_socket_insert(sock);
+	fastnet_socket_put(sock);
+}
+
+static void setup(){
+	struct ipv4_nif_struct* ipv4;
+	nd6_nce_handle_t handle;
+	nd6_nce_t* ptr;
+	ipv6_addr_t addr;
+	socket_key_t* key;
+	uint32_t w,i;
+	
+	server_ip = ipv4_addr_init(10,0,0,1);
+	ipv4 = calloc(sizeof(*ipv4),1);
+	if(!ipv4) EXAMPLE_ABORT("Error: out of memory.\n");
+	fastnet_ip_set(ipv4,server_ip,ipv4_addr_init(0xff,0xff,0xff,0));
+	nif->ipv4 = ipv4;
+	
+	/* The clients of tcp_state, and the neighbors of arp_cache. */
+	for(w=0;w<(uint32_t)table->workers;++w)
+		fastnet_ipv4_mac_put(nif,tcpgen_client_ip(w),tcpgen_client_mac(w),1);
+	for(i=0;i<NEIGHBORS;++i)
+		fastnet_ipv4_mac_put(nif,neighbor_ip(i),0x020000010000ULL+i,1);
+	
+	for(i=0;i<NEIGHBORS;++i){
+		addr = neighbor_ip6(i);
+		fastnet_nd6_nce_lock_key(nif,addr);
+		handle = fastnet_nd6_nce_find_or_create(nif,addr,odp_time_global());
+		if(handle==ODP_BUFFER_INVALID) EXAMPLE_ABORT("Error: ND6 entry allocation failed (see --nd6_entries).\n");
+		ptr = odp_buffer_addr(handle);
+		ptr->state = ND6_NC_REACHABLE;
+		fastnet_nd6_nce_set_hwaddr(ptr,0x020000020000ULL+i);
+		fastnet_nd6_nce_unlock(handle);
+		fastnet_nd6_nce_put(handle);
+	}
+	
+	flow_keys = calloc(sizeof(socket_key_t),table->workers*num_flows);
+	if(!flow_keys) EXAMPLE_ABORT("Error: out of memory.\n");
+	for(w=0;w<(uint32_t)table->workers;++w){
+		for(i=0;i<num_flows;++i){
+			key = &flow_keys[w*num_flows+i];
+			key->layer3_version = 0x44;
+			key->layer4_version = IP_PROTOCOL_TCP;
+			key->ifindex        = nif->ifindex;
+			key->src_port       = odp_cpu_to_be_16(CLIENT_PORT+i);
+			key->dst_port       = odp_cpu_to_be_16(SERVER_PORT);
+			key->v4.src_ip      = tcpgen_client_ip(w);
+			key->v4.dst_ip      = server_ip;
+			establish(key);
+		}
+	}
+}
+
+/* ------------------- Subsystems ------------------- */
+
+static void run_socket_lookup(result_t* res,uint32_t me){
+	fastnet_socket_t sock;
+	uint32_t i,n = table->workers*num_flows;
+	
+	/* Every worker starts at its own connections, and walks through all of them. */
+	for(i=0;i<num_ops;++i){
+		sock = fastnet_socket_lookup(&flow_keys[(me*num_flows+i)%n]);
+		if(odp_likely(sock!=ODP_BUFFER_INVALID)) fastnet_socket_put(sock);
+		else res->misses++;
+	}
+	res->ops = num_ops;
+}
+
+static void run_arp_cache(result_t* res,uint32_t me){
+	uint64_t hwaddr;
+	int sendarp;
+	uint32_t i;
+	
+	for(i=0;i<num_ops;++i){
+		if(fastnet_ipv4_mac_lookup(nif,neighbor_ip((me*(NEIGHBORS/NET_MAXTHREAD)+i)%NEIGHBORS),&hwaddr,&sendarp,ODP_PACKET_INVALID)!=NETPP_CONTINUE)
+			res->misses++;
+	}
+	res->ops = num_ops;
+}
+
+static void run_nd6_cache(result_t* res,uint32_t me){
+	nd6_nce_handle_t handle;
+	nd6_nce_t* ptr;
+	ipv6_addr_t addr;
+	uint32_t i;
+	
+	for(i=0;i<num_ops;++i){
+		addr = neighbor_ip6((me*(NEIGHBORS/NET_MAXTHREAD)+i)%NEIGHBORS);
+		fastnet_nd6_nce_lock_key(nif,addr);
+		handle = fastnet_nd6_nce_find_or_create(nif,addr,odp_time_global());
+		if(odp_unlikely(handle==ODP_BUFFER_INVALID)){
+			fastnet_nd6_nce_unlock_key(nif,addr);
+			res->misses++;
+			continue;
+		}
+		ptr = odp_buffer_addr(handle);
+		if(odp_unlikely(ptr->state!=ND6_NC_REACHABLE)) res->misses++;
+		fastnet_nd6_nce_unlock(handle);
+		fastnet_nd6_nce_put(handle);
+	}
+	res->ops = num_ops;
+}
+
+static void run_tcp_state(result_t* res,uint32_t me){
+	odp_packet_t pkt;
+	uint32_t i,flow,round;
+	
+	for(i=0;i<num_ops;++i){
+		flow  = i%num_flows;
+		round = i/num_flows;
+		
+		/*
+		 * The stack does not process segment text yet, so RCV.NXT does not advance.
+		 * The sequence numbers wrap within the receive window.
+		 */
+		pkt = tcpgen_segment(nif,me,CLIENT_PORT+flow,CLIENT_ISS+1+((round*PAYLOAD)%(RCV_WND-PAYLOAD)),
+			SERVER_ISS+1,FNET_TCP_SGT_ACK|FNET_TCP_SGT_PSH,PAYLOAD);
+		if(odp_unlikely(pkt==ODP_PACKET_INVALID)){
+			res->misses++;
+			continue;
+		}
+		if(fastnet_classified_input(pkt)!=NETPP_CONSUMED) odp_packet_free(pkt);
+		res->ops++;
+		if((i%BURST)==(BURST-1)){
+			fastnet_flowdir_poll();
+			fastnet_mem_discard(nif);
+		}
+	}
+}
+
+static void run_tx_enqueue(result_t* res,uint32_t me){
+	odp_packet_t pkts[BURST];
+	odp_event_t ev[BURST];
+	odp_queue_t queue = nif->output[odp_thread_id() % nif->num_queues];
+	uint32_t i;
+	int j,n,k;
+	
+	(void)me;
+	for(n=0;n<BURST;++n){
+		pkts[n] = fastnet_pktout_alloc(PAYLOAD);
+		if(pkts[n]==ODP_PACKET_INVALID) break;
+	}
+	
+	/* The packets circulate: enqueued by fastnet_pkt_output(), and dequeued again. */
+	for(i=0;i<num_ops;i+=BURST){
+		for(j=0;j<n;++j){
+			if(fastnet_pkt_output(pkts[j],nif)==NETPP_CONSUMED) res->ops++;
+			else{
+				odp_packet_free(pkts[j]);
+				res->misses++;
+			}
+		}
+		k = odp_queue_deq_multi(queue,ev,BURST);
+		for(n=0;n<k;++n) pkts[n] = odp_packet_from_event(ev[n]);
+	}
+	for(j=0;j<n;++j) odp_packet_free(pkts[j]);
+}
+
+static void run_tcp_flows(result_t* res,uint32_t me){
+	tcpgen_result_t* tres = &tcpgen_results[me];
+	int ph;
+	
+	memset(tres,0,sizeof(*tres));
+	tcpgen_run(tres,me);
+	for(ph=0;ph<TCPGEN_NUM_PHASES;++ph) res->ops += tres->count[ph];
+	res->misses = tres->no_buffer+tres->bad_cksum+(num_flows-tres->established);
+}
+
+static void run_pcap_replay(result_t* res,uint32_t me){
+	replay_result_t* rres = &replay_results[me];
+	
+	memset(rres,0,sizeof(*rres));
+	replay_run(rres,replay_rounds);
+	res->ops    = rres->packets;
+	res->misses = rres->no_buffer;
+}
+
+/* pcap_replay comes last: It is left out without a pcap file. */
+static subsystem_t subsystems[] = {
+	{ .name = "socket_lookup", .run = run_socket_lookup },
+	{ .name = "arp_cache",     .run = run_arp_cache },
+	{ .name = "nd6_cache",     .run = run_nd6_cache },
+	{ .name = "tcp_state",     .run = run_tcp_state },
+	{ .name = "tx_enqueue",    .run = run_tx_enqueue },
+	{ .name = "tcp_flows",     .run = run_tcp_flows },
+	{ .name = "pcap_replay",   .run = run_pcap_replay },
+};
+
+#define NUM_SUBSYSTEMS (sizeof(subsystems)/sizeof(subsystems[0]))
+
+/* ------------------- Workers ------------------- */
+
+static int worker(void* arg){
+	subsystem_t* sub = arg;
+	result_t* res;
+	odp_time_t begin;
+	
+	fastnet_worker_enter(odp_atomic_fetch_inc_u32(&(table->worker_seq)));
+	fastnet_numa_thread_init();
+	res = &results[fastnet_worker_id()];
+	memset(res,0,sizeof(*res));
+	
+	odp_barrier_wait(&barrier);
+	begin = odp_time_local();
+	sub->run(res,fastnet_worker_id());
+	
+	/* Process the forwarded packets, and wait for the other workers. */
+	odp_barrier_wait(&barrier);
+	while(fastnet_flowdir_poll()>0);
+	fastnet_mem_discard(nif);
+	res->ns = odp_time_to_ns(odp_time_diff(odp_time_local(),begin));
+	
+	fastnet_alloc_flush();
+	return 0;
+}
+
+static void run(subsystem_t* sub,int r,int workers){
+	uint64_t ops = 0,misses = 0,ns = 0;
+	int i;
+	
+	fastnet_flowdir_set_workers(workers);
+	fastnet_lockprof_reset();
+	odp_barrier_init(&barrier,workers);
+	fastnet_runworkers(table,workers,worker,sub);
+	fastnet_mem_discard(nif);
+	
+	for(i=0;i<workers;++i){
+		ops    += results[i].ops;
+		misses += results[i].misses;
+		if(results[i].ns>ns) ns = results[i].ns;
+	}
+	sub->workers[r] = workers;
+	sub->mpps[r]    = ns ? ((double)ops*1000.0)/ns : 0.0;
+	sub->misses[r]  = misses;
+#ifdef NET_LOCKPROF
+	fastnet_lockprof_sum(sub->locks[r]);
+#endif
+	fprintf(stderr,"%-14s %3d workers: %8.3f Mpps\n",sub->name,workers,sub->mpps[r]);
+}
+
+/* ------------------- Output ------------------- */
+
+static void print_json(int runs){
+	subsystem_t* sub;
+	unsigned s;
+	int r,c,cpu;
+	
+	printf("{\n");
+	printf("  \"benchmark\": \"scaling\",\n");
+	printf("  \"ops_per_worker\": %u,\n",num_ops);
+	printf("  \"flows_per_worker\": %u,\n",num_flows);
+	printf("  \"cpus\": [");
+	cpu = odp_cpumask_first(&(table->cpumask));
+	for(c=0;c<table->workers;++c){
+		printf(c ? ", %d" : "%d",cpu);
+		cpu = odp_cpumask_next(&(table->cpumask),cpu);
+	}
+	printf("],\n");
+	printf("  \"subsystems\": {\n");
+	for(s=0;s<num_subsystems;++s){
+		sub = &subsystems[s];
+		printf("    \"%s\": [\n",sub->name);
+		for(r=0;r<runs;++r){
+			printf("      { \"workers\": %d, \"mpps\": %.4f, \"mpps_per_worker\": %.4f, \"efficiency\": %.4f, \"misses\": %llu",
+				sub->workers[r],sub->mpps[r],sub->mpps[r]/sub->workers[r],
+				sub->mpps[0]>0 ? sub->mpps[r]/(sub->mpps[0]*sub->workers[r]) : 0.0,
+				(unsigned long long)sub->misses[r]);
+#ifdef NET_LOCKPROF
+			printf(",\n        \"locks\": {");
+			for(c=0;c<FASTNET_LOCK_NUM_CLASSES;++c){
+				printf("%s\n          \"%s\": { \"acquired\": %llu, \"contended\": %llu, \"spin_cycles\": %llu, \"hold_cycles\": %llu }",
+					c ? "," : "",fastnet_lockprof_name(c),
+					(unsigned long long)sub->locks[r][c].acquired,
+					(unsigned long long)sub->locks[r][c].contended,
+					(unsigned long long)sub->locks[r][c].spin_cycles,
+					(unsigned long long)sub->locks[r][c].hold_cycles);
+			}
+			printf("\n        }");
+#endif
+			printf(" }%s\n",r+1<runs ? "," : "");
+		}
+		printf("    ]%s\n",s+1<num_subsystems ? "," : "");
+	}
+	printf("  }\n");
+	printf("}\n");
+}
+
+/* ------------------- Main ------------------- */
+
+int main(int argc,char** argv){
+	odp_instance_t instance;
+	nif_t* tcp_nif;
+	nif_t* replay_nif;
+	const char* pcap = NULL;
+	int counts[MAX_RUNS];
+	int runs,r,w;
+	unsigned s;
+	uint32_t segments;
+	
+	if(argc>1 && argv[1][0]!='-') num_ops = atoi(argv[1]);
+	if(argc>2 && argv[2][0]!='-') num_flows = atoi(argv[2]);
+	if(argc>3 && argv[3][0]!='-') pcap = argv[3];
+	if(!num_ops || !num_flows || num_flows>MAX_FLOWS)
+		EXAMPLE_ABORT("Usage: %s [ops] [flows (1-%d)] [file.pcap] [--key=value ...]\n",argv[0],MAX_FLOWS);
+	
+	if(odp_init_global(&instance, NULL, NULL))
+		EXAMPLE_ABORT("Error: ODP global init failed.\n");
+	if(odp_init_local(instance, ODP_THREAD_CONTROL))
+		EXAMPLE_ABORT("Error: ODP local init failed.\n");
+	
+	if(fastnet_conf_args(&fastnet_conf,argc,argv))
+		EXAMPLE_ABORT("Error: invalid configuration.\n");
+	fastnet_conf_finalize(&fastnet_conf);
+	
+	num_subsystems = NUM_SUBSYSTEMS-1;
+	if(pcap){
+		if(replay_load(pcap) || !replay_frames())
+			EXAMPLE_ABORT("Error: can't load '%s' (Ethernet pcap expected).\n",pcap);
+		replay_rounds = num_ops/replay_frames();
+		if(!replay_rounds) replay_rounds = 1;
+		num_subsystems = NUM_SUBSYSTEMS;
+	}
+	
+	if(!fastnet_pools_init(0,0,0,0))
+		EXAMPLE_ABORT("Error: allocating pools.\n");
+	fastnet_tlp_init();
+	table = calloc(sizeof(*table),1);
+	if(!table || !fastnet_niftable_prepare(table,instance))
+		EXAMPLE_ABORT("Error: nif-table init failed.\n");
+	nif = fastnet_openpktio(table,"mem:0");
+	if(!nif) EXAMPLE_ABORT("Error: can't open mem:0.\n");
+	fastnet_nif_offload_emulate(nif);
+	tcp_nif = fastnet_openpktio(table,"mem:1");
+	if(!tcp_nif) EXAMPLE_ABORT("Error: can't open mem:1.\n");
+	fastnet_nif_offload_emulate(tcp_nif);
+	
+	/* The connections of tcp_state, and those of tcp_flows. */
+	if(2*(uint64_t)table->workers*num_flows>(uint64_t)fastnet_conf.tcp_pcbs)
+		EXAMPLE_ABORT("Error: %u flows exceed --tcp_pcbs=%u\n",2*table->workers*num_flows,fastnet_conf.tcp_pcbs);
+	setup();
+	
+	/* About 'ops' segments per worker, mostly data. */
+	segments = num_ops/(2*num_flows);
+	if(!segments) segments = 1;
+	if(tcpgen_init(table,tcp_nif,num_flows,segments,&barrier))
+		EXAMPLE_ABORT("Error: TCP workload init failed.\n");
+	
+	if(pcap){
+		replay_nif = fastnet_openpktio(table,"mem:2");
+		if(!replay_nif) EXAMPLE_ABORT("Error: can't open mem:2.\n");
+		fastnet_nif_offload_emulate(replay_nif);
+		if(replay_init(replay_nif,&barrier))
+			EXAMPLE_ABORT("Error: replay init failed.\n");
+	}
+	
+	/* 1, 2, 4, ... and all workers. */
+	runs = 0;
+	for(w=1;w<table->workers && runs<MAX_RUNS-1;w<<=1) counts[runs++] = w;
+	counts[runs++] = table->workers;
+	
+	for(s=0;s<num_subsystems;++s)
+		for(r=0;r<runs;++r)
+			run(&subsystems[s],r,counts[r]);
+	
+	print_json(runs);
+	
+	odp_term_local();
+	odp_term_global(instance);
+	return 0;
+}
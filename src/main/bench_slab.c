@@ -0,0 +1,120 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <odp_api.h>
+#include <net/slab.h>
+#include <net/socket_tcp.h>
+
+/*
+ * Benchmark: Startup time and resident memory of a preallocated PCB pool
+ * vs. a slab, that grows on demand. Also compares alloc/free through the magazines
+ * with plain odp_buffer_alloc()/odp_buffer_free().
+ */
+
+#define EXAMPLE_ABORT(...) do{ printf(__VA_ARGS__); abort(); }while(0)
+
+#define PCB_LIMIT  (512*1024)
+#define CHUNK      4096
+#define ROUNDS     1000000
+#define WORKING    1024
+
+static odp_buffer_t bufs[WORKING];
+
+static uint64_t rss_bytes(){
+	unsigned long size = 0,resident = 0;
+	FILE* f = fopen("/proc/self/statm","r");
+	if(!f) return 0;
+	if(fscanf(f,"%lu %lu",&size,&resident)!=2) resident = 0;
+	fclose(f);
+	return ((uint64_t)resident)*sysconf(_SC_PAGESIZE);
+}
+
+static void report(const char* name,odp_time_t begin,uint64_t rss0){
+	uint64_t ns = odp_time_to_ns(odp_time_diff(odp_time_local(),begin));
+	printf("%-24s startup %8.2f ms, RSS +%8.1f MB\n",name,ns/1e6,(rss_bytes()-rss0)/1048576.0);
+}
+
+int main(){
+	odp_instance_t instance;
+	odp_pool_param_t params;
+	odp_pool_t pool;
+	fastnet_slab_t slab;
+	odp_time_t begin;
+	uint64_t rss0,capacity,used;
+	uint32_t chunks;
+	int i,j;
+	
+	if(odp_init_global(&instance, NULL, NULL))
+		EXAMPLE_ABORT("Error: ODP global init failed.\n");
+	if(odp_init_local(instance, ODP_THREAD_CONTROL))
+		EXAMPLE_ABORT("Error: ODP local init failed.\n");
+	
+	odp_pool_param_init(&params);
+	params.type      = ODP_POOL_BUFFER;
+	params.buf.num   = PCB_LIMIT;
+	params.buf.align = 8;
+	params.buf.size  = sizeof(fastnet_tcp_pcb_t);
+	
+	/* ------------------- Startup ------------------- */
+	rss0  = rss_bytes();
+	begin = odp_time_local();
+	pool  = odp_pool_create("bench_prealloc",&params);
+	if(pool==ODP_POOL_INVALID) EXAMPLE_ABORT("Error: pool create failed.\n");
+	report("preallocated pool",begin,rss0);
+	
+	rss0  = rss_bytes();
+	begin = odp_time_local();
+	if(!fastnet_slab_init(&slab,"bench_slab",&params,CHUNK,PCB_LIMIT))
+		EXAMPLE_ABORT("Error: slab init failed.\n");
+	report("slab",begin,rss0);
+	
+	/* ------------------- Alloc/Free ------------------- */
+	begin = odp_time_local();
+	for(j=0;j<ROUNDS/WORKING;++j){
+		for(i=0;i<WORKING;++i) bufs[i] = odp_buffer_alloc(pool);
+		for(i=0;i<WORKING;++i) odp_buffer_free(bufs[i]);
+	}
+	printf("%-24s %8.1f ns/op\n","odp_buffer_alloc/free",
+		odp_time_to_ns(odp_time_diff(odp_time_local(),begin))/(double)(ROUNDS));
+	
+	begin = odp_time_local();
+	for(j=0;j<ROUNDS/WORKING;++j){
+		for(i=0;i<WORKING;++i) bufs[i] = fastnet_slab_buffer_alloc(&slab);
+		for(i=0;i<WORKING;++i) fastnet_slab_buffer_free(&slab,bufs[i]);
+	}
+	printf("%-24s %8.1f ns/op\n","slab alloc/free",
+		odp_time_to_ns(odp_time_diff(odp_time_local(),begin))/(double)(ROUNDS));
+	
+	/* ------------------- Growth and reclaim ------------------- */
+	fastnet_slab_stats(&slab,&chunks,&capacity,&used);
+	printf("before growth: %u chunks, capacity %llu, used %llu\n",chunks,
+		(unsigned long long)capacity,(unsigned long long)used);
+	
+	fastnet_slab_flush_thread(&slab);
+	rss0 = rss_bytes();
+	for(i=0;i<CHUNK*4;++i)
+		if(fastnet_slab_buffer_alloc(&slab)==ODP_BUFFER_INVALID) break;
+	fastnet_slab_stats(&slab,&chunks,&capacity,&used);
+	printf("after %d allocs: %u chunks, capacity %llu, used %llu, RSS +%.1f MB\n",i,chunks,
+		(unsigned long long)capacity,(unsigned long long)used,(rss_bytes()-rss0)/1048576.0);
+	
+	odp_term_local();
+	odp_term_global(instance);
+	return 0;
+}
+
@@ -0,0 +1,183 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <odp_api.h>
+#include <net/socket_tcp.h>
+#include <net/header/layer4.h>
+
+/*
+ * Microbenchmark: Per-segment PCB processing (lookup compare, lock, state and sequence
+ * number update) in cycles/segment, with the previous PCB layout vs. the hot/cold layout.
+ *
+ * The PCBs are visited in random order, so that nearly every access misses the cache, and
+ * the number of cache lines touched per segment dominates.
+ */
+
+#define EXAMPLE_ABORT(...) do{ printf(__VA_ARGS__); abort(); }while(0)
+
+#define NUM_PCBS  (1<<16)
+#define SEGMENTS  4000000
+#define SEG_LEN   1448
+#define KEY_HASH  0x1234
+
+/* The socket header and PCB layout before the hot/cold split. */
+typedef struct {
+	ipv6_addr_t src_ip, dst_ip;
+	uint16_t src_port,dst_port;
+	nif_t * nif;
+	uint8_t layer3_version;
+	uint8_t layer4_version;
+} legacy_key_t;
+
+typedef struct {
+	fastnet_socket_t next_ht;
+	odp_atomic_u32_t refc;
+	uint32_t         is_ht;
+	legacy_key_t     key;
+	uint32_t         hash;
+	uint32_t         type_tag;
+	fastnet_socket_finalizer_t finalizer;
+	fastnet_slab_t*  slab;
+} legacy_sockstruct_t;
+
+typedef struct {
+	legacy_sockstruct_t _head;
+	odp_ticketlock_t lock;
+	uint8_t state;
+	struct {
+		uint32_t una,nxt,wnd,up,wl1,wl2;
+	} snd;
+	struct {
+		uint32_t nxt,wnd,up;
+	} rcv;
+	uint32_t iss;
+	uint32_t irs;
+	struct {
+		odp_packet_t buf;
+		uint64_t     eth_lifetime;
+		odp_time_t   eth_tstamp;
+		nif_t*       eth_nif;
+	} tcpiphdr;
+} legacy_pcb_t;
+
+static uint32_t order[NUM_PCBS];
+
+/*
+ * The same code for both layouts. The PCBs are placed back to back, every one starting on
+ * a cache line, like in a pool.
+ */
+#define STRIDE(T) ((sizeof(T)+ODP_CACHE_LINE_SIZE-1)&~(size_t)(ODP_CACHE_LINE_SIZE-1))
+
+#define LEGACY_KEY_EQ(a,b) \
+	(IP6ADDR_EQ((a)->src_ip,(b)->src_ip) && IP6ADDR_EQ((a)->dst_ip,(b)->dst_ip) && \
+	 (a)->src_port==(b)->src_port && (a)->dst_port==(b)->dst_port && (a)->nif==(b)->nif && \
+	 (a)->layer3_version==(b)->layer3_version && (a)->layer4_version==(b)->layer4_version)
+
+#define SEGMENT_LOOP(T,K,EQ,name) \
+static uint64_t name(uint8_t* base,K* key){ \
+	uint64_t begin,end; \
+	uint32_t i,hit = 0; \
+	T* pcb; \
+	begin = odp_cpu_cycles(); \
+	for(i=0;i<SEGMENTS;++i){ \
+		pcb = (T*)(base+((size_t)order[i%NUM_PCBS])*STRIDE(T)); \
+		if(pcb->_head.hash==KEY_HASH && EQ(key,&(pcb->_head.key))) hit++; \
+		odp_ticketlock_lock(&(pcb->lock)); \
+		if(odp_likely(pcb->state==4)){ \
+			if(pcb->rcv.nxt==pcb->snd.wl1) pcb->rcv.nxt += SEG_LEN; \
+			pcb->snd.wl1  = pcb->rcv.nxt; \
+			pcb->snd.una  = pcb->snd.nxt; \
+			pcb->snd.wnd  = pcb->rcv.wnd; \
+		} \
+		odp_ticketlock_unlock(&(pcb->lock)); \
+	} \
+	end = odp_cpu_cycles(); \
+	if(hit!=SEGMENTS) EXAMPLE_ABORT("Error: key mismatch.\n"); \
+	return odp_cpu_cycles_diff(end,begin); \
+}
+
+SEGMENT_LOOP(legacy_pcb_t,legacy_key_t,LEGACY_KEY_EQ,bench_legacy)
+SEGMENT_LOOP(fastnet_tcp_pcb_t,socket_key_t,fastnet_socket_key_eq,bench_hotcold)
+
+#define INIT_PCBS(T,base,k) do{ \
+	uint32_t j; T* p; \
+	for(j=0;j<NUM_PCBS;++j){ \
+		p = (T*)((base)+((size_t)j)*STRIDE(T)); \
+		odp_ticketlock_init(&(p->lock)); \
+		p->_head.key  = *(k); \
+		p->_head.hash = KEY_HASH; \
+		p->state = 4; \
+		p->rcv.nxt = p->snd.wl1 = j; \
+		p->rcv.wnd = 0xffff; \
+	} }while(0)
+
+int main(){
+	odp_instance_t instance;
+	legacy_key_t lkey;
+	socket_key_t key;
+	uint8_t *legacy,*hotcold;
+	uint32_t i,j,t;
+	
+	if(odp_init_global(&instance, NULL, NULL))
+		EXAMPLE_ABORT("Error: ODP global init failed.\n");
+	if(odp_init_local(instance, ODP_THREAD_CONTROL))
+		EXAMPLE_ABORT("Error: ODP local init failed.\n");
+	
+	if(posix_memalign((void**)&legacy,ODP_CACHE_LINE_SIZE,STRIDE(legacy_pcb_t)*NUM_PCBS) ||
+	   posix_memalign((void**)&hotcold,ODP_CACHE_LINE_SIZE,STRIDE(fastnet_tcp_pcb_t)*NUM_PCBS))
+		EXAMPLE_ABORT("Error: out of memory.\n");
+	memset(legacy,0,STRIDE(legacy_pcb_t)*NUM_PCBS);
+	memset(hotcold,0,STRIDE(fastnet_tcp_pcb_t)*NUM_PCBS);
+	
+	/* Every lookup compare hits, so the whole key is read. */
+	memset(&key,0,sizeof key);
+	key.src_port       = odp_cpu_to_be_16(80);
+	key.dst_port       = odp_cpu_to_be_16(40000);
+	key.layer3_version = 0x44;
+	key.layer4_version = IP_PROTOCOL_TCP;
+	memset(&lkey,0,sizeof lkey);
+	lkey.src_port       = key.src_port;
+	lkey.dst_port       = key.dst_port;
+	lkey.layer3_version = key.layer3_version;
+	lkey.layer4_version = key.layer4_version;
+	INIT_PCBS(legacy_pcb_t,legacy,&lkey);
+	INIT_PCBS(fastnet_tcp_pcb_t,hotcold,&key);
+	
+	/* Random visiting order (Fisher-Yates). */
+	for(i=0;i<NUM_PCBS;++i) order[i] = i;
+	for(i=NUM_PCBS-1;i>0;--i){
+		j = (uint32_t)rand()%(i+1);
+		t = order[i]; order[i] = order[j]; order[j] = t;
+	}
+	
+	printf("PCB size: legacy %zu bytes, hot/cold %zu bytes\n",sizeof(legacy_pcb_t),sizeof(fastnet_tcp_pcb_t));
+	
+	/* Warm up. */
+	bench_legacy(legacy,&lkey);
+	bench_hotcold(hotcold,&key);
+	
+	printf("%-16s %8.1f cycles/segment\n","legacy",((double)bench_legacy(legacy,&lkey))/SEGMENTS);
+	printf("%-16s %8.1f cycles/segment\n","hot/cold",((double)bench_hotcold(hotcold,&key))/SEGMENTS);
+	
+	free(legacy);
+	free(hotcold);
+	odp_term_local();
+	odp_term_global(instance);
+	return 0;
+}
+
@@ -0,0 +1,147 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <odp_api.h>
+#include <odp/helper/linux.h>
+#include <net/niftable.h>
+#include <net/nethread.h>
+#include <net/numa.h>
+#include <net/conf.h>
+#include <net/pkt_alloc.h>
+#include <net/mem_pktio.h>
+#include <net/stats.h>
+#include "tcpgen.h"
+
+/*
+ * Benchmark: Synthetic TCP clients against a listening socket, end to end.
+ *
+ *   bench_tcpgen [flows] [segments] [--key=value ...]
+ *
+ * Every worker plays 'flows' clients, and sends 'segments' data segments per connection
+ * in either direction (see "tcpgen.h" for the phases). The segments are received on an
+ * in-memory device ("mem:0", see <net/mem_pktio.h>), whose transmitted packets are taken
+ * out and verified by the workload.
+ */
+
+#define EXAMPLE_ABORT(...) do{ printf(__VA_ARGS__); abort(); }while(0)
+
+#define DEF_FLOWS     4096
+#define DEF_SEGMENTS  16
+
+static nif_table_t*    table;
+static odp_barrier_t   barrier;
+static tcpgen_result_t results[NET_MAXTHREAD];
+
+static int worker(void* arg){
+	uint32_t me;
+	
+	(void)arg;
+	fastnet_worker_enter(odp_atomic_fetch_inc_u32(&(table->worker_seq)));
+	fastnet_numa_thread_init();
+	me = fastnet_worker_id();
+	
+	tcpgen_run(&results[me],me);
+	
+	fastnet_alloc_flush();
+	return 0;
+}
+
+int main(int argc,char** argv){
+	odp_instance_t instance;
+	nif_t* nif;
+	uint64_t cycles[TCPGEN_NUM_PHASES],count[TCPGEN_NUM_PHASES],ns[TCPGEN_NUM_PHASES];
+	uint64_t tx = 0,bad_cksum = 0,no_buffer = 0,synacks = 0,established = 0;
+	uint32_t num_flows = DEF_FLOWS,num_segments = DEF_SEGMENTS;
+	int i,k;
+	
+	if(argc>1 && argv[1][0]!='-') num_flows = atoi(argv[1]);
+	if(argc>2 && argv[2][0]!='-') num_segments = atoi(argv[2]);
+	if(!num_flows || num_flows>TCPGEN_MAX_FLOWS)
+		EXAMPLE_ABORT("Usage: %s [flows (1-%d)] [segments] [--key=value ...]\n",argv[0],TCPGEN_MAX_FLOWS);
+	
+	if(odp_init_global(&instance, NULL, NULL))
+		EXAMPLE_ABORT("Error: ODP global init failed.\n");
+	if(odp_init_local(instance, ODP_THREAD_CONTROL))
+		EXAMPLE_ABORT("Error: ODP local init failed.\n");
+	
+	if(fastnet_conf_args(&fastnet_conf,argc,argv))
+		EXAMPLE_ABORT("Error: invalid configuration.\n");
+	fastnet_conf_finalize(&fastnet_conf);
+	
+	if(!fastnet_pools_init(0,0,0,0))
+		EXAMPLE_ABORT("Error: allocating pools.\n");
+	fastnet_tlp_init();
+	table = calloc(sizeof(*table),1);
+	if(!table || !fastnet_niftable_prepare(table,instance))
+		EXAMPLE_ABORT("Error: nif-table init failed.\n");
+	nif = fastnet_openpktio(table,"mem:0");
+	if(!nif) EXAMPLE_ABORT("Error: can't open mem:0.\n");
+	
+	/* The stack leaves the checksums to the NIF; the workload verifies them. */
+	fastnet_nif_offload_emulate(nif);
+	
+	if((uint64_t)table->workers*num_flows>(uint64_t)fastnet_conf.tcp_pcbs)
+		printf("Warning: %u flows exceed --tcp_pcbs=%u\n",table->workers*num_flows,fastnet_conf.tcp_pcbs);
+	if(tcpgen_init(table,nif,num_flows,num_segments,&barrier))
+		EXAMPLE_ABORT("Error: TCP workload init failed.\n");
+	
+	printf("%u flows/worker, %u segments/flow, %d workers\n",num_flows,num_segments,table->workers);
+#ifdef NET_TCP_FLOW_AFFINITY
+	printf("flow affinity (TCP flows are pinned to workers)\n");
+#else
+	printf("no flow affinity (TCP PCBs are locked)\n");
+#endif
+	
+	odp_barrier_init(&barrier,table->workers);
+	fastnet_runworkers(table,table->workers,worker,NULL);
+	
+	memset(cycles,0,sizeof cycles);
+	memset(count,0,sizeof count);
+	memset(ns,0,sizeof ns);
+	for(i=0;i<table->workers;++i){
+		for(k=0;k<TCPGEN_NUM_PHASES;++k){
+			cycles[k] += results[i].cycles[k];
+			count[k]  += results[i].count[k];
+			if(results[i].ns[k]>ns[k]) ns[k] = results[i].ns[k];
+		}
+		synacks     += results[i].synacks;
+		established += results[i].established;
+		tx          += results[i].tx;
+		bad_cksum   += results[i].bad_cksum;
+		no_buffer   += results[i].no_buffer;
+	}
+	
+	printf("%-10s %10.0f conn/s (%llu SYN-ACKs, %llu established)\n","connect",
+		(ns[TCPGEN_PH_SYN]+ns[TCPGEN_PH_ACK]) ? ((double)established*1e9)/(ns[TCPGEN_PH_SYN]+ns[TCPGEN_PH_ACK]) : 0.0,
+		(unsigned long long)synacks,(unsigned long long)established);
+	for(k=0;k<TCPGEN_NUM_PHASES;++k){
+		if(!count[k]) continue;
+		printf("%-10s %10.0f seg/s %8.1f cycles/segment (%llu segments in %.3f s)\n",tcpgen_phase_names[k],
+			ns[k] ? ((double)count[k]*1e9)/ns[k] : 0.0,((double)cycles[k])/count[k],
+			(unsigned long long)count[k],ns[k]/1e9);
+	}
+	printf("%-10s %llu packets, %llu bad checksums, %llu without buffer\n","sink",
+		(unsigned long long)tx,(unsigned long long)bad_cksum,(unsigned long long)no_buffer);
+	
+	printf("\n");
+	fastnet_stats_report(stdout);
+	
+	odp_term_local();
+	odp_term_global(instance);
+	return 0;
+}
@@ -0,0 +1,267 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <odp_api.h>
+#include <net/niftable.h>
+#include <net/nethread.h>
+#include <net/numa.h>
+#include <net/conf.h>
+#include <net/ipv4.h>
+#include <net/ipv6.h>
+#include <net/nd6.h>
+#include <net/ip6ext.h>
+#include <net/packet_input.h>
+#include <net/pkt_alloc.h>
+#include <net/mem_pktio.h>
+#include <net/requirement.h>
+#include <net/checksum.h>
+#include <net/mac_addr_ldst.h>
+#include <net/header/ethhdr.h>
+#include <net/header/iphdr.h>
+#include <net/header/ip6hdr.h>
+#include <net/header/ip6defs.h>
+#include <net/header/layer4.h>
+
+/*
+ * Fuzzing: The protocol parsers, as a libFuzzer target.
+ *
+ *   make fuzz_parsers
+ *   ./fuzz_parsers [-libfuzzer_flag=value ...] [--key=value ...] fuzz_out fuzz/corpus
+ *
+ * The first octet of an input selects the parser (modulo NUM_TARGETS), the rest is the packet
+ * from the L3 header on. The harness puts an Ethernet header in front of it and sets the
+ * offsets and flags, as the classifier and the IP input would:
+ *
+ *   0  fastnet_ip6x_hop_dst_opts()  IPv6 header, Hop-by-Hop (or Destination) Options header.
+ *   1  fastnet_nd6_nsol_input()     IPv6 header, Neighbor Solicitation.
+ *   2  fastnet_nd6_nadv_input()     IPv6 header, Neighbor Advertisement.
+ *   3  fastnet_nd6_radv_input()     IPv6 header, Router Advertisement.
+ *   4  fastnet_arp_input()          ARP packet.
+ *   5  fastnet_icmpv4_input()       IPv4 header, ICMP message.
+ *   6  fastnet_icmpv6_input()       IPv6 header, ICMPv6 message.
+ *
+ * If bit 7 of the first octet is set, the ICMP checksum is inserted before the parser runs,
+ * so the fuzzer gets past the checksum test. The interface is 10.0.0.1/24, fe80::1/64 and
+ * 2001:db8::1/64, on an in-memory device ("mem:0", see <net/mem_pktio.h>); replies are taken
+ * from it and freed.
+ *
+ * fuzz/corpus holds valid packets for every parser, the file names start with the parser.
+ */
+
+#define EXAMPLE_ABORT(...) do{ fprintf(stderr,__VA_ARGS__); abort(); }while(0)
+
+#define FIX_CHECKSUM  0x80
+#define PEER_MAC      0x020000000002ULL
+#define MAX_INPUT     0x4000
+
+enum {
+	T_IP6_OPTS,
+	T_ND6_NSOL,
+	T_ND6_NADV,
+	T_ND6_RADV,
+	T_ARP,
+	T_ICMPV4,
+	T_ICMPV6,
+	NUM_TARGETS
+};
+
+static nif_table_t* table;
+static nif_t*       nif;
+
+static const ipv6_addr_t ipv6_any = IP6_ADDR_ANY_INIT;
+
+static void setup_addresses(){
+	struct ipv4_nif_struct* ipv4;
+	struct ipv6_nif_struct* ipv6;
+	ipv6_addr_t addr;
+	
+	ipv4 = calloc(sizeof(*ipv4),1);
+	ipv6 = calloc(sizeof(*ipv6),1);
+	if(!ipv4 || !ipv6) EXAMPLE_ABORT("Error: out of memory.\n");
+	
+	fastnet_ip_set(ipv4,ipv4_addr_init(10,0,0,1),ipv4_addr_init(0xff,0xff,0xff,0));
+	nif->ipv4 = ipv4;
+	
+	fastnet_ipv6_init(ipv6);
+	memset(&addr,0,sizeof addr);
+	addr.addr[0]  = 0xfe;
+	addr.addr[1]  = 0x80;
+	addr.addr[15] = 1;
+	fastnet_ipv6_addr_add(ipv6,&addr,IPV6_DEFAULT_PREFIX);
+	addr.addr[0]  = 0x20;
+	addr.addr[1]  = 0x01;
+	addr.addr[2]  = 0x0d;
+	addr.addr[3]  = 0xb8;
+	fastnet_ipv6_addr_add(ipv6,&addr,IPV6_DEFAULT_PREFIX);
+	nif->ipv6 = ipv6;
+}
+
+static void drain(){
+	odp_event_t ev;
+	fastnet_mem_discard(nif);
+	
+	/* Replies to the own addresses are in the loopback queue, which is scheduled. */
+	while((ev = odp_schedule(NULL,ODP_SCHED_NO_WAIT))!=ODP_EVENT_INVALID)
+		odp_event_free(ev);
+}
+
+int LLVMFuzzerInitialize(int* argc,char*** argv){
+	odp_instance_t instance;
+	
+	if(odp_init_global(&instance, NULL, NULL))
+		EXAMPLE_ABORT("Error: ODP global init failed.\n");
+	if(odp_init_local(instance, ODP_THREAD_CONTROL))
+		EXAMPLE_ABORT("Error: ODP local init failed.\n");
+	
+	/* libFuzzer's own flags have a single dash, and are skipped. */
+	if(fastnet_conf_args(&fastnet_conf,*argc,*argv))
+		EXAMPLE_ABORT("Error: invalid configuration.\n");
+	fastnet_conf_finalize(&fastnet_conf);
+	
+	if(!fastnet_pools_init(0,0,0,0))
+		EXAMPLE_ABORT("Error: allocating pools.\n");
+	fastnet_tlp_init();
+	table = calloc(sizeof(*table),1);
+	if(!table || !fastnet_niftable_prepare(table,instance))
+		EXAMPLE_ABORT("Error: nif-table init failed.\n");
+	nif = fastnet_openpktio(table,"mem:0");
+	if(!nif) EXAMPLE_ABORT("Error: can't open mem:0.\n");
+	setup_addresses();
+	
+	fastnet_numa_thread_init();
+	return 0;
+}
+
+/*
+ * Builds the packet, as the pktio would receive it: Ethernet header and 'data'.
+ */
+static odp_packet_t build(const uint8_t* data,size_t size,uint16_t type){
+	fnet_eth_header_t eth;
+	odp_packet_t pkt;
+	
+	pkt = odp_packet_alloc(fastnet_pool_pktin(),sizeof(eth)+size);
+	if(odp_unlikely(pkt==ODP_PACKET_INVALID)) return pkt;
+	
+	fastnet_int_to_mac(eth.destination_addr,nif->hwaddr);
+	fastnet_int_to_mac(eth.source_addr,PEER_MAC);
+	eth.type = odp_cpu_to_be_16(type);
+	if(
+		odp_packet_copy_from_mem(pkt,0,sizeof(eth),&eth) ||
+		odp_packet_copy_from_mem(pkt,sizeof(eth),size,data)
+	){
+		odp_packet_free(pkt);
+		return ODP_PACKET_INVALID;
+	}
+	
+	odp_packet_l2_offset_set(pkt,0);
+	odp_packet_l3_offset_set(pkt,sizeof(eth));
+	odp_packet_has_eth_set(pkt,1);
+	odp_packet_user_ptr_set(pkt,nif);
+	fastnet_pkt_uarea_init(pkt);
+	return pkt;
+}
+
+/*
+ * Inserts the checksum of the ICMP message at 'l4'.
+ */
+static void fix_checksum(odp_packet_t pkt,uint32_t l4,const fnet_ip6_header_t* ip6){
+	uint16_t cksum = 0;
+	
+	if(odp_packet_len(pkt)<l4+4) return;
+	odp_packet_copy_from_mem(pkt,l4+2,2,&cksum);
+	if(ip6)
+		cksum = fastnet_ip6_checksum(pkt,ip6->source_addr,ip6->destination_addr,IP_PROTOCOL_ICMP6,NULL,0);
+	else
+		cksum = fastnet_checksum(pkt,l4,0,nif,0);
+	odp_packet_copy_from_mem(pkt,l4+2,2,&cksum);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data,size_t size){
+	fnet_ip6_header_t ip6;
+	odp_packet_t pkt;
+	netpp_retcode_t ret;
+	uint32_t l4,ihl,tlen;
+	uint8_t sel;
+	int target,nxt;
+	
+	if(size<1 || size>MAX_INPUT) return 0;
+	sel = data[0];
+	target = (sel&~FIX_CHECKSUM)%NUM_TARGETS;
+	data++;
+	size--;
+	
+	switch(target){
+	case T_ARP:
+		pkt = build(data,size,NETPROT_L3_ARP);
+		if(pkt==ODP_PACKET_INVALID) return 0;
+		odp_packet_has_arp_set(pkt,1);
+		ret = fastnet_arp_input(pkt);
+		break;
+	case T_ICMPV4:
+		/* The IP input has checked the header length, and cut the packet to the total length. */
+		if(size<sizeof(fnet_ip_header_t)) return 0;
+		ihl = (data[0]&0xf)<<2;
+		tlen = (((uint32_t)data[2])<<8)|data[3];
+		if(ihl<sizeof(fnet_ip_header_t) || tlen<ihl || tlen>size) return 0;
+		size = tlen;
+		pkt = build(data,size,NETPROT_L3_IPV4);
+		if(pkt==ODP_PACKET_INVALID) return 0;
+		l4 = sizeof(fnet_eth_header_t)+ihl;
+		odp_packet_l4_offset_set(pkt,l4);
+		odp_packet_has_ipv4_set(pkt,1);
+		odp_packet_has_icmp_set(pkt,1);
+		if(sel&FIX_CHECKSUM) fix_checksum(pkt,l4,NULL);
+		ret = fastnet_icmpv4_input(pkt);
+		break;
+	default:
+		/* The IPv6 input has checked the header, and cut the packet to the payload length. */
+		if(size<sizeof(fnet_ip6_header_t)) return 0;
+		memcpy(&ip6,data,sizeof(ip6));
+		tlen = sizeof(fnet_ip6_header_t)+odp_be_to_cpu_16(ip6.length);
+		if(tlen>size) return 0;
+		size = tlen;
+		pkt = build(data,size,NETPROT_L3_IPV6);
+		if(pkt==ODP_PACKET_INVALID) return 0;
+		l4 = sizeof(fnet_eth_header_t)+sizeof(fnet_ip6_header_t);
+		odp_packet_l4_offset_set(pkt,l4);
+		odp_packet_has_ipv6_set(pkt,1);
+		if(target!=T_IP6_OPTS && (sel&FIX_CHECKSUM)) fix_checksum(pkt,l4,&ip6);
+		switch(target){
+		case T_IP6_OPTS:
+			ret = fastnet_ip6x_hop_dst_opts(pkt,&nxt,0);
+			break;
+		case T_ND6_NSOL:
+			ret = fastnet_nd6_nsol_input(pkt,IP6ADDR_EQ(ipv6_any,ip6.source_addr));
+			break;
+		case T_ND6_NADV:
+			ret = fastnet_nd6_nadv_input(pkt,IP6_ADDR_IS_MULTICAST(ip6.destination_addr)?1:0);
+			break;
+		case T_ND6_RADV:
+			ret = fastnet_nd6_radv_input(pkt,&ip6.source_addr);
+			break;
+		default:
+			ret = fastnet_icmpv6_input(pkt);
+			break;
+		}
+		break;
+	}
+	
+	if(ret!=NETPP_CONSUMED) odp_packet_free(pkt);
+	drain();
+	return 0;
+}
@@ -24,6 +24,9 @@
 #include <net/packet_input.h>
 #include <net/header/ip.h>
 #include <net/requirement.h>
+#include <net/conf.h>
+#include <net/stats.h>
+#include <net/log.h>
 
 #include <net/header/iphdr.h>
 #include <net/header/ip6hdr.h>
@@ -121,9 +124,9 @@ void test_arpcache(){
 	}
 }
 
-int main(){
+int main(int argc,char** argv){
 	int i,p;
-
+	
 	/* ---------------------Packet IO Vars.----------------------- */
 	odp_pool_param_t params;
 	odp_instance_t instance;
@@ -152,6 +155,14 @@ int main(){
 	"eth0"
 	"tap:tap1"
 	*/
+	/*
+	 * Configuration: eg. "--config=fastnet.conf" or "--mem_budget=4G --workers=8"
+	 */
+	if(fastnet_conf_args(&fastnet_conf,argc,argv))
+		EXAMPLE_ABORT("Error: invalid configuration.\n");
+	fastnet_conf_finalize(&fastnet_conf);
+	fastnet_conf_print(&fastnet_conf);
+	
 	if(!fastnet_pools_init(0,0,0,0))
 		EXAMPLE_ABORT("Error: allocating pools.\n");
 	fastnet_tlp_init();
@@ -168,6 +179,14 @@ int main(){
 	
 	/* ---------------------Thread Code.----------------------- */
 	
+	/* The workers log into per-worker rings, this thread writes them out. */
+	if(fastnet_log_start(stdout,100))
+		printf("Warning: log thread failed.\n");
+	
+	/* The counters can be read with "cat /dev/shm/fastnet.stats". */
+	if(fastnet_stats_export_start("/dev/shm/fastnet.stats",fastnet_conf.stats_interval))
+		printf("Warning: statistics export failed.\n");
+	
 	fastnet_runthreads(table);
 	
 	odp_term_local();
@@ -0,0 +1,317 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <odp_api.h>
+#include <net/ipv4.h>
+#include <net/ipv6.h>
+#include <net/ipv4_mac_cache.h>
+#include <net/packet_input.h>
+#include <net/pkt_alloc.h>
+#include <net/mem_pktio.h>
+#include <net/requirement.h>
+#include <net/flow_director.h>
+#include <net/mac_addr_ldst.h>
+#include <net/socket_tcp.h>
+#include <net/fastnet_tcp.h>
+#include <net/stats.h>
+#include <net/latency.h>
+#include <net/header/ethhdr.h>
+#include <net/header/iphdr.h>
+#include <net/header/ip6hdr.h>
+#include <net/header/ip6defs.h>
+#include <net/header/tcphdr.h>
+#include <net/header/layer4.h>
+#include "pcap_replay.h"
+
+#define BURST       32
+#define MAX_FRAMES  (1<<20)
+#define MAX_LISTEN  64
+
+/* ------------------- pcap ------------------- */
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version_major,version_minor;
+	int32_t  thiszone;
+	uint32_t sigfigs;
+	uint32_t snaplen;
+	uint32_t network;
+} pcap_hdr_t;
+
+typedef struct {
+	uint32_t ts_sec,ts_usec;
+	uint32_t incl_len;
+	uint32_t orig_len;
+} pcap_rec_t;
+
+#define PCAP_MAGIC      0xa1b2c3d4
+#define PCAP_MAGIC_NSEC 0xa1b23c4d
+#define PCAP_LINK_ETH   1
+
+#define SWAP32(x) __builtin_bswap32(x)
+
+/* ------------------- Frames ------------------- */
+
+const char* replay_path_names[REPLAY_NUM_PATHS] = {
+	"arp","ipv4/tcp","ipv4/udp","ipv4/icmp","ipv4/other",
+	"ipv6/tcp","ipv6/udp","ipv6/icmp","ipv6/other","other",
+};
+
+typedef struct {
+	uint8_t* data;
+	uint32_t len;
+	uint16_t l3off;
+	uint8_t  path;
+} frame_t;
+
+static frame_t*       frames;
+static uint32_t       num_frames;
+static nif_t*         nif;
+static odp_barrier_t* barrier;
+
+int replay_load(const char* path){
+	pcap_hdr_t hdr;
+	pcap_rec_t rec;
+	frame_t*   fr;
+	int swap;
+	FILE* f = fopen(path,"rb");
+	if(!f) return 1;
+	if(fread(&hdr,sizeof hdr,1,f)!=1) goto fail;
+	
+	swap = 0;
+	if(hdr.magic!=PCAP_MAGIC && hdr.magic!=PCAP_MAGIC_NSEC){
+		hdr.magic = SWAP32(hdr.magic);
+		hdr.network = SWAP32(hdr.network);
+		if(hdr.magic!=PCAP_MAGIC && hdr.magic!=PCAP_MAGIC_NSEC) goto fail;
+		swap = 1;
+	}
+	if(hdr.network!=PCAP_LINK_ETH) goto fail;
+	
+	frames = calloc(sizeof(frame_t),MAX_FRAMES);
+	if(!frames) goto fail;
+	
+	while(num_frames<MAX_FRAMES && fread(&rec,sizeof rec,1,f)==1){
+		if(swap) rec.incl_len = SWAP32(rec.incl_len);
+		if(rec.incl_len>0xffff) goto fail;
+		fr = &frames[num_frames];
+		fr->len  = rec.incl_len;
+		fr->data = malloc(fr->len ? fr->len : 1);
+		if(!fr->data || fread(fr->data,1,fr->len,f)!=fr->len) goto fail;
+		num_frames++;
+	}
+	fclose(f);
+	return 0;
+fail:
+	fclose(f);
+	return 1;
+}
+
+uint32_t replay_frames(){
+	return num_frames;
+}
+
+static uint8_t l4_path(uint8_t proto,int v6){
+	switch(proto){
+	case IP_PROTOCOL_TCP:   return v6 ? REPLAY_PATH_IP6_TCP  : REPLAY_PATH_IP4_TCP;
+	case IP_PROTOCOL_UDP:   return v6 ? REPLAY_PATH_IP6_UDP  : REPLAY_PATH_IP4_UDP;
+	case IP_PROTOCOL_ICMP:  return v6 ? REPLAY_PATH_IP6_OTHER: REPLAY_PATH_IP4_ICMP;
+	case IP_PROTOCOL_ICMP6: return v6 ? REPLAY_PATH_IP6_ICMP : REPLAY_PATH_IP4_OTHER;
+	}
+	return v6 ? REPLAY_PATH_IP6_OTHER : REPLAY_PATH_IP4_OTHER;
+}
+
+static int listen_tcp(uint16_t port){
+	static uint16_t ports[MAX_LISTEN];
+	static int nports = 0;
+	fastnet_socket_t sock;
+	fastnet_tcp_pcb_t* pcb;
+	socket_key_t key;
+	int i;
+	
+	for(i=0;i<nports;++i) if(ports[i]==port) return 0;
+	if(nports>=MAX_LISTEN) return 0;
+	ports[nports++] = port;
+	
+	sock = fastnet_tcp_allocate();
+	if(sock==ODP_BUFFER_INVALID) return 1;
+	pcb = odp_buffer_addr(sock);
+	memset(&(pcb->snd),0,sizeof(pcb->snd));
+	memset(&(pcb->rcv),0,sizeof(pcb->rcv));
+	
+	/* IN_ANY: both IP versions, any address. */
+	memset(&key,0,sizeof key);
+	key.layer4_version = IP_PROTOCOL_TCP;
+	key.ifindex        = nif->ifindex;
+	key.dst_port       = port;
+	
+	((fastnet_sockstruct_t*) pcb)->key = key;
+	((fastnet_sockstruct_t*) pcb)->type_tag = IP_PROTOCOL_TCP;
+	fastnet_socket_construct(sock,NULL);
+	pcb->state   = LISTEN;
+	pcb->rcv.wnd = 0xffff;
+	fastnet_socket_insert(sock);
+	return 0;
+}
+
+/*
+ * Classifies the frames, and configures the stack after them.
+ */
+static int prepare(struct ipv4_nif_struct* ipv4,struct ipv6_nif_struct* ipv6){
+	fnet_eth_header_t* eth;
+	fnet_ip_header_t* ip;
+	fnet_ip6_header_t* ip6;
+	fnet_tcp_header_t* th;
+	frame_t* fr;
+	uint16_t type;
+	uint32_t i,hl;
+	int have4 = 0,have6 = 0;
+	
+	for(i=0;i<num_frames;++i){
+		fr = &frames[i];
+		fr->path = REPLAY_PATH_OTHER;
+		if(fr->len<sizeof(fnet_eth_header_t)) continue;
+		eth = (fnet_eth_header_t*)fr->data;
+		type = odp_be_to_cpu_16(eth->type);
+		fr->l3off = sizeof(fnet_eth_header_t);
+		
+		/* One VLAN tag. */
+		if(type==0x8100 && fr->len>=(uint32_t)fr->l3off+4){
+			type = odp_be_to_cpu_16(*((uint16_t*)(fr->data+fr->l3off+2)));
+			fr->l3off += 4;
+		}
+		
+		if(type==NETPROT_L3_ARP){
+			fr->path = REPLAY_PATH_ARP;
+		}else if(type==NETPROT_L3_IPV4 && fr->len>=fr->l3off+sizeof(fnet_ip_header_t)){
+			ip = (fnet_ip_header_t*)(fr->data+fr->l3off);
+			fr->path = l4_path(ip->protocol,0);
+			if(!have4){
+				nif->hwaddr = fastnet_mac_to_int(eth->destination_addr);
+				fastnet_ip_set(ipv4,ip->destination_addr,ipv4_addr_init(0xff,0xff,0xff,0));
+				have4 = 1;
+			}
+			fastnet_ipv4_mac_put(nif,ip->source_addr,fastnet_mac_to_int(eth->source_addr),1);
+			
+			hl = FNET_IP_HEADER_GET_HEADER_LENGTH(ip)*4;
+			if(ip->protocol==IP_PROTOCOL_TCP && fr->len>=fr->l3off+hl+sizeof(fnet_tcp_header_t)){
+				th = (fnet_tcp_header_t*)(fr->data+fr->l3off+hl);
+				if(odp_be_to_cpu_16(th->hdrlength__flags) & FNET_TCP_SGT_SYN)
+					if(listen_tcp(th->destination_port)) return 1;
+			}
+		}else if(type==NETPROT_L3_IPV6 && fr->len>=fr->l3off+sizeof(fnet_ip6_header_t)){
+			ip6 = (fnet_ip6_header_t*)(fr->data+fr->l3off);
+			fr->path = l4_path(ip6->next_header,1);
+			if(!have6 && !IP6_ADDR_IS_MULTICAST(ip6->destination_addr)){
+				fastnet_ipv6_addr_add(ipv6,&(ip6->destination_addr),IPV6_DEFAULT_PREFIX);
+				have6 = 1;
+			}
+			if(ip6->next_header==IP_PROTOCOL_TCP && fr->len>=fr->l3off+sizeof(fnet_ip6_header_t)+sizeof(fnet_tcp_header_t)){
+				th = (fnet_tcp_header_t*)(fr->data+fr->l3off+sizeof(fnet_ip6_header_t));
+				if(odp_be_to_cpu_16(th->hdrlength__flags) & FNET_TCP_SGT_SYN)
+					if(listen_tcp(th->destination_port)) return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+int replay_init(nif_t* n,odp_barrier_t* b){
+	struct ipv4_nif_struct* ipv4;
+	struct ipv6_nif_struct* ipv6;
+	
+	nif     = n;
+	barrier = b;
+	
+	ipv4 = calloc(sizeof(*ipv4),1);
+	ipv6 = calloc(sizeof(*ipv6),1);
+	if(!ipv4 || !ipv6) return 1;
+	fastnet_ipv6_init(ipv6);
+	nif->ipv4 = ipv4;
+	nif->ipv6 = ipv6;
+	return prepare(ipv4,ipv6);
+}
+
+/* ------------------- Workers ------------------- */
+
+/*
+ * Does, what the pktio's parser and fastnet_packet_input() would do.
+ */
+static odp_packet_t receive(frame_t* fr){
+	odp_packet_t pkt = odp_packet_alloc(fastnet_pool_pktin(),fr->len);
+	if(odp_unlikely(pkt==ODP_PACKET_INVALID)) return pkt;
+	odp_packet_copy_from_mem(pkt,0,fr->len,fr->data);
+	odp_packet_l2_offset_set(pkt,0);
+	odp_packet_l3_offset_set(pkt,fr->l3off);
+	odp_packet_has_eth_set(pkt,1);
+	switch(fr->path){
+	case REPLAY_PATH_ARP: odp_packet_has_arp_set(pkt,1); break;
+	case REPLAY_PATH_IP4_TCP: case REPLAY_PATH_IP4_UDP: case REPLAY_PATH_IP4_ICMP: case REPLAY_PATH_IP4_OTHER:
+		odp_packet_has_ipv4_set(pkt,1); break;
+	case REPLAY_PATH_IP6_TCP: case REPLAY_PATH_IP6_UDP: case REPLAY_PATH_IP6_ICMP: case REPLAY_PATH_IP6_OTHER:
+		odp_packet_has_ipv6_set(pkt,1); break;
+	}
+	odp_packet_user_ptr_set(pkt,nif);
+	fastnet_pkt_uarea_init(pkt);
+	fastnet_lat_rx(pkt);
+	return pkt;
+}
+
+void replay_run(replay_result_t* res,uint32_t rounds){
+	odp_packet_t pkts[BURST];
+	frame_t* fr[BURST];
+	uint64_t c0,c1;
+	odp_time_t begin;
+	uint32_t r,i,j,n;
+	
+	odp_barrier_wait(barrier);
+	begin = odp_time_local();
+	
+	for(r=0;r<rounds;++r){
+		for(i=0;i<num_frames;i+=n){
+			n = num_frames-i;
+			if(n>BURST) n = BURST;
+			for(j=0;j<n;++j){
+				fr[j]   = &frames[i+j];
+				pkts[j] = receive(fr[j]);
+			}
+			for(j=0;j<n;++j){
+				if(odp_unlikely(pkts[j]==ODP_PACKET_INVALID)){
+					res->no_buffer++;
+					continue;
+				}
+				c0 = odp_cpu_cycles();
+				if(fastnet_classified_input(pkts[j])!=NETPP_CONSUMED){
+					FASTNET_STAT_INC(drop_total);
+					odp_packet_free(pkts[j]);
+				}
+				c1 = odp_cpu_cycles();
+				res->cycles[fr[j]->path] += odp_cpu_cycles_diff(c1,c0);
+				res->count[fr[j]->path]++;
+			}
+			res->packets += n;
+			fastnet_flowdir_poll();
+			res->tx += fastnet_mem_discard(nif);
+		}
+	}
+	
+	/* Wait for the other workers, then process the remaining forwarded packets. */
+	odp_barrier_wait(barrier);
+	while(fastnet_flowdir_poll()>0);
+	res->tx += fastnet_mem_discard(nif);
+	res->ns += odp_time_to_ns(odp_time_diff(odp_time_local(),begin));
+}
@@ -0,0 +1,83 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+#include <odp_api.h>
+#include <net/nif.h>
+
+/*
+ * The pcap replay workload of bench_replay and bench_scaling.
+ *
+ * The frames of a pcap file are loaded into memory, and fed through fastnet_classified_input(),
+ * as if they were received on a device. What the stack transmits is taken from the device and
+ * freed (see fastnet_mem_discard()), so the device must be an in-memory one ("mem:N").
+ *
+ * The stack takes the destination addresses of the first IPv4 and IPv6 packets as its own.
+ * The ARP cache is filled from the source addresses, and every TCP port, that receives a
+ * SYN, gets a listening socket.
+ */
+
+enum {
+	REPLAY_PATH_ARP,
+	REPLAY_PATH_IP4_TCP,
+	REPLAY_PATH_IP4_UDP,
+	REPLAY_PATH_IP4_ICMP,
+	REPLAY_PATH_IP4_OTHER,
+	REPLAY_PATH_IP6_TCP,
+	REPLAY_PATH_IP6_UDP,
+	REPLAY_PATH_IP6_ICMP,
+	REPLAY_PATH_IP6_OTHER,
+	REPLAY_PATH_OTHER,
+	REPLAY_NUM_PATHS
+};
+
+extern const char* replay_path_names[REPLAY_NUM_PATHS];
+
+/*
+ * Cycles are measured per protocol path around fastnet_classified_input(), and include the
+ * odp_cpu_cycles() overhead. 'ns' includes the packet copy.
+ */
+typedef struct {
+	uint64_t cycles[REPLAY_NUM_PATHS];
+	uint64_t count[REPLAY_NUM_PATHS];
+	uint64_t packets;
+	uint64_t tx;
+	uint64_t no_buffer;
+	uint64_t ns;
+} ODP_ALIGNED_CACHE replay_result_t;
+
+/*
+ * Loads the frames of an Ethernet pcap file. Returns 0 on success, non-0 on failure.
+ */
+int replay_load(const char* path);
+
+/*
+ * Returns the number of frames loaded.
+ */
+uint32_t replay_frames();
+
+/*
+ * Configures 'nif' and the stack after the frames. 'barrier' separates the runs; it must be
+ * initialized with the number of workers before every run.
+ *
+ * Returns 0 on success, non-0 on failure.
+ */
+int replay_init(nif_t* nif,odp_barrier_t* barrier);
+
+/*
+ * Feeds all frames through the stack 'rounds' times. Called by every worker of the run,
+ * the counters are added to 'res'.
+ */
+void replay_run(replay_result_t* res,uint32_t rounds);
@@ -0,0 +1,369 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <odp_api.h>
+#include <net/ipv4.h>
+#include <net/ipv4_mac_cache.h>
+#include <net/packet_input.h>
+#include <net/pkt_alloc.h>
+#include <net/mem_pktio.h>
+#include <net/requirement.h>
+#include <net/flow_director.h>
+#include <net/checksum.h>
+#include <net/mac_addr_ldst.h>
+#include <net/socket_tcp.h>
+#include <net/fastnet_tcp.h>
+#include <net/latency.h>
+#include <net/header/ethhdr.h>
+#include <net/header/iphdr.h>
+#include <net/header/tcphdr.h>
+#include <net/header/layer4.h>
+#include "tcpgen.h"
+
+#define BURST         32
+#define SERVER_PORT   80
+#define CLIENT_PORT   1024
+#define CLIENT_ISS    1000
+#define CLIENT_WND    0xffff
+
+/* Receive window of the listener, inherited by the connections. */
+#define RCV_WND       0xffff
+
+const char* tcpgen_phase_names[TCPGEN_NUM_PHASES] = { "syn","ack","data-in","data-out","close" };
+
+static nif_table_t*   table;
+static nif_t*         nif;
+static uint32_t       num_flows;
+static uint32_t       num_segments;
+static odp_barrier_t* barrier;
+static uint8_t        payload[TCPGEN_PAYLOAD];
+
+static ipv4_addr_t    server_ip;
+
+/* ISS of the server side of every flow, as seen in the SYN-ACK; indexed by flow. */
+static uint32_t*      flow_iss;
+static uint8_t*       flow_synack;
+
+/* ------------------- Segments ------------------- */
+
+odp_packet_t tcpgen_segment(nif_t* dev,uint32_t worker,uint32_t port,uint32_t seq,uint32_t ack,uint16_t flags,uint32_t len){
+	fnet_eth_header_t* eth;
+	fnet_ip_header_t* ip;
+	fnet_tcp_header_t* th;
+	odp_packet_t pkt;
+	uint32_t total = sizeof(*eth)+sizeof(*ip)+sizeof(*th)+len;
+	
+	pkt = odp_packet_alloc(fastnet_pool_pktin(),total);
+	if(odp_unlikely(pkt==ODP_PACKET_INVALID)) return pkt;
+	if(odp_unlikely(odp_packet_seg_len(pkt)<total)){
+		odp_packet_free(pkt);
+		return ODP_PACKET_INVALID;
+	}
+	
+	eth = odp_packet_data(pkt);
+	ip  = (fnet_ip_header_t*)(eth+1);
+	th  = (fnet_tcp_header_t*)(ip+1);
+	memset(eth,0,total);
+	
+	fastnet_int_to_mac(eth->destination_addr,dev->hwaddr);
+	fastnet_int_to_mac(eth->source_addr,tcpgen_client_mac(worker));
+	eth->type = odp_cpu_to_be_16(NETPROT_L3_IPV4);
+	
+	ip->version__header_length = 0x45;
+	ip->total_length           = odp_cpu_to_be_16(total-sizeof(*eth));
+	ip->flags_fragment_offset  = odp_cpu_to_be_16(FNET_IP_DF);
+	ip->ttl                    = 64;
+	ip->protocol               = IP_PROTOCOL_TCP;
+	ip->source_addr            = tcpgen_client_ip(worker);
+	ip->destination_addr       = ipv4_addr_init(10,0,0,1);
+	
+	th->source_port            = odp_cpu_to_be_16(port);
+	th->destination_port       = odp_cpu_to_be_16(SERVER_PORT);
+	th->sequence_number        = odp_cpu_to_be_32(seq);
+	th->ack_number             = odp_cpu_to_be_32(ack);
+	th->hdrlength__flags       = odp_cpu_to_be_16(0x5000|flags);
+	th->window                 = odp_cpu_to_be_16(CLIENT_WND);
+	
+	odp_packet_l2_offset_set(pkt,0);
+	odp_packet_l3_offset_set(pkt,sizeof(*eth));
+	odp_packet_l4_offset_set(pkt,sizeof(*eth)+sizeof(*ip));
+	odp_packet_has_eth_set(pkt,1);
+	odp_packet_has_ipv4_set(pkt,1);
+	odp_packet_has_tcp_set(pkt,1);
+	odp_packet_user_ptr_set(pkt,dev);
+	fastnet_pkt_uarea_init(pkt);
+	fastnet_lat_rx(pkt);
+	fastnet_checksum_insert(pkt,NIFOFL_IP4_CKSUM|NIFOFL_TCP_CKSUM);
+	return pkt;
+}
+
+/*
+ * Verifies the checksums, which the emulated offload of the NIF has inserted.
+ */
+static int bad_checksum(fnet_ip_header_t* ip,uint32_t hl){
+	uint32_t len;
+	uint64_t sum;
+	
+	/* A correct checksum makes the sum 0xffff. */
+	if(fastnet_cksum_fold(fastnet_cksum_sum(ip,hl,0))!=0xffff) return 1;
+	len = odp_be_to_cpu_16(ip->total_length);
+	if(len<hl) return 1;
+	len -= hl;
+	sum = fastnet_ip_ph(ip->source_addr,ip->destination_addr,IP_PROTOCOL_TCP);
+	sum += odp_cpu_to_be_16(len);
+	sum = fastnet_cksum_sum(((uint8_t*)ip)+hl,len,sum);
+	return fastnet_cksum_fold(sum)!=0xffff;
+}
+
+/*
+ * Records the ISS of SYN-ACKs. Every worker drains the sink, so the SYN-ACK of a flow may
+ * be seen by any worker.
+ */
+static void sink_packet(tcpgen_result_t* res,odp_packet_t pkt){
+	fnet_eth_header_t* eth;
+	fnet_ip_header_t* ip;
+	fnet_tcp_header_t* th;
+	uint32_t worker,port,flow,hl;
+	
+	eth = odp_packet_data(pkt);
+	if(odp_packet_seg_len(pkt)<sizeof(*eth)+sizeof(*ip)+sizeof(*th)) return;
+	if(eth->type!=odp_cpu_to_be_16(NETPROT_L3_IPV4)) return;
+	ip = (fnet_ip_header_t*)(eth+1);
+	if(ip->protocol!=IP_PROTOCOL_TCP) return;
+	hl = FNET_IP_HEADER_GET_HEADER_LENGTH(ip)*4;
+	if(odp_packet_seg_len(pkt)<sizeof(*eth)+hl+sizeof(*th)) return;
+	th = (fnet_tcp_header_t*)(((uint8_t*)ip)+hl);
+	if(odp_packet_seg_len(pkt)<sizeof(*eth)+odp_be_to_cpu_16(ip->total_length) || bad_checksum(ip,hl)){
+		res->bad_cksum++;
+		return;
+	}
+	
+	if((odp_be_to_cpu_16(th->hdrlength__flags)&(FNET_TCP_SGT_SYN|FNET_TCP_SGT_ACK))!=(FNET_TCP_SGT_SYN|FNET_TCP_SGT_ACK)) return;
+	worker = (odp_be_to_cpu_32(ip->destination_addr)&0xff)-2;
+	port   = odp_be_to_cpu_16(th->destination_port)-CLIENT_PORT;
+	if(worker>=(uint32_t)table->workers || port>=num_flows) return;
+	flow = worker*num_flows+port;
+	flow_iss[flow]    = odp_be_to_cpu_32(th->sequence_number);
+	flow_synack[flow] = 1;
+}
+
+static uint64_t sink(tcpgen_result_t* res){
+	odp_packet_t pkts[BURST];
+	uint64_t n = 0;
+	int i,k;
+	while((k = fastnet_mem_capture(nif,pkts,BURST))>0){
+		for(i=0;i<k;++i){
+			sink_packet(res,pkts[i]);
+			odp_packet_free(pkts[i]);
+		}
+		n += k;
+	}
+	return n;
+}
+
+/*
+ * The key of the server side of a flow.
+ */
+static void flow_key(socket_key_t* key,uint32_t worker,uint32_t port){
+	memset(key,0,sizeof(*key));
+	key->layer3_version = 0x44;
+	key->layer4_version = IP_PROTOCOL_TCP;
+	key->ifindex        = nif->ifindex;
+	key->src_port       = odp_cpu_to_be_16(port);
+	key->dst_port       = odp_cpu_to_be_16(SERVER_PORT);
+	key->v4.src_ip      = tcpgen_client_ip(worker);
+	key->v4.dst_ip      = server_ip;
+}
+
+/* ------------------- Workers ------------------- */
+
+static inline
+void input(tcpgen_result_t* res,int phase,odp_packet_t pkt){
+	uint64_t c0,c1;
+	if(odp_unlikely(pkt==ODP_PACKET_INVALID)){
+		res->no_buffer++;
+		return;
+	}
+	c0 = odp_cpu_cycles();
+	if(fastnet_classified_input(pkt)!=NETPP_CONSUMED) odp_packet_free(pkt);
+	c1 = odp_cpu_cycles();
+	res->cycles[phase] += odp_cpu_cycles_diff(c1,c0);
+	res->count[phase]++;
+}
+
+static inline
+void output(tcpgen_result_t* res,uint32_t worker,uint32_t port){
+	fastnet_socket_t sock;
+	fastnet_tcp_pcb_t* pcb;
+	socket_key_t key;
+	uint64_t c0,c1;
+	
+	flow_key(&key,worker,port);
+	sock = fastnet_socket_lookup(&key);
+	if(odp_unlikely(sock==ODP_BUFFER_INVALID)) return;
+	pcb = odp_buffer_addr(sock);
+	
+	c0 = odp_cpu_cycles();
+	if(fastnet_tcp_send(sock,pcb->snd.nxt,FNET_TCP_SGT_ACK|FNET_TCP_SGT_PSH,payload,TCPGEN_PAYLOAD)!=TCPGEN_PAYLOAD)
+		res->no_buffer++;
+	c1 = odp_cpu_cycles();
+	pcb->snd.nxt += TCPGEN_PAYLOAD;
+	res->cycles[TCPGEN_PH_DATA_OUT] += odp_cpu_cycles_diff(c1,c0);
+	res->count[TCPGEN_PH_DATA_OUT]++;
+	
+	fastnet_socket_put(sock);
+}
+
+/*
+ * Processes all forwarded segments, and waits for the other workers.
+ */
+static void settle(tcpgen_result_t* res){
+	odp_barrier_wait(barrier);
+	while(fastnet_flowdir_poll()>0);
+	res->tx += sink(res);
+	odp_barrier_wait(barrier);
+	res->tx += sink(res);
+}
+
+/*
+ * Counts the connections of worker 'me', that are ESTABLISHED.
+ */
+static uint64_t established(uint32_t me){
+	fastnet_socket_t sock;
+	socket_key_t key;
+	uint64_t n = 0;
+	uint32_t i;
+	
+	for(i=0;i<num_flows;++i){
+		flow_key(&key,me,CLIENT_PORT+i);
+		sock = fastnet_socket_lookup(&key);
+		if(sock==ODP_BUFFER_INVALID) continue;
+		if(((fastnet_tcp_pcb_t*)odp_buffer_addr(sock))->state==ESTABLISHED) n++;
+		fastnet_socket_put(sock);
+	}
+	return n;
+}
+
+void tcpgen_run(tcpgen_result_t* res,uint32_t me){
+	odp_time_t begin;
+	uint32_t i,k,flow,seq;
+	int ph;
+	
+	/* The SYN-ACKs of the previous run. */
+	memset(&flow_synack[me*num_flows],0,num_flows);
+	odp_barrier_wait(barrier);
+	
+	for(ph=0;ph<TCPGEN_NUM_PHASES;++ph){
+		begin = odp_time_local();
+		for(k=0;k<((ph==TCPGEN_PH_DATA_IN || ph==TCPGEN_PH_DATA_OUT) ? num_segments : 1);++k){
+			for(i=0;i<num_flows;++i){
+				flow = me*num_flows+i;
+				switch(ph){
+				case TCPGEN_PH_SYN:
+					input(res,ph,tcpgen_segment(nif,me,CLIENT_PORT+i,CLIENT_ISS,0,FNET_TCP_SGT_SYN,0));
+					break;
+				case TCPGEN_PH_ACK:
+					if(!flow_synack[flow]) continue;
+					input(res,ph,tcpgen_segment(nif,me,CLIENT_PORT+i,CLIENT_ISS+1,flow_iss[flow]+1,FNET_TCP_SGT_ACK,0));
+					break;
+				case TCPGEN_PH_DATA_IN:
+					/*
+					 * The stack does not process segment text yet, so RCV.NXT does not advance.
+					 * The sequence numbers wrap within the receive window.
+					 */
+					seq = CLIENT_ISS+1+((k*TCPGEN_PAYLOAD)%(RCV_WND-TCPGEN_PAYLOAD));
+					input(res,ph,tcpgen_segment(nif,me,CLIENT_PORT+i,seq,flow_iss[flow]+1,FNET_TCP_SGT_ACK|FNET_TCP_SGT_PSH,TCPGEN_PAYLOAD));
+					break;
+				case TCPGEN_PH_DATA_OUT:
+					output(res,me,CLIENT_PORT+i);
+					break;
+				case TCPGEN_PH_CLOSE:
+					/* RCV.NXT is still CLIENT_ISS+1, so the reset is in the window. */
+					if(!flow_synack[flow]) continue;
+					input(res,ph,tcpgen_segment(nif,me,CLIENT_PORT+i,CLIENT_ISS+1,0,FNET_TCP_SGT_RST,0));
+					break;
+				}
+				if((i%BURST)==(BURST-1)){
+					fastnet_flowdir_poll();
+					res->tx += sink(res);
+				}
+			}
+		}
+		settle(res);
+		res->ns[ph] += odp_time_to_ns(odp_time_diff(odp_time_local(),begin));
+		
+		if(ph==TCPGEN_PH_SYN)
+			for(i=0;i<num_flows;++i) res->synacks += flow_synack[me*num_flows+i];
+		if(ph==TCPGEN_PH_ACK)
+			res->established += established(me);
+	}
+}
+
+/* ------------------- Setup ------------------- */
+
+static int listen_tcp(){
+	fastnet_socket_t sock;
+	fastnet_tcp_pcb_t* pcb;
+	socket_key_t key;
+	
+	sock = fastnet_tcp_allocate();
+	if(sock==ODP_BUFFER_INVALID) return 1;
+	pcb = odp_buffer_addr(sock);
+	memset(&(pcb->snd),0,sizeof(pcb->snd));
+	memset(&(pcb->rcv),0,sizeof(pcb->rcv));
+	
+	memset(&key,0,sizeof key);
+	key.layer3_version = 0x4;
+	key.layer4_version = IP_PROTOCOL_TCP;
+	key.ifindex        = nif->ifindex;
+	key.dst_port       = odp_cpu_to_be_16(SERVER_PORT);
+	key.v4.dst_ip      = server_ip;
+	
+	((fastnet_sockstruct_t*) pcb)->key = key;
+	((fastnet_sockstruct_t*) pcb)->type_tag = IP_PROTOCOL_TCP;
+	fastnet_socket_construct(sock,NULL);
+	pcb->state   = LISTEN;
+	pcb->rcv.wnd = RCV_WND;
+	fastnet_socket_insert(sock);
+	return 0;
+}
+
+int tcpgen_init(nif_table_t* t,nif_t* n,uint32_t flows,uint32_t segments,odp_barrier_t* b){
+	struct ipv4_nif_struct* ipv4;
+	int i;
+	
+	table        = t;
+	nif          = n;
+	num_flows    = flows;
+	num_segments = segments;
+	barrier      = b;
+	
+	server_ip = ipv4_addr_init(10,0,0,1);
+	ipv4 = calloc(sizeof(*ipv4),1);
+	if(!ipv4) return 1;
+	fastnet_ip_set(ipv4,server_ip,ipv4_addr_init(0xff,0xff,0xff,0));
+	nif->ipv4 = ipv4;
+	
+	/* Every client is known to the ARP cache. */
+	for(i=0;i<table->workers;++i)
+		fastnet_ipv4_mac_put(nif,tcpgen_client_ip(i),tcpgen_client_mac(i),1);
+	
+	flow_iss    = calloc(sizeof(uint32_t),table->workers*num_flows);
+	flow_synack = calloc(1,table->workers*num_flows);
+	if(!flow_iss || !flow_synack) return 1;
+	return listen_tcp();
+}
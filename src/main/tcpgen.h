@@ -0,0 +1,99 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+#include <odp_api.h>
+#include <net/nif.h>
+#include <net/niftable.h>
+#include <net/nethread.h>
+#include <net/header/ip.h>
+
+/*
+ * The synthetic TCP workload of bench_tcpgen and bench_scaling.
+ *
+ * Every worker plays 'flows' clients (10.0.0.<2+worker>, ports 1024 and up), that connect
+ * to 10.0.0.1:80 on the device. A run has phases, separated by barriers:
+ *
+ *   syn       The clients send SYNs; the SYN-ACKs are taken from the device, and their ISS is recorded.
+ *   ack       The clients complete the handshake.
+ *   data-in   Every client sends 'segments' data segments.
+ *   data-out  The server sends 'segments' data segments per connection (fastnet_tcp_send()).
+ *   close     The clients reset their connections, which removes them from the socket table.
+ *
+ * As the connections are gone after a run, runs can be repeated. The device should emulate
+ * checksum offload (fastnet_nif_offload_emulate()); the checksums of the TCP segments taken
+ * from it are verified.
+ */
+
+#define TCPGEN_MAX_FLOWS 60000
+#define TCPGEN_PAYLOAD   64
+
+enum {
+	TCPGEN_PH_SYN,
+	TCPGEN_PH_ACK,
+	TCPGEN_PH_DATA_IN,
+	TCPGEN_PH_DATA_OUT,
+	TCPGEN_PH_CLOSE,
+	TCPGEN_NUM_PHASES
+};
+
+extern const char* tcpgen_phase_names[TCPGEN_NUM_PHASES];
+
+/*
+ * Latency is measured around fastnet_classified_input() and fastnet_tcp_send(), in cycles,
+ * and includes the odp_cpu_cycles() overhead. Segments forwarded to another worker by the
+ * flow director are measured on the sending worker, up to the forwarding.
+ */
+typedef struct {
+	uint64_t cycles[TCPGEN_NUM_PHASES];
+	uint64_t count[TCPGEN_NUM_PHASES];
+	uint64_t ns[TCPGEN_NUM_PHASES];
+	uint64_t synacks;     /* Flows of the worker, that got a SYN-ACK. */
+	uint64_t established; /* Flows of the worker, that reached ESTABLISHED. */
+	uint64_t tx;
+	uint64_t bad_cksum;
+	uint64_t no_buffer;
+} ODP_ALIGNED_CACHE tcpgen_result_t;
+
+static inline
+ipv4_addr_t tcpgen_client_ip(uint32_t worker){
+	return ipv4_addr_init(10,0,0,2+worker);
+}
+
+static inline
+uint64_t tcpgen_client_mac(uint32_t worker){
+	return 0x020000000100ULL+worker;
+}
+
+/*
+ * Gives 'nif' the address 10.0.0.1/24, puts the clients of all workers into its ARP cache,
+ * and opens the listening socket. 'barrier' separates the phases; it must be initialized
+ * with the number of workers before every run.
+ *
+ * Returns 0 on success, non-0 on failure.
+ */
+int tcpgen_init(nif_table_t* table,nif_t* nif,uint32_t flows,uint32_t segments,odp_barrier_t* barrier);
+
+/*
+ * Runs all phases as worker 'me'. Called by every worker of the run, the counters are
+ * added to 'res'.
+ */
+void tcpgen_run(tcpgen_result_t* res,uint32_t me);
+
+/*
+ * Builds a client segment of worker 'worker' towards 10.0.0.1:80 on 'dev', as the pktio would
+ * receive it. 'len' octets of payload (zeros) follow the TCP header.
+ */
+odp_packet_t tcpgen_segment(nif_t* dev,uint32_t worker,uint32_t port,uint32_t seq,uint32_t ack,uint16_t flags,uint32_t len);
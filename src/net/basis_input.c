@@ -15,8 +15,21 @@
  */
 
 #include <net/niftable.h>
+#include <net/nethread.h>
+#include <net/flow_director.h>
+#include <net/requirement.h>
+#include <net/numa.h>
+#include <net/conf.h>
+#include <net/stats.h>
+#include <net/latency.h>
 
-#define BURST_SIZE 1024
+/*
+ * How long a worker may block in the scheduler, before it polls the flow director.
+ */
+#define FLOWDIR_POLL_NS 50000
+
+__thread int fastnet_worker_idx = 0;
+__thread int fastnet_thread_slot_idx = FASTNET_NONWORKER_SLOT;
 
 #define caseof(VAL,BODY)  case VAL: BODY; break;
 #define caseelse(BODY) default: BODY; break;
@@ -37,11 +50,14 @@ void fastnet_packet_input(odp_packet_t pkt,nif_table_t* tab,nif_t *nif){
 	int i,n;
 	
 	odp_packet_user_ptr_set(pkt,nif);
+	fastnet_pkt_uarea_init(pkt);
+	fastnet_lat_rx(pkt);
 	
 	retcode = tab->function(pkt);
 	if(odp_likely(retcode==NETPP_CONSUMED)) return;
 	
 error:
+	FASTNET_STAT_INC(drop_total);
 	odp_packet_free(pkt);
 }
 
@@ -49,12 +65,27 @@ int fastnet_eventlist(void *arg){
 	odp_event_t ev;
 	odp_queue_t src_queue;
 	void* context;
-	odp_event_t events[BURST_SIZE];
-	int n_event,i;
+	odp_event_t events[FASTNET_MAX_BURST];
+	int n_event,i,burst;
+	uint64_t wait;
 	nif_table_t* tab = arg;
 	
+	fastnet_worker_enter(odp_atomic_fetch_inc_u32(&(tab->worker_seq)));
+	fastnet_numa_thread_init();
+	
+	burst = fastnet_conf.burst;
+	if(burst<1 || burst>FASTNET_MAX_BURST) burst = FASTNET_MAX_BURST;
+	
+	/*
+	 * With more than one worker, packets might be forwarded to us by other workers.
+	 */
+	if(tab->workers>1) wait = odp_schedule_wait_time(FLOWDIR_POLL_NS);
+	else               wait = ODP_SCHED_WAIT;
+	
 	for(;;){
-		n_event = odp_schedule_multi(&src_queue, ODP_SCHED_WAIT, events, BURST_SIZE);
+		n_event = odp_schedule_multi(&src_queue, wait, events, burst);
+		fastnet_flowdir_poll();
+		if(n_event<1) continue;
 		context = queue_context(src_queue);
 		
 		if(odp_unlikely(context==NULL)){
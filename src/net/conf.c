@@ -0,0 +1,291 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stddef.h>
+#include <net/conf.h>
+#include <net/niftable.h>
+#include <net/socket_tcp.h>
+
+fastnet_conf_t fastnet_conf;
+
+/* ------------------- Defaults (without memory budget) ------------------- */
+
+#define DEF_PKT_SIZE       1856
+#define DEF_PKT_NUM        512
+#define DEF_OBJECTS        (512*1024)
+#define DEF_SOCKET_BUCKETS 0x4000
+#define DEF_ARP_BUCKETS    0x1000
+#define DEF_ND6_BUCKETS    0x1000
+#define DEF_PMTU_BUCKETS   0x1000
+#define DEF_SLAB_CHUNK     4096
+#define DEF_STATS_INTERVAL 1000
+#define DEF_ICMP_ECHO_RATE 10000
+#define DEF_ICMP_ERR_RATE  1000
+#define DEF_TCP_RST_RATE   10000
+#define DEF_REPLY_BURST    64
+#define DEF_PMTU_EXPIRE    600 /* RFC 1191 6.3: 10 minutes. */
+
+#define MIN_PKT_NUM        512
+#define MIN_OBJECTS        64
+#define MIN_BUCKETS        0x100
+#define MAX_BUCKETS        0x1000000
+
+/*
+ * Estimated memory cost per element, including the pool's per-element overhead.
+ */
+#define PKT_OVERHEAD       256
+#define OBJ_OVERHEAD       64
+#define PCB_COST           (sizeof(fastnet_tcp_pcb_t)+OBJ_OVERHEAD)
+#define CACHE_ENTRY_COST   (128+OBJ_OVERHEAD)
+
+/* ------------------- Variables ------------------- */
+
+typedef enum { T_U32, T_U64 } var_type_t;
+
+typedef struct {
+	const char* name;
+	var_type_t  type;
+	size_t      offset;
+} conf_var_t;
+
+#define VAR(n,t) { #n, t, offsetof(fastnet_conf_t,n) }
+
+static const conf_var_t variables[] = {
+	VAR(workers,T_U32),
+	VAR(mem_budget,T_U64),
+	VAR(pktin_size,T_U32),
+	VAR(pktin_num,T_U32),
+	VAR(pktout_size,T_U32),
+	VAR(pktout_num,T_U32),
+	VAR(tcp_pcbs,T_U32),
+	VAR(arp_entries,T_U32),
+	VAR(nd6_entries,T_U32),
+	VAR(slab_chunk,T_U32),
+	VAR(socket_buckets,T_U32),
+	VAR(arp_buckets,T_U32),
+	VAR(nd6_buckets,T_U32),
+	VAR(pmtu_buckets,T_U32),
+	VAR(burst,T_U32),
+	VAR(out_queues,T_U32),
+	VAR(stats_interval,T_U32),
+	VAR(lat_sample,T_U32),
+	VAR(icmp_echo_rate,T_U32),
+	VAR(icmp_echo_burst,T_U32),
+	VAR(icmp_err_rate,T_U32),
+	VAR(icmp_err_burst,T_U32),
+	VAR(tcp_rst_rate,T_U32),
+	VAR(tcp_rst_burst,T_U32),
+	VAR(pmtu_expire,T_U32),
+};
+
+#define NUM_VARIABLES (sizeof(variables)/sizeof(variables[0]))
+
+static int parse_size(const char* value,uint64_t* result){
+	char* end;
+	uint64_t v;
+	if(!isdigit((unsigned char)*value)) return 1;
+	v = strtoull(value,&end,0);
+	switch(*end){
+	case 'k': case 'K': v <<= 10; end++; break;
+	case 'm': case 'M': v <<= 20; end++; break;
+	case 'g': case 'G': v <<= 30; end++; break;
+	}
+	while(isspace((unsigned char)*end)) end++;
+	if(*end) return 1;
+	*result = v;
+	return 0;
+}
+
+int fastnet_conf_set(fastnet_conf_t* conf,const char* key,const char* value){
+	uint64_t v;
+	size_t i;
+	char* field;
+	for(i=0;i<NUM_VARIABLES;++i){
+		if(strcmp(variables[i].name,key)) continue;
+		if(parse_size(value,&v)) return 1;
+		field = ((char*)conf)+variables[i].offset;
+		switch(variables[i].type){
+		case T_U32:
+			if(v>0xffffffffULL) return 1;
+			*((uint32_t*)field) = (uint32_t)v;
+			break;
+		case T_U64:
+			*((uint64_t*)field) = v;
+			break;
+		}
+		return 0;
+	}
+	return 1;
+}
+
+static char* trim(char* str){
+	char* end;
+	while(isspace((unsigned char)*str)) str++;
+	end = str+strlen(str);
+	while(end>str && isspace((unsigned char)end[-1])) end--;
+	*end = 0;
+	return str;
+}
+
+int fastnet_conf_load(fastnet_conf_t* conf,const char* path){
+	char line[256];
+	char *key,*value,*p;
+	int lineno = 0,ret = 0;
+	FILE* f = fopen(path,"r");
+	if(!f) return 1;
+	while(fgets(line,sizeof line,f)){
+		lineno++;
+		p = strchr(line,'#');
+		if(p) *p = 0;
+		key = trim(line);
+		if(!*key) continue;
+		p = strchr(key,'=');
+		if(!p){
+			fprintf(stderr,"%s:%d: expected 'key = value'\n",path,lineno);
+			ret = 1;
+			continue;
+		}
+		*p = 0;
+		key = trim(key);
+		value = trim(p+1);
+		if(fastnet_conf_set(conf,key,value)){
+			fprintf(stderr,"%s:%d: invalid setting '%s'\n",path,lineno,key);
+			ret = 1;
+		}
+	}
+	fclose(f);
+	return ret;
+}
+
+int fastnet_conf_args(fastnet_conf_t* conf,int argc,char** argv){
+	char key[64];
+	const char *arg,*eq;
+	size_t len;
+	int i,ret = 0;
+	for(i=1;i<argc;++i){
+		arg = argv[i];
+		if(strncmp(arg,"--",2)) continue;
+		arg += 2;
+		eq = strchr(arg,'=');
+		if(!eq) continue;
+		len = eq-arg;
+		if(len>=sizeof key) continue;
+		memcpy(key,arg,len);
+		key[len] = 0;
+		if(!strcmp(key,"config")){
+			if(fastnet_conf_load(conf,eq+1)){
+				fprintf(stderr,"failed to load configuration '%s'\n",eq+1);
+				ret = 1;
+			}
+		}else if(fastnet_conf_set(conf,key,eq+1)){
+			fprintf(stderr,"invalid argument '%s'\n",argv[i]);
+			ret = 1;
+		}
+	}
+	return ret;
+}
+
+/* ------------------- Derivation ------------------- */
+
+static uint32_t pow2_ceil(uint32_t x){
+	uint32_t r = MIN_BUCKETS;
+	while(r<x && r<MAX_BUCKETS) r <<= 1;
+	return r;
+}
+
+static uint32_t clamp_num(uint64_t x,uint32_t min){
+	if(x<min) return min;
+	if(x>0x7fffffff) return 0x7fffffff;
+	return (uint32_t)x;
+}
+
+void fastnet_conf_finalize(fastnet_conf_t* conf){
+	uint64_t b = conf->mem_budget;
+	if(conf->finalized) return;
+	conf->finalized = 1;
+	
+	if(!conf->pktin_size)  conf->pktin_size  = DEF_PKT_SIZE;
+	if(conf->pktin_size<DEF_PKT_SIZE) conf->pktin_size = DEF_PKT_SIZE;
+	if(!conf->pktout_size) conf->pktout_size = conf->pktin_size;
+	
+	if(b){
+		/*
+		 * Split of the budget:
+		 *   30% input packets, 20% output packets, 30% TCP PCBs,
+		 *   5% ARP cache, 5% ND6 cache, 10% hash tables and headroom.
+		 */
+		if(!conf->pktin_num)   conf->pktin_num   = clamp_num((b*30/100)/(conf->pktin_size+PKT_OVERHEAD),MIN_PKT_NUM);
+		if(!conf->pktout_num)  conf->pktout_num  = clamp_num((b*20/100)/(conf->pktout_size+PKT_OVERHEAD),MIN_PKT_NUM);
+		if(!conf->tcp_pcbs)    conf->tcp_pcbs    = clamp_num((b*30/100)/PCB_COST,MIN_OBJECTS);
+		if(!conf->arp_entries) conf->arp_entries = clamp_num((b*5/100)/CACHE_ENTRY_COST,MIN_OBJECTS);
+		if(!conf->nd6_entries) conf->nd6_entries = clamp_num((b*5/100)/CACHE_ENTRY_COST,MIN_OBJECTS);
+		
+		/* About two PCBs or four cache entries per bucket. */
+		if(!conf->socket_buckets) conf->socket_buckets = pow2_ceil(conf->tcp_pcbs/2);
+		if(!conf->arp_buckets)    conf->arp_buckets    = pow2_ceil(conf->arp_entries/4);
+		if(!conf->nd6_buckets)    conf->nd6_buckets    = pow2_ceil(conf->nd6_entries/4);
+	}
+	
+	if(!conf->pktin_num)      conf->pktin_num      = DEF_PKT_NUM;
+	if(conf->pktin_num<MIN_PKT_NUM) conf->pktin_num = MIN_PKT_NUM;
+	if(!conf->pktout_num)     conf->pktout_num     = conf->pktin_num;
+	if(!conf->tcp_pcbs)       conf->tcp_pcbs       = DEF_OBJECTS;
+	if(!conf->arp_entries)    conf->arp_entries    = DEF_OBJECTS;
+	if(!conf->nd6_entries)    conf->nd6_entries    = DEF_OBJECTS;
+	if(!conf->slab_chunk)     conf->slab_chunk     = DEF_SLAB_CHUNK;
+	if(!conf->socket_buckets) conf->socket_buckets = DEF_SOCKET_BUCKETS;
+	if(!conf->arp_buckets)    conf->arp_buckets    = DEF_ARP_BUCKETS;
+	if(!conf->nd6_buckets)    conf->nd6_buckets    = DEF_ND6_BUCKETS;
+	if(!conf->pmtu_buckets)   conf->pmtu_buckets   = DEF_PMTU_BUCKETS;
+	if(!conf->stats_interval) conf->stats_interval = DEF_STATS_INTERVAL;
+	if(!conf->icmp_echo_rate)  conf->icmp_echo_rate  = DEF_ICMP_ECHO_RATE;
+	if(!conf->icmp_echo_burst) conf->icmp_echo_burst = DEF_REPLY_BURST;
+	if(!conf->icmp_err_rate)   conf->icmp_err_rate   = DEF_ICMP_ERR_RATE;
+	if(!conf->icmp_err_burst)  conf->icmp_err_burst  = DEF_REPLY_BURST;
+	if(!conf->tcp_rst_rate)    conf->tcp_rst_rate    = DEF_TCP_RST_RATE;
+	if(!conf->tcp_rst_burst)   conf->tcp_rst_burst   = DEF_REPLY_BURST;
+	if(!conf->pmtu_expire)     conf->pmtu_expire     = DEF_PMTU_EXPIRE;
+	
+	/* The hash functions select the bucket with a mask. */
+	conf->socket_buckets = pow2_ceil(conf->socket_buckets);
+	conf->arp_buckets    = pow2_ceil(conf->arp_buckets);
+	conf->nd6_buckets    = pow2_ceil(conf->nd6_buckets);
+	conf->pmtu_buckets   = pow2_ceil(conf->pmtu_buckets);
+	
+	if(conf->workers>NET_MAXTHREAD) conf->workers = NET_MAXTHREAD;
+	if(!conf->burst || conf->burst>FASTNET_MAX_BURST) conf->burst = FASTNET_MAX_BURST;
+	if(!conf->out_queues || conf->out_queues>NET_NIF_MAX_QUEUE) conf->out_queues = NET_NIF_MAX_QUEUE;
+}
+
+void fastnet_conf_print(fastnet_conf_t* conf){
+	size_t i;
+	const char* field;
+	for(i=0;i<NUM_VARIABLES;++i){
+		field = ((const char*)conf)+variables[i].offset;
+		switch(variables[i].type){
+		case T_U32:
+			printf("%-16s = %u\n",variables[i].name,(unsigned)*((const uint32_t*)field));
+			break;
+		case T_U64:
+			printf("%-16s = %llu\n",variables[i].name,(unsigned long long)*((const uint64_t*)field));
+			break;
+		}
+	}
+}
+
@@ -26,6 +26,8 @@
 #include <net/header/ethhdr.h>
 #include <net/mac_addr_ldst.h>
 #include <net/safe_packet.h>
+#include <net/pkt_alloc.h>
+#include <net/stats.h>
 
 #define M2I fastnet_mac_to_int
 #define I2M fastnet_int_to_mac
@@ -68,12 +70,16 @@ netpp_retcode_t fastnet_arp_input(odp_packet_t pkt){
 	
 	nif = odp_packet_user_ptr(pkt);
 	
+	FASTNET_STAT_INC(arp_in_pkts);
 	if(odp_unlikely(nif->ipv4 == NULL)) return NETPP_DROP;
 	
 	target_hard_addr = nif->hwaddr;
 	
 	arp_hdr = fastnet_safe_l3(pkt,sizeof(fnet_arp_header_t));
-	if (odp_unlikely(arp_hdr == NULL)) return NETPP_DROP;
+	if (odp_unlikely(arp_hdr == NULL)) {
+		FASTNET_STAT_INC(arp_in_errors);
+		return NETPP_DROP;
+	}
 	
 	sender_prot_addr = arp_hdr->sender_prot_addr;
 	target_prot_addr = arp_hdr->target_prot_addr;
@@ -118,6 +124,7 @@ netpp_retcode_t fastnet_arp_input(odp_packet_t pkt){
 		if(odp_unlikely(pretrail>0))
 			odp_packet_pull_head(pkt,pretrail);
 		
+		FASTNET_STAT_INC(arp_out_replies);
 		return fastnet_pkt_output(pkt,nif);
 	}
 	
@@ -131,15 +138,11 @@ typedef struct ODP_PACKED {
 } arp_pkt_t;
 
 int fastnet_arp_output(ipv4_addr_t src,ipv4_addr_t dst,nif_t* nif){
-	odp_pool_t      pool;
 	odp_packet_t    pkt;
 	arp_pkt_t*      hdr;
 	netpp_retcode_t ret;
 	
-	pool = odp_pool_lookup("fn_pktout");
-	if(odp_unlikely(pool == ODP_POOL_INVALID)) return 0;
-	
-	pkt  = odp_packet_alloc(pool,sizeof(arp_pkt_t));
+	pkt  = fastnet_pktout_alloc(sizeof(arp_pkt_t));
 	if(odp_unlikely(pkt == ODP_PACKET_INVALID)) return 0;
 	
 	hdr = odp_packet_offset(pkt,0,NULL,NULL);
@@ -184,10 +187,11 @@ int fastnet_arp_output(ipv4_addr_t src,ipv4_addr_t dst,nif_t* nif){
 	
 	ret = fastnet_pkt_output(pkt,nif);
 	if(odp_unlikely(ret!=NETPP_CONSUMED)){
-		odp_packet_free(pkt);
+		fastnet_pktout_free(pkt);
 		return 0;
 	}
 	
+	FASTNET_STAT_INC(arp_out_requests);
 	return 1;
 }
 
@@ -17,6 +17,10 @@
 #include <net/header/iphdr.h>
 #include <net/header/ip6hdr.h>
 #include <net/safe_packet.h>
+#include <net/requirement.h>
+#include <net/header/layer4.h>
+#include <net/header/tcphdr.h>
+#include <net/header/udphdr.h>
 
 static inline uint16_t cksum_finalize(uint32_t chk){
 	uint16_t res = (uint16_t)chk;
@@ -30,18 +34,37 @@ static inline uint16_t cksum_cast(uint32_t chk){
 
 static inline 
 uint32_t l4_sum_part(uint16_t* __restrict__ data,uint32_t checksum,uint32_t words){
+	return fastnet_cksum_fold(fastnet_cksum_sum(data,words*2,checksum));
+}
+
+/*
+ * Returns non-0, if the checksum is offloaded. '*result' is set to the return value of the checksum function.
+ */
+static inline
+int cksum_offloaded(odp_packet_t pkt,nif_t* nif,uint32_t offload_flags,uint16_t* result){
+	if(odp_likely(nif == NULL)) return 0;
+	if(odp_likely(!(nif->offload_flags & offload_flags))) return 0;
 	
-	while( words-- ) checksum += *(data++);
-	
-	checksum = (checksum>>16) + (checksum & 0xffff);
-	
-	return checksum;
+	if(offload_flags & NIFOFL_RX_MASK){
+		/* Receive: The NIC has validated the checksum. */
+		if(offload_flags & NIFOFL_RX_IP4_CKSUM)
+			*result = odp_packet_has_l3_error(pkt) ? 0xffff : 0;
+		else
+			*result = odp_packet_has_l4_error(pkt) ? 0xffff : 0;
+	}else{
+		/* Transmit: The NIC will insert the checksum. */
+		*result = 0;
+	}
+	return 1;
 }
 
-uint16_t fastnet_ipv4_hdr_checksum(odp_packet_t pkt){
+uint16_t fastnet_ipv4_hdr_checksum(odp_packet_t pkt,nif_t* nif,uint32_t offload_flags){
 	uint32_t length,cksum,max,off;
+	uint16_t result;
 	void* ptr;
 	
+	if(odp_unlikely(cksum_offloaded(pkt,nif,offload_flags,&result))) return result;
+	
 	off = odp_packet_l3_offset(pkt);
 	
 	/*
@@ -59,7 +82,11 @@ uint16_t fastnet_ipv4_hdr_checksum(odp_packet_t pkt){
 	return cksum_finalize(cksum);
 }
 
-uint16_t fastnet_checksum(odp_packet_t pkt,uint32_t offset,uint32_t cksuminit,nif_t* nif,uint32_t offload_flags){
+/*
+ * Sums the packet from 'offset' to its end, segment by segment.
+ */
+static
+uint64_t pkt_sum(odp_packet_t pkt,uint32_t offset,uint64_t sum){
 	uint32_t length;
 	uint8_t* bptr;
 	union {
@@ -67,11 +94,6 @@ uint16_t fastnet_checksum(odp_packet_t pkt,uint32_t offset,uint32_t cksuminit,ni
 		uint16_t repr16 ODP_PACKED;
 	} gap = { .repr16 = 0 };
 	int gap_i = 0;
-	if(odp_likely(nif != NULL)){
-		if(odp_unlikely(nif->offload_flags & offload_flags)) return 0;
-	}
-	
-	cksuminit = (cksuminit >> 16) + (cksuminit & 0xffff);
 	
 	for(;;){
 		bptr = odp_packet_offset(pkt,offset,&length,NULL);
@@ -79,11 +101,11 @@ uint16_t fastnet_checksum(odp_packet_t pkt,uint32_t offset,uint32_t cksuminit,ni
 		offset+=length;
 		if(gap_i){
 			gap.repr8[1] = *bptr;
-			cksuminit += gap.repr16;
+			sum += gap.repr16;
 			bptr++;
 			length--;
 		}
-		cksuminit = l4_sum_part((uint16_t*)bptr,cksuminit,length/2);
+		sum = fastnet_cksum_sum(bptr,length&~1,sum);
 		gap_i = length&1;
 		if(gap_i){
 			gap.repr8[0] = bptr[length-1];
@@ -91,11 +113,16 @@ uint16_t fastnet_checksum(odp_packet_t pkt,uint32_t offset,uint32_t cksuminit,ni
 	}
 	if(gap_i){
 		gap.repr8[1] = 0;
-		cksuminit += gap.repr16;
+		sum += gap.repr16;
 	}
-	cksuminit = (cksuminit >> 16) + (cksuminit & 0xffff);
-	cksuminit = (cksuminit >> 16) + (cksuminit & 0xffff);
-	return cksum_finalize(cksuminit);
+	return sum;
+}
+
+uint16_t fastnet_checksum(odp_packet_t pkt,uint32_t offset,uint32_t cksuminit,nif_t* nif,uint32_t offload_flags){
+	uint16_t result;
+	if(odp_unlikely(cksum_offloaded(pkt,nif,offload_flags,&result))) return result;
+	
+	return cksum_finalize(fastnet_cksum_fold(pkt_sum(pkt,offset,cksuminit)));
 }
 
 uint16_t fastnet_ip_ph(ipv4_addr_t src,ipv4_addr_t dst,uint8_t prot){
@@ -105,7 +132,7 @@ uint16_t fastnet_ip_ph(ipv4_addr_t src,ipv4_addr_t dst,uint8_t prot){
 		uint8_t     zero;
 		uint8_t     prot;
 	} ph = { src,dst,0,prot };
-	uint32_t cksum = l4_sum_part((uint16_t*)&ph,0,sizeof(ph));
+	uint32_t cksum = l4_sum_part((uint16_t*)&ph,0,sizeof(ph)/2);
 	cksum = (cksum>>16) + (cksum&0xffff);
 	cksum = (cksum>>16) + (cksum&0xffff);
 	return cksum_cast(cksum);
@@ -117,14 +144,15 @@ uint16_t fastnet_ip6_ph(ipv6_addr_t src,ipv6_addr_t dst,uint8_t prot){
 		uint8_t     zero;
 		uint8_t     prot;
 	} ph = { src,dst,0,prot };
-	uint32_t cksum = l4_sum_part((uint16_t*)&ph,0,sizeof(ph));
+	uint32_t cksum = l4_sum_part((uint16_t*)&ph,0,sizeof(ph)/2);
 	cksum = (cksum>>16) + (cksum&0xffff);
 	cksum = (cksum>>16) + (cksum&0xffff);
 	return cksum_cast(cksum);
 }
 
-uint16_t fastnet_ip4_checksum(odp_packet_t pkt,ipv4_addr_t src,ipv4_addr_t dst,uint8_t prot){
+uint16_t fastnet_ip4_checksum(odp_packet_t pkt,ipv4_addr_t src,ipv4_addr_t dst,uint8_t prot,nif_t* nif,uint32_t offload_flags){
 	uint32_t offset,length,checksum;
+	uint16_t result;
 	struct ODP_PACKED
 	{
 		ipv4_addr_t src;
@@ -134,6 +162,8 @@ uint16_t fastnet_ip4_checksum(odp_packet_t pkt,ipv4_addr_t src,ipv4_addr_t dst,u
 		uint16_t    length;
 	} pseudo_header;
 	
+	if(odp_unlikely(cksum_offloaded(pkt,nif,offload_flags,&result))) return result;
+	
 	offset = odp_packet_l4_offset(pkt);
 	length = odp_packet_len(pkt);
 	length -= offset;
@@ -147,8 +177,9 @@ uint16_t fastnet_ip4_checksum(odp_packet_t pkt,ipv4_addr_t src,ipv4_addr_t dst,u
 	return fastnet_checksum(pkt,offset,checksum,NULL,0);
 }
 
-uint16_t fastnet_ip6_checksum(odp_packet_t pkt,ipv6_addr_t src,ipv6_addr_t dst,uint8_t prot){
+uint16_t fastnet_ip6_checksum(odp_packet_t pkt,ipv6_addr_t src,ipv6_addr_t dst,uint8_t prot,nif_t* nif,uint32_t offload_flags){
 	uint32_t offset,length,checksum;
+	uint16_t result;
 	struct ODP_PACKED
 	{
 		ipv6_addr_t src;
@@ -158,6 +189,8 @@ uint16_t fastnet_ip6_checksum(odp_packet_t pkt,ipv6_addr_t src,ipv6_addr_t dst,u
 		uint8_t     prot;
 	} pseudo_header;
 	
+	if(odp_unlikely(cksum_offloaded(pkt,nif,offload_flags,&result))) return result;
+	
 	offset = odp_packet_l4_offset(pkt);
 	length = odp_packet_len(pkt);
 	length -= offset;
@@ -176,16 +209,131 @@ uint16_t fastnet_ip6_checksum(odp_packet_t pkt,ipv6_addr_t src,ipv6_addr_t dst,u
 uint16_t fastnet_tcpudp_input_checksum(odp_packet_t pkt,uint8_t prot) {
 	fnet_ip_header_t*  ip;
 	fnet_ip6_header_t* ip6;
+	nif_t*             nif = odp_packet_user_ptr(pkt);
+	uint32_t           offload_flags = (prot==IP_PROTOCOL_TCP) ? NIFOFL_RX_TCP_CKSUM : NIFOFL_RX_UDP_CKSUM;
 	
 	if(odp_packet_has_ipv4(pkt)){
 		ip = fastnet_safe_l3(pkt,sizeof(fnet_ip_header_t));
 		if(odp_unlikely(ip==NULL)) return ~0;
-		return fastnet_ip4_checksum(pkt, ip->source_addr, ip->destination_addr,prot);
+		return fastnet_ip4_checksum(pkt, ip->source_addr, ip->destination_addr,prot,nif,offload_flags);
 	}else{
 		ip6 = fastnet_safe_l3(pkt,sizeof(fnet_ip6_header_t));
 		if(odp_unlikely(ip6==NULL)) return ~0;
-		return fastnet_ip6_checksum(pkt,ip6->source_addr,ip6->destination_addr,prot);
+		return fastnet_ip6_checksum(pkt,ip6->source_addr,ip6->destination_addr,prot,nif,offload_flags);
 	}
 	return ~0;
 }
 
+void fastnet_checksum_insert(odp_packet_t pkt,uint32_t offload_flags){
+	fnet_ip_header_t*  ip;
+	fnet_ip6_header_t* ip6;
+	uint8_t            prot;
+	uint32_t           field;
+	uint16_t           cksum;
+	
+	/* The IP output sets the flags (see fastnet_pkt_set_l3l4()), ARP packets have none. */
+	if(odp_packet_has_ipv4(pkt)){
+		ip = fastnet_safe_l3(pkt,sizeof(fnet_ip_header_t));
+		if(odp_unlikely(ip==NULL)) return;
+		if(offload_flags & NIFOFL_IP4_CKSUM){
+			ip->checksum = 0;
+			ip->checksum = fastnet_ipv4_hdr_checksum(pkt,NULL,0);
+		}
+		prot = ip->protocol;
+		ip6 = NULL;
+	}else if(odp_packet_has_ipv6(pkt)){
+		ip6 = fastnet_safe_l3(pkt,sizeof(fnet_ip6_header_t));
+		if(odp_unlikely(ip6==NULL)) return;
+		prot = ip6->next_header;
+		ip = NULL;
+	}else return;
+	
+	switch(prot){
+	case IP_PROTOCOL_TCP:
+		if(!(offload_flags & NIFOFL_TCP_CKSUM)) return;
+		field = TCP_HDR_CHECKSUM_OFFSET;
+		break;
+	case IP_PROTOCOL_UDP:
+		if(!(offload_flags & NIFOFL_UDP_CKSUM)) return;
+		field = 6; /* fnet_udp_header_t.checksum */
+		break;
+	default: return;
+	}
+	field += odp_packet_l4_offset(pkt);
+	
+	cksum = 0;
+	if(odp_unlikely(odp_packet_copy_from_mem(pkt,field,2,&cksum))) return;
+	if(ip) cksum = fastnet_ip4_checksum(pkt,ip->source_addr,ip->destination_addr,prot,NULL,0);
+	else   cksum = fastnet_ip6_checksum(pkt,ip6->source_addr,ip6->destination_addr,prot,NULL,0);
+	
+	/* An UDP checksum of 0 means 'no checksum'. */
+	if(odp_unlikely(cksum==0 && prot==IP_PROTOCOL_UDP)) cksum = 0xffff;
+	odp_packet_copy_from_mem(pkt,field,2,&cksum);
+}
+
+void fastnet_pkt_psum_compute(odp_packet_t pkt,uint32_t offset){
+	fastnet_pkt_uarea_t* ua = FASTNET_PACKET_UAREA(pkt);
+	
+	ua->psum     = fastnet_cksum_fold(pkt_sum(pkt,offset,0));
+	ua->psum_len = odp_packet_len(pkt)-offset;
+	ua->flags   |= FASTNET_PKTF_PSUM;
+}
+
+int fastnet_pkt_copyin_psum(odp_packet_t pkt,uint32_t offset,const void* data,uint32_t len){
+	fastnet_pkt_uarea_t* ua = FASTNET_PACKET_UAREA(pkt);
+	const uint8_t* src = data;
+	uint32_t remain,length,cur;
+	uint8_t* bptr;
+	uint64_t sum = 0;
+	union {
+		uint8_t  repr8[2];
+		uint16_t repr16 ODP_PACKED;
+	} gap = { .repr16 = 0 };
+	int gap_i = 0;
+	
+	if(odp_unlikely((offset+len) > odp_packet_len(pkt))) return 1;
+	
+	/* The cached sum covers the tail of the packet. */
+	if(odp_unlikely((offset+len) != odp_packet_len(pkt))){
+		fastnet_pkt_psum_clear(pkt);
+		if(odp_unlikely(odp_packet_copy_from_mem(pkt,offset,len,data))) return 1;
+		return 0;
+	}
+	
+	/*
+	 * Same segment walk as in pkt_sum(), the payload starts at an even position.
+	 */
+	remain = len;
+	while(remain){
+		bptr = odp_packet_offset(pkt,offset,&length,NULL);
+		if(odp_unlikely(length==0)) return 1;
+		cur = (length<remain) ? length : remain;
+		offset += cur;
+		remain -= cur;
+		if(gap_i){
+			*bptr = *src;
+			gap.repr8[1] = *src;
+			sum += gap.repr16;
+			bptr++;
+			src++;
+			cur--;
+		}
+		sum = fastnet_cksum_copy(bptr,src,cur&~1,sum);
+		gap_i = cur&1;
+		if(gap_i){
+			bptr[cur-1] = src[cur-1];
+			gap.repr8[0] = src[cur-1];
+		}
+		src += cur;
+	}
+	if(gap_i){
+		gap.repr8[1] = 0;
+		sum += gap.repr16;
+	}
+	
+	ua->psum     = fastnet_cksum_fold(sum);
+	ua->psum_len = len;
+	ua->flags   |= FASTNET_PKTF_PSUM;
+	return 0;
+}
+
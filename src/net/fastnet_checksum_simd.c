@@ -0,0 +1,219 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <net/checksum.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CKSUM_X86
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define CKSUM_NEON
+#include <arm_neon.h>
+#endif
+
+/*
+ * The ones-complement sum is independent of the word size: 2^16 == 1 (mod 2^16-1).
+ * So instead of 16-bit words, we sum 32-bit words into 64-bit accumulators, and fold
+ * them at the very end. The words are loaded in native byte order, as before.
+ */
+
+/* 64-bit add with end-around carry. */
+static inline uint64_t add64(uint64_t sum,uint64_t x){
+	sum += x;
+	return sum + (sum<x);
+}
+
+static inline
+uint64_t cksum_generic(const uint8_t* data,uint32_t len,uint64_t sum){
+	uint64_t s0 = 0,s1 = 0,v;
+	uint16_t w;
+	union {
+		uint8_t  repr8[2];
+		uint16_t repr16 ODP_PACKED;
+	} gap;
+
+	/*
+	 * Each iteration adds less than 2^34, so the accumulators can't overflow for len < 2^32.
+	 */
+	while(len>=16){
+		memcpy(&v,data,8);
+		s0 += (v&0xffffffff) + (v>>32);
+		memcpy(&v,data+8,8);
+		s1 += (v&0xffffffff) + (v>>32);
+		data += 16;
+		len  -= 16;
+	}
+	while(len>=2){
+		memcpy(&w,data,2);
+		s0 += w;
+		data += 2;
+		len  -= 2;
+	}
+	if(len){
+		gap.repr8[0] = *data;
+		gap.repr8[1] = 0;
+		s0 += gap.repr16;
+	}
+	return add64(add64(sum,s0),s1);
+}
+
+#ifdef CKSUM_X86
+
+__attribute__((target("sse2")))
+static uint64_t cksum_sse2(const uint8_t* data,uint32_t len,uint64_t sum){
+	__m128i acc0 = _mm_setzero_si128();
+	__m128i acc1 = _mm_setzero_si128();
+	__m128i zero = _mm_setzero_si128();
+	__m128i v;
+	uint64_t lanes[2];
+
+	while(len>=32){
+		v    = _mm_loadu_si128((const __m128i*)data);
+		acc0 = _mm_add_epi64(acc0,_mm_unpacklo_epi32(v,zero));
+		acc1 = _mm_add_epi64(acc1,_mm_unpackhi_epi32(v,zero));
+		v    = _mm_loadu_si128((const __m128i*)(data+16));
+		acc0 = _mm_add_epi64(acc0,_mm_unpacklo_epi32(v,zero));
+		acc1 = _mm_add_epi64(acc1,_mm_unpackhi_epi32(v,zero));
+		data += 32;
+		len  -= 32;
+	}
+	acc0 = _mm_add_epi64(acc0,acc1);
+	_mm_storeu_si128((__m128i*)lanes,acc0);
+	sum = add64(add64(sum,lanes[0]),lanes[1]);
+	return cksum_generic(data,len,sum);
+}
+
+__attribute__((target("avx2")))
+static uint64_t cksum_avx2(const uint8_t* data,uint32_t len,uint64_t sum){
+	__m256i acc0 = _mm256_setzero_si256();
+	__m256i acc1 = _mm256_setzero_si256();
+	__m256i acc2 = _mm256_setzero_si256();
+	__m256i acc3 = _mm256_setzero_si256();
+	__m256i zero = _mm256_setzero_si256();
+	__m256i v;
+	uint64_t lanes[4];
+
+	while(len>=64){
+		v    = _mm256_loadu_si256((const __m256i*)data);
+		acc0 = _mm256_add_epi64(acc0,_mm256_unpacklo_epi32(v,zero));
+		acc1 = _mm256_add_epi64(acc1,_mm256_unpackhi_epi32(v,zero));
+		v    = _mm256_loadu_si256((const __m256i*)(data+32));
+		acc2 = _mm256_add_epi64(acc2,_mm256_unpacklo_epi32(v,zero));
+		acc3 = _mm256_add_epi64(acc3,_mm256_unpackhi_epi32(v,zero));
+		data += 64;
+		len  -= 64;
+	}
+	acc0 = _mm256_add_epi64(_mm256_add_epi64(acc0,acc1),_mm256_add_epi64(acc2,acc3));
+	_mm256_storeu_si256((__m256i*)lanes,acc0);
+	sum = add64(add64(sum,lanes[0]),lanes[1]);
+	sum = add64(add64(sum,lanes[2]),lanes[3]);
+	return cksum_generic(data,len,sum);
+}
+
+#endif
+
+#ifdef CKSUM_NEON
+
+static uint64_t cksum_neon(const uint8_t* data,uint32_t len,uint64_t sum){
+	uint64x2_t acc0 = vdupq_n_u64(0);
+	uint64x2_t acc1 = vdupq_n_u64(0);
+
+	while(len>=32){
+		acc0 = vpadalq_u32(acc0,vreinterpretq_u32_u8(vld1q_u8(data)));
+		acc1 = vpadalq_u32(acc1,vreinterpretq_u32_u8(vld1q_u8(data+16)));
+		data += 32;
+		len  -= 32;
+	}
+	acc0 = vaddq_u64(acc0,acc1);
+	sum = add64(add64(sum,vgetq_lane_u64(acc0,0)),vgetq_lane_u64(acc0,1));
+	return cksum_generic(data,len,sum);
+}
+
+#endif
+
+uint64_t fastnet_cksum_copy(void* dst,const void* src,uint32_t len,uint64_t sum){
+	uint64_t s0 = 0,s1 = 0,v,w;
+	uint8_t* d = dst;
+	const uint8_t* s = src;
+	uint16_t h;
+	
+	/*
+	 * Every word is loaded once, and then stored and summed from the register.
+	 */
+	while(len>=16){
+		memcpy(&v,s,8);
+		memcpy(&w,s+8,8);
+		memcpy(d,&v,8);
+		memcpy(d+8,&w,8);
+		s0 += (v&0xffffffff) + (v>>32);
+		s1 += (w&0xffffffff) + (w>>32);
+		s += 16;
+		d += 16;
+		len -= 16;
+	}
+	while(len>=2){
+		memcpy(&h,s,2);
+		memcpy(d,&h,2);
+		s0 += h;
+		s += 2;
+		d += 2;
+		len -= 2;
+	}
+	if(len){
+		*d = *s;
+		s0 = cksum_generic(s,1,s0);
+	}
+	return add64(add64(sum,s0),s1);
+}
+
+typedef uint64_t (*cksum_fn_t)(const uint8_t* data,uint32_t len,uint64_t sum);
+
+static uint64_t cksum_generic_fn(const uint8_t* data,uint32_t len,uint64_t sum){
+	return cksum_generic(data,len,sum);
+}
+
+static uint64_t cksum_select(const uint8_t* data,uint32_t len,uint64_t sum);
+
+static cksum_fn_t cksum_fn = cksum_select;
+
+/*
+ * Selects the kernel on the first call. Races are harmless, as every thread picks the same one.
+ */
+static uint64_t cksum_select(const uint8_t* data,uint32_t len,uint64_t sum){
+	cksum_fn_t fn = cksum_generic_fn;
+#if defined(CKSUM_X86)
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2"))      fn = cksum_avx2;
+	else if(__builtin_cpu_supports("sse2")) fn = cksum_sse2;
+#elif defined(CKSUM_NEON)
+	fn = cksum_neon;
+#endif
+	cksum_fn = fn;
+	return fn(data,len,sum);
+}
+
+uint64_t fastnet_cksum_sum_generic(const void* data,uint32_t len,uint64_t sum){
+	return cksum_generic(data,len,sum);
+}
+
+uint64_t fastnet_cksum_sum(const void* data,uint32_t len,uint64_t sum){
+	/*
+	 * Short buffers (headers, pseudo headers) are not worth the vector setup.
+	 */
+	if(len<64) return cksum_generic(data,len,sum);
+	return cksum_fn(data,len,sum);
+}
+
@@ -0,0 +1,278 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <net/icmp_error.h>
+#include <net/icmp_limit.h>
+#include <net/header/icmp.h>
+#include <net/header/icmp6.h>
+#include <net/header/iphdr.h>
+#include <net/header/ip6hdr.h>
+#include <net/header/ip6defs.h>
+#include <net/header/layer4.h>
+#include <net/ipv4.h>
+#include <net/ipv6.h>
+#include <net/checksum.h>
+#include <net/defaults.h>
+#include <net/safe_packet.h>
+#include <net/ip_next_hop.h>
+#include <net/ip6_next_hop.h>
+#include <net/pkt_alloc.h>
+#include <net/stats.h>
+
+enum {
+	/*
+	 * Ethernet header (14 bytes),
+	 * VLAN tag(4 bytes),
+	 */
+	ETHERNET_HEADER_LEN = 14 + 4,
+	
+	/* Max. size of the error message, including the IP header. */
+	ICMP_ERR_MAX  = 576,
+	ICMP6_ERR_MAX = 1280,
+};
+
+/* ICMP and ICMPv6 errors have the same header. */
+typedef struct ODP_PACKED {
+	uint8_t  type;
+	uint8_t  code;
+	uint16_t checksum;
+	uint32_t info;
+} icmp_err_t;
+
+/*
+ * Was the packet received as a link-layer broadcast or multicast?
+ */
+static inline
+int is_l2_group(odp_packet_t pkt){
+	uint8_t* eth = odp_packet_l2_ptr(pkt,NULL);
+	
+	/* The I/G bit of the destination MAC address. */
+	return eth!=NULL && (eth[0]&1);
+}
+
+static inline
+int v4_class(uint8_t type,uint8_t code){
+	switch(type){
+	case FNET_ICMP_UNREACHABLE:
+		return code==FNET_ICMP_UNREACHABLE_NEEDFRAG ? FASTNET_ICMPL_TOOBIG : FASTNET_ICMPL_UNREACH;
+	case FNET_ICMP_TIMXCEED:  return FASTNET_ICMPL_TIMXCEED;
+	case FNET_ICMP_PARAMPROB: return FASTNET_ICMPL_PARAMPROB;
+	}
+	return FASTNET_ICMPL_UNREACH;
+}
+
+static inline
+int v6_class(uint8_t type){
+	switch(type){
+	case FNET_ICMP6_TYPE_PACKET_TOOBIG: return FASTNET_ICMPL_TOOBIG;
+	case FNET_ICMP6_TYPE_TIME_EXCEED:   return FASTNET_ICMPL_TIMXCEED;
+	case FNET_ICMP6_TYPE_PARAM_PROB:    return FASTNET_ICMPL_PARAMPROB;
+	}
+	return FASTNET_ICMPL_UNREACH;
+}
+
+int fastnet_icmpv4_error(odp_packet_t pkt,uint8_t type,uint8_t code,uint32_t info){
+	fnet_ip_header_t* ip;
+	icmp_err_t*       eh;
+	nif_t*            nif;
+	odp_packet_t      err;
+	ipv4_addr_t       src,dst;
+	uint32_t          l3off,ihl,quote,len;
+	netpp_retcode_t   ret;
+	uint8_t           itype;
+	
+	nif = odp_packet_user_ptr(pkt);
+	if(odp_unlikely(nif==NULL)) return 1;
+	ip = fastnet_safe_l3(pkt,sizeof(fnet_ip_header_t));
+	if(odp_unlikely(ip==NULL)) return 1;
+	src = ip->source_addr;
+	dst = ip->destination_addr;
+	l3off = odp_packet_l3_offset(pkt);
+	
+	/*
+	 * RFC 1122 3.2.2: An ICMP error message MUST NOT be sent as the result of receiving:
+	 *  - an ICMP error message,
+	 *  - a datagram destined to an IP broadcast or IP multicast address,
+	 *  - a datagram sent as a link-layer broadcast,
+	 *  - a non-initial fragment,
+	 *  - a datagram whose source address does not define a single host (a zero, loopback,
+	 *    broadcast, multicast or Class E address).
+	 */
+	if(odp_unlikely(
+		IP4_ADDR_IS_UNSPECIFIED(src) || IP4_ADDR_IS_LOOPBACK(src) ||
+		fastnet_ip_broadcast(nif->ipv4,src) || IP4_ADDR_IS_MULTICAST(src) || IP4_CLASS_E(src) ||
+		fastnet_ip_broadcast(nif->ipv4,dst) || IP4_ADDR_IS_MULTICAST(dst) ||
+		(odp_be_to_cpu_16(ip->flags_fragment_offset) & FNET_IP_OFFSET_MASK) ||
+		is_l2_group(pkt)
+	)) return 1;
+	if(ip->protocol==IP_PROTOCOL_ICMP){
+		ihl = (ip->version__header_length&0xf)<<2;
+		if(odp_unlikely(odp_packet_copy_to_mem(pkt,l3off+ihl,1,&itype))) return 1;
+		if(!FNET_ICMP_IS_QUERY_TYPE(itype)) return 1;
+	}
+	
+	if(odp_unlikely(!fastnet_icmp_allow(v4_class(type,code)))){
+		FASTNET_STAT_INC(icmp_out_ratelimited);
+		return 1;
+	}
+	
+	quote = odp_packet_len(pkt)-l3off;
+	if(quote > ICMP_ERR_MAX-sizeof(fnet_ip_header_t)-sizeof(icmp_err_t))
+		quote = ICMP_ERR_MAX-sizeof(fnet_ip_header_t)-sizeof(icmp_err_t);
+	len = sizeof(icmp_err_t)+quote;
+	
+	err = fastnet_pktout_alloc(ETHERNET_HEADER_LEN+sizeof(fnet_ip_header_t)+len);
+	if(odp_unlikely(err==ODP_PACKET_INVALID)) return 1;
+	odp_packet_user_ptr_set(err,nif);
+	odp_packet_l3_offset_set(err,ETHERNET_HEADER_LEN);
+	odp_packet_l4_offset_set(err,ETHERNET_HEADER_LEN+sizeof(fnet_ip_header_t));
+	if(odp_unlikely(odp_packet_copy_from_pkt(err,ETHERNET_HEADER_LEN+sizeof(fnet_ip_header_t)+sizeof(icmp_err_t),pkt,l3off,quote))) goto drop;
+	
+	ip = fastnet_safe_l3(err,sizeof(fnet_ip_header_t)+sizeof(icmp_err_t));
+	if(odp_unlikely(ip==NULL)) goto drop;
+	eh = (icmp_err_t*)(ip+1);
+	
+	eh->type     = type;
+	eh->code     = code;
+	eh->checksum = 0;
+	eh->info     = odp_cpu_to_be_32(info);
+	eh->checksum = fastnet_checksum(err,odp_packet_l4_offset(err),0,NULL,0);
+	
+	ip->version__header_length = 0x45;
+	ip->tos                    = FNET_IP_TOS_NORMAL;
+	ip->total_length           = odp_cpu_to_be_16(len+sizeof(fnet_ip_header_t));
+	ip->id                     = 0;
+	ip->flags_fragment_offset  = 0;
+	ip->ttl                    = DATAGRAM_TTL;
+	ip->protocol               = IP_PROTOCOL_ICMP;
+	ip->checksum               = 0;
+	/*
+	 * The destination address of the offending datagram is one of ours, and a unicast address.
+	 */
+	ip->source_addr            = dst;
+	ip->destination_addr       = src;
+	
+	FASTNET_STAT_INC(icmp_out_msgs);
+	ret = fastnet_ip_output(err,NULL);
+	if(ret!=NETPP_CONSUMED) goto drop;
+	return 0;
+drop:
+	fastnet_pktout_free(err);
+	return 1;
+}
+
+int fastnet_icmpv6_error(odp_packet_t pkt,uint8_t type,uint8_t code,uint32_t info){
+	fnet_ip6_header_t* ip6;
+	icmp_err_t*        eh;
+	nif_t*             nif;
+	odp_packet_t       err;
+	ipv6_addr_t        src,dst;
+	uint32_t           l3off,quote,len;
+	netpp_retcode_t    ret;
+	int                to_group;
+	uint8_t            itype;
+	
+	nif = odp_packet_user_ptr(pkt);
+	if(odp_unlikely(nif==NULL || nif->ipv6==NULL)) return 1;
+	ip6 = fastnet_safe_l3(pkt,sizeof(fnet_ip6_header_t));
+	if(odp_unlikely(ip6==NULL)) return 1;
+	src = ip6->source_addr;
+	dst = ip6->destination_addr;
+	l3off = odp_packet_l3_offset(pkt);
+	
+	/*
+	 * RFC 4443 2.4 (e): An ICMPv6 error message MUST NOT be originated as a result of receiving:
+	 *  - an ICMPv6 error message,
+	 *  - a packet destined to an IPv6 multicast address, or sent as a link-layer multicast or
+	 *    broadcast, except for Packet Too Big and Parameter Problem Code 2,
+	 *  - a packet whose source address does not uniquely identify a single node.
+	 */
+	if(odp_unlikely(IP6_ADDR_IS_UNSPECIFIED(src) || IP6_ADDR_IS_MULTICAST(src))) return 1;
+	to_group = IP6_ADDR_IS_MULTICAST(dst) || is_l2_group(pkt);
+	if(odp_unlikely(to_group) &&
+		type!=FNET_ICMP6_TYPE_PACKET_TOOBIG &&
+		!(type==FNET_ICMP6_TYPE_PARAM_PROB && code==FNET_ICMP6_CODE_PP_OPTION)
+	) return 1;
+	if(ip6->next_header==IP_PROTOCOL_ICMP6){
+		if(odp_unlikely(odp_packet_copy_to_mem(pkt,l3off+sizeof(fnet_ip6_header_t),1,&itype))) return 1;
+		if(itype<FNET_ICMP6_TYPE_ECHO_REQ) return 1;
+	}
+	
+	/*
+	 * The source address must be a unicast address of ours.
+	 */
+	if(IP6_ADDR_IS_MULTICAST(dst)){
+		if(odp_unlikely(!fastnet_ipv6_addr_select(nif->ipv6,&dst,&src))) return 1;
+	}
+	
+	if(odp_unlikely(!fastnet_icmp_allow(v6_class(type)))){
+		FASTNET_STAT_INC(icmp6_out_ratelimited);
+		return 1;
+	}
+	
+	quote = odp_packet_len(pkt)-l3off;
+	if(quote > ICMP6_ERR_MAX-sizeof(fnet_ip6_header_t)-sizeof(icmp_err_t))
+		quote = ICMP6_ERR_MAX-sizeof(fnet_ip6_header_t)-sizeof(icmp_err_t);
+	len = sizeof(icmp_err_t)+quote;
+	
+	err = fastnet_pktout_alloc(ETHERNET_HEADER_LEN+sizeof(fnet_ip6_header_t)+len);
+	if(odp_unlikely(err==ODP_PACKET_INVALID)) return 1;
+	odp_packet_user_ptr_set(err,nif);
+	odp_packet_l3_offset_set(err,ETHERNET_HEADER_LEN);
+	odp_packet_l4_offset_set(err,ETHERNET_HEADER_LEN+sizeof(fnet_ip6_header_t));
+	if(odp_unlikely(odp_packet_copy_from_pkt(err,ETHERNET_HEADER_LEN+sizeof(fnet_ip6_header_t)+sizeof(icmp_err_t),pkt,l3off,quote))) goto drop;
+	
+	ip6 = fastnet_safe_l3(err,sizeof(fnet_ip6_header_t)+sizeof(icmp_err_t));
+	if(odp_unlikely(ip6==NULL)) goto drop;
+	eh = (icmp_err_t*)(ip6+1);
+	
+	/*
+	 * The IP-version is 6, the Traffic Class is 0x00 and the
+	 * Flow Label is 0x00000 (will be set by the IPv6 stack).
+	 */
+	ip6->version_tclass_flowl  = odp_cpu_to_be_32(0x60000000); // tclass = 0
+	ip6->length                = odp_cpu_to_be_16(len);
+	ip6->next_header           = IP_PROTOCOL_ICMP6;
+	ip6->hop_limit             = DATAGRAM_TTL;
+	ip6->source_addr           = dst;
+	ip6->destination_addr      = src;
+	
+	eh->type     = type;
+	eh->code     = code;
+	eh->checksum = 0;
+	eh->info     = odp_cpu_to_be_32(info);
+	eh->checksum = fastnet_ip6_checksum(err,dst,src,IP_PROTOCOL_ICMP6,NULL,0);
+	
+	FASTNET_STAT_INC(icmp6_out_msgs);
+	ret = fastnet_ip6_output(err,NULL);
+	if(ret!=NETPP_CONSUMED) goto drop;
+	return 0;
+drop:
+	fastnet_pktout_free(err);
+	return 1;
+}
+
+int fastnet_icmp_port_unreach(odp_packet_t pkt){
+	uint8_t* l3 = odp_packet_l3_ptr(pkt,NULL);
+	
+	/*
+	 * Packets created by the stack don't carry the odp_packet_has_ipv[46]() flags,
+	 * so the IP version is taken from the header itself.
+	 */
+	if(odp_unlikely(l3==NULL)) return 1;
+	if((l3[0]>>4)==6)
+		return fastnet_icmpv6_error(pkt,FNET_ICMP6_TYPE_DEST_UNREACH,FNET_ICMP6_CODE_DU_PORT_UNREACH,0);
+	return fastnet_icmpv4_error(pkt,FNET_ICMP_UNREACHABLE,FNET_ICMP_UNREACHABLE_PORT,0);
+}
@@ -27,6 +27,9 @@
 #include <net/defaults.h>
 #include <net/safe_packet.h>
 #include <net/ip_next_hop.h>
+#include <net/stats.h>
+#include <net/icmp_limit.h>
+#include <net/pmtu.h>
 
 typedef struct{
 	ipv4_addr_t src,dst;
@@ -110,6 +113,43 @@ void add_response_header(ip_pair_t* pair,odp_packet_t pkt,uint32_t pktlen,uint32
 	ip->destination_addr       = pair->src;
 }
 
+/*
+ * RFC 1191 7: Plateau table, to estimate the Path MTU from the length of the quoted datagram, if
+ * the router did not report the Next-Hop MTU (pre RFC 1191 routers).
+ */
+static const uint16_t mtu_plateaus[] = { 32000, 17914, 8166, 4352, 2002, 1492, 1006, 508, 296, 68 };
+
+/*
+ * Updates the PMTU cache from a "Fragmentation needed and DF set" message.
+ */
+static
+void needfrag(odp_packet_t pkt,struct ipv4_nif_struct* ipv4){
+	fnet_icmp_err_header_t* hdr;
+	uint32_t mtu,len,i;
+	
+	hdr = fastnet_safe_l4(pkt,sizeof(fnet_icmp_err_header_t));
+	if(odp_unlikely(!hdr)) return;
+	
+	/* The quoted datagram must have been sent by us. */
+	if(odp_unlikely(ipv4==NULL || hdr->ip.source_addr!=ipv4->address)) return;
+	
+	mtu = odp_be_to_cpu_16(hdr->mtu_ptr);
+	len = odp_be_to_cpu_16(hdr->ip.total_length);
+	if(!mtu){
+		for(i=0;i<sizeof(mtu_plateaus)/sizeof(mtu_plateaus[0]);++i){
+			if(mtu_plateaus[i] >= len) continue;
+			mtu = mtu_plateaus[i];
+			break;
+		}
+		if(!mtu) return;
+	}
+	
+	/* A bogus report: The datagram would have fit. */
+	if(odp_unlikely(len && mtu>=len)) return;
+	
+	fastnet_pmtu_update4(hdr->ip.destination_addr,mtu);
+}
+
 
 netpp_retcode_t fastnet_icmpv4_input(odp_packet_t pkt){
 	ip_pair_t               pair;
@@ -121,6 +161,12 @@ netpp_retcode_t fastnet_icmpv4_input(odp_packet_t pkt){
 	nif_t*                  nif;
 	//int                 ;
 	uint16_t                chksum;
+	union {
+		uint8_t  repr8[2];
+		uint16_t repr16 ODP_PACKED;
+	} type_code;
+	
+	FASTNET_STAT_INC(icmp_in_msgs);
 	
 	ipv4 = getIpv4(pkt,&nif);
 	
@@ -138,7 +184,10 @@ netpp_retcode_t fastnet_icmpv4_input(odp_packet_t pkt){
 	/*
 	 * Checksum test.
 	 */
-	if(odp_unlikely( fastnet_checksum(pkt,pktoff,0,odp_packet_user_ptr(pkt),0) != 0 )) return NETPP_DROP;
+	if(odp_unlikely( fastnet_checksum(pkt,pktoff,0,odp_packet_user_ptr(pkt),0) != 0 )) {
+		FASTNET_STAT_INC(icmp_in_errors);
+		return NETPP_DROP;
+	}
 	
 	switch(hdr->type){
 	/**************************
@@ -151,14 +200,27 @@ netpp_retcode_t fastnet_icmpv4_input(odp_packet_t pkt){
 		 */
 		if(odp_unlikely(fastnet_ip_broadcast(ipv4,pair.dst))) return NETPP_DROP;
 		
+		if(odp_unlikely(!fastnet_icmp_allow(FASTNET_ICMPL_ECHO))){
+			FASTNET_STAT_INC(icmp_out_ratelimited);
+			return NETPP_DROP;
+		}
+		
+		/*
+		 * Only the type changes, so the checksum is updated incrementally (RFC 1624).
+		 */
+		type_code.repr8[0] = hdr->type;
+		type_code.repr8[1] = hdr->code;
+		chksum = type_code.repr16;
+		type_code.repr8[0] = FNET_ICMP_ECHOREPLY;
+		
 		hdr->type = FNET_ICMP_ECHOREPLY;
-		hdr->checksum = 0;
-		hdr->checksum = fastnet_checksum(pkt,pktoff,0,odp_packet_user_ptr(pkt),0);
+		hdr->checksum = fastnet_cksum_update16(hdr->checksum,chksum,type_code.repr16);
 		
 		add_response_header(&pair,pkt,pktlen,pktoff);
 		
 		NET_LOG("ICMP ECHO: %08x %08x\n",pair.src,pair.dst);
 		
+		FASTNET_STAT_INC(icmp_out_msgs);
 		return fastnet_ip_output(pkt,NULL);
 		break;
 		
@@ -194,6 +256,7 @@ netpp_retcode_t fastnet_icmpv4_input(odp_packet_t pkt){
 			break;
 		case FNET_ICMP_UNREACHABLE_NEEDFRAG:      /* fragmentation needed and DF set*/
 			prot_cmd = FNET_PROT_NOTIFY_MSGSIZE;
+			needfrag(pkt,ipv4);
 			break;
 		
 		default: return NETPP_DROP;
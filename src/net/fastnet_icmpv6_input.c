@@ -27,6 +27,10 @@
 #include <net/nd6.h>
 #include <net/defaults.h>
 #include <net/safe_packet.h>
+#include <net/stats.h>
+#include <net/icmp_limit.h>
+#include <net/ip6_next_hop.h>
+#include <net/pmtu.h>
 
 typedef struct{
 	ipv6_addr_t src,dst;
@@ -102,6 +106,35 @@ void add_response_header(ip6_pair_t* pair,odp_packet_t pkt,uint32_t pktlen,uint3
 
 static const ipv6_addr_t  ipv6_any = IP6_ADDR_ANY_INIT;
 
+typedef struct ODP_PACKED {
+	fnet_icmp6_err_header_t err;
+	fnet_ip6_header_t       ip;  /* The invoking packet. */
+} icmp6_toobig_t;
+
+/*
+ * Updates the PMTU cache from a Packet Too Big message (RFC 8201 4).
+ */
+static
+void packet_toobig(odp_packet_t pkt,struct ipv6_nif_struct* ipv6){
+	icmp6_toobig_t* hdr;
+	ipv6_addr_t src;
+	
+	if(odp_unlikely(ipv6==NULL || !ipv6->pmtu_on)) return;
+	
+	hdr = fastnet_safe_l4(pkt,sizeof(icmp6_toobig_t));
+	if(odp_unlikely(!hdr)) return;
+	
+	/* The invoking packet must have been sent by us. */
+	src = hdr->ip.source_addr;
+	if(odp_unlikely(!fastnet_ipv6_addr_is_self(ipv6,&src))) return;
+	
+	/*
+	 * The source node reduces its assumed PMTU for the path based on the MTU of the
+	 * constricting hop; it MUST NOT increase it (done by fastnet_pmtu_update6()).
+	 */
+	fastnet_pmtu_update6(&(hdr->ip.destination_addr),odp_be_to_cpu_32(hdr->err.data));
+}
+
 
 netpp_retcode_t fastnet_icmpv6_input(odp_packet_t pkt){
 	fnet_prot_notify_t       prot_cmd;
@@ -113,6 +146,14 @@ netpp_retcode_t fastnet_icmpv6_input(odp_packet_t pkt){
 	uint32_t                 pktlen,pktoff;
 	int                      source_is_unspecified;
 	int                      is_dest_multicast;
+	ipv6_addr_t              request_dst;
+	uint16_t                 chksum;
+	union {
+		uint8_t  repr8[2];
+		uint16_t repr16 ODP_PACKED;
+	} type_code;
+	
+	FASTNET_STAT_INC(icmp6_in_msgs);
 	
 	ipv6 = getIpv6(pkt,&nif);
 	
@@ -129,7 +170,10 @@ netpp_retcode_t fastnet_icmpv6_input(odp_packet_t pkt){
 	/*
 	 * Checksum test.
 	 */
-	if(odp_unlikely( fastnet_ip6_checksum(pkt,pair.src,pair.dst,IP_PROTOCOL_ICMP6) != 0 )) return NETPP_DROP;
+	if(odp_unlikely( fastnet_ip6_checksum(pkt,pair.src,pair.dst,IP_PROTOCOL_ICMP6,NULL,0) != 0 )) {
+		FASTNET_STAT_INC(icmp6_in_errors);
+		return NETPP_DROP;
+	}
 	
 	switch (hdr->type){
 	/**************************
@@ -144,7 +188,10 @@ netpp_retcode_t fastnet_icmpv6_input(odp_packet_t pkt){
 		 *  - If the IP source address is the unspecified address, the IP
 		 *    destination address is a solicited-node multicast address.
 		 */
-		if(odp_unlikely(pair.hop_limit != 255)) return NETPP_DROP;
+		if(odp_unlikely(pair.hop_limit != 255)) {
+			FASTNET_STAT_INC(nd6_in_errors);
+			return NETPP_DROP;
+		}
 		
 		if(IP6ADDR_EQ(ipv6_any,pair.src)){
 			if(odp_unlikely(!fastnet_ipv6_addr_is_own_ip6_solicited_multicast(ipv6,&pair.dst))) return NETPP_DROP;
@@ -152,6 +199,7 @@ netpp_retcode_t fastnet_icmpv6_input(odp_packet_t pkt){
 		}else{
 			source_is_unspecified = 0;
 		}
+		FASTNET_STAT_INC(nd6_in_msgs);
 		return fastnet_nd6_nsol_input(pkt,source_is_unspecified);
 		break;
 	/**************************
@@ -164,10 +212,14 @@ netpp_retcode_t fastnet_icmpv6_input(odp_packet_t pkt){
 		 *    could not possibly have been forwarded by a router.
 		 *  - ICMP Checksum is valid.
 		 */
-		if(odp_unlikely(pair.hop_limit != 255)) return NETPP_DROP;
+		if(odp_unlikely(pair.hop_limit != 255)) {
+			FASTNET_STAT_INC(nd6_in_errors);
+			return NETPP_DROP;
+		}
 		
 		is_dest_multicast = IP6_ADDR_IS_MULTICAST(pair.dst) ?1:0;
 		
+		FASTNET_STAT_INC(nd6_in_msgs);
 		return fastnet_nd6_nadv_input(pkt,is_dest_multicast);
 		break;
 	/**************************
@@ -189,7 +241,10 @@ netpp_retcode_t fastnet_icmpv6_input(odp_packet_t pkt){
 		 *  - ICMP Checksum is valid.
 		 */
 		if(odp_unlikely(!IP6_ADDR_IS_LINKLOCAL(pair.src))) return NETPP_DROP;
-		if(odp_unlikely(pair.hop_limit != 255)) return NETPP_DROP;
+		if(odp_unlikely(pair.hop_limit != 255)) {
+			FASTNET_STAT_INC(nd6_in_errors);
+			return NETPP_DROP;
+		}
 		
 		//netnd6_router_advertisement_receive(nif,pkt,&src_ip,&dest_ip);
 		break;
@@ -216,46 +271,42 @@ netpp_retcode_t fastnet_icmpv6_input(odp_packet_t pkt){
 		 * address belonging to the interface on which
 		 * the Echo Request message was received.
 		 */
+		request_dst = pair.dst;
 		if(IP6_ADDR_IS_MULTICAST(pair.dst)){
 			if(odp_unlikely(!fastnet_ipv6_addr_select(ipv6,&pair.dst,&pair.src))) return NETPP_DROP;
 		}
 		
+		if(odp_unlikely(!fastnet_icmp_allow(FASTNET_ICMPL_ECHO))){
+			FASTNET_STAT_INC(icmp6_out_ratelimited);
+			return NETPP_DROP;
+		}
+		
+		/*
+		 * The checksum is updated incrementally (RFC 1624): The type changes, and the
+		 * pseudo header only changes, if the reply's source address differs from the
+		 * request's destination address (the address swap doesn't change the sum).
+		 */
+		type_code.repr8[0] = hdr->type;
+		type_code.repr8[1] = hdr->code;
+		chksum = type_code.repr16;
+		type_code.repr8[0] = FNET_ICMP6_TYPE_ECHO_REPLY;
+		
 		hdr->type = FNET_ICMP6_TYPE_ECHO_REPLY;
-		hdr->checksum = 0;
-		hdr->checksum = fastnet_ip6_checksum(pkt,pair.dst,pair.src,IP_PROTOCOL_ICMP6);
+		hdr->checksum = fastnet_cksum_update16(hdr->checksum,chksum,type_code.repr16);
+		if(odp_unlikely(!IP6ADDR_EQ(request_dst,pair.dst)))
+			hdr->checksum = fastnet_cksum_update(hdr->checksum,&request_dst,&pair.dst,sizeof(ipv6_addr_t));
 		
 		add_response_header(&pair,pkt,pktlen,pktoff);
 		
-		// TODO: send IPv6
-		//neticmp6_output(nif,pkt,dst_addr,src_addr,0);
-                break;
+		FASTNET_STAT_INC(icmp6_out_msgs);
+		return fastnet_ip6_output(pkt,NULL);
 	/**************************
 	 * Packet Too Big Message.
 	 **************************/
 	case FNET_ICMP6_TYPE_PACKET_TOOBIG:
-	#if 0
-		if(nif->ipv6->pmtu_on) /* If PMTU is enabled for the interface.*/
-		{
-			
-			
-			/* The header must reside in contiguous area of memory. */
-			if( netpkt_pullup(pkt,sizeof(fnet_icmp6_err_header_t)) ) goto DROP;
-			
-			icmp6_err = netpkt_data(pkt);
-			
-			/* RFC 1981.Upon receipt of such a
-			 * message, the source node reduces its assumed PMTU for the path based
-			 * on the MTU of the constricting hop as reported in the Packet Too Big
-			 * message.*/
-			pmtu = ntoh32(icmp6_err->data);
-			
-			/* A node MUST NOT increase its estimate of the Path MTU in response to
-			 * the contents of a Packet Too Big message. */
-			if(nif->ipv6->pmtu > pmtu) nif->ipv6->pmtu = pmtu;
-		}
-		goto DROP;
-	#endif
-                break;
+		packet_toobig(pkt,ipv6);
+		prot_cmd = FNET_PROT_NOTIFY_MSGSIZE;
+		break;
 	/**************************
 	 * Destination Unreachable.
 	 **************************/
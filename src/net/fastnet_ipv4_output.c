@@ -23,6 +23,9 @@
 #include <net/ipv4_mac_cache.h>
 #include <net/requirement.h>
 #include <net/std_defs.h>
+#include <net/stats.h>
+#include <net/prof.h>
+#include <net/latency.h>
 
 struct ip_local_info{
 	ip_next_hop_t*    nh;
@@ -67,14 +70,17 @@ nh_done:
 	 * If the Upper layer has not filled out
 	 * the source IP, we have to do it.
 	 */
-	if (odata->ip->destination_addr == 0) {
+	if (odata->ip->source_addr == 0) {
 		/* Null-pointer check. */
 		if(odp_unlikely(odata->outnif->ipv4 == NULL)) {
 			NET_LOG("!odata->outnif->ipv4\n");
 			return NETPP_DROP;
 		}
 		
-		odata->ip->destination_addr = odata->outnif->ipv4->address;
+		/* Keep a precomputed checksum valid. */
+		if(odata->ip->checksum != 0)
+			odata->ip->checksum = fastnet_cksum_update32(odata->ip->checksum,0,odata->outnif->ipv4->address);
+		odata->ip->source_addr = odata->outnif->ipv4->address;
 	}
 	return NETPP_CONTINUE;
 }
@@ -157,7 +163,9 @@ netpp_retcode_t ipv4_add_eth(odp_packet_t pkt,struct ip_local_info* __restrict__
 		odata->is_loopback = 1;
 		dst = odata->outnif->hwaddr;
 	}else{
+		FASTNET_PROF_BEGIN(FASTNET_PROF_NEIGH_LOOKUP);
 		res = fastnet_ipv4_mac_lookup(odata->outnif,dst_ip,&dst,&sendarp,pkt);
+		FASTNET_PROF_END();
 		if(sendarp){
 			/*
 			 * Send an ARP packet out the network interface.
@@ -221,16 +229,36 @@ netpp_retcode_t fastnet_ip_output(odp_packet_t pkt,ip_next_hop_t* nh){
 	odata.outnif = NULL;
 	odata.is_loopback = 0;
 	
+	FASTNET_STAT_INC(ip_out_requests);
+	fastnet_lat_out(pkt);
+	FASTNET_PROF_BEGIN(FASTNET_PROF_IP_OUTPUT);
+	
 	ret = ipv4_find_route(&odata);
-	if(odp_unlikely(ret != NETPP_CONTINUE)) return ret;
+	if(odp_unlikely(ret != NETPP_CONTINUE)) goto discard;
+	
+	fastnet_pkt_set_l3l4(pkt,0,odata.ip->protocol);
 	
-	odata.ip->checksum = fastnet_ipv4_hdr_checksum(pkt);
+	/*
+	 * A checksum of 0 means, that the upper layer left it to us. Otherwise it is valid: The upper layer
+	 * has precomputed it (or updated it incrementally), so we don't need to touch the header again.
+	 */
+	if(odata.ip->checksum == 0 || (odata.outnif->offload_flags & NIFOFL_IP4_CKSUM)){
+		odata.ip->checksum = 0;
+		odata.ip->checksum = fastnet_ipv4_hdr_checksum(pkt,odata.outnif,NIFOFL_IP4_CKSUM);
+	}
+	
+	/*
+	 * The upper layer may have left the checksum to the NIC of the context-NIF, which is not
+	 * the one, the packet is sent through.
+	 */
+	if(odp_unlikely(odata.ctxnif != odata.outnif && odata.ctxnif != NULL))
+		fastnet_checksum_insert(pkt,odata.ctxnif->offload_flags & ~(odata.outnif->offload_flags) & NIFOFL_TX_MASK);
 	
 	ret = ipv4_add_eth(pkt,&odata);
-	if(odp_unlikely(ret != NETPP_CONTINUE)) return ret;
+	if(odp_unlikely(ret != NETPP_CONTINUE)) goto discard;
 	
 	if(odata.is_loopback)
-		return fastnet_pkt_loopback(pkt,odata.outnif);
+		ret = fastnet_pkt_loopback(pkt,odata.outnif);
 	else{
 		/*
 		 * Do we have any data in front of the Layer 2 header? Get Rid of it!
@@ -239,8 +267,16 @@ netpp_retcode_t fastnet_ip_output(odp_packet_t pkt,ip_next_hop_t* nh){
 		if(odp_unlikely(pretrail>0))
 			odp_packet_pull_head(pkt,pretrail);
 		
-		return fastnet_pkt_output(pkt,odata.outnif);
+		ret = fastnet_pkt_output(pkt,odata.outnif);
 	}
+	FASTNET_PROF_END();
+	return ret;
+	
+discard:
+	/* NETPP_CONSUMED: The packet waits for the address resolution. */
+	if(ret==NETPP_DROP) FASTNET_STAT_INC(ip_out_discards);
+	FASTNET_PROF_END();
+	return ret;
 }
 
 void fastnet_ip_arp_transmit(odp_packet_t pkt,nif_t *nif,uint64_t src,uint64_t dst){
@@ -35,16 +35,25 @@ enum{
 	I6OPT_DISCARD_UICMP,
 };
 
+/*
+ * Walks the options in [pos,end), which must lie within the packet. Every option advances
+ * 'pos' by at least one octet, so the walk ends. An option, that overruns 'end', is
+ * malformed.
+ */
 static int fastnet_ip6_ext_process(odp_packet_t pkt,uint32_t pos,uint32_t end){
 	opt_hdr_t oh;
-	uint8_t type,datalen;
 	
 	while(pos<end){
-		odp_packet_copy_to_mem(pkt,pos,sizeof(oh),&oh);
-		switch(oh.type){
-		case FNET_IP6_OPTION_TYPE_PAD1:
+		/* Pad1 has no length field, and may be the last octet of the header. */
+		if(odp_unlikely(odp_packet_copy_to_mem(pkt,pos,1,&oh.type))) return I6OPT_DISCARD;
+		if(oh.type==FNET_IP6_OPTION_TYPE_PAD1){
 			pos ++;
-			break;
+			continue;
+		}
+		if(odp_unlikely(pos+sizeof(oh)>end)) return I6OPT_DISCARD;
+		if(odp_unlikely(odp_packet_copy_to_mem(pkt,pos,sizeof(oh),&oh))) return I6OPT_DISCARD;
+		if(odp_unlikely(pos+sizeof(oh)+oh.len>end)) return I6OPT_DISCARD;
+		switch(oh.type){
 		case FNET_IP6_OPTION_TYPE_PADN:
 			pos += ((uint32_t)oh.len)+sizeof(oh);
 			break;
@@ -163,7 +172,7 @@ static int fastnet_ip6_ext_process(odp_packet_t pkt,uint32_t pos,uint32_t end){
 			/* The Option Type identifiers are internally encoded such that their
 			 * highest-order two bits specify the action that must be taken if the
 			 * processing IPv6 node does not recognize the Option Type.*/
-			switch(type & FNET_IP6_OPTION_TYPE_UNRECOGNIZED_MASK){
+			switch(oh.type & FNET_IP6_OPTION_TYPE_UNRECOGNIZED_MASK){
 			/* 00 - skip over this option and continue processing the header.*/
 			case FNET_IP6_OPTION_TYPE_UNRECOGNIZED_SKIP:
 				pos += ((uint32_t)oh.len)+sizeof(oh);
@@ -215,6 +224,9 @@ netpp_retcode_t fastnet_ip6x_hop_dst_opts(odp_packet_t pkt,int* nxt, int idx){
 	 */
 	size = (ho.hdr_len+1)*8;
 	
+	/* The options are walked up to the end of the header, which must be in the packet. */
+	if(odp_unlikely(off+size>odp_packet_len(pkt))) return NETPP_DROP;
+	
 	switch( fastnet_ip6_ext_process(pkt,off+sizeof(ip_hopopts_t),off+size) ){
 	case I6OPT_DISCARD_UICMP: // XXX: send ICMP error
 	case I6OPT_DISCARD_ICMP: // XXX: send ICMP error
@@ -18,6 +18,7 @@
 #include <net/header/ip6hdr.h>
 #include <net/header/ip6defs.h>
 #include <net/header/ethhdr.h>
+#include <net/checksum.h>
 #include <net/packet_output.h>
 
 #include <net/nd6_cache.h>
@@ -25,6 +26,9 @@
 #include <net/requirement.h>
 #include <net/std_defs.h>
 #include <net/_config.h>
+#include <net/stats.h>
+#include <net/prof.h>
+#include <net/latency.h>
 
 struct ip6_local_info{
 	ip6_next_hop_t*    nh;
@@ -165,6 +169,7 @@ netpp_retcode_t ipv6_add_eth(odp_packet_t pkt,struct ip6_local_info* __restrict_
 		now = odp_time_global();
 		
 		
+		FASTNET_PROF_BEGIN(FASTNET_PROF_NEIGH_LOOKUP);
 		fastnet_nd6_nce_lock_key(odata->outnif,dst_ip);
 		
 		/*
@@ -172,8 +177,12 @@ netpp_retcode_t ipv6_add_eth(odp_packet_t pkt,struct ip6_local_info* __restrict_
 		 */
 		
 		neighbor = fastnet_nd6_nce_find_or_create(odata->outnif,dst_ip,now);
+		FASTNET_PROF_END();
 		
-		if(odp_unlikely( neighbor==ODP_BUFFER_INVALID ) ) return NETPP_DROP;
+		if(odp_unlikely( neighbor==ODP_BUFFER_INVALID ) ) {
+			fastnet_nd6_nce_unlock_key(odata->outnif,dst_ip);
+			return NETPP_DROP;
+		}
 		
 		neighptr = odp_buffer_addr(neighbor);
 		
@@ -224,7 +233,7 @@ netpp_retcode_t ipv6_add_eth(odp_packet_t pkt,struct ip6_local_info* __restrict_
 	
 	ipv6_setmacaddrs(ethp,src,dst);
 	
-	return NETPP_DROP;
+	return NETPP_CONTINUE;
 }
 
 static
@@ -264,14 +273,27 @@ netpp_retcode_t fastnet_ip6_output(odp_packet_t pkt,ip6_next_hop_t* nh){
 	odata.outnif = NULL;
 	odata.is_loopback = 0;
 	
+	FASTNET_STAT_INC(ip6_out_requests);
+	fastnet_lat_out(pkt);
+	FASTNET_PROF_BEGIN(FASTNET_PROF_IP6_OUTPUT);
+	
 	ret = ipv6_find_route(&odata);
-	if(odp_unlikely(ret != NETPP_CONTINUE)) return ret;
+	if(odp_unlikely(ret != NETPP_CONTINUE)) goto discard;
+	
+	fastnet_pkt_set_l3l4(pkt,1,odata.ip6->next_header);
+	
+	/*
+	 * The upper layer may have left the checksum to the NIC of the context-NIF, which is not
+	 * the one, the packet is sent through.
+	 */
+	if(odp_unlikely(odata.ctxnif != odata.outnif && odata.ctxnif != NULL))
+		fastnet_checksum_insert(pkt,odata.ctxnif->offload_flags & ~(odata.outnif->offload_flags) & NIFOFL_TX_MASK);
 	
 	ret = ipv6_add_eth(pkt,&odata);
-	if(odp_unlikely(ret != NETPP_CONTINUE)) return ret;
+	if(odp_unlikely(ret != NETPP_CONTINUE)) goto discard;
 	
 	if(odata.is_loopback)
-		return fastnet_pkt_loopback(pkt,odata.outnif);
+		ret = fastnet_pkt_loopback(pkt,odata.outnif);
 	else{
 		/*
 		 * Do we have any data in front of the Layer 2 header? Get Rid of it!
@@ -280,8 +302,16 @@ netpp_retcode_t fastnet_ip6_output(odp_packet_t pkt,ip6_next_hop_t* nh){
 		if(odp_unlikely(pretrail>0))
 			odp_packet_pull_head(pkt,pretrail);
 		
-		return fastnet_pkt_output(pkt,odata.outnif);
+		ret = fastnet_pkt_output(pkt,odata.outnif);
 	}
+	FASTNET_PROF_END();
+	return ret;
+	
+discard:
+	/* NETPP_CONSUMED: The packet waits for the address resolution. */
+	if(ret==NETPP_DROP) FASTNET_STAT_INC(ip6_out_discards);
+	FASTNET_PROF_END();
+	return ret;
 }
 
 void fastnet_ip6_nd6_transmit(odp_packet_t pkt,nif_t *nif,uint64_t src,uint64_t dst){
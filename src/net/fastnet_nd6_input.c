@@ -22,6 +22,7 @@
 #include <net/mac_addr_ldst.h>
 #include <net/nd6_cache.h>
 #include <net/packet_output.h>
+#include <net/lockprof.h>
 
 /*
  * RFC-4861 10. Protocol Constants.
@@ -171,7 +172,7 @@ netpp_retcode_t fastnet_nd6_nsol_input(odp_packet_t pkt,int source_is_unspecifie
 		if(neighptr->state == ND6_NC__PHANTOM_){
 			neighptr->state        = ND6_NC_STALE;
 			neighptr->state_tstamp = now;
-			neighptr->hwaddr       = hwaddr;
+			fastnet_nd6_nce_set_hwaddr(neighptr,hwaddr);
 			neighptr->is_router    = 0;
 		} else
 		
@@ -190,14 +191,14 @@ netpp_retcode_t fastnet_nd6_nsol_input(odp_packet_t pkt,int source_is_unspecifie
 			if(neighptr->hwaddr != hwaddr){
 				neighptr->state        = ND6_NC_STALE;
 				neighptr->state_tstamp = now;
-				neighptr->hwaddr       = hwaddr;
+				fastnet_nd6_nce_set_hwaddr(neighptr,hwaddr);
 			}
 			break;
 		case ND6_NC_INCOMPLETE:
 			sendchain = neighptr->chain;
 			neighptr->state        = ND6_NC_STALE;
 			neighptr->state_tstamp = now;
-			neighptr->hwaddr       = hwaddr;
+			fastnet_nd6_nce_set_hwaddr(neighptr,hwaddr);
 			neighptr->chain        = ODP_PACKET_INVALID;
 			break;
 		}
@@ -267,7 +268,7 @@ netpp_retcode_t fastnet_nd6_nadv_input(odp_packet_t pkt,int is_dest_multicast){
 		if(odp_unlikely(message->flags & ND6_NADV_SOLICITED)) return NETPP_DROP;
 	}
 	
-	cur = start + sizeof(nd6_nsol_msg_t);
+	cur = start + sizeof(nd6_nadv_msg_t);
 	while(cur<end){
 		if(odp_unlikely(odp_packet_copy_to_mem(pkt,cur,sizeof(oh),&oh)))
 			return NETPP_DROP;
@@ -347,7 +348,7 @@ netpp_retcode_t fastnet_nd6_nadv_input(odp_packet_t pkt,int is_dest_multicast){
 		 *
 		 *  - It records the link-layer address in the Neighbor Cache entry.
 		 */
-		neighptr->hwaddr       = hwaddr;
+		fastnet_nd6_nce_set_hwaddr(neighptr,hwaddr);
 		neighptr->state_tstamp = now;
 		
 		/*
@@ -410,7 +411,7 @@ netpp_retcode_t fastnet_nd6_nadv_input(odp_packet_t pkt,int is_dest_multicast){
 			 *       MUST be inserted in the cache (if one is supplied and differs
 			 *       from the already recorded address).
 			 */
-			neighptr->hwaddr       = hwaddr;
+			fastnet_nd6_nce_set_hwaddr(neighptr,hwaddr);
 			neighptr->state_tstamp = now;
 			
 			/*
@@ -510,7 +511,7 @@ netpp_retcode_t fastnet_nd6_radv_input(odp_packet_t pkt,ipv6_addr_t* ipaddr_p){
 	/* - ICMP length (derived from the IP length) is 16 or more octets. */
 	if(odp_unlikely((end-start)<16)) return NETPP_DROP;
 	
-	cur = start + sizeof(nd6_nsol_msg_t);
+	cur = start + sizeof(nd6_radv_msg_t);
 	while(cur<end){
 		if(odp_unlikely(odp_packet_copy_to_mem(pkt,cur,sizeof(oh),&oh)))
 			return NETPP_DROP;
@@ -549,7 +550,7 @@ netpp_retcode_t fastnet_nd6_radv_input(odp_packet_t pkt,ipv6_addr_t* ipaddr_p){
 		cur += oh.length<<3;
 	}
 	
-	odp_spinlock_lock(&(nif->ipv6->fields_lock));
+	FASTNET_SPIN_LOCK(FASTNET_LOCK_IPV6_NIF,&(nif->ipv6->fields_lock));
 	/*
 	 * If the received Cur Hop Limit value is non-zero, the host SHOULD set
 	 * its CurHopLimit variable to the received value.
@@ -604,7 +605,7 @@ netpp_retcode_t fastnet_nd6_radv_input(odp_packet_t pkt,ipv6_addr_t* ipaddr_p){
 		
 	}
 	
-	odp_spinlock_unlock(&(nif->ipv6->fields_lock));
+	FASTNET_SPIN_UNLOCK(FASTNET_LOCK_IPV6_NIF,&(nif->ipv6->fields_lock));
 	
 	/* ----------------------------------------------------------------- */
 	
@@ -655,7 +656,7 @@ netpp_retcode_t fastnet_nd6_radv_input(odp_packet_t pkt,ipv6_addr_t* ipaddr_p){
 			neighptr->state  = ND6_NC_STALE;
 			break;
 		}
-		neighptr->hwaddr = hwaddr;
+		fastnet_nd6_nce_set_hwaddr(neighptr,hwaddr);
 		
 		sendchain              = neighptr->chain;
 		neighptr->chain        = ODP_PACKET_INVALID;
@@ -729,7 +730,7 @@ end_neighbor_cache_handling:
 	
 	#if 0
 	/* Loop through all Prefixes. */
-	cur = start + sizeof(nd6_nsol_msg_t);
+	cur = start + sizeof(nd6_radv_msg_t);
 	while(cur<end){
 		if(odp_unlikely(odp_packet_copy_to_mem(pkt,cur,sizeof(oh),&oh)))
 			return NETPP_DROP;
@@ -26,6 +26,10 @@
 #include <net/in_tlp.h>
 #include <net/checksum.h>
 #include <net/safe_packet.h>
+#include <net/socket_key.h>
+#include <net/stats.h>
+#include <net/prof.h>
+#include <net/latency.h>
 
 #if 0
 static void print_next_header(char ipv,int next_header){
@@ -52,18 +56,27 @@ static void print_next_header(char ipv,int next_header){
 netpp_retcode_t fastnet_ip_input(odp_packet_t pkt){
 	fnet_ip_header_t * __restrict__  ip;
 	nif_t*                           nif = odp_packet_user_ptr(pkt);
+	netpp_retcode_t                  ret;
 	ipv4_addr_t                      dest_addr;
 	int                              is_ours;
 	uint8_t                          next_header;
 	uint16_t                         cksum;
 	uint32_t                         havelen,shouldlen,offset,hdrlen;
 	
+	FASTNET_STAT_INC(ip_in_receives);
+	
 	ip = fastnet_safe_l3(pkt,sizeof(fnet_ip_header_t));
-	if (odp_unlikely(ip == NULL)) return NETPP_DROP;
+	if (odp_unlikely(ip == NULL)) goto hdr_error;
 	
-	if(odp_unlikely(FNET_IP_HEADER_GET_VERSION(ip)!=4)) return NETPP_DROP;
-	cksum = fastnet_ipv4_hdr_checksum(pkt);
-	if(odp_unlikely(cksum != 0)) return NETPP_DROP;
+	if(odp_unlikely(FNET_IP_HEADER_GET_VERSION(ip)!=4)) goto hdr_error;
+	FASTNET_PROF_BEGIN(FASTNET_PROF_CKSUM);
+	cksum = fastnet_ipv4_hdr_checksum(pkt,nif,NIFOFL_RX_IP4_CKSUM);
+	FASTNET_PROF_END();
+	if(odp_unlikely(cksum != 0)) {
+		FASTNET_STAT_INC(ip_in_hdr_errors);
+		FASTNET_STAT_INC(drop_ip_checksum);
+		return NETPP_DROP;
+	}
 	
 	dest_addr = ip->destination_addr;
 	
@@ -76,7 +89,7 @@ netpp_retcode_t fastnet_ip_input(odp_packet_t pkt){
 		/*
 		 * Check the IP header length for invalid values.
 		 */
-		if(odp_unlikely( hdrlen < sizeof(fnet_ip_header_t) )) return NETPP_DROP;
+		if(odp_unlikely( hdrlen < sizeof(fnet_ip_header_t) )) goto hdr_error;
 		
 		/*
 		 * Calculate/set the layer 4 offset.
@@ -103,16 +116,41 @@ netpp_retcode_t fastnet_ip_input(odp_packet_t pkt){
 		shouldlen = odp_be_to_cpu_16(ip->total_length);
 		
 		if(odp_unlikely(havelen>shouldlen)) odp_packet_pull_tail(pkt,havelen-shouldlen);
-		else if(odp_unlikely(havelen<shouldlen)) return NETPP_DROP;
+		else if(odp_unlikely(havelen<shouldlen)) {
+			FASTNET_STAT_INC(ip_in_truncated_pkts);
+			FASTNET_STAT_INC(drop_ip_length);
+			return NETPP_DROP;
+		}
+		
+		/*
+		 * Store the socket key for the transport layer.
+		 */
+		fastnet_socket_key_parse4(pkt,ip,next_header);
 		
 		ip = NULL;
 		fastnet_ip_reass(&pkt);
-		if(pkt==ODP_PACKET_INVALID) return NETPP_CONSUMED;
+		if(pkt==ODP_PACKET_INVALID) {
+			FASTNET_STAT_INC(ip_reasm_fails);
+			FASTNET_STAT_INC(drop_ip_fragment);
+			return NETPP_CONSUMED;
+		}
 		
-		return fn_in_protocols[fn_in4_protocol_idx[next_header]].in_hook(pkt);
+		FASTNET_STAT_INC(ip_in_delivers);
+		fastnet_lat_stamp(pkt,FASTNET_LAT_L4);
+		FASTNET_PROF_BEGIN(fastnet_prof_l4_stage(next_header));
+		ret = fn_in_protocols[fn_in4_protocol_idx[next_header]].in_hook(pkt);
+		FASTNET_PROF_END();
+		return ret;
 	}
 	
 	/* TODO: forward */
+	FASTNET_STAT_INC(ip_in_addr_errors);
+	FASTNET_STAT_INC(drop_ip_not_ours);
+	return NETPP_DROP;
+	
+hdr_error:
+	FASTNET_STAT_INC(ip_in_hdr_errors);
+	FASTNET_STAT_INC(drop_ip_header);
 	return NETPP_DROP;
 }
 
@@ -127,15 +165,17 @@ netpp_retcode_t fastnet_ip6_input(odp_packet_t pkt){
 	int                               proto_idx;
 	uint32_t                          havelen,shouldlen,offset;
 	
-	if(odp_unlikely(fastnet_ipv6_deactivated(nif->ipv6))) return NETPP_DROP;
+	FASTNET_STAT_INC(ip6_in_receives);
+	
+	if(odp_unlikely(fastnet_ipv6_deactivated(nif->ipv6))) goto not_ours;
 	
 	ip6 = fastnet_safe_l3(pkt,sizeof(fnet_ip6_header_t));
-	if(odp_unlikely(ip6 == NULL)) return NETPP_DROP;
+	if(odp_unlikely(ip6 == NULL)) goto hdr_error;
 	
 	/*
 	 * Check the IPv6 header correctness.
 	 */
-	if(odp_unlikely((odp_be_to_cpu_32(ip6->version_tclass_flowl)>>28)!=6)) return NETPP_DROP;
+	if(odp_unlikely((odp_be_to_cpu_32(ip6->version_tclass_flowl)>>28)!=6)) goto hdr_error;
 	
 	/*
 	 * Get IPv6 addresses.
@@ -148,7 +188,7 @@ netpp_retcode_t fastnet_ip6_input(odp_packet_t pkt){
 	 * Multicast addresses must not be used as source addresses
 	 * in IPv6 packets or appear in any Routing header.
 	 */
-	if(odp_unlikely(IP6_ADDR_IS_MULTICAST(src_addr))) return NETPP_DROP;
+	if(odp_unlikely(IP6_ADDR_IS_MULTICAST(src_addr))) goto hdr_error;
 	
 	/*
 	 * Check, wether this IP address is targeted at us.
@@ -163,8 +203,6 @@ netpp_retcode_t fastnet_ip6_input(odp_packet_t pkt){
 		 */
 		shouldlen = odp_be_to_cpu_16(ip6->length);
 		
-		ip6 = NULL;
-		
 		/*
 		 * Calculate/set the layer 4 offset.
 		 */
@@ -184,29 +222,68 @@ netpp_retcode_t fastnet_ip6_input(odp_packet_t pkt){
 		 * PayloadLength-field, THEN we drop the packet.
 		 */
 		if(odp_unlikely(havelen>shouldlen)) odp_packet_pull_tail(pkt,havelen-shouldlen);
-		else if(odp_unlikely(havelen<shouldlen)) return NETPP_DROP;
+		else if(odp_unlikely(havelen<shouldlen)) {
+			FASTNET_STAT_INC(ip6_in_truncated_pkts);
+			FASTNET_STAT_INC(drop_ip6_length);
+			return NETPP_DROP;
+		}
 		
+		/*
+		 * Store the socket key for the transport layer.
+		 */
+		fastnet_socket_key_parse6(pkt,ip6,next_header);
+		
+		ip6 = NULL;
+		
+		FASTNET_STAT_INC(ip6_in_delivers);
+		fastnet_lat_stamp(pkt,FASTNET_LAT_L4);
 		ret = NETPP_CONTINUE;
+		FASTNET_PROF_BEGIN(fastnet_prof_l4_stage(next_header));
 		while(ret==NETPP_CONTINUE && next_header<IP_NO_PROTOCOL){
 			proto_idx = fn_in6_protocol_idx[next_header];
 			ret = fn_in_protocols[proto_idx].in6_hook(pkt,&next_header,proto_idx);
 		}
+		FASTNET_PROF_END();
 		return ret;
 	}
 	
 	/* TODO: forward */
+not_ours:
+	FASTNET_STAT_INC(ip6_in_addr_errors);
+	FASTNET_STAT_INC(drop_ip6_not_ours);
+	return NETPP_DROP;
+	
+hdr_error:
+	FASTNET_STAT_INC(ip6_in_hdr_errors);
+	FASTNET_STAT_INC(drop_ip6_header);
 	return NETPP_DROP;
 }
 
 netpp_retcode_t fastnet_classified_input(odp_packet_t pkt){
-	if(odp_packet_has_ipv4(pkt))
-		return fastnet_ip_input(pkt);
+	netpp_retcode_t ret;
+	
+	fastnet_lat_stamp(pkt,FASTNET_LAT_L3);
 	
-	if(odp_packet_has_arp(pkt))
-		return fastnet_arp_input(pkt);
+	if(odp_packet_has_ipv4(pkt)){
+		FASTNET_PROF_BEGIN(FASTNET_PROF_IP_INPUT);
+		ret = fastnet_ip_input(pkt);
+		FASTNET_PROF_END();
+		return ret;
+	}
 	
-	if(odp_packet_has_ipv6(pkt))
-		return fastnet_ip6_input(pkt);
+	if(odp_packet_has_arp(pkt)){
+		FASTNET_PROF_BEGIN(FASTNET_PROF_ARP_INPUT);
+		ret = fastnet_arp_input(pkt);
+		FASTNET_PROF_END();
+		return ret;
+	}
+	
+	if(odp_packet_has_ipv6(pkt)){
+		FASTNET_PROF_BEGIN(FASTNET_PROF_IP6_INPUT);
+		ret = fastnet_ip6_input(pkt);
+		FASTNET_PROF_END();
+		return ret;
+	}
 	return NETPP_DROP;
 }
 
@@ -14,13 +14,33 @@
  *   limitations under the License.
  */
 #include <net/packet_output.h>
+#include <net/checksum.h>
+#include <net/stats.h>
+#include <net/prof.h>
+#include <net/latency.h>
 
 netpp_retcode_t fastnet_pkt_output(odp_packet_t pkt,nif_t *dest){
 	int qi = odp_thread_id() % dest->num_queues;
-	return odp_queue_enq(dest->output[qi], odp_packet_to_event (pkt))?NETPP_DROP:NETPP_CONSUMED;
+	int rc;
+	if(odp_unlikely(dest->offload_flags & NIFOFL_EMULATED))
+		fastnet_checksum_insert(pkt,dest->offload_flags & NIFOFL_TX_MASK);
+	fastnet_lat_tx(pkt);
+	FASTNET_PROF_BEGIN(FASTNET_PROF_QUEUE_ENQ);
+	rc = odp_queue_enq(dest->output[qi], odp_packet_to_event (pkt));
+	FASTNET_PROF_END();
+	if(odp_unlikely(rc)){
+		FASTNET_STAT_INC(drop_tx_queue_full);
+		return NETPP_DROP;
+	}
+	return NETPP_CONSUMED;
 }
 
 netpp_retcode_t fastnet_pkt_loopback(odp_packet_t pkt,nif_t *dest){
+	/*
+	 * The packet doesn't pass the NIC, so we must insert the checksums, that were left to it.
+	 */
+	if(odp_unlikely(dest->offload_flags & NIFOFL_TX_MASK))
+		fastnet_checksum_insert(pkt,dest->offload_flags & NIFOFL_TX_MASK);
 	return odp_queue_enq(dest->loopback, odp_packet_to_event (pkt))?NETPP_DROP:NETPP_CONSUMED;
 }
 
@@ -22,6 +22,10 @@
 #include <net/fastnet_tcp.h>
 #include <net/header/layer4.h>
 #include <net/checksum.h>
+#include <net/stats.h>
+#include <net/header/iphdr.h>
+#include <net/header/ip6hdr.h>
+#include <net/pmtu.h>
 
 /* TODO: implement a sane algorithm (RFC 793/1122) */
 static uint32_t fastnet_gen_next_iss(){
@@ -34,6 +38,47 @@ enum {
 	TCP_LISTEN_MASK = FNET_TCP_SGT_RST|FNET_TCP_SGT_SYN|FNET_TCP_SGT_ACK,
 };
 
+/*
+ * Returns the MSS option of the SYN 'pkt', 0 if there is none.
+ */
+static uint16_t syn_mss(odp_packet_t pkt,uint16_t flags){
+	uint8_t* opt;
+	uint32_t hdrlen,i;
+	
+	hdrlen = (flags>>10)&0x3c;
+	if(hdrlen<=sizeof(fnet_tcp_header_t)) return 0;
+	opt = fastnet_safe_l4(pkt,hdrlen);
+	if(odp_unlikely(opt==NULL)) return 0;
+	
+	i = sizeof(fnet_tcp_header_t);
+	while(i<hdrlen){
+		switch(opt[i]){
+		case FNET_TCP_OPT_EOL: return 0;
+		case FNET_TCP_OPT_NOP: i++; continue;
+		}
+		if(odp_unlikely((i+1)>=hdrlen || opt[i+1]<2 || (i+opt[i+1])>hdrlen)) return 0;
+		if(opt[i]==FNET_TCP_OPT_MSS && opt[i+1]==FNET_TCP_OPT_MSS_LEN)
+			return (((uint16_t)opt[i+2])<<8)|opt[i+3];
+		i += opt[i+1];
+	}
+	return 0;
+}
+
+/*
+ * Returns the MSS, we announce: The link MTU of the receiving interface, minus the TCP/IP headers
+ * (RFC 879, RFC 6691).
+ */
+static uint16_t our_mss(odp_packet_t pkt,socket_key_t *key){
+	nif_t* nif = odp_packet_user_ptr(pkt);
+	uint32_t mss;
+	
+	if(key->layer3_version==0x66)
+		mss = fastnet_link_mtu6(nif) - sizeof(fnet_ip6_header_t) - sizeof(fnet_tcp_header_t);
+	else
+		mss = fastnet_link_mtu4(nif) - sizeof(fnet_ip_header_t) - sizeof(fnet_tcp_header_t);
+	return mss<0xffff ? mss : 0xffff;
+}
+
 static
 netpp_retcode_t fastnet_tcp_internal_listen(odp_packet_t pkt, fastnet_tcp_pcb_t* parent_pcb, socket_key_t *key) {
 	fastnet_socket_t sock;
@@ -95,7 +140,7 @@ netpp_retcode_t fastnet_tcp_internal_listen(odp_packet_t pkt, fastnet_tcp_pcb_t*
 	/*
 	 * Precompute TCP/IP header. This will accelerate the creation of TCP/IP packets.
 	 */
-	fastnet_tcp_segmout_create_header_buf(pcb->tcpiphdr.buf,key);
+	fastnet_tcp_segmout_create_header(pcb,key,odp_packet_user_ptr(pkt));
 	
 	/*
 	 * Copy the PCB Fragments.
@@ -108,7 +153,7 @@ netpp_retcode_t fastnet_tcp_internal_listen(odp_packet_t pkt, fastnet_tcp_pcb_t*
 	 */
 	((fastnet_sockstruct_t*) pcb)->key = *key;
 	((fastnet_sockstruct_t*) pcb)->type_tag = IP_PROTOCOL_TCP;
-	fastnet_socket_construct(sock,fastnet_tcp_socket_finalize);
+	fastnet_socket_construct(sock,NULL);
 	
 	/*
 	 * Set RCV.NXT to SEG.SEQ+1, IRS is set to SEG.SEQ and any other
@@ -134,11 +179,13 @@ netpp_retcode_t fastnet_tcp_internal_listen(odp_packet_t pkt, fastnet_tcp_pcb_t*
 	pcb->snd.nxt = iss+1;
 	pcb->snd.una = iss;
 	pcb->state   = SYN_RECEIVED;
+	pcb->snd_mss = syn_mss(pkt,flags);
 	
 	/*
 	 * Insert socket into he socket table.
 	 */
 	fastnet_socket_insert(sock);
+	FASTNET_STAT_INC(tcp_passive_opens);
 	
 	/* Drop socket reference. */
 	fastnet_socket_put(sock);
@@ -146,11 +193,11 @@ netpp_retcode_t fastnet_tcp_internal_listen(odp_packet_t pkt, fastnet_tcp_pcb_t*
 	/*
 	 * SEND <SEQ=ISS><ACK=RCV.NXT><CTL=SYN,ACK>
 	 */
-	return fastnet_tcp_output_flags_wnd(pkt,key,
+	return fastnet_tcp_output_synack(pkt,key,
 		/*SEQ=*/ iss,
 		/*ACK=*/ seg_seq+1,
 		/*WND=*/ pcb->rcv.wnd,
-		/*CTL=*/ FNET_TCP_SGT_SYN | FNET_TCP_SGT_ACK);
+		/*MSS=*/ our_mss(pkt,key));
 }
 
 netpp_retcode_t fastnet_tcp_handshake_listen (odp_packet_t pkt,socket_key_t *key,fastnet_socket_t sock) {
@@ -22,25 +22,132 @@
 #include <net/fastnet_tcp.h>
 #include <net/header/layer4.h>
 #include <net/checksum.h>
+#include <net/flow_director.h>
+#include <net/stats.h>
+#include <net/prof.h>
+#include <net/lockprof.h>
+
+#ifdef NET_TCP_FLOW_AFFINITY
+
+static inline
+netpp_retcode_t fastnet_tcp_input_owned(odp_packet_t pkt,socket_key_t *key,uint32_t hash) {
+	fastnet_socket_t sock;
+	netpp_retcode_t ret;
+	
+	/*
+	 * We own the flow: Neither the PCB lock nor the reference count is required.
+	 */
+	FASTNET_PROF_BEGIN(FASTNET_PROF_SOCKET_LOOKUP);
+	sock = fastnet_socket_lookup_owned(key,hash);
+	FASTNET_PROF_END();
+	if(odp_likely(sock==ODP_BUFFER_INVALID)) {
+		FASTNET_STAT_INC(tcp_no_ports);
+		ret = fastnet_tcp_output_reset(pkt,key);
+		if(ret==NETPP_DROP) FASTNET_STAT_INC(drop_tcp_no_socket);
+		return ret;
+	}
+	
+	FASTNET_PROF_BEGIN(FASTNET_PROF_TCP_PROCESS);
+	ret = fastnet_tcp_process(pkt,key,sock);
+	FASTNET_PROF_END();
+	return ret;
+}
+
+/*
+ * Entry point for packets forwarded by the flow director. The checksum is already verified.
+ */
+static
+netpp_retcode_t fastnet_tcp_input_forwarded(odp_packet_t pkt) {
+	socket_key_t key;
+	uint32_t hash;
+	
+	/* The key has been stored in the user area by fastnet_tcp_input(). */
+	if(odp_unlikely(fastnet_socket_key_obtain_hash(pkt,&key,IP_PROTOCOL_TCP,&hash)!=NETPP_CONTINUE)) return NETPP_DROP;
+	return fastnet_tcp_input_owned(pkt,&key,hash);
+}
 
 netpp_retcode_t fastnet_tcp_input(odp_packet_t pkt) {
 	socket_key_t key;
+	uint32_t hash;
+	uint16_t cksum;
+	netpp_retcode_t ret;
+	
+	/*
+	 * Check checksum.
+	 */
+	FASTNET_STAT_INC(tcp_in_segs);
+	FASTNET_PROF_BEGIN(FASTNET_PROF_CKSUM);
+	cksum = fastnet_tcpudp_input_checksum(pkt,IP_PROTOCOL_TCP);
+	FASTNET_PROF_END();
+	if(odp_unlikely(cksum!=0)) {
+		FASTNET_STAT_INC(tcp_in_errs);
+		FASTNET_STAT_INC(drop_tcp_checksum);
+		return NETPP_DROP;
+	}
+	
+	if(odp_unlikely(fastnet_socket_key_obtain_hash(pkt,&key,IP_PROTOCOL_TCP,&hash)!=NETPP_CONTINUE)) return NETPP_DROP;
+	
+	/*
+	 * Forward the packet, if the flow belongs to an other worker.
+	 */
+	FASTNET_PROF_BEGIN(FASTNET_PROF_FLOWDIR_STEER);
+	ret = fastnet_flowdir_steer(pkt,hash,fastnet_tcp_input_forwarded);
+	FASTNET_PROF_END();
+	if(odp_unlikely(ret!=NETPP_CONTINUE)) return ret;
+	
+	return fastnet_tcp_input_owned(pkt,&key,hash);
+}
+
+#else
+
+netpp_retcode_t fastnet_tcp_input(odp_packet_t pkt) {
+	socket_key_t key;
+	uint32_t hash;
 	fastnet_socket_t sock;
+	fastnet_tcp_pcb_t* pcb;
+	uint16_t cksum;
+	netpp_retcode_t ret;
 	
 	/*
 	 * Check checksum.
 	 */
-	if(odp_unlikely(fastnet_tcpudp_input_checksum(pkt,IP_PROTOCOL_TCP)!=0)) return NETPP_DROP;
+	FASTNET_STAT_INC(tcp_in_segs);
+	FASTNET_PROF_BEGIN(FASTNET_PROF_CKSUM);
+	cksum = fastnet_tcpudp_input_checksum(pkt,IP_PROTOCOL_TCP);
+	FASTNET_PROF_END();
+	if(odp_unlikely(cksum!=0)) {
+		FASTNET_STAT_INC(tcp_in_errs);
+		FASTNET_STAT_INC(drop_tcp_checksum);
+		return NETPP_DROP;
+	}
 	
 	/*
 	 * Socket Lookup.
 	 */
-	fastnet_socket_key_obtain(pkt,&key);
-	key.layer4_version = IP_PROTOCOL_TCP;
-	sock = fastnet_socket_lookup(&key);
-	if(odp_likely(sock==ODP_BUFFER_INVALID)) return NETPP_DROP; /* XXX: should send RST. */
+	if(odp_unlikely(fastnet_socket_key_obtain_hash(pkt,&key,IP_PROTOCOL_TCP,&hash)!=NETPP_CONTINUE)) return NETPP_DROP;
+	FASTNET_PROF_BEGIN(FASTNET_PROF_SOCKET_LOOKUP);
+	sock = fastnet_socket_lookup_hash(&key,hash);
+	FASTNET_PROF_END();
+	if(odp_likely(sock==ODP_BUFFER_INVALID)) {
+		FASTNET_STAT_INC(tcp_no_ports);
+		ret = fastnet_tcp_output_reset(pkt,&key);
+		if(ret==NETPP_DROP) FASTNET_STAT_INC(drop_tcp_no_socket);
+		return ret;
+	}
+	
+	/*
+	 * Any worker may receive segments of this flow, so the PCB must be locked.
+	 */
+	pcb = odp_buffer_addr(sock);
+	FASTNET_TICKET_LOCK(FASTNET_LOCK_TCP_PCB,&(pcb->lock));
+	FASTNET_PROF_BEGIN(FASTNET_PROF_TCP_PROCESS);
+	ret = fastnet_tcp_process(pkt,&key,sock);
+	FASTNET_PROF_END();
+	FASTNET_TICKET_UNLOCK(FASTNET_LOCK_TCP_PCB,&(pcb->lock));
 	
-	return fastnet_tcp_process(pkt,&key,sock);
+	fastnet_socket_put(sock);
+	return ret;
 }
 
+#endif
 
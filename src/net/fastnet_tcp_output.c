@@ -19,6 +19,11 @@
 #include <net/header/tcphdr.h>
 #include <net/header/layer4.h>
 #include <net/socket_tcp.h>
+#include <net/header/iphdr.h>
+#include <net/header/ip6hdr.h>
+#include <net/pmtu.h>
+#include <net/checksum.h>
+#include <net/pkt_alloc.h>
 
 static uint16_t wnd_to_16(uint32_t wnd){
 	if(wnd<0xFFFF)return (uint16_t)wnd;
@@ -28,16 +33,13 @@ static uint16_t wnd_to_16(uint32_t wnd){
 netpp_retcode_t fastnet_tcp_output(odp_packet_t pkt,fastnet_socket_t sock,uint32_t seq_num,uint16_t flags){
 	nif_t* nif;
 	fastnet_tcp_pcb_t* pcb;
-	odp_time_t now;
 	uint32_t length;
 	
 	length = odp_packet_len(pkt);
 	
-	now = odp_time_global();
-	
 	pcb = odp_buffer_addr(sock);
 	
-	if(odp_unlikely(fastnet_tcp_add_header(pkt,pcb,now,&nif) )) return NETPP_DROP;
+	if(odp_unlikely(fastnet_tcp_add_header(pkt,pcb,&nif) )) return NETPP_DROP;
 	
 	fnet_tcp_parthdr_t thdr = {
 		.sequence_number  = odp_cpu_to_be_32(seq_num),
@@ -48,8 +50,65 @@ netpp_retcode_t fastnet_tcp_output(odp_packet_t pkt,fastnet_socket_t sock,uint32
 		.urgent_ptr       = 0,
 	};
 	
-	odp_packet_copy_from_mem(pkt,odp_packet_l4_offset(pkt)+3,sizeof(thdr),&thdr);
+	odp_packet_copy_from_mem(pkt,odp_packet_l4_offset(pkt)+4,sizeof(thdr),&thdr);
 	
-	return fastnet_tcp_sendout_ll(pkt,pcb,nif,length);
+	return fastnet_tcp_sendout_ll(pkt,pcb,nif,length+sizeof(fnet_tcp_header_t));
 }
 
+netpp_retcode_t fastnet_tcp_output_data(fastnet_socket_t sock,uint32_t seq_num,uint16_t flags,const void* data,uint32_t len){
+	netpp_retcode_t ret;
+	odp_packet_t pkt;
+	
+	pkt = fastnet_pktout_alloc(len);
+	if(odp_unlikely(pkt==ODP_PACKET_INVALID)) return NETPP_DROP;
+	
+	/* The payload's checksum is computed while copying. */
+	if(odp_unlikely(fastnet_pkt_copyin_psum(pkt,0,data,len))){
+		fastnet_pktout_free(pkt);
+		return NETPP_DROP;
+	}
+	
+	ret = fastnet_tcp_output(pkt,sock,seq_num,flags);
+	if(odp_unlikely(ret!=NETPP_CONSUMED)) fastnet_pktout_free(pkt);
+	return ret;
+}
+
+uint32_t fastnet_tcp_send(fastnet_socket_t sock,uint32_t seq_num,uint16_t flags,const void* data,uint32_t len){
+	const uint8_t* src = data;
+	uint32_t mss,cur,sent = 0;
+	uint16_t f;
+	
+	/* Read once per call: After a "fragmentation needed", the next call sends smaller segments. */
+	mss = fastnet_tcp_snd_mss(odp_buffer_addr(sock));
+	if(odp_unlikely(!mss)) return 0;
+	
+	while(sent<len){
+		cur = len-sent;
+		if(cur>mss) cur = mss;
+		
+		/* PSH and FIN belong to the last segment. */
+		f = flags;
+		if(cur<len-sent) f &= ~(FNET_TCP_SGT_PSH|FNET_TCP_SGT_FIN);
+		
+		if(odp_unlikely(fastnet_tcp_output_data(sock,seq_num+sent,f,src+sent,cur)!=NETPP_CONSUMED)) break;
+		sent += cur;
+	}
+	return sent;
+}
+
+uint32_t fastnet_tcp_snd_mss(fastnet_tcp_pcb_t* pcb){
+	socket_key_t* key;
+	uint32_t mss,max;
+	
+	key = &(((fastnet_sockstruct_t*)pcb)->key);
+	
+	/* The template's Ethernet header names the output interface, if known. */
+	if(key->layer3_version==0x66){
+		mss = pcb->snd_mss ? pcb->snd_mss : FASTNET_TCP_DEFAULT_MSS6;
+		max = fastnet_pmtu6(pcb->tcpiphdr.eth_nif,&(key->v6.src_ip)) - sizeof(fnet_ip6_header_t) - sizeof(fnet_tcp_header_t);
+	}else{
+		mss = pcb->snd_mss ? pcb->snd_mss : FASTNET_TCP_DEFAULT_MSS4;
+		max = fastnet_pmtu4(pcb->tcpiphdr.eth_nif,key->v4.src_ip) - sizeof(fnet_ip_header_t) - sizeof(fnet_tcp_header_t);
+	}
+	return mss<max ? mss : max;
+}
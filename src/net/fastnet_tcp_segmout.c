@@ -19,12 +19,24 @@
 #include <net/header/tcphdr.h>
 #include <net/header/iphdr.h>
 #include <net/header/ip6hdr.h>
+#include <net/header/ip6defs.h>
 #include <net/socket_tcp.h>
 #include <net/header/layer4.h>
 #include <net/ip_next_hop.h>
 #include <net/ip6_next_hop.h>
 #include <net/checksum.h>
 #include <net/packet_output.h>
+#include <net/safe_packet.h>
+#include <net/requirement.h>
+#include <net/pkt_alloc.h>
+#include <net/header/ethhdr.h>
+#include <net/mac_addr_ldst.h>
+#include <net/stats.h>
+#include <net/icmp_limit.h>
+#include <net/ipv4.h>
+#include <net/ipv4_mac_cache.h>
+#include <net/nd6_cache.h>
+#include <string.h>
 
 enum {
 	/*
@@ -39,15 +51,19 @@ static uint16_t wnd_to_16(uint32_t wnd){
 	return 0xFFFF;
 }
 
-netpp_retcode_t fastnet_tcp_output_flags_wnd(odp_packet_t pkt,socket_key_t *key,uint32_t seq,uint32_t ack,uint32_t wnd,uint16_t flags){
+/*
+ * Sends a segment without payload. If 'mss' is not 0, the MSS option is added.
+ */
+static
+netpp_retcode_t output_segment(odp_packet_t pkt,socket_key_t *key,uint32_t seq,uint32_t ack,uint32_t wnd,uint16_t flags,uint16_t mss){
 	netpp_retcode_t   ret;
-	odp_pool_t        pool;
 	fnet_tcp_header_t header;
 	union{
 	fnet_ip6_header_t ip6;
 	fnet_ip_header_t  ip;
 	} ihdr;
-	uint32_t          ihdrlen, full_len, cur_len;
+	uint8_t           opt[FNET_TCP_OPT_MSS_LEN];
+	uint32_t          ihdrlen, thdrlen, full_len, cur_len;
 	int               is_alloc;
 	
 	if(key->layer3_version==0x66){
@@ -57,16 +73,14 @@ netpp_retcode_t fastnet_tcp_output_flags_wnd(odp_packet_t pkt,socket_key_t *key,
 		/* IPv4 */
 		ihdrlen = sizeof(fnet_ip_header_t);
 	}
+	thdrlen = sizeof(fnet_tcp_header_t) + (mss ? sizeof(opt) : 0);
 	
-	full_len = ETHERNET_HEADER_LEN + sizeof(fnet_tcp_header_t) + ihdrlen;
+	full_len = ETHERNET_HEADER_LEN + thdrlen + ihdrlen;
 	
 	is_alloc = pkt==ODP_PACKET_INVALID;
 	
 	if(is_alloc){
-		pool = odp_pool_lookup("fn_pktout");
-		if(odp_unlikely(pool == ODP_POOL_INVALID)) return NETPP_DROP;
-		
-		pkt  = odp_packet_alloc(pool,full_len );
+		pkt  = fastnet_pktout_alloc(full_len);
 		if(odp_unlikely(pkt == ODP_PACKET_INVALID)) return NETPP_DROP;
 	}else{
 		cur_len = odp_packet_len(pkt);
@@ -82,7 +96,7 @@ netpp_retcode_t fastnet_tcp_output_flags_wnd(odp_packet_t pkt,socket_key_t *key,
 	header.destination_port = key->src_port;
 	header.sequence_number = odp_cpu_to_be_32(seq);
 	header.ack_number = odp_cpu_to_be_32(ack);
-	header.hdrlength__flags = odp_cpu_to_be_16(0x5000|flags);
+	header.hdrlength__flags = odp_cpu_to_be_16((thdrlen<<10)|flags);
 	header.window = odp_cpu_to_be_16(wnd_to_16(wnd));
 	header.checksum = 0;
 	header.urgent_ptr = 0;
@@ -90,76 +104,208 @@ netpp_retcode_t fastnet_tcp_output_flags_wnd(odp_packet_t pkt,socket_key_t *key,
 	odp_packet_l4_offset_set(pkt,ETHERNET_HEADER_LEN+ihdrlen);
 	odp_packet_copy_from_mem(pkt,ETHERNET_HEADER_LEN+ihdrlen,sizeof(header),&header);
 	
-	
+	if(mss){
+		opt[0] = FNET_TCP_OPT_MSS;
+		opt[1] = FNET_TCP_OPT_MSS_LEN;
+		opt[2] = mss>>8;
+		opt[3] = mss;
+		odp_packet_copy_from_mem(pkt,ETHERNET_HEADER_LEN+ihdrlen+sizeof(header),sizeof(opt),opt);
+	}
 	
 	if(key->layer3_version==0x66){
 		/* IPv6 */
 		ihdr.ip6.version_tclass_flowl  = odp_cpu_to_be_32(0x60000000); // tclass = 0
-		ihdr.ip6.length                = odp_cpu_to_be_16(sizeof(header));
+		ihdr.ip6.length                = odp_cpu_to_be_16(thdrlen);
 		ihdr.ip6.next_header           = IP_PROTOCOL_TCP;
 		ihdr.ip6.hop_limit             = 64;
-		ihdr.ip6.source_addr           = key->dst_ip;
-		ihdr.ip6.destination_addr      = key->src_ip;
+		ihdr.ip6.source_addr           = key->v6.dst_ip;
+		ihdr.ip6.destination_addr      = key->v6.src_ip;
 		odp_packet_copy_from_mem(pkt,ETHERNET_HEADER_LEN,sizeof(ihdr.ip6),&ihdr.ip6);
+		header.checksum = fastnet_ip6_checksum(pkt,key->v6.dst_ip,key->v6.src_ip,IP_PROTOCOL_TCP,odp_packet_user_ptr(pkt),NIFOFL_TCP_CKSUM);
+		odp_packet_copy_from_mem(pkt,ETHERNET_HEADER_LEN+ihdrlen+TCP_HDR_CHECKSUM_OFFSET,2,&header.checksum);
 		ret = fastnet_ip6_output(pkt,NULL);
 	}else{
 		/* IPv4 */
 		ihdr.ip.version__header_length = 0x45;
 		ihdr.ip.tos                    = FNET_IP_TOS_NORMAL;
-		ihdr.ip.total_length           = odp_cpu_to_be_16(sizeof(header)+sizeof(fnet_ip_header_t));
+		ihdr.ip.total_length           = odp_cpu_to_be_16(thdrlen+sizeof(fnet_ip_header_t));
 		ihdr.ip.id                     = 0;
 		ihdr.ip.flags_fragment_offset  = 0;
 		ihdr.ip.ttl                    = 64;
 		ihdr.ip.protocol               = IP_PROTOCOL_TCP;
 		ihdr.ip.checksum               = 0;
-		ihdr.ip.source_addr            = key->dst_ip.addr32[4];
-		ihdr.ip.destination_addr       = key->src_ip.addr32[4];
+		ihdr.ip.source_addr            = key->v4.dst_ip;
+		ihdr.ip.destination_addr       = key->v4.src_ip;
 		odp_packet_copy_from_mem(pkt,ETHERNET_HEADER_LEN,sizeof(ihdr.ip),&ihdr.ip);
+		header.checksum = fastnet_ip4_checksum(pkt,key->v4.dst_ip,key->v4.src_ip,IP_PROTOCOL_TCP,odp_packet_user_ptr(pkt),NIFOFL_TCP_CKSUM);
+		odp_packet_copy_from_mem(pkt,ETHERNET_HEADER_LEN+ihdrlen+TCP_HDR_CHECKSUM_OFFSET,2,&header.checksum);
 		ret = fastnet_ip_output(pkt,NULL);
 	}
 	
+	FASTNET_STAT_INC(tcp_out_segs);
+	if(flags&FNET_TCP_SGT_RST) FASTNET_STAT_INC(tcp_out_rsts);
 	if(is_alloc && (ret!=NETPP_CONSUMED))
-		odp_packet_free(pkt);
+		fastnet_pktout_free(pkt);
 	
 	return ret;
 }
 
+netpp_retcode_t fastnet_tcp_output_flags_wnd(odp_packet_t pkt,socket_key_t *key,uint32_t seq,uint32_t ack,uint32_t wnd,uint16_t flags){
+	return output_segment(pkt,key,seq,ack,wnd,flags,0);
+}
+
+netpp_retcode_t fastnet_tcp_output_synack(odp_packet_t pkt,socket_key_t *key,uint32_t seq,uint32_t ack,uint32_t wnd,uint16_t mss){
+	return output_segment(pkt,key,seq,ack,wnd,FNET_TCP_SGT_SYN|FNET_TCP_SGT_ACK,mss);
+}
+
 netpp_retcode_t fastnet_tcp_output_flags(odp_packet_t pkt,socket_key_t *key,uint32_t seq,uint32_t ack,uint16_t flags){
 	return fastnet_tcp_output_flags_wnd(pkt,key,seq,ack,0,flags);
 }
 
+netpp_retcode_t fastnet_tcp_output_reset(odp_packet_t pkt,socket_key_t *key){
+	fnet_tcp_header_t* th;
+	nif_t*   nif;
+	uint32_t seq,len,hdrlen;
+	uint16_t flags;
+	
+	th = fastnet_safe_l4(pkt,sizeof(fnet_tcp_header_t));
+	if(odp_unlikely(th==NULL)) return NETPP_DROP;
+	flags = odp_be_to_cpu_16(th->hdrlength__flags);
+	
+	/* A reset is never answered with a reset. */
+	if(flags&FNET_TCP_SGT_RST) return NETPP_DROP;
+	
+	/* Segments from or to a broadcast or multicast address are not answered either. */
+	if(key->layer3_version==0x66){
+		if(odp_unlikely(IP6_ADDR_IS_MULTICAST(key->v6.src_ip) || IP6_ADDR_IS_MULTICAST(key->v6.dst_ip))) return NETPP_DROP;
+	}else{
+		nif = odp_packet_user_ptr(pkt);
+		if(odp_unlikely(
+			IP4_ADDR_IS_MULTICAST(key->v4.src_ip) || IP4_ADDR_IS_MULTICAST(key->v4.dst_ip) ||
+			fastnet_ip_broadcast(nif ? nif->ipv4 : NULL,key->v4.src_ip) ||
+			fastnet_ip_broadcast(nif ? nif->ipv4 : NULL,key->v4.dst_ip)
+		)) return NETPP_DROP;
+	}
+	
+	if(odp_unlikely(!fastnet_icmp_allow(FASTNET_ICMPL_TCP_RST))){
+		FASTNET_STAT_INC(tcp_rst_ratelimited);
+		return NETPP_DROP;
+	}
+	
+	/*
+	 * If the incoming segment has an ACK field, the reset takes its sequence number from the
+	 * ACK field of the segment, otherwise the reset has sequence number zero and the ACK field
+	 * is set to the sum of the sequence number and segment length of the incoming segment.
+	 *
+	 * <SEQ=SEG.ACK><CTL=RST>   or   <SEQ=0><ACK=SEG.SEQ+SEG.LEN><CTL=RST,ACK>
+	 */
+	if(flags&FNET_TCP_SGT_ACK)
+		return fastnet_tcp_output_flags(pkt,key,odp_be_to_cpu_32(th->ack_number),0,FNET_TCP_SGT_RST);
+	
+	hdrlen = (flags>>10)&0x3c;
+	len = odp_packet_len(pkt)-odp_packet_l4_offset(pkt);
+	if(odp_unlikely(hdrlen<sizeof(fnet_tcp_header_t) || hdrlen>len)) return NETPP_DROP;
+	len -= hdrlen;
+	if(flags&FNET_TCP_SGT_SYN) len++;
+	if(flags&FNET_TCP_SGT_FIN) len++;
+	seq = odp_be_to_cpu_32(th->sequence_number);
+	
+	return fastnet_tcp_output_flags(pkt,key,0,seq+len,FNET_TCP_SGT_RST|FNET_TCP_SGT_ACK);
+}
+
+/*
+ * Computes the TCP checksum of an outgoing segment of 'length' bytes (header + payload).
+ *
+ * The payload's partial sum is taken from the packet's user area, if present, so only the
+ * header and the pseudo header are summed here. Otherwise it is computed and cached, so that
+ * a retransmission of the same payload can reuse it.
+ */
+static uint16_t tcp_checksum(odp_packet_t pkt,socket_key_t* key,nif_t* nif,uint16_t length){
+	fastnet_pkt_uarea_t* ua;
+	fnet_tcp_header_t* th;
+	uint32_t hdrlen;
+	uint64_t sum;
+	
+	if(nif && (nif->offload_flags & NIFOFL_TCP_CKSUM)) return 0;
+	
+	th = fastnet_safe_l4(pkt,sizeof(fnet_tcp_header_t));
+	if(odp_unlikely(th==NULL)) goto fullsum;
+	
+	hdrlen = (odp_be_to_cpu_16(th->hdrlength__flags)>>10)&0x3c;
+	if(odp_unlikely(hdrlen<sizeof(fnet_tcp_header_t) || hdrlen>length)) goto fullsum;
+	
+	/* The options are contiguous as well? */
+	if(hdrlen>sizeof(fnet_tcp_header_t)){
+		th = fastnet_safe_l4(pkt,hdrlen);
+		if(odp_unlikely(th==NULL)) goto fullsum;
+	}
+	
+	/* The cached sum covers the tail of the packet, so the segment must end with the packet. */
+	if(odp_unlikely((odp_packet_l4_offset(pkt)+length)!=odp_packet_len(pkt))) goto fullsum;
+	
+	ua = FASTNET_PACKET_UAREA(pkt);
+	if(!(ua->flags & FASTNET_PKTF_PSUM) || (ua->psum_len+hdrlen)!=length)
+		fastnet_pkt_psum_compute(pkt,odp_packet_l4_offset(pkt)+hdrlen);
+	
+	th->checksum = 0;
+	if(key->layer3_version==0x66)
+		sum = fastnet_ip6_ph(key->v6.src_ip,key->v6.dst_ip,IP_PROTOCOL_TCP);
+	else
+		sum = fastnet_ip_ph(key->v4.src_ip,key->v4.dst_ip,IP_PROTOCOL_TCP);
+	sum += odp_cpu_to_be_16(length);
+	sum += ua->psum;
+	sum  = fastnet_cksum_sum(th,hdrlen,sum);
+	return ~fastnet_cksum_fold(sum);
+	
+fullsum:
+	if(key->layer3_version==0x66)
+		return fastnet_ip6_checksum(pkt,key->v6.src_ip,key->v6.dst_ip,IP_PROTOCOL_TCP,nif,NIFOFL_TCP_CKSUM);
+	return fastnet_ip4_checksum(pkt,key->v4.src_ip,key->v4.dst_ip,IP_PROTOCOL_TCP,nif,NIFOFL_TCP_CKSUM);
+}
+
 netpp_retcode_t fastnet_tcp_sendout_ll(odp_packet_t pkt,fastnet_tcp_pcb_t* pcb,nif_t* nif,uint16_t length) {
 	socket_key_t* key;
+	fnet_ip_header_t* ip;
 	uint16_t field16;
+	int is_ipv4;
 	
 	key = &(((fastnet_sockstruct_t*)pcb)->key);
+	is_ipv4 = key->layer3_version!=0x66;
 	
 	/*
 	 * Update the IPv[46] length field.
 	 */
-	if(odp_packet_has_ipv4(pcb->tcpiphdr.buf)){
+	if(is_ipv4){
+		/*
+		 * The header has been copied from the template with a valid checksum, so it is updated incrementally.
+		 */
+		ip = fastnet_safe_l3(pkt,sizeof(fnet_ip_header_t));
+		if(odp_unlikely(ip==NULL)) return NETPP_DROP;
 		field16 = odp_cpu_to_be_16(length+sizeof(fnet_ip_header_t));
-		odp_packet_copy_from_mem(pkt,odp_packet_l3_offset(pkt)+IPV4_HDR_LENGTH_OFFSET,2,&field16);
-		
-		field16 = fastnet_ip4_checksum(pkt,key->src_ip.addr32[3],key->dst_ip.addr32[3],IP_PROTOCOL_TCP);
+		ip->checksum = fastnet_cksum_update16(ip->checksum,ip->total_length,field16);
+		ip->total_length = field16;
 	}else{
 		field16 = odp_cpu_to_be_16(length);
 		odp_packet_copy_from_mem(pkt,odp_packet_l3_offset(pkt)+IPV6_HDR_LENGTH_OFFSET,2,&field16);
-		field16 = fastnet_ip6_checksum(pkt,key->src_ip,key->dst_ip,IP_PROTOCOL_TCP);
 	}
 	
+	field16 = tcp_checksum(pkt,key,nif,length);
+	FASTNET_STAT_INC(tcp_out_segs);
+	
 	odp_packet_copy_from_mem(pkt,odp_packet_l4_offset(pkt)+TCP_HDR_CHECKSUM_OFFSET,2,&field16);
 	
 	if(nif){
-		if(odp_packet_has_ipv4(pcb->tcpiphdr.buf)){
-			field16 = fastnet_ipv4_hdr_checksum(pkt);
-			
-			odp_packet_copy_from_mem(pkt,odp_packet_l3_offset(pkt)+IPV4_HDR_CHECKSUM_OFFSET,2,&field16);
+		/* The IP output is bypassed. */
+		fastnet_pkt_set_l3l4(pkt,!is_ipv4,IP_PROTOCOL_TCP);
+		
+		/* If the NIC inserts the IPv4 header checksum, it must be 0. */
+		if(is_ipv4 && (nif->offload_flags & NIFOFL_IP4_CKSUM)){
+			ip->checksum = 0;
 		}
 		/* XXX whats about loopback? */
 		return fastnet_pkt_output(pkt,nif);
 	}else{
-		if(odp_packet_has_ipv4(pcb->tcpiphdr.buf)){
+		if(is_ipv4){
 			return fastnet_ip_output(pkt,NULL);
 		}else{
 			return fastnet_ip6_output(pkt,NULL);
@@ -167,54 +313,115 @@ netpp_retcode_t fastnet_tcp_sendout_ll(odp_packet_t pkt,fastnet_tcp_pcb_t* pcb,n
 	}
 }
 
-static int tmo_exceed(odp_time_t diff,uint32_t tmo_ms){
-	register uint32_t tmo = tmo_ms/1000;
-	if(tmo<diff.tv_sec) return 1;
-	if(tmo>diff.tv_sec) return 0;
-	return (tmo_ms%1000)<(diff.tv_nsec/1000000);
+/*
+ * Looks up the link-layer address of the peer, and adds the Ethernet header to the template.
+ * Only on-link peers with a resolved address are looked up; otherwise the segments take the
+ * IP output, which resolves the address.
+ */
+static
+void resolve_eth(fastnet_tcp_pcb_t* pcb){
+	socket_key_t* key = &(((fastnet_sockstruct_t*)pcb)->key);
+	nif_t* nif = pcb->tcpiphdr.eth_nif;
+	nd6_nce_handle_t neighbor;
+	nd6_nce_t* neighptr;
+	uint64_t dst;
+	uint32_t gen;
+	int sendarp,valid;
+	
+	/* Read before the lookup: If the caches change meanwhile, the header is never used. */
+	gen = fastnet_neigh_gen();
+	
+	if(key->layer3_version==0x66){
+		neighbor = fastnet_nd6_nce_find_only_valid(nif,key->v6.src_ip);
+		if(neighbor==ODP_BUFFER_INVALID) return;
+		neighptr = odp_buffer_addr(neighbor);
+		fastnet_nd6_nce_lock(neighbor);
+		valid = neighptr->state!=ND6_NC__PHANTOM_ && neighptr->state!=ND6_NC_INCOMPLETE;
+		dst = neighptr->hwaddr;
+		fastnet_nd6_nce_unlock(neighbor);
+		fastnet_nd6_nce_put(neighbor);
+		if(!valid) return;
+	}else{
+		/* Loopback and off-link peers are left to fastnet_ip_output(). */
+		if(nif->ipv4==NULL || nif->ipv4->address==key->v4.src_ip) return;
+		if(!fastnet_ip_onlink(nif->ipv4,key->v4.src_ip)) return;
+		if(fastnet_ipv4_mac_lookup(nif,key->v4.src_ip,&dst,&sendarp,ODP_PACKET_INVALID)!=NETPP_CONTINUE) return;
+	}
+	fastnet_tcp_segmout_set_eth(pcb,nif,nif->hwaddr,dst,gen);
 }
 
-int fastnet_tcp_add_header(odp_packet_t pkt,fastnet_tcp_pcb_t* __restrict__ pcb,odp_time_t now,nif_t** nifp){
+int fastnet_tcp_add_header(odp_packet_t pkt,fastnet_tcp_pcb_t* __restrict__ pcb,nif_t** nifp){
 	nif_t* nif = NULL;
-	uint32_t begin,end,l3p,timeout;
-	odp_time_t tmdiff;
+	uint32_t len,l3len,skip;
+	uint8_t* p;
 	
-	timeout = pcb->tcpiphdr.eth_lifetime;
-	if(timeout && tmo_exceed(odp_time_diff(now,pcb->tcpiphdr.eth_tstamp),timeout)) timeout = 0;
+	l3len = pcb->tcpiphdr.l3len;
+	if(odp_unlikely(!l3len)) return 1;
+	len = l3len+sizeof(fnet_tcp_header_t);
 	
-	if(timeout){
-		nif = pcb->tcpiphdr.eth_nif;
-	} /* TODO query. */
+	if(odp_likely(pcb->tcpiphdr.eth_nif!=NULL)){
+		/* Without an Ethernet header, fastnet_ip_output() needs the interface. */
+		odp_packet_user_ptr_set(pkt,pcb->tcpiphdr.eth_nif);
+		
+		/* None yet, or the neighbor caches changed. */
+		if(odp_unlikely(!pcb->tcpiphdr.l2len || pcb->tcpiphdr.eth_gen!=fastnet_neigh_gen()))
+			resolve_eth(pcb);
+	}
 	
-	end = odp_packet_l4_offset(pcb->tcpiphdr.buf)+sizeof(fnet_tcp_header_t);
-	l3p = odp_packet_l3_offset(pcb->tcpiphdr.buf);
-	if(nif) begin = odp_packet_l2_offset(pcb->tcpiphdr.buf);
-	else    begin = l3p;
+	/* The Ethernet header is valid, as long as the neighbor caches did not change. */
+	if(pcb->tcpiphdr.l2len && pcb->tcpiphdr.eth_gen==fastnet_neigh_gen()){
+		nif = pcb->tcpiphdr.eth_nif;
+		len += pcb->tcpiphdr.l2len;
+	}
 	
-	end -= begin;
-	l3p -= begin;
+	p = odp_packet_push_head(pkt,len);
+	if(odp_unlikely(!p)) return 1;
 	
-	if(odp_unlikely(!odp_packet_push_head(pkt,end))) return 1;
+	/*
+	 * The template is right-aligned, so copying all of it ends at the end of the TCP header.
+	 * The bytes in front of the header land in the headroom. This is a fixed-size copy.
+	 */
+	skip = FASTNET_TCP_TMPL_SZ-len;
+	if(odp_likely(odp_packet_headroom(pkt)>=skip))
+		memcpy(p-skip,pcb->tcpiphdr.data,FASTNET_TCP_TMPL_SZ);
+	else
+		memcpy(p,pcb->tcpiphdr.data+skip,len);
 	
-	odp_packet_copy_from_pkt(pkt,0, pcb->tcpiphdr.buf, begin, end);
-	odp_packet_l4_offset_set(pkt,end-sizeof(fnet_tcp_header_t));
-	odp_packet_l3_offset_set(pkt,l3p);
+	odp_packet_l4_offset_set(pkt,len-sizeof(fnet_tcp_header_t));
+	odp_packet_l3_offset_set(pkt,len-sizeof(fnet_tcp_header_t)-l3len);
 	odp_packet_l2_offset_set(pkt,0);
 	*nifp = nif;
 	return 0;
 }
 
+void fastnet_tcp_segmout_set_eth(fastnet_tcp_pcb_t* pcb,nif_t* nif,uint64_t src,uint64_t dst,uint32_t gen){
+	fnet_eth_header_t* eth;
+	uint32_t l3off;
+	
+	if(odp_unlikely(!pcb->tcpiphdr.l3len)) return;
+	l3off = FASTNET_TCP_TMPL_SZ-sizeof(fnet_tcp_header_t)-pcb->tcpiphdr.l3len;
+	eth = (fnet_eth_header_t*)(pcb->tcpiphdr.data+l3off-sizeof(fnet_eth_header_t));
+	
+	fastnet_int_to_mac(eth->destination_addr,dst);
+	fastnet_int_to_mac(eth->source_addr,src);
+	eth->type = odp_cpu_to_be_16(pcb->tcpiphdr.l3len==sizeof(fnet_ip_header_t) ? NETPROT_L3_IPV4 : NETPROT_L3_IPV6);
+	
+	pcb->tcpiphdr.eth_nif = nif;
+	pcb->tcpiphdr.eth_gen = gen;
+	pcb->tcpiphdr.l2len   = sizeof(fnet_eth_header_t);
+}
+
 
 /*
- * This function constructs a TCP/IP header in a given buffer (type is odp_packet_t).
- * odp_packet_l4_offset() must be set.
+ * This function constructs the TCP/IP header template of the PCB.
  */
-void fastnet_tcp_segmout_create_header_buf(odp_packet_t pkt,socket_key_t *key){
+void fastnet_tcp_segmout_create_header(fastnet_tcp_pcb_t* pcb,socket_key_t *key,nif_t* nif){
 	fnet_tcp_header_t header;
 	union{
 	fnet_ip6_header_t ip6;
 	fnet_ip_header_t  ip;
 	} ihdr;
+	uint8_t* l4p = pcb->tcpiphdr.data+FASTNET_TCP_TMPL_SZ-sizeof(header);
 	
 	
 	if(key->layer3_version==0x66){
@@ -227,19 +434,17 @@ void fastnet_tcp_segmout_create_header_buf(odp_packet_t pkt,socket_key_t *key){
 		/*
 		 * Source and Destination addresses/ports must be swapped.
 		 */
-		ihdr.ip6.source_addr           = key->dst_ip;
-		ihdr.ip6.destination_addr      = key->src_ip;
-		odp_packet_l3_offset_set(pkt,odp_packet_l4_offset(pkt)-sizeof(ihdr.ip6));
-		odp_packet_copy_from_mem(pkt,odp_packet_l3_offset(pkt),sizeof(ihdr.ip6),&ihdr.ip6);
-		odp_packet_has_ipv4_set(pkt,0);
-		odp_packet_has_ipv6_set(pkt,1);
+		ihdr.ip6.source_addr           = key->v6.dst_ip;
+		ihdr.ip6.destination_addr      = key->v6.src_ip;
+		memcpy(l4p-sizeof(ihdr.ip6),&ihdr.ip6,sizeof(ihdr.ip6));
+		pcb->tcpiphdr.l3len = sizeof(ihdr.ip6);
 	}else{
 		/* IPv4 */
 		ihdr.ip.version__header_length = 0x45;
 		ihdr.ip.tos                    = FNET_IP_TOS_NORMAL;
 		ihdr.ip.total_length           = odp_cpu_to_be_16(sizeof(header)+sizeof(fnet_ip_header_t));
 		ihdr.ip.id                     = 0;
-		ihdr.ip.flags_fragment_offset  = 0;
+		ihdr.ip.flags_fragment_offset  = odp_cpu_to_be_16(FNET_IP_DF); /* Path MTU Discovery (RFC 1191). */
 		ihdr.ip.ttl                    = 64;
 		ihdr.ip.protocol               = IP_PROTOCOL_TCP;
 		ihdr.ip.checksum               = 0;
@@ -247,12 +452,15 @@ void fastnet_tcp_segmout_create_header_buf(odp_packet_t pkt,socket_key_t *key){
 		/*
 		 * Source and Destination addresses/ports must be swapped.
 		 */
-		ihdr.ip.source_addr            = key->dst_ip.addr32[4];
-		ihdr.ip.destination_addr       = key->src_ip.addr32[4];
-		odp_packet_l3_offset_set(pkt,odp_packet_l4_offset(pkt)-sizeof(ihdr.ip));
-		odp_packet_copy_from_mem(pkt,odp_packet_l3_offset(pkt),sizeof(ihdr.ip),&ihdr.ip);
-		odp_packet_has_ipv4_set(pkt,1);
-		odp_packet_has_ipv6_set(pkt,0);
+		ihdr.ip.source_addr            = key->v4.dst_ip;
+		ihdr.ip.destination_addr       = key->v4.src_ip;
+		
+		/*
+		 * The checksum is precomputed, and updated incrementally, when the length is patched.
+		 */
+		ihdr.ip.checksum               = ~fastnet_cksum_fold(fastnet_cksum_sum(&ihdr.ip,sizeof(ihdr.ip),0));
+		memcpy(l4p-sizeof(ihdr.ip),&ihdr.ip,sizeof(ihdr.ip));
+		pcb->tcpiphdr.l3len = sizeof(ihdr.ip);
 	}
 	
 	/*
@@ -266,7 +474,10 @@ void fastnet_tcp_segmout_create_header_buf(odp_packet_t pkt,socket_key_t *key){
 	header.window           = 0;
 	header.checksum         = 0;
 	header.urgent_ptr       = 0;
-	odp_packet_copy_from_mem(pkt,odp_packet_l4_offset(pkt),sizeof(header),&header);
+	memcpy(l4p,&header,sizeof(header));
+	
+	/* No Ethernet header yet, it is added by the first fastnet_tcp_add_header(). */
+	pcb->tcpiphdr.l2len   = 0;
+	pcb->tcpiphdr.eth_nif = nif;
 }
 
-
@@ -13,78 +13,53 @@
  *   See the License for the specific language governing permissions and
  *   limitations under the License.
  */
+#include <stddef.h>
 #include <net/socket_tcp.h>
 #include <net/std_lib.h>
+#include <net/slab.h>
+#include <net/conf.h>
 
-static odp_pool_t objects;
-static odp_pool_t hdrbufs;
+/*
+ * PCB layout: The socket header, then the hot part, then the cold part, which starts on a
+ * cache line of its own (ODP_ALIGNED_CACHE). The socket key must fit into the first cache
+ * line, and the header and the hot part into the first two, so the input path touches
+ * two cache lines of the PCB at most.
+ */
+#define PCB_HOT_END   (offsetof(fastnet_tcp_pcb_t,irs)+sizeof(uint32_t))
 
-enum {
-	/*
-	 * Ethernet header (14 bytes),
-	 * VLAN tag(4 bytes),
-	 * IPv6 header (40 bytes),
-	 * TCP header(20 bytes)
-	 */
-	MAX_TCP_IP_ETH_HDR = 14 + 4 + 40 + 20,
-	MAX_IP_ETH_HDR = 14 + 4 + 40,
-};
+_Static_assert(offsetof(fastnet_tcp_pcb_t,_head)==0,"the socket header must be first");
+_Static_assert((offsetof(fastnet_sockstruct_t,key)+sizeof(socket_key_t))<=ODP_CACHE_LINE_SIZE,"socket key exceeds the first cache line");
+_Static_assert(PCB_HOT_END<=2*ODP_CACHE_LINE_SIZE,"socket header and hot part exceed two cache lines");
+
+static fastnet_slab_t objects;
 
 void fastnet_tcp_initpool(){
 	odp_pool_param_t epool;
 	odp_pool_param_init(&epool);
 	epool.type = ODP_POOL_BUFFER;
-	epool.buf.num   = 512*1024;
-	epool.buf.align = 8;
+	epool.buf.num   = fastnet_conf.tcp_pcbs;
+	epool.buf.align = ODP_CACHE_LINE_SIZE; /* See the PCB layout above. */
 	epool.buf.size  = sizeof(fastnet_tcp_pcb_t);
-	objects = odp_pool_create("tcp_pcb_pool",&epool);
-	if(objects==ODP_POOL_INVALID) fastnet_abort();
-	odp_pool_param_init(&epool);
-	epool.type = ODP_POOL_PACKET;
-	epool.pkt.num        = 512*1024;
-	epool.pkt.len        = MAX_TCP_IP_ETH_HDR;
-	epool.pkt.seg_len    = MAX_TCP_IP_ETH_HDR;
-	epool.pkt.uarea_size = 0;
-	hdrbufs = odp_pool_create("tcp_hdrbuf_pool",&epool);
-	if(hdrbufs==ODP_POOL_INVALID) fastnet_abort();
+	if(!fastnet_slab_init(&objects,"tcp_pcb_pool",&epool,fastnet_conf.slab_chunk,fastnet_conf.tcp_pcbs)) fastnet_abort();
 }
 
 fastnet_socket_t fastnet_tcp_allocate(){
 	fastnet_tcp_pcb_t* ptr;
-	fastnet_socket_t handle = odp_buffer_alloc(objects);	
+	fastnet_socket_t handle = fastnet_slab_buffer_alloc(&objects);
 	if(handle!=ODP_BUFFER_INVALID){
 		ptr = odp_buffer_addr(handle);
+		ptr->_head.slab = &objects;
 		odp_ticketlock_init(&(ptr->lock));
-		ptr->tcpiphdr.buf = ODP_PACKET_INVALID;
+		ptr->tcpiphdr.l3len = 0;
+		ptr->tcpiphdr.l2len = 0;
+		ptr->snd_mss = 0;
 	}
 	return handle;
 }
 
+/*
+ * The header template is part of the PCB, so this is the same as fastnet_tcp_allocate().
+ */
 fastnet_socket_t fastnet_tcp_allocate_with_hdr(){
-	fastnet_tcp_pcb_t* ptr;
-	fastnet_socket_t handle;
-	odp_packet_t hbuf;
-	
-	hbuf = odp_packet_alloc(hdrbufs,MAX_TCP_IP_ETH_HDR);
-	if(odp_unlikely(hbuf==ODP_PACKET_INVALID)) return ODP_BUFFER_INVALID;
-	
-	odp_packet_l2_offset_set(hbuf,MAX_IP_ETH_HDR);
-	odp_packet_l3_offset_set(hbuf,MAX_IP_ETH_HDR);
-	odp_packet_l4_offset_set(hbuf,MAX_IP_ETH_HDR);
-	
-	handle = odp_buffer_alloc(objects);	
-	if(handle!=ODP_BUFFER_INVALID){
-		ptr = odp_buffer_addr(handle);
-		odp_ticketlock_init(&(ptr->lock));
-		ptr->tcpiphdr.buf          = hbuf;
-		ptr->tcpiphdr.eth_lifetime = 0;
-	}
-	return handle;
+	return fastnet_tcp_allocate();
 }
-
-void fastnet_tcp_socket_finalize(fastnet_socket_t sock){
-	fastnet_tcp_pcb_t* ptr;
-	ptr = odp_buffer_addr(sock);
-	if(ptr->tcpiphdr.buf!=ODP_PACKET_INVALID) odp_packet_free(ptr->tcpiphdr.buf);
-}
-
@@ -23,6 +23,7 @@
 #include <net/header/layer4.h>
 #include <net/checksum.h>
 #include <net/net_tcp_seqnums.h>
+#include <net/stats.h>
 
 #define NOBODY { return NETPP_DROP; }
 
@@ -138,7 +139,10 @@ netpp_retcode_t fastnet_tcp_process(odp_packet_t pkt,socket_key_t *key,fastnet_s
 	 * first check sequence number
 	 */
 	ret = fastnet_tcp_seqcheck(&seg,pcb);
-	if(odp_unlikely(ret!=NETPP_CONTINUE)) return ret;
+	if(odp_unlikely(ret!=NETPP_CONTINUE)) {
+		FASTNET_STAT_INC(drop_tcp_seqcheck);
+		return ret;
+	}
 	
 	
 	
@@ -227,6 +231,22 @@ netpp_retcode_t fastnet_tcp_process(odp_packet_t pkt,socket_key_t *key,fastnet_s
 	 */
 	if(odp_likely( !!(seg.flags & FNET_TCP_SGT_ACK) ))
 	switch(pcb->state){
+	case SYN_RECEIVED:
+		/*
+		 * If SND.UNA =< SEG.ACK =< SND.NXT then enter ESTABLISHED state
+		 * and continue processing.
+		 *
+		 *   If the segment acknowledgment is not acceptable, form a
+		 *   reset segment,
+		 *
+		 *     <SEQ=SEG.ACK><CTL=RST>
+		 *
+		 *   and send it.
+		 */
+		if(odp_unlikely( TCPSEQ_IS_LOWER(seg.ack,pcb->snd.una) || TCPSEQ_IS_LOWER(pcb->snd.nxt,seg.ack) ))
+			return fastnet_tcp_output_flags(pkt,key,seg.ack,0,FNET_TCP_SGT_RST);
+		pcb->state = ESTABLISHED;
+		/* fall through */
 	case ESTABLISHED:
 	case FIN_WAIT_1:
 	case FIN_WAIT_2:
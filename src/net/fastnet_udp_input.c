@@ -19,12 +19,18 @@
 #include <net/header/udphdr.h>
 
 #include <net/in_tlp.h>
+#include <net/stats.h>
+#include <net/icmp_error.h>
 
 netpp_retcode_t fastnet_udp_input(odp_packet_t pkt){
 	fnet_udp_header_t *uh = odp_packet_l4_ptr(pkt,NULL);
 	
 	NET_LOG("UDP datagram: %d->%d\n",(int)odp_be_to_cpu_16(uh->source_port),(int)odp_be_to_cpu_16(uh->destination_port));
 	
+	/* There are no UDP sockets yet: Every port is closed. */
+	FASTNET_STAT_INC(udp_no_ports);
+	FASTNET_STAT_INC(drop_udp_no_socket);
+	fastnet_icmp_port_unreach(pkt);
 	return NETPP_DROP;
 }
 
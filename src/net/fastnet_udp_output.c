@@ -24,6 +24,7 @@
 //#include <net/in_tlp.h>
 #include <net/ip_next_hop.h>
 #include <net/checksum.h>
+#include <net/pmtu.h>
 
 typedef struct ODP_PACKED {
 	fnet_ip_header_t  ip;
@@ -46,7 +47,7 @@ netpp_retcode_t udp_set_head(odp_packet_t pkt, fastnet_ip_pair_t addrs, uint16_t
 	 */
 	
 	if(odp_unlikely(pktlen>0xffeb)){
-		NET_LOG("unable to send length > %d: pktlen = %d",0xffeb,(int)pktlen);
+		NET_LOG_WRN("unable to send length > %d: pktlen = %d",0xffeb,(int)pktlen);
 		return NETPP_DROP;
 	}
 	
@@ -85,7 +86,11 @@ netpp_retcode_t udp_set_head(odp_packet_t pkt, fastnet_ip_pair_t addrs, uint16_t
 		uh4->ip.tos                    = FNET_IP_TOS_NORMAL;
 		uh4->ip.total_length           = odp_cpu_to_be_16(pktlen+sizeof(fnet_ip_header_t));
 		uh4->ip.id                     = 0;
-		uh4->ip.flags_fragment_offset  = 0;
+		/*
+		 * Datagrams, that fit the path MTU, are sent with DF, so a smaller MTU on the path is
+		 * reported (RFC 1191), instead of silently fragmenting them.
+		 */
+		uh4->ip.flags_fragment_offset  = (!isbc && (pktlen+sizeof(fnet_ip_header_t))<=fastnet_pmtu4(odp_packet_user_ptr(pkt),addrs.ipv4.dst)) ? odp_cpu_to_be_16(FNET_IP_DF) : 0;
 		uh4->ip.ttl                    = isbc ? FNET_UDP_TTL_MULTICAST : FNET_UDP_TTL;
 		uh4->ip.protocol               = IP_PROTOCOL_UDP;
 		uh4->ip.checksum               = 0;
@@ -107,8 +112,12 @@ netpp_retcode_t fastnet_udp_output(odp_packet_t pkt, fastnet_ip_pair_t addrs, ui
 	if(odp_unlikely(ret!=NETPP_CONTINUE)) return ret;
 	
 	uh = odp_packet_l4_ptr(pkt,NULL);
-	uh->checksum = fastnet_checksum(pkt,odp_packet_l4_offset(pkt),pktlen,odp_packet_user_ptr(pkt),0);
-	/* XXX: checksum offload support is deferred. */
+	
+	/*
+	 * If the interface inserts the checksum, the field is left 0. Should the packet leave through an other
+	 * interface, fastnet_ip_output() will fix it up.
+	 */
+	uh->checksum = fastnet_checksum(pkt,odp_packet_l4_offset(pkt),pktlen,odp_packet_user_ptr(pkt),NIFOFL_UDP_CKSUM);
 	
 	if(isipv6){
 		/* TODO: IPv6 */
@@ -118,3 +127,8 @@ netpp_retcode_t fastnet_udp_output(odp_packet_t pkt, fastnet_ip_pair_t addrs, ui
 	}
 }
 
+uint32_t fastnet_udp_max_payload(nif_t* nif, fastnet_ip_pair_t addrs, odp_bool_t isipv6){
+	if(isipv6)
+		return fastnet_pmtu6(nif,&(addrs.ipv6->dst)) - sizeof(udpip6hdr_t);
+	return fastnet_pmtu4(nif,addrs.ipv4.dst) - sizeof(udpiphdr_t);
+}
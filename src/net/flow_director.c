@@ -0,0 +1,150 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <net/flow_director.h>
+#include <net/nethread.h>
+#include <net/std_lib.h>
+#include <net/stats.h>
+#include <net/prof.h>
+
+/* Must be power of 2 */
+#define RING_SZ         0x100
+#define RING_SZ_MOD(x)  ((x)&0xff)
+
+typedef struct {
+	odp_packet_t pkt;
+	netpp_cb_t   cb;
+} ring_slot_t;
+
+/*
+ * Single-Producer/Single-Consumer ring.
+ *
+ * 'head' is written by the producer only, 'tail' is written by the consumer only.
+ */
+typedef struct {
+	odp_atomic_u32_t head ODP_ALIGNED_CACHE;
+	odp_atomic_u32_t tail ODP_ALIGNED_CACHE;
+	ring_slot_t      slots[RING_SZ] ODP_ALIGNED_CACHE;
+} ring_t;
+
+static odp_shm_t rings_shm;
+static ring_t*   rings;
+static uint32_t  num_workers;
+static uint32_t  max_workers;
+
+/*
+ * The ring from worker 'src' to worker 'dst'.
+ *
+ * The rings are grouped by the consumer, so that a worker polls a contiguous memory area.
+ */
+#define RING(dst,src) (&rings[((dst)*num_workers)+(src)])
+
+void fastnet_flowdir_init(int workers) {
+	uint32_t i,n;
+	if(workers<1) workers = 1;
+	num_workers = workers;
+	max_workers = workers;
+	n = num_workers*num_workers;
+
+	rings_shm = odp_shm_reserve("flowdir_rings",sizeof(ring_t)*n,ODP_CACHE_LINE_SIZE,0);
+	if(rings_shm==ODP_SHM_INVALID) fastnet_abort();
+	rings = odp_shm_addr(rings_shm);
+	for(i=0;i<n;++i){
+		odp_atomic_init_u32(&(rings[i].head),0);
+		odp_atomic_init_u32(&(rings[i].tail),0);
+	}
+}
+
+void fastnet_flowdir_set_workers(int workers) {
+	uint32_t i,n;
+	if(workers<1) workers = 1;
+	if((uint32_t)workers>max_workers) workers = max_workers;
+	num_workers = workers;
+
+	/* The rings are re-indexed, they must be empty. */
+	n = num_workers*num_workers;
+	for(i=0;i<n;++i){
+		odp_atomic_init_u32(&(rings[i].head),0);
+		odp_atomic_init_u32(&(rings[i].tail),0);
+	}
+}
+
+int fastnet_flowdir_owner(uint32_t hash) {
+	/* Multiply-Shift: maps the hash uniformly onto [0,num_workers). */
+	return (int)( (((uint64_t)hash)*num_workers) >> 32 );
+}
+
+netpp_retcode_t fastnet_flowdir_steer(odp_packet_t pkt,uint32_t hash,netpp_cb_t cb) {
+	ring_t*  ring;
+	uint32_t head,tail;
+	int owner,self;
+
+	if(odp_likely(num_workers<2)) return NETPP_CONTINUE;
+
+	/* The rings are single-producer: Threads, that are not workers, have no ring of their own. */
+	if(odp_unlikely(fastnet_thread_slot()==FASTNET_NONWORKER_SLOT)) {
+		FASTNET_STAT_INC(drop_flowdir_nonworker);
+		return NETPP_DROP;
+	}
+
+	owner = fastnet_flowdir_owner(hash);
+	self  = fastnet_worker_id();
+	if(odp_likely(owner==self)) return NETPP_CONTINUE;
+
+	ring = RING(owner,self);
+	head = odp_atomic_load_u32(&(ring->head));
+	tail = odp_atomic_load_acq_u32(&(ring->tail));
+
+	/* The ring is full. */
+	if(odp_unlikely((head-tail)>=RING_SZ)) {
+		FASTNET_STAT_INC(drop_flowdir_full);
+		return NETPP_DROP;
+	}
+
+	ring->slots[RING_SZ_MOD(head)] = (ring_slot_t){ pkt, cb };
+	odp_atomic_store_rel_u32(&(ring->head),head+1);
+
+	return NETPP_CONSUMED;
+}
+
+int fastnet_flowdir_poll() {
+	ring_t*  ring;
+	ring_slot_t slot;
+	uint32_t head,tail,src;
+	netpp_retcode_t ret;
+	int count = 0;
+
+	if(odp_likely(num_workers<2)) return 0;
+
+	ring = RING(fastnet_worker_id(),0);
+	for(src=0;src<num_workers;++src,++ring){
+		tail = odp_atomic_load_u32(&(ring->tail));
+		head = odp_atomic_load_acq_u32(&(ring->head));
+		if(odp_likely(head==tail)) continue;
+
+		for(;tail!=head;++tail){
+			slot = ring->slots[RING_SZ_MOD(tail)];
+			FASTNET_PROF_BEGIN(FASTNET_PROF_FLOWDIR_INPUT);
+			ret = slot.cb(slot.pkt);
+			FASTNET_PROF_END();
+			if(odp_unlikely(ret!=NETPP_CONSUMED))
+				odp_packet_free(slot.pkt);
+			count++;
+		}
+		odp_atomic_store_rel_u32(&(ring->tail),tail);
+	}
+	return count;
+}
+
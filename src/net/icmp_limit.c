@@ -0,0 +1,80 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <net/icmp_limit.h>
+#include <net/conf.h>
+
+#define NS_PER_SEC 1000000000ULL
+
+fastnet_icmp_limit_block_t fastnet_icmp_limit_blocks[FASTNET_THREAD_SLOTS];
+
+/* Serializes the threads, that are not workers (a zeroed spinlock is unlocked). */
+static odp_spinlock_t nonworker_lock;
+
+static
+int take(fastnet_icmp_bucket_t* b,uint32_t rate,uint32_t burst){
+	uint64_t now,credit,cost;
+	
+	cost = NS_PER_SEC/rate;
+	
+	/*
+	 * Refill: The credit grows with the time, up to 'burst' messages. A bucket, that has never
+	 * been used, starts full.
+	 */
+	now = odp_time_to_ns(odp_time_local());
+	credit = b->credit + (now - b->last);
+	if(credit > cost*burst || now < b->last) credit = cost*burst;
+	b->last = now;
+	
+	if(credit < cost){
+		b->credit = credit;
+		return 0;
+	}
+	b->credit = credit - cost;
+	return 1;
+}
+
+int fastnet_icmp_allow(int cls){
+	fastnet_icmp_bucket_t* b;
+	uint32_t rate,burst;
+	int slot,ret;
+	
+	switch(cls){
+	case FASTNET_ICMPL_ECHO:
+		rate  = fastnet_conf.icmp_echo_rate;
+		burst = fastnet_conf.icmp_echo_burst;
+		break;
+	case FASTNET_ICMPL_TCP_RST:
+		rate  = fastnet_conf.tcp_rst_rate;
+		burst = fastnet_conf.tcp_rst_burst;
+		break;
+	default:
+		rate  = fastnet_conf.icmp_err_rate;
+		burst = fastnet_conf.icmp_err_burst;
+		break;
+	}
+	
+	/* Not configured (fastnet_conf_finalize() has not been called). */
+	if(odp_unlikely(!rate)) return 1;
+	
+	slot = fastnet_thread_slot();
+	b = &fastnet_icmp_limit_blocks[slot].bucket[cls];
+	if(odp_likely(slot!=FASTNET_NONWORKER_SLOT)) return take(b,rate,burst);
+	
+	odp_spinlock_lock(&nonworker_lock);
+	ret = take(b,rate,burst);
+	odp_spinlock_unlock(&nonworker_lock);
+	return ret;
+}
@@ -19,9 +19,11 @@
 #include <net/packet_input.h>
 #include <net/header/layer4.h>
 #include <net/socket_tcp.h>
+#include <net/stats.h>
 
 static
 netpp_retcode_t def_protocol(odp_packet_t pkt){
+	FASTNET_STAT_INC(drop_no_protocol);
 	return NETPP_DROP;
 }
 
@@ -18,14 +18,20 @@
 #include <net/std_lib.h>
 #include <net/requirement.h>
 #include <net/variables.h>
+#include <net/slab.h>
+#include <net/conf.h>
+#include <net/stats.h>
+#include <net/lockprof.h>
 
 uint16_t fastnet_arp_cache_timeout;
 uint16_t fastnet_arp_cache_timeout_soft;
 
+odp_atomic_u32_t fastnet_neigh_generation;
+
 /* Must be power of 2 */
 
-#define HASHTAB_SZ           0x1000
-#define HASHTAB_SZ_MOD(x)    x&0xfff
+/* The number of buckets is configured at runtime (fastnet_conf.arp_buckets). */
+#define HASHTAB_SZ_MOD(x)    ((x)&hashtab_mask)
 
 #define HASHTAB_LOCKS        0x10
 #define HASHTAB_LOCKS_MOD(x) x&0xf
@@ -53,12 +59,13 @@ enum {
 };
 
 typedef struct {
-	odp_buffer_t   entries[HASHTAB_SZ];
 	odp_spinlock_t locks[HASHTAB_LOCKS];
+	odp_buffer_t   entries[];
 } i4m_ht_t;
 
-static odp_pool_t entries;
+static fastnet_slab_t entries;
 static odp_shm_t  hashtab;
+static uint32_t   hashtab_mask;
 
 static
 uint32_t ip_hash(nif_t* nif,ipv4_addr_t ipaddr){
@@ -118,6 +125,7 @@ static int ip_entry_overwrite(ipv4_mac_entry_t* entry,ipv4_mac_entry_t* key) {
 		key->flags |= FLAGS_HAS_CHAIN;
 		return 1;
 	}else{
+		if(entry->hwaddr != key->hwaddr) fastnet_neigh_gen_bump();
 		entry->hwaddr = key->hwaddr;
 		entry->flags  = key->flags;
 		entry->tstamp = key->tstamp;
@@ -126,21 +134,24 @@ static int ip_entry_overwrite(ipv4_mac_entry_t* entry,ipv4_mac_entry_t* key) {
 }
 
 void fastnet_initialize_ipmac_cache(){
-	int i;
+	uint32_t i,n;
 	odp_pool_param_t epool;
+	odp_pool_param_init(&epool);
 	epool.type = ODP_POOL_BUFFER;
-	epool.buf.num   = 512*1024;
+	epool.buf.num   = fastnet_conf.arp_entries;
 	epool.buf.size  = sizeof(ipv4_mac_entry_t);
 	epool.buf.align = 8;
-	entries = odp_pool_create("ipv4_mac_entries",&epool);
-	if(entries==ODP_POOL_INVALID) fastnet_abort();
-	hashtab = odp_shm_reserve("ipv4_mac_hashtab",sizeof(i4m_ht_t),8,0);
+	if(!fastnet_slab_init(&entries,"ipv4_mac_entries",&epool,fastnet_conf.slab_chunk,fastnet_conf.arp_entries)) fastnet_abort();
+	n = fastnet_conf.arp_buckets;
+	hashtab_mask = n-1;
+	hashtab = odp_shm_reserve("ipv4_mac_hashtab",sizeof(i4m_ht_t)+(n*sizeof(odp_buffer_t)),8,0);
 	if(hashtab==ODP_SHM_INVALID) fastnet_abort();
 	i4m_ht_t* h = odp_shm_addr(hashtab);
-	for(i=0;i<HASHTAB_SZ;++i)
+	for(i=0;i<n;++i)
 		h->entries[i] = ODP_BUFFER_INVALID;
 	for(i=0;i<HASHTAB_LOCKS;++i)
 		odp_spinlock_init(&(h->locks[i]));
+	odp_atomic_init_u32(&fastnet_neigh_generation,0);
 	fastnet_arp_cache_timeout = 128;
 	fastnet_arp_cache_timeout_soft = fastnet_arp_cache_timeout;
 	if(fastnet_arp_cache_timeout_soft>3) fastnet_arp_cache_timeout_soft-=3;
@@ -181,7 +192,7 @@ ipmac_lkup_or_insert(ipv4_mac_entry_t* key,odp_packet_t pkt,int create){
 	
 	alloc = ODP_BUFFER_INVALID;
 	
-	odp_spinlock_lock(&(h->locks[lock]));
+	FASTNET_SPIN_LOCK(FASTNET_LOCK_ARP_TABLE,&(h->locks[lock]));
 	bufaddr = &(h->entries[index]);
 	
 	ret = -1;
@@ -208,18 +219,22 @@ ipmac_lkup_or_insert(ipv4_mac_entry_t* key,odp_packet_t pkt,int create){
 		 * If we found an outdated entry, we deal with it.
 		 */
 		if(ip_entry_timeout(diff)){
-			if(alloc!=ODP_BUFFER_INVALID) odp_buffer_free(alloc);
+			if(alloc!=ODP_BUFFER_INVALID) fastnet_slab_buffer_free(&entries,alloc);
 			alloc = *bufaddr;
 			*bufaddr = entry->next;
 			free_chain(alloc);
+			fastnet_neigh_gen_bump();
 			continue;
 		}
 		bufaddr = &entry->next;
 	}
 	
 	if(odp_likely(create) && ret<0){
-		if(alloc==ODP_BUFFER_INVALID) alloc = odp_buffer_alloc(entries);
-		if(odp_unlikely(alloc==ODP_BUFFER_INVALID)) goto terminate;
+		if(alloc==ODP_BUFFER_INVALID) alloc = fastnet_slab_buffer_alloc(&entries);
+		if(odp_unlikely(alloc==ODP_BUFFER_INVALID)) {
+			FASTNET_STAT_INC(drop_arp_pool);
+			goto terminate;
+		}
 		entry = odp_buffer_addr(alloc);
 		*entry = *key;
 		entry->next = *bufaddr;
@@ -231,11 +246,11 @@ ipmac_lkup_or_insert(ipv4_mac_entry_t* key,odp_packet_t pkt,int create){
 		}else
 			ret = 1;
 	}else{
-		if(alloc!=ODP_BUFFER_INVALID) odp_buffer_free(alloc);
+		if(alloc!=ODP_BUFFER_INVALID) fastnet_slab_buffer_free(&entries,alloc);
 	}
 	
 terminate:
-	odp_spinlock_unlock(&(h->locks[lock]));
+	FASTNET_SPIN_UNLOCK(FASTNET_LOCK_ARP_TABLE,&(h->locks[lock]));
 	return ret;
 }
 
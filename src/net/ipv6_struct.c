@@ -15,6 +15,7 @@
  */
 #include <net/ipv6.h>
 #include <net/header/ip6defs.h>
+#include <net/pmtu.h>
 
 /*
  * RFC-4861 10. Protocol Constants.
@@ -48,12 +49,11 @@ void fastnet_ipv6_init(struct ipv6_nif_struct *ipv6){
 	odp_spinlock_init(&(ipv6->multicast_lock));
 	
 	ipv6->hop_limit = 64;
-	ipv6->mtu = IP6_DEFAULT_MTU;
-	ipv6->pmtu = IP6_DEFAULT_MTU;
+	ipv6->mtu = FASTNET_PMTU_DEFAULT6;
 	ipv6->base_reachable_time = 30000;
 	ipv6->reachable_time = 30000;
 	ipv6->retrans_timer = 1000;
 	ipv6->disabled = 0;
-	ipv6->pmtu_on = 0;
+	ipv6->pmtu_on = 1;
 }
 
@@ -15,6 +15,7 @@
  */
 #include <net/ipv6.h>
 #include <net/header/ip6defs.h>
+#include <net/lockprof.h>
 
 /*
  * Solicited-node Multicast Address prefix
@@ -87,7 +88,7 @@ int ipv6_addr_add(struct ipv6_nif_struct *ipv6, struct addr_creation_request* re
 	
 	freei = IPV6_NIF_ADDR_MAX;
 	
-	odp_spinlock_lock(&(ipv6->address_lock));
+	FASTNET_SPIN_LOCK(FASTNET_LOCK_IPV6_NIF,&(ipv6->address_lock));
 	
 	for(i=0;i<IPV6_NIF_ADDR_MAX;++i){
 		if( !ipv6->addrs[i].used ){
@@ -96,7 +97,7 @@ int ipv6_addr_add(struct ipv6_nif_struct *ipv6, struct addr_creation_request* re
 		}
 	}
 	if(freei == IPV6_NIF_ADDR_MAX){
-		odp_spinlock_unlock(&(ipv6->address_lock));
+		FASTNET_SPIN_UNLOCK(FASTNET_LOCK_IPV6_NIF,&(ipv6->address_lock));
 		return 0;
 	}
 	
@@ -111,7 +112,7 @@ int ipv6_addr_add(struct ipv6_nif_struct *ipv6, struct addr_creation_request* re
 	ipv6->addrs[i].state                    = req->state;
 	ipv6->addrs[i].used                     = 1;
 	
-	odp_spinlock_unlock(&(ipv6->address_lock));
+	FASTNET_SPIN_UNLOCK(FASTNET_LOCK_IPV6_NIF,&(ipv6->address_lock));
 	return 1;
 }
 
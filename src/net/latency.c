@@ -0,0 +1,201 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <net/latency.h>
+#include <net/header/iphdr.h>
+#include <net/header/ip6hdr.h>
+#include <net/header/tcphdr.h>
+#include <net/header/layer4.h>
+
+/*
+ * Samples above this are discarded: The packet has been held (waiting for the address
+ * resolution, or in the reassembly), so the number says nothing about the stack.
+ */
+#define LAT_MAX_NS 1000000000ULL
+
+fastnet_lat_block_t fastnet_lat_blocks[FASTNET_THREAD_SLOTS];
+
+static const char* series_names[FASTNET_LAT_NUM_SERIES] = {
+	"icmp",
+	"tcp_synack",
+	"tcp_rst",
+	"tcp",
+	"udp",
+	"other",
+	"rx_to_l3",
+	"l3_to_l4",
+	"l4_to_out",
+	"out_to_tx",
+};
+
+static inline
+uint64_t now_ns(){
+	return odp_time_to_ns(odp_time_global());
+}
+
+void fastnet_lat_start(odp_packet_t pkt){
+	fastnet_pkt_uarea_t* ua = FASTNET_PACKET_UAREA(pkt);
+	
+	/* The pktio's timestamp includes the time, the packet has been waiting in the queue. */
+	if(odp_packet_has_ts(pkt))
+		ua->lat_rx = odp_time_to_ns(odp_packet_ts(pkt));
+	else
+		ua->lat_rx = now_ns();
+	memset(ua->lat_stamp,0,sizeof(ua->lat_stamp));
+	ua->lat_class = FASTNET_LAT_OTHER;
+	ua->flags |= FASTNET_PKTF_LAT;
+}
+
+void fastnet_lat_rx_nonworker(odp_packet_t pkt){
+	fastnet_lat_block_t* b = &fastnet_lat_blocks[FASTNET_NONWORKER_SLOT];
+	uint32_t c,n;
+	
+	c = __atomic_load_n(&(b->countdown),__ATOMIC_RELAXED);
+	do{
+		n = c>1 ? c-1 : fastnet_conf.lat_sample;
+	}while(!__atomic_compare_exchange_n(&(b->countdown),&c,n,1,__ATOMIC_RELAXED,__ATOMIC_RELAXED));
+	if(c<=1) fastnet_lat_start(pkt);
+}
+
+uint32_t fastnet_lat_since(fastnet_pkt_uarea_t* ua){
+	uint64_t diff = now_ns()-ua->lat_rx;
+	
+	/* 0 means "not stamped". */
+	if(odp_unlikely(diff==0)) return 1;
+	if(odp_unlikely(diff>LAT_MAX_NS)) return LAT_MAX_NS;
+	return diff;
+}
+
+void fastnet_lat_output(odp_packet_t pkt){
+	fastnet_pkt_uarea_t* ua = FASTNET_PACKET_UAREA(pkt);
+	uint32_t l3off,l4off,len;
+	uint8_t* l3;
+	uint8_t  proto,version,tcpflags;
+	
+	ua->lat_stamp[FASTNET_LAT_OUT] = fastnet_lat_since(ua);
+	
+	l3 = odp_packet_l3_ptr(pkt,&len);
+	if(odp_unlikely(l3==NULL || len<1)) return;
+	l3off = odp_packet_l3_offset(pkt);
+	version = l3[0]>>4;
+	if(version==4 && len>=sizeof(fnet_ip_header_t)){
+		proto = ((fnet_ip_header_t*)l3)->protocol;
+		l4off = l3off+((l3[0]&0xf)<<2);
+	}else if(version==6 && len>=sizeof(fnet_ip6_header_t)){
+		proto = ((fnet_ip6_header_t*)l3)->next_header;
+		l4off = l3off+sizeof(fnet_ip6_header_t);
+	}else return;
+	
+	switch(proto){
+	case IP_PROTOCOL_ICMP:
+	case IP_PROTOCOL_ICMP6:
+		ua->lat_class = FASTNET_LAT_ICMP;
+		break;
+	case IP_PROTOCOL_UDP:
+		ua->lat_class = FASTNET_LAT_UDP;
+		break;
+	case IP_PROTOCOL_TCP:
+		/* The flags are the low byte of hdrlength__flags. */
+		if(odp_packet_copy_to_mem(pkt,l4off+13,1,&tcpflags)) return;
+		if(tcpflags & FNET_TCP_SGT_RST)
+			ua->lat_class = FASTNET_LAT_TCP_RST;
+		else if((tcpflags & (FNET_TCP_SGT_SYN|FNET_TCP_SGT_ACK)) == (FNET_TCP_SGT_SYN|FNET_TCP_SGT_ACK))
+			ua->lat_class = FASTNET_LAT_TCP_SYNACK;
+		else
+			ua->lat_class = FASTNET_LAT_TCP;
+		break;
+	}
+}
+
+static inline
+void account(fastnet_lat_block_t* b,uint32_t series,uint64_t ns){
+	uint64_t max;
+	
+	/* The block of the threads, that are not workers, as in FASTNET_STAT_ADD(). */
+	if(odp_unlikely(b==&fastnet_lat_blocks[FASTNET_NONWORKER_SLOT])){
+		__atomic_fetch_add(&(b->count[series]),1,__ATOMIC_RELAXED);
+		__atomic_fetch_add(&(b->sum[series]),ns,__ATOMIC_RELAXED);
+		__atomic_fetch_add(&(b->hist[series][fastnet_hist_bucket(ns)]),1,__ATOMIC_RELAXED);
+		max = __atomic_load_n(&(b->max[series]),__ATOMIC_RELAXED);
+		while(max<ns && !__atomic_compare_exchange_n(&(b->max[series]),&max,ns,1,__ATOMIC_RELAXED,__ATOMIC_RELAXED));
+		return;
+	}
+	b->count[series]++;
+	b->sum[series] += ns;
+	if(b->max[series]<ns) b->max[series] = ns;
+	b->hist[series][fastnet_hist_bucket(ns)]++;
+}
+
+void fastnet_lat_finish(odp_packet_t pkt){
+	fastnet_pkt_uarea_t* ua = FASTNET_PACKET_UAREA(pkt);
+	fastnet_lat_block_t* b = &fastnet_lat_blocks[fastnet_thread_slot()];
+	uint32_t total,prev,i;
+	
+	ua->flags &= ~FASTNET_PKTF_LAT;
+	
+	total = fastnet_lat_since(ua);
+	if(odp_unlikely(total>=LAT_MAX_NS)) return;
+	
+	account(b,ua->lat_class,total);
+	
+	/*
+	 * The segments between the stamps. Stages, that have not been passed (an ARP reply has
+	 * no L4 stamp), are skipped, so the segment spans to the next stamp.
+	 */
+	prev = 0;
+	for(i=0;i<FASTNET_LAT_STAMPS;++i){
+		if(!ua->lat_stamp[i] || ua->lat_stamp[i]<prev) continue;
+		account(b,FASTNET_LAT_RX_L3+i,ua->lat_stamp[i]-prev);
+		prev = ua->lat_stamp[i];
+	}
+	if(prev) account(b,FASTNET_LAT_OUT_TX,total-prev);
+}
+
+/*
+ * The counters are read, while the workers keep on counting, so the output is not a
+ * consistent snapshot.
+ */
+void fastnet_lat_print(FILE* f){
+	uint64_t* hist;
+	uint64_t count,sum,max;
+	int s,w,i;
+	
+	hist = malloc(sizeof(uint64_t)*FASTNET_HIST_BUCKETS);
+	if(!hist) return;
+	
+	fprintf(f,"%-16s %12s %8s %8s %8s %8s %10s\n","latency (ns)","count","mean","p50","p99","p99.9","max");
+	for(s=0;s<FASTNET_LAT_NUM_SERIES;++s){
+		memset(hist,0,sizeof(uint64_t)*FASTNET_HIST_BUCKETS);
+		count = sum = max = 0;
+		for(w=0;w<FASTNET_THREAD_SLOTS;++w){
+			count += fastnet_lat_blocks[w].count[s];
+			sum   += fastnet_lat_blocks[w].sum[s];
+			if(max<fastnet_lat_blocks[w].max[s]) max = fastnet_lat_blocks[w].max[s];
+			for(i=0;i<FASTNET_HIST_BUCKETS;++i)
+				hist[i] += fastnet_lat_blocks[w].hist[s][i];
+		}
+		if(!count) continue;
+		fprintf(f,"%-16s %12llu %8llu %8llu %8llu %8llu %10llu\n",series_names[s],
+			(unsigned long long)count,
+			(unsigned long long)(sum/count),
+			(unsigned long long)fastnet_hist_percentile(hist,count,0.5),
+			(unsigned long long)fastnet_hist_percentile(hist,count,0.99),
+			(unsigned long long)fastnet_hist_percentile(hist,count,0.999),
+			(unsigned long long)max);
+	}
+	free(hist);
+}
@@ -0,0 +1,118 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <net/lockprof.h>
+
+static const char* class_names[FASTNET_LOCK_NUM_CLASSES] = {
+	"socket_table",
+	"arp_table",
+	"nd6_bucket",
+	"nd6_instance",
+	"nd6_router",
+	"ipv6_nif",
+	"tcp_pcb",
+	"slab",
+};
+
+const char* fastnet_lockprof_name(uint32_t cls){
+	return cls<FASTNET_LOCK_NUM_CLASSES ? class_names[cls] : "?";
+}
+
+#ifdef NET_LOCKPROF
+
+fastnet_lockprof_block_t fastnet_lockprof_blocks[FASTNET_THREAD_SLOTS];
+
+void fastnet_lockprof_sum(fastnet_lockprof_stat_t* stat){
+	fastnet_lockprof_stat_t* src;
+	int c,w;
+	
+	memset(stat,0,sizeof(fastnet_lockprof_stat_t)*FASTNET_LOCK_NUM_CLASSES);
+	for(w=0;w<FASTNET_THREAD_SLOTS;++w){
+		for(c=0;c<FASTNET_LOCK_NUM_CLASSES;++c){
+			src = &(fastnet_lockprof_blocks[w].stat[c]);
+			stat[c].acquired    += src->acquired;
+			stat[c].contended   += src->contended;
+			stat[c].spin_cycles += src->spin_cycles;
+			stat[c].holds       += src->holds;
+			stat[c].hold_cycles += src->hold_cycles;
+			if(stat[c].spin_max<src->spin_max) stat[c].spin_max = src->spin_max;
+			if(stat[c].hold_max<src->hold_max) stat[c].hold_max = src->hold_max;
+		}
+	}
+}
+
+void fastnet_lockprof_reset(){
+	int w,c;
+	for(w=0;w<FASTNET_THREAD_SLOTS;++w){
+		for(c=0;c<FASTNET_LOCK_NUM_CLASSES;++c){
+			/* A lock may be held across the reset (eg. a cache entry), keep the open holds. */
+			memset(&(fastnet_lockprof_blocks[w].stat[c]),0,sizeof(fastnet_lockprof_stat_t));
+			memset(fastnet_lockprof_blocks[w].hold_hist[c],0,sizeof(uint64_t)*FASTNET_HIST_BUCKETS);
+		}
+	}
+}
+
+/*
+ * The counters are read, while the workers keep on counting, so the output is not a
+ * consistent snapshot.
+ */
+void fastnet_lockprof_print(FILE* f){
+	fastnet_lockprof_stat_t stat[FASTNET_LOCK_NUM_CLASSES];
+	uint64_t* hist;
+	uint64_t spin_total = 0;
+	int c,w,i,worst = -1;
+	
+	hist = malloc(sizeof(uint64_t)*FASTNET_HIST_BUCKETS);
+	if(!hist) return;
+	
+	fastnet_lockprof_sum(stat);
+	
+	fprintf(f,"%-14s %12s %12s %7s %10s %10s %8s %8s %10s\n",
+		"lock","acquired","contended","cont%","spin/cont","spin_max","hold","hold_p99","hold_max");
+	for(c=0;c<FASTNET_LOCK_NUM_CLASSES;++c){
+		if(!stat[c].acquired) continue;
+		memset(hist,0,sizeof(uint64_t)*FASTNET_HIST_BUCKETS);
+		for(w=0;w<FASTNET_THREAD_SLOTS;++w)
+			for(i=0;i<FASTNET_HIST_BUCKETS;++i)
+				hist[i] += fastnet_lockprof_blocks[w].hold_hist[c][i];
+		fprintf(f,"%-14s %12llu %12llu %6.2f%% %10llu %10llu %8llu %8llu %10llu\n",class_names[c],
+			(unsigned long long)stat[c].acquired,
+			(unsigned long long)stat[c].contended,
+			100.0*stat[c].contended/stat[c].acquired,
+			(unsigned long long)(stat[c].contended ? stat[c].spin_cycles/stat[c].contended : 0),
+			(unsigned long long)stat[c].spin_max,
+			(unsigned long long)(stat[c].holds ? stat[c].hold_cycles/stat[c].holds : 0),
+			(unsigned long long)fastnet_hist_percentile(hist,stat[c].holds,0.99),
+			(unsigned long long)stat[c].hold_max);
+		spin_total += stat[c].spin_cycles;
+		if(worst<0 || stat[worst].spin_cycles<stat[c].spin_cycles) worst = c;
+	}
+	if(spin_total)
+		fprintf(f,"most spin cycles: %s (%.1f%% of %llu)\n",class_names[worst],
+			100.0*stat[worst].spin_cycles/spin_total,(unsigned long long)spin_total);
+	free(hist);
+}
+
+#else
+
+void fastnet_lockprof_sum(fastnet_lockprof_stat_t* stat){
+	memset(stat,0,sizeof(fastnet_lockprof_stat_t)*FASTNET_LOCK_NUM_CLASSES);
+}
+void fastnet_lockprof_reset(){}
+void fastnet_lockprof_print(FILE* f){ (void)f; }
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdarg.h>
+#include <string.h>
+#include <net/log.h>
+#include <net/niftable.h>
+#include <net/nethread.h>
+
+int fastnet_log_level = NET_LOG_MAX;
+
+/* Must be power of 2 */
+#define RING_SZ         0x80
+#define RING_SZ_MOD(x)  ((x)&0x7f)
+
+#define NS_PER_SEC 1000000000ULL
+
+typedef struct {
+	uint64_t tstamp;
+	uint32_t level;
+	char     text[NET_LOG_MSG_SZ];
+} log_entry_t;
+
+/*
+ * Single-Producer/Single-Consumer ring, like the ones of the flow director.
+ *
+ * The rings are static (and thus zero-initialized), so messages can be logged before ODP
+ * is initialized. Threads, that are not workers, share an extra ring, whose producer side
+ * is serialized by 'nonworker_lock' (a zeroed spinlock is unlocked).
+ */
+typedef struct {
+	odp_atomic_u32_t head ODP_ALIGNED_CACHE;
+	uint32_t         dropped;
+	odp_atomic_u32_t tail ODP_ALIGNED_CACHE;
+	log_entry_t      entries[RING_SZ] ODP_ALIGNED_CACHE;
+} log_ring_t;
+
+static log_ring_t rings[FASTNET_THREAD_SLOTS];
+
+static odp_spinlock_t nonworker_lock;
+
+static const char* level_names[] = { "", "ERROR", "WARN", "INFO", "DEBUG" };
+
+void fastnet_log_emit(fastnet_log_site_t* site,int level,const char* fmt,...){
+	int slot = fastnet_thread_slot();
+	log_ring_t* ring = &rings[slot];
+	log_entry_t* entry;
+	uint32_t head,tail;
+	uint64_t now;
+	int len;
+	va_list ap;
+	
+	now = odp_time_to_ns(odp_time_local());
+	
+	/* Rate limit. */
+	if((now-site->window)>=NS_PER_SEC){
+		site->window = now;
+		site->count  = 0;
+	}
+	if(site->count>=NET_LOG_BURST){
+		site->suppressed++;
+		return;
+	}
+	site->count++;
+	
+	if(odp_unlikely(slot==FASTNET_NONWORKER_SLOT)) odp_spinlock_lock(&nonworker_lock);
+	
+	head = odp_atomic_load_u32(&(ring->head));
+	tail = odp_atomic_load_acq_u32(&(ring->tail));
+	if(odp_unlikely((head-tail)>=RING_SZ)){
+		ring->dropped++;
+		if(odp_unlikely(slot==FASTNET_NONWORKER_SLOT)) odp_spinlock_unlock(&nonworker_lock);
+		return;
+	}
+	
+	entry = &(ring->entries[RING_SZ_MOD(head)]);
+	entry->tstamp = now;
+	entry->level  = level;
+	len = 0;
+	if(site->suppressed){
+		len = snprintf(entry->text,sizeof(entry->text),"(%u suppressed) ",site->suppressed);
+		if(len<0 || len>=(int)sizeof(entry->text)) len = 0;
+		site->suppressed = 0;
+	}
+	va_start(ap,fmt);
+	vsnprintf(entry->text+len,sizeof(entry->text)-len,fmt,ap);
+	va_end(ap);
+	
+	odp_atomic_store_rel_u32(&(ring->head),head+1);
+	
+	if(odp_unlikely(slot==FASTNET_NONWORKER_SLOT)) odp_spinlock_unlock(&nonworker_lock);
+}
+
+int fastnet_log_drain(FILE* f){
+	log_ring_t* ring;
+	log_entry_t* entry;
+	uint32_t head,tail,dropped;
+	size_t len;
+	int i,count = 0;
+	
+	for(i=0;i<FASTNET_THREAD_SLOTS;++i){
+		ring = &rings[i];
+		head = odp_atomic_load_acq_u32(&(ring->head));
+		tail = odp_atomic_load_u32(&(ring->tail));
+		for(;tail!=head;++tail,++count){
+			entry = &(ring->entries[RING_SZ_MOD(tail)]);
+			len = strnlen(entry->text,sizeof(entry->text));
+			fprintf(f,"%llu.%06llu [%d] %-5s %.*s%s",
+				(unsigned long long)(entry->tstamp/NS_PER_SEC),
+				(unsigned long long)((entry->tstamp%NS_PER_SEC)/1000),
+				i,level_names[entry->level<=NET_LOG_DEBUG ? entry->level : 0],
+				(int)len,entry->text,
+				(len && entry->text[len-1]=='\n') ? "" : "\n");
+		}
+		odp_atomic_store_rel_u32(&(ring->tail),tail);
+		
+		/* Racy with the producer, only approximate. */
+		dropped = ring->dropped;
+		if(odp_unlikely(dropped)){
+			ring->dropped = 0;
+			fprintf(f,"[%d] %u log messages dropped\n",i,dropped);
+		}
+	}
+	if(count) fflush(f);
+	return count;
+}
@@ -0,0 +1,274 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <net/mem_pktio.h>
+#include <net/mac_addr_ldst.h>
+#include <net/pkt_alloc.h>
+#include <net/fnv1a.h>
+#include <net/conf.h>
+#include <net/header/ethhdr.h>
+#include <net/header/iphdr.h>
+#include <net/header/ip6hdr.h>
+#include <net/header/layer4.h>
+
+#define ETH_TYPE_VLAN 0x8100
+
+typedef struct {
+	nif_t*      nif;
+	odp_queue_t rx[NET_NIF_MAX_QUEUE];
+	int         num_rx;
+} mem_dev_t;
+
+/* Indexed by ifindex. */
+static mem_dev_t* mem_devs[NET_NIFTAB_MAX_NIFS];
+
+static inline
+mem_dev_t* get_dev(nif_t* nif){
+	mem_dev_t* md;
+	if(odp_unlikely(nif==NULL || nif->ifindex>=NET_NIFTAB_MAX_NIFS)) return NULL;
+	md = mem_devs[nif->ifindex];
+	if(odp_unlikely(md==NULL || md->nif!=nif)) return NULL;
+	return md;
+}
+
+static void destroy_queues(mem_dev_t* md,nif_t* nif){
+	int q;
+	for(q=0;q<md->num_rx;++q)
+		if(md->rx[q]!=ODP_QUEUE_INVALID) odp_queue_destroy(md->rx[q]);
+	for(q=0;q<nif->num_queues;++q)
+		if(nif->output[q]!=ODP_QUEUE_INVALID) odp_queue_destroy(nif->output[q]);
+	if(nif->loopback!=ODP_QUEUE_INVALID) odp_queue_destroy(nif->loopback);
+}
+
+nif_t* fastnet_mem_open(nif_table_t* table,const char* dev){
+	odp_queue_param_t qp;
+	mem_dev_t* md;
+	nif_t* nif;
+	char name[64];
+	char* end;
+	unsigned long id;
+	uint8_t mac[6];
+	int q,num;
+	
+	if(strncmp(dev,"mem:",4)) return 0;
+	id = strtoul(dev+4,&end,10);
+	if(end==dev+4 || *end || id>0xffff) return 0;
+	if(table->max>=NET_NIFTAB_MAX_NIFS) return 0;
+	
+	md = calloc(sizeof(*md),1);
+	if(!md) return 0;
+	
+	nif = &(table->table[table->max]);
+	memset(nif,0,sizeof(*nif));
+	nif->ifindex  = table->max;
+	nif->pktio    = ODP_PKTIO_INVALID;
+	nif->loopback = ODP_QUEUE_INVALID;
+	md->nif = nif;
+	
+	mac[0] = 0x02;
+	mac[1] = 0;
+	mac[2] = 0;
+	mac[3] = 0;
+	mac[4] = id>>8;
+	mac[5] = id;
+	nif->hwaddr = fastnet_mac_to_int(mac);
+	
+	/*
+	 * Receive queues: One per worker, as fastnet_openpktio() configures the pktin queues.
+	 */
+	num = table->workers;
+	if(num<1) num = 1;
+	if(num>NET_NIF_MAX_QUEUE) num = NET_NIF_MAX_QUEUE;
+	odp_queue_param_init(&qp);
+	qp.type        = ODP_QUEUE_TYPE_SCHED;
+	qp.enq_mode    = ODP_QUEUE_OP_MT;
+	qp.sched.sync  = ODP_SCHED_SYNC_ATOMIC;
+	qp.context     = nif;
+	qp.context_len = sizeof(*nif);
+	for(q=0;q<num;++q){
+		snprintf(name,sizeof name,"%s(rx%d)",dev,q);
+		md->rx[q] = odp_queue_create(name,&qp);
+		md->num_rx = q+1;
+		if(md->rx[q]==ODP_QUEUE_INVALID) goto error;
+	}
+	
+	odp_queue_param_init(&qp);
+	qp.type        = ODP_QUEUE_TYPE_SCHED;
+	qp.enq_mode    = ODP_QUEUE_OP_MT;
+	qp.context     = nif;
+	qp.context_len = sizeof(*nif);
+	snprintf(name,sizeof name,"%s(loopback)",dev);
+	nif->loopback = odp_queue_create(name,&qp);
+	if(nif->loopback==ODP_QUEUE_INVALID) goto error;
+	
+	/*
+	 * Transmit queues: Plain queues, drained by fastnet_mem_capture().
+	 */
+	num = table->workers;
+	if(num>(int)fastnet_conf.out_queues) num = fastnet_conf.out_queues;
+	if(num<1) num = 1;
+	odp_queue_param_init(&qp);
+	qp.type     = ODP_QUEUE_TYPE_PLAIN;
+	qp.enq_mode = ODP_QUEUE_OP_MT;
+	qp.deq_mode = ODP_QUEUE_OP_MT;
+	for(q=0;q<num;++q){
+		snprintf(name,sizeof name,"%s(tx%d)",dev,q);
+		nif->output[q] = odp_queue_create(name,&qp);
+		nif->num_queues = q+1;
+		if(nif->output[q]==ODP_QUEUE_INVALID) goto error;
+	}
+	
+	mem_devs[nif->ifindex] = md;
+	table->max++;
+	return nif;
+error:
+	destroy_queues(md,nif);
+	free(md);
+	return 0;
+}
+
+int fastnet_mem_is(nif_t* nif){
+	return get_dev(nif)!=NULL;
+}
+
+int fastnet_mem_rx_queues(nif_t* nif){
+	mem_dev_t* md = get_dev(nif);
+	return md ? md->num_rx : 0;
+}
+
+/*
+ * Does, what the pktio's parser would do: Ethernet (with up to one VLAN tag), ARP, IPv4 and
+ * IPv6. The layer 4 offset is set by the IP input.
+ */
+static int parse(odp_packet_t pkt){
+	fnet_eth_header_t eth;
+	uint16_t type;
+	uint32_t l3;
+	
+	if(odp_packet_copy_to_mem(pkt,0,sizeof(eth),&eth)) return 1;
+	type = odp_be_to_cpu_16(eth.type);
+	l3 = sizeof(eth);
+	if(type==ETH_TYPE_VLAN){
+		if(odp_packet_copy_to_mem(pkt,l3+2,2,&type)) return 1;
+		type = odp_be_to_cpu_16(type);
+		l3 += 4;
+	}
+	
+	odp_packet_l2_offset_set(pkt,0);
+	odp_packet_l3_offset_set(pkt,l3);
+	odp_packet_has_eth_set(pkt,1);
+	switch(type){
+	case NETPROT_L3_ARP:  odp_packet_has_arp_set(pkt,1); break;
+	case NETPROT_L3_IPV4: odp_packet_has_ipv4_set(pkt,1); break;
+	case NETPROT_L3_IPV6: odp_packet_has_ipv6_set(pkt,1); break;
+	}
+	return 0;
+}
+
+/*
+ * Hashes the addresses, and for TCP and UDP (unfragmented) the ports, like the RSS of a NIC.
+ * Other packets go to queue 0.
+ */
+static uint32_t rss_hash(odp_packet_t pkt){
+	fnet_ip_header_t ip;
+	fnet_ip6_header_t ip6;
+	uint32_t hash = fastnet_fnv1a_init();
+	uint32_t l3 = odp_packet_l3_offset(pkt);
+	uint32_t ports,l4;
+	uint8_t proto;
+	
+	if(odp_packet_has_ipv4(pkt)){
+		if(odp_packet_copy_to_mem(pkt,l3,sizeof(ip),&ip)) return 0;
+		hash = fastnet_fnv1a(hash,(uint8_t*)&ip.source_addr,sizeof(ip.source_addr));
+		hash = fastnet_fnv1a(hash,(uint8_t*)&ip.destination_addr,sizeof(ip.destination_addr));
+		if(odp_be_to_cpu_16(ip.flags_fragment_offset) & ~FNET_IP_DF) return hash;
+		proto = ip.protocol;
+		l4 = l3+((ip.version__header_length&0xf)<<2);
+	}else if(odp_packet_has_ipv6(pkt)){
+		if(odp_packet_copy_to_mem(pkt,l3,sizeof(ip6),&ip6)) return 0;
+		hash = fastnet_fnv1a(hash,(uint8_t*)&ip6.source_addr,sizeof(ip6.source_addr));
+		hash = fastnet_fnv1a(hash,(uint8_t*)&ip6.destination_addr,sizeof(ip6.destination_addr));
+		proto = ip6.next_header;
+		l4 = l3+sizeof(ip6);
+	}else return 0;
+	
+	if(proto!=IP_PROTOCOL_TCP && proto!=IP_PROTOCOL_UDP) return hash;
+	if(odp_packet_copy_to_mem(pkt,l4,sizeof(ports),&ports)) return hash;
+	return fastnet_fnv1a(hash,(uint8_t*)&ports,sizeof(ports));
+}
+
+int fastnet_mem_inject_queue(nif_t* nif,odp_packet_t pkt,int queue){
+	mem_dev_t* md = get_dev(nif);
+	if(odp_unlikely(md==NULL || queue<0 || queue>=md->num_rx)) return 1;
+	if(odp_unlikely(parse(pkt))) return 1;
+	return odp_queue_enq(md->rx[queue],odp_packet_to_event(pkt)) ? 1 : 0;
+}
+
+int fastnet_mem_inject(nif_t* nif,odp_packet_t pkt){
+	mem_dev_t* md = get_dev(nif);
+	if(odp_unlikely(md==NULL)) return 1;
+	if(odp_unlikely(parse(pkt))) return 1;
+	return odp_queue_enq(md->rx[rss_hash(pkt)%md->num_rx],odp_packet_to_event(pkt)) ? 1 : 0;
+}
+
+int fastnet_mem_inject_frame(nif_t* nif,const void* data,uint32_t len){
+	odp_packet_t pkt;
+	
+	pkt = odp_packet_alloc(fastnet_pool_pktin(),len);
+	if(odp_unlikely(pkt==ODP_PACKET_INVALID)) return 1;
+	if(odp_unlikely(odp_packet_copy_from_mem(pkt,0,len,data) || fastnet_mem_inject(nif,pkt))){
+		odp_packet_free(pkt);
+		return 1;
+	}
+	return 0;
+}
+
+int fastnet_mem_capture(nif_t* nif,odp_packet_t* pkts,int num){
+	odp_event_t ev[64];
+	int q,i,k,n = 0;
+	
+	if(odp_unlikely(get_dev(nif)==NULL)) return 0;
+	for(q=0;q<nif->num_queues && n<num;++q){
+		for(;;){
+			k = num-n;
+			if(k>64) k = 64;
+			k = odp_queue_deq_multi(nif->output[q],ev,k);
+			if(k<1) break;
+			for(i=0;i<k;++i) pkts[n++] = odp_packet_from_event(ev[i]);
+			if(n>=num) break;
+		}
+	}
+	return n;
+}
+
+uint64_t fastnet_mem_discard(nif_t* nif){
+	odp_event_t ev[64];
+	uint64_t n = 0;
+	int q,i,k;
+	
+	if(odp_unlikely(get_dev(nif)==NULL)) return 0;
+	for(q=0;q<nif->num_queues;++q){
+		for(;;){
+			k = odp_queue_deq_multi(nif->output[q],ev,64);
+			if(k<1) break;
+			for(i=0;i<k;++i) odp_event_free(ev[i]);
+			n += k;
+		}
+	}
+	return n;
+}
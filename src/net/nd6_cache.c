@@ -17,20 +17,25 @@
 #include <net/fnv1a.h>
 #include <net/std_lib.h>
 #include <net/_config.h>
+#include <net/slab.h>
+#include <net/conf.h>
+#include <net/lockprof.h>
 
 /* Must be power of 2 */
 
-#define HASHTAB_SZ           0x1000
-#define HASHTAB_SZ_MOD(x)    x&0xfff
+/* The number of buckets is configured at runtime (fastnet_conf.nd6_buckets). */
+#define HASHTAB_SZ_MOD(x)    ((x)&hashtab_mask)
 
 #define HASHTAB_LOCKS        0x10
 #define HASHTAB_LOCKS_MOD(x) x&0xf
 
 
+static uint32_t hashtab_mask;
+
 typedef struct{
-	nd6_nce_handle_t buckets[HASHTAB_SZ];
 	odp_spinlock_t   bucket_locks  [HASHTAB_LOCKS];
 	odp_spinlock_t   instance_locks[HASHTAB_LOCKS];
+	nd6_nce_handle_t buckets[];
 } neighbor_cache_t;
 
 typedef struct{
@@ -40,8 +45,8 @@ typedef struct{
 
 static void
 nc_init(neighbor_cache_t* nc){
-	int i;
-	for(i=0;i<HASHTAB_SZ;++i)
+	uint32_t i;
+	for(i=0;i<=hashtab_mask;++i)
 		nc->buckets[i] = ODP_BUFFER_INVALID;
 	for(i=0;i<HASHTAB_LOCKS;++i){
 		odp_spinlock_init(&(nc->bucket_locks[i]));
@@ -55,9 +60,10 @@ rl_init(router_list_t* rl){
 	odp_spinlock_init(&(rl->list_lock));
 }
 
+/* The neighbor cache must be the last member, as it ends with the buckets. */
 typedef struct{
-	neighbor_cache_t  neighbor;
 	router_list_t     router;
+	neighbor_cache_t  neighbor;
 } nd6_cache_t;
 
 static
@@ -68,7 +74,7 @@ uint32_t ip6_hash(nif_t* nif,ipv6_addr_t ipaddr){
 	return hash;
 }
 
-static odp_pool_t nc_entries;
+static fastnet_slab_t nc_entries;
 static odp_shm_t  hashtab;
 
 void fastnet_nd6_cache_init(){
@@ -76,16 +82,17 @@ void fastnet_nd6_cache_init(){
 	nd6_cache_t* ci;
 	
 	odp_pool_param_t epool;
+	odp_pool_param_init(&epool);
 	epool.type = ODP_POOL_BUFFER;
-	epool.buf.num   = 512*1024;
+	epool.buf.num   = fastnet_conf.nd6_entries;
 	epool.buf.align = 8;
 	
-	epool.buf.size  = sizeof(neighbor_cache_t);
-	nc_entries = odp_pool_create("nd6_nc_entries",&epool);
-	if(nc_entries==ODP_POOL_INVALID) fastnet_abort();
+	epool.buf.size  = sizeof(nd6_nce_t);
+	if(!fastnet_slab_init(&nc_entries,"nd6_nc_entries",&epool,fastnet_conf.slab_chunk,fastnet_conf.nd6_entries)) fastnet_abort();
 	
 	
-	hashtab = odp_shm_reserve("nd6_hashtable",sizeof(nd6_cache_t),8,0);
+	hashtab_mask = fastnet_conf.nd6_buckets-1;
+	hashtab = odp_shm_reserve("nd6_hashtable",sizeof(nd6_cache_t)+(fastnet_conf.nd6_buckets*sizeof(nd6_nce_handle_t)),8,0);
 	if(hashtab==ODP_SHM_INVALID) fastnet_abort();
 	ci = odp_shm_addr(hashtab);
 	nc_init(&(ci->neighbor));
@@ -97,7 +104,7 @@ void fastnet_nd6_cache_init(){
 
 nd6_nce_handle_t fastnet_nd6_nce_alloc(){
 	nd6_nce_t *ptr;
-	nd6_nce_handle_t handle = odp_buffer_alloc(nc_entries);
+	nd6_nce_handle_t handle = fastnet_slab_buffer_alloc(&nc_entries);
 	if(handle!=ODP_BUFFER_INVALID){
 		ptr = odp_buffer_addr(handle);
 		odp_atomic_init_u32(&(ptr->refc),1);
@@ -126,7 +133,7 @@ void fastnet_nd6_nce_put(nd6_nce_handle_t handle){
 	/*
 	 * Unlikely, because most decrements don't reach 0 (statistically).
 	 */
-	if(odp_unlikely(odp_atomic_fetch_dec_u32(&(ptr->refc))==1)) odp_buffer_free(handle);
+	if(odp_unlikely(odp_atomic_fetch_dec_u32(&(ptr->refc))==1)) fastnet_slab_buffer_free(&nc_entries,handle);
 }
 
 void fastnet_nd6_nce_lock_key(nif_t* nif, ipv6_addr_t addr){
@@ -140,7 +147,7 @@ void fastnet_nd6_nce_lock_key(nif_t* nif, ipv6_addr_t addr){
 	
 	lockno = HASHTAB_LOCKS_MOD(hash);
 	
-	odp_spinlock_lock(&(ci->neighbor.instance_locks[lockno]));
+	FASTNET_SPIN_LOCK(FASTNET_LOCK_ND6_INSTANCE,&(ci->neighbor.instance_locks[lockno]));
 }
 
 void fastnet_nd6_nce_unlock_key(nif_t* nif, ipv6_addr_t addr){
@@ -154,7 +161,7 @@ void fastnet_nd6_nce_unlock_key(nif_t* nif, ipv6_addr_t addr){
 	
 	lockno = HASHTAB_LOCKS_MOD(hash);
 	
-	odp_spinlock_unlock(&(ci->neighbor.instance_locks[lockno]));
+	FASTNET_SPIN_UNLOCK(FASTNET_LOCK_ND6_INSTANCE,&(ci->neighbor.instance_locks[lockno]));
 }
 
 void fastnet_nd6_nce_lock(nd6_nce_handle_t handle){
@@ -167,7 +174,7 @@ void fastnet_nd6_nce_lock(nd6_nce_handle_t handle){
 	
 	ci = odp_shm_addr(hashtab);
 	
-	odp_spinlock_lock(&(ci->neighbor.instance_locks[lockno]));
+	FASTNET_SPIN_LOCK(FASTNET_LOCK_ND6_INSTANCE,&(ci->neighbor.instance_locks[lockno]));
 }
 
 void fastnet_nd6_nce_unlock(nd6_nce_handle_t handle){
@@ -179,7 +186,7 @@ void fastnet_nd6_nce_unlock(nd6_nce_handle_t handle){
 	lockno = HASHTAB_LOCKS_MOD(ptr->key_hash);
 	
 	ci = odp_shm_addr(hashtab);
-	odp_spinlock_unlock(&(ci->neighbor.instance_locks[lockno]));
+	FASTNET_SPIN_UNLOCK(FASTNET_LOCK_ND6_INSTANCE,&(ci->neighbor.instance_locks[lockno]));
 }
 
 void fastnet_nd6_nce_hashit(nd6_nce_handle_t handle){
@@ -200,19 +207,19 @@ void fastnet_nd6_nce_ht_enter(nd6_nce_handle_t handle){
 	
 	ci = odp_shm_addr(hashtab);
 	
-	odp_spinlock_lock(&(ci->neighbor.bucket_locks[lockno]));
+	FASTNET_SPIN_LOCK(FASTNET_LOCK_ND6_BUCKET,&(ci->neighbor.bucket_locks[lockno]));
 	
 	if(odp_unlikely(ptr->in_hashtab)) goto terminate;
 	
 	odp_atomic_inc_u32(&(ptr->refc));
 	
 	ptr->next_hashtab = ci->neighbor.buckets[hashno];
-	ci->neighbor.buckets[hashno] = ptr->next_hashtab;
+	ci->neighbor.buckets[hashno] = handle;
 	
 	ptr->in_hashtab = 0xff;
 	
 	terminate:
-	odp_spinlock_unlock(&(ci->neighbor.bucket_locks[lockno]));
+	FASTNET_SPIN_UNLOCK(FASTNET_LOCK_ND6_BUCKET,&(ci->neighbor.bucket_locks[lockno]));
 }
 
 void fastnet_nd6_nce_ht_leave(nd6_nce_handle_t handle){
@@ -227,7 +234,7 @@ void fastnet_nd6_nce_ht_leave(nd6_nce_handle_t handle){
 	
 	ci = odp_shm_addr(hashtab);
 	
-	odp_spinlock_lock(&(ci->neighbor.bucket_locks[lockno]));
+	FASTNET_SPIN_LOCK(FASTNET_LOCK_ND6_BUCKET,&(ci->neighbor.bucket_locks[lockno]));
 	
 	if(odp_unlikely(!(ptr->in_hashtab))) goto terminate;
 	
@@ -240,10 +247,11 @@ void fastnet_nd6_nce_ht_leave(nd6_nce_handle_t handle){
 	}
 	NET_ASSERT( *bp == handle , "*bp == handle\n");
 	*bp = ptr->next_hashtab;
+	fastnet_neigh_gen_bump();
 	fastnet_nd6_nce_put(handle);
 	
 	terminate:
-	odp_spinlock_unlock(&(ci->neighbor.bucket_locks[lockno]));
+	FASTNET_SPIN_UNLOCK(FASTNET_LOCK_ND6_BUCKET,&(ci->neighbor.bucket_locks[lockno]));
 }
 
 nd6_nce_handle_t fastnet_nd6_nce_find(nif_t* nif, ipv6_addr_t addr){
@@ -260,7 +268,7 @@ nd6_nce_handle_t fastnet_nd6_nce_find(nif_t* nif, ipv6_addr_t addr){
 	lockno = HASHTAB_LOCKS_MOD(hash);
 	hashno = HASHTAB_SZ_MOD(hash);
 	
-	odp_spinlock_lock(&(ci->neighbor.bucket_locks[lockno]));
+	FASTNET_SPIN_LOCK(FASTNET_LOCK_ND6_BUCKET,&(ci->neighbor.bucket_locks[lockno]));
 	
 	handle = ci->neighbor.buckets[hashno];
 	
@@ -274,12 +282,12 @@ nd6_nce_handle_t fastnet_nd6_nce_find(nif_t* nif, ipv6_addr_t addr){
 	}
 	
 	if(odp_unlikely(handle == ODP_BUFFER_INVALID)){
-		odp_spinlock_unlock(&(ci->neighbor.bucket_locks[lockno]));
+		FASTNET_SPIN_UNLOCK(FASTNET_LOCK_ND6_BUCKET,&(ci->neighbor.bucket_locks[lockno]));
 		return ODP_BUFFER_INVALID;
 	}
 	
 	odp_atomic_inc_u32(&(ptr->refc));
-	odp_spinlock_unlock(&(ci->neighbor.bucket_locks[lockno]));
+	FASTNET_SPIN_UNLOCK(FASTNET_LOCK_ND6_BUCKET,&(ci->neighbor.bucket_locks[lockno]));
 	
 	return handle;
 }
@@ -342,7 +350,7 @@ void fastnet_nd6_nce_rl_enter(nd6_nce_handle_t handle){
 	
 	ci = odp_shm_addr(hashtab);
 	
-	odp_spinlock_lock(&(ci->router.list_lock));
+	FASTNET_SPIN_LOCK(FASTNET_LOCK_ND6_ROUTER,&(ci->router.list_lock));
 	
 	if(odp_unlikely(ptr->in_hashtab)) goto terminate;
 	
@@ -354,7 +362,7 @@ void fastnet_nd6_nce_rl_enter(nd6_nce_handle_t handle){
 	ptr->in_hashtab = 0xff;
 	
 	terminate:
-	odp_spinlock_unlock(&(ci->router.list_lock));
+	FASTNET_SPIN_UNLOCK(FASTNET_LOCK_ND6_ROUTER,&(ci->router.list_lock));
 }
 
 void fastnet_nd6_nce_rl_leave(nd6_nce_handle_t handle){
@@ -366,7 +374,7 @@ void fastnet_nd6_nce_rl_leave(nd6_nce_handle_t handle){
 	
 	ci = odp_shm_addr(hashtab);
 	
-	odp_spinlock_lock(&(ci->router.list_lock));
+	FASTNET_SPIN_LOCK(FASTNET_LOCK_ND6_ROUTER,&(ci->router.list_lock));
 	
 	if(odp_unlikely(!(ptr->in_hashtab))) goto terminate;
 	ptr->in_hashtab = 0;
@@ -381,6 +389,6 @@ void fastnet_nd6_nce_rl_leave(nd6_nce_handle_t handle){
 	fastnet_nd6_nce_put(handle);
 	
 	terminate:
-	odp_spinlock_unlock(&(ci->router.list_lock));
+	FASTNET_SPIN_UNLOCK(FASTNET_LOCK_ND6_ROUTER,&(ci->router.list_lock));
 }
 
@@ -20,6 +20,10 @@
 #include <net/std_defs.h>
 #include <net/mac_addr_ldst.h>
 #include <net/requirement.h>
+#include <net/flow_director.h>
+#include <net/pkt_alloc.h>
+#include <net/conf.h>
+#include <net/mem_pktio.h>
 
 #if 1
 #include <stdio.h>
@@ -37,12 +41,19 @@
 #define DBGPF(...) (void)0
 #endif
 
+/* Minimum packet buffer size. */
 #define BUFFER_SIZE 1856
-#define POOL_SIZE   (512*2048)
 
 int fastnet_pools_init(uint32_t pktsize,uint32_t pktnum,uint32_t poutsize,uint32_t poutnum){
 	odp_pool_param_t params;
-	odp_pool_t pool;
+	fastnet_numa_pool_t pktin,pktout;
+	
+	/* Arguments, that are 0, are taken from the configuration. */
+	fastnet_conf_finalize(&fastnet_conf);
+	if(!pktsize)  pktsize  = fastnet_conf.pktin_size;
+	if(!pktnum)   pktnum   = fastnet_conf.pktin_num;
+	if(!poutsize) poutsize = fastnet_conf.pktout_size;
+	if(!poutnum)  poutnum  = fastnet_conf.pktout_num;
 	
 	/* ------------  Pool used by the NIFs for input  -------------- */
 	if(pktsize<BUFFER_SIZE) pktsize = BUFFER_SIZE;
@@ -55,14 +66,10 @@ int fastnet_pools_init(uint32_t pktsize,uint32_t pktnum,uint32_t poutsize,uint32
 	params.pkt.uarea_size = sizeof(fastnet_pkt_uarea_t);
 	params.type           = ODP_POOL_PACKET;
 	
-	pool = odp_pool_create("fn_pktin",&params);
-	if(pool == ODP_POOL_INVALID) return 0;
+	if(!fastnet_numa_pool_create(&pktin,"fn_pktin",&params)) return 0;
 	
 	/* ------------- Pool used by the net-stack for output  --------------*/
 	
-	if(!poutsize) poutsize = pktsize;
-	if(!poutnum)  poutnum  = pktnum;
-	
 	odp_pool_param_init(&params);
 	params.pkt.seg_len    = poutsize;
 	params.pkt.len        = poutsize;
@@ -70,17 +77,21 @@ int fastnet_pools_init(uint32_t pktsize,uint32_t pktnum,uint32_t poutsize,uint32
 	params.pkt.uarea_size = sizeof(fastnet_pkt_uarea_t);
 	params.type           = ODP_POOL_PACKET;
 	
-	pool = odp_pool_create("fn_pktout",&params);
-	if(pool == ODP_POOL_INVALID) return 0;
+	if(!fastnet_numa_pool_create(&pktout,"fn_pktout",&params)) return 0;
+	
+	fastnet_alloc_set_pools(&pktin,&pktout);
 	
 	return 1;
 }
 
 int fastnet_niftable_prepare(nif_table_t* table,odp_instance_t instance) {
-	table->workers = odp_cpumask_default_worker(&(table->cpumask), NET_MAXTHREAD);
+	fastnet_conf_finalize(&fastnet_conf);
+	table->workers = odp_cpumask_default_worker(&(table->cpumask), fastnet_conf.workers ? fastnet_conf.workers : NET_MAXTHREAD);
 	DEBUG( table->workers==0 );
 	if(table->workers==0) return 0;
 	table->instance = instance;
+	odp_atomic_init_u32(&(table->worker_seq),0);
+	fastnet_flowdir_init(table->workers);
 	return 1;
 }
 
@@ -94,6 +105,8 @@ nif_t* fastnet_openpktio(nif_table_t* table,const char* dev) {
 	odp_pktio_param_t        pktio_p;
 	odp_pktin_queue_param_t  pktin_qp;
 	odp_pktout_queue_param_t pktout_qp;
+	odp_pktio_capability_t   capa;
+	odp_pktio_config_t       config;
 	nif_t*                   nif;
 	odp_queue_t              loop;
 	odp_queue_param_t        loop_p;
@@ -101,12 +114,18 @@ nif_t* fastnet_openpktio(nif_table_t* table,const char* dev) {
 	uint8_t mac_addr[6];
 	int ret;
 	
-	pool = odp_pool_lookup("fn_pktin");
+	/* In-memory devices (see <net/mem_pktio.h>). */
+	if(!strncmp(dev,"mem:",4)) return fastnet_mem_open(table,dev);
+	
+	/* Packets are received into memory local to the device. */
+	pool = fastnet_pool_pktin_node(fastnet_numa_dev_node(dev));
 	if(pool == ODP_POOL_INVALID) return 0;
 	
 	if(table->max>=NET_NIFTAB_MAX_NIFS) return 0;
 	nif = &(table->table[table->max]);
+	nif->ifindex = table->max;
 	nif->ipv4 = 0;
+	nif->offload_flags = 0;
 	
 	odp_queue_param_init(&loop_p);
 	loop_p.type        = ODP_QUEUE_TYPE_SCHED;
@@ -149,6 +168,34 @@ nif_t* fastnet_openpktio(nif_table_t* table,const char* dev) {
 	
 	odp_queue_context_set(loop,nif,sizeof(*nif));
 	
+	/*
+	 * Configure checksum offload: Enable everything the device supports.
+	 */
+	if(odp_pktio_capability(pktio,&capa)==0){
+		odp_pktio_config_init(&config);
+		config.pktin.bit.ipv4_chksum  = capa.config.pktin.bit.ipv4_chksum;
+		config.pktin.bit.udp_chksum   = capa.config.pktin.bit.udp_chksum;
+		config.pktin.bit.tcp_chksum   = capa.config.pktin.bit.tcp_chksum;
+		config.pktout.bit.ipv4_chksum = capa.config.pktout.bit.ipv4_chksum;
+		config.pktout.bit.udp_chksum  = capa.config.pktout.bit.udp_chksum;
+		config.pktout.bit.tcp_chksum  = capa.config.pktout.bit.tcp_chksum;
+		
+		/* RX timestamps for the latency samples (see <net/latency.h>). */
+		if(fastnet_conf.lat_sample)
+			config.pktin.bit.ts_all   = capa.config.pktin.bit.ts_all;
+		if(odp_pktio_config(pktio,&config)==0){
+			if(config.pktin.bit.ipv4_chksum)  nif->offload_flags |= NIFOFL_RX_IP4_CKSUM;
+			if(config.pktin.bit.udp_chksum)   nif->offload_flags |= NIFOFL_RX_UDP_CKSUM;
+			if(config.pktin.bit.tcp_chksum)   nif->offload_flags |= NIFOFL_RX_TCP_CKSUM;
+			if(config.pktout.bit.ipv4_chksum) nif->offload_flags |= NIFOFL_IP4_CKSUM;
+			if(config.pktout.bit.udp_chksum)  nif->offload_flags |= NIFOFL_UDP_CKSUM;
+			if(config.pktout.bit.tcp_chksum)  nif->offload_flags |= NIFOFL_TCP_CKSUM;
+		}else{
+			DBGPF("Device '%s': odp_pktio_config() FAILED\n",dev);
+		}
+	}
+	SHOW("Device '%s' checksum offload flags: %02x\n",dev,(int)nif->offload_flags);
+	
 	/*
 	 * Configure input-queues.
 	 */
@@ -197,12 +244,12 @@ nif_t* fastnet_openpktio(nif_table_t* table,const char* dev) {
 	/*
 	 * Get output event queues
 	 */
-	ret = odp_pktout_event_queue(pktio,nif->output,NET_NIF_MAX_QUEUE);
-	DBGPF("ret = odp_pktout_event_queue(pktio,nif->output,NET_NIF_MAX_QUEUE);\n");
+	ret = odp_pktout_event_queue(pktio,nif->output,fastnet_conf.out_queues);
+	DBGPF("ret = odp_pktout_event_queue(pktio,nif->output,fastnet_conf.out_queues);\n");
 	DEBUG(ret == 0);
 	DEBUG(ret);
 	if(ret == 0) goto error1;
-	if(ret>NET_NIF_MAX_QUEUE) nif->num_queues = NET_NIF_MAX_QUEUE;
+	if((uint32_t)ret>fastnet_conf.out_queues) nif->num_queues = fastnet_conf.out_queues;
 	else nif->num_queues = ret;
 	
 	/*
@@ -226,3 +273,7 @@ error2:
 	return 0;
 }
 
+void fastnet_nif_offload_emulate(nif_t* nif){
+	nif->offload_flags = NIFOFL_TCP_CKSUM|NIFOFL_UDP_CKSUM|NIFOFL_IP4_CKSUM|NIFOFL_EMULATED;
+}
+
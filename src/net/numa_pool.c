@@ -0,0 +1,142 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdio.h>
+#include <net/numa.h>
+#include <net/niftable.h>
+#include <net/nethread.h>
+
+__thread int fastnet_numa_node_idx = 0;
+
+/*
+ * Every counter is written by one worker only. Threads, that are not workers, share an
+ * extra counter, which they update atomically.
+ */
+typedef struct {
+	uint64_t local;
+	uint64_t remote;
+} ODP_ALIGNED_CACHE numa_counter_t;
+
+static numa_counter_t counters[FASTNET_THREAD_SLOTS];
+
+static uint32_t per_node(uint32_t num,int nodes){
+	num = (num+nodes-1)/nodes;
+	return num ? num : 1;
+}
+
+int fastnet_numa_pool_create(fastnet_numa_pool_t* pools,const char* name,odp_pool_param_t* params){
+	odp_pool_param_t p;
+	char pname[ODP_POOL_NAME_LEN];
+	int i,n;
+	
+	n = fastnet_numa_num_nodes();
+	p = *params;
+	switch(p.type){
+	case ODP_POOL_BUFFER: p.buf.num = per_node(p.buf.num,n); break;
+	case ODP_POOL_PACKET: p.pkt.num = per_node(p.pkt.num,n); break;
+	case ODP_POOL_TIMEOUT: p.tmo.num = per_node(p.tmo.num,n); break;
+	}
+	
+	for(i=0;i<NET_MAXNODES;++i)
+		pools->pool[i] = ODP_POOL_INVALID;
+	
+	for(i=0;i<n;++i){
+		if(i) snprintf(pname,sizeof pname,"%s.%d",name,i);
+		else  snprintf(pname,sizeof pname,"%s",name);
+		
+		/* The pool's memory is touched first by a thread running on node 'i'. */
+		fastnet_numa_enter(i);
+		pools->pool[i] = odp_pool_create(pname,&p);
+		fastnet_numa_leave();
+		
+		if(pools->pool[i]==ODP_POOL_INVALID) return 0;
+	}
+	
+	/* Nodes, that have no pool, use the pool of node 0. */
+	for(;i<NET_MAXNODES;++i)
+		pools->pool[i] = pools->pool[0];
+	
+	return 1;
+}
+
+odp_buffer_t fastnet_numa_buffer_alloc(fastnet_numa_pool_t* pools){
+	odp_buffer_t buf;
+	int i,n,node;
+	
+	node = fastnet_numa_node();
+	buf = odp_buffer_alloc(pools->pool[node]);
+	if(odp_likely(buf!=ODP_BUFFER_INVALID)){
+		fastnet_numa_count(1,0);
+		return buf;
+	}
+	
+	n = fastnet_numa_num_nodes();
+	for(i=0;i<n;++i){
+		if(i==node) continue;
+		buf = odp_buffer_alloc(pools->pool[i]);
+		if(buf!=ODP_BUFFER_INVALID){
+			fastnet_numa_count(0,1);
+			return buf;
+		}
+	}
+	return ODP_BUFFER_INVALID;
+}
+
+odp_packet_t fastnet_numa_packet_alloc(fastnet_numa_pool_t* pools,uint32_t len){
+	odp_packet_t pkt;
+	int i,n,node;
+	
+	node = fastnet_numa_node();
+	pkt = odp_packet_alloc(pools->pool[node],len);
+	if(odp_likely(pkt!=ODP_PACKET_INVALID)){
+		fastnet_numa_count(1,0);
+		return pkt;
+	}
+	
+	n = fastnet_numa_num_nodes();
+	for(i=0;i<n;++i){
+		if(i==node) continue;
+		pkt = odp_packet_alloc(pools->pool[i],len);
+		if(pkt!=ODP_PACKET_INVALID){
+			fastnet_numa_count(0,1);
+			return pkt;
+		}
+	}
+	return ODP_PACKET_INVALID;
+}
+
+void fastnet_numa_count(uint64_t local,uint64_t remote){
+	int slot = fastnet_thread_slot();
+	numa_counter_t* c = &counters[slot];
+	if(odp_likely(slot!=FASTNET_NONWORKER_SLOT)){
+		c->local  += local;
+		c->remote += remote;
+	}else{
+		__atomic_fetch_add(&(c->local),local,__ATOMIC_RELAXED);
+		__atomic_fetch_add(&(c->remote),remote,__ATOMIC_RELAXED);
+	}
+}
+
+void fastnet_numa_stats(uint64_t* local,uint64_t* remote){
+	int i;
+	uint64_t l = 0,r = 0;
+	for(i=0;i<FASTNET_THREAD_SLOTS;++i){
+		l += counters[i].local;
+		r += counters[i].remote;
+	}
+	*local  = l;
+	*remote = r;
+}
+
@@ -0,0 +1,97 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <net/pkt_alloc.h>
+#include <net/slab.h>
+
+__thread fastnet_alloc_ctx_t fastnet_alloc_ctx;
+
+/*
+ * Written once, at startup, before the worker threads are started.
+ */
+static fastnet_numa_pool_t pool_pktin;
+static fastnet_numa_pool_t pool_pktout;
+static int                 pools_set = 0;
+
+void fastnet_alloc_set_pools(fastnet_numa_pool_t* pktin,fastnet_numa_pool_t* pktout){
+	pool_pktin  = *pktin;
+	pool_pktout = *pktout;
+	pools_set   = 1;
+}
+
+odp_pool_t fastnet_pool_pktin_node(int node){
+	if(odp_unlikely(!pools_set)) return odp_pool_lookup("fn_pktin");
+	return pool_pktin.pool[node];
+}
+
+void fastnet_alloc_ctx_init(){
+	fastnet_alloc_ctx_t* ctx = &fastnet_alloc_ctx;
+	
+	if(odp_likely(pools_set)){
+		ctx->pktin  = fastnet_numa_local_pool(&pool_pktin);
+		ctx->pktout = fastnet_numa_local_pool(&pool_pktout);
+	}else{
+		/* Fallback, if the pools have been created by someone else. */
+		ctx->pktin  = odp_pool_lookup("fn_pktin");
+		ctx->pktout = odp_pool_lookup("fn_pktout");
+	}
+	ctx->num    = 0;
+	ctx->ready  = 1;
+}
+
+odp_packet_t fastnet_pktout_refill(uint32_t len){
+	fastnet_alloc_ctx_t* ctx = &fastnet_alloc_ctx;
+	odp_packet_t pkt;
+	int n,burst;
+	
+	if(odp_unlikely(!ctx->ready)) fastnet_alloc_ctx_init();
+	if(odp_unlikely(ctx->pktout==ODP_POOL_INVALID)) return ODP_PACKET_INVALID;
+	
+	/*
+	 * Only short packets (ARP, RST, ACK, ...) are taken from the cache.
+	 */
+	if(odp_unlikely(len>FASTNET_PKTCACHE_LEN)) goto direct;
+	
+	burst = FASTNET_PKTCACHE_SZ-ctx->num;
+	if(burst>FASTNET_PKTCACHE_BURST) burst = FASTNET_PKTCACHE_BURST;
+	if(odp_unlikely(burst<1)) goto direct;
+	
+	n = odp_packet_alloc_multi(ctx->pktout,FASTNET_PKTCACHE_LEN,ctx->cache+ctx->num,burst);
+	if(odp_unlikely(n<1)) goto direct;
+	fastnet_numa_count(n,0);
+	ctx->num += n-1;
+	pkt = ctx->cache[ctx->num];
+	if(odp_unlikely(odp_packet_reset(pkt,len))){
+		odp_packet_free(pkt);
+		goto direct;
+	}
+	fastnet_pkt_uarea_init(pkt);
+	return pkt;
+
+direct:
+	/* If the local pool is exhausted, fall back to the other nodes. */
+	if(odp_likely(pools_set)) pkt = fastnet_numa_packet_alloc(&pool_pktout,len);
+	else                      pkt = odp_packet_alloc(ctx->pktout,len);
+	if(odp_likely(pkt!=ODP_PACKET_INVALID)) fastnet_pkt_uarea_init(pkt);
+	return pkt;
+}
+
+void fastnet_alloc_flush(){
+	fastnet_alloc_ctx_t* ctx = &fastnet_alloc_ctx;
+	if(ctx->num>0) odp_packet_free_multi(ctx->cache,ctx->num);
+	ctx->num = 0;
+	fastnet_slab_flush_all_thread();
+}
+
@@ -0,0 +1,217 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <string.h>
+#include <net/pmtu.h>
+#include <net/ipv4.h>
+#include <net/ipv6.h>
+#include <net/header/ip6defs.h>
+#include <net/fnv1a.h>
+#include <net/conf.h>
+#include <net/std_lib.h>
+#include <net/stats.h>
+
+#define NS_PER_SEC 1000000000ULL
+
+#define PMTU_WAYS  2
+
+typedef struct {
+	odp_atomic_u32_t seq;    /* Odd, while the entry is written. */
+	uint32_t         mtu;    /* 0 = unused */
+	uint64_t         expire; /* odp_time_global() in ns */
+	ipv6_addr_t      addr;   /* IPv4 addresses are IPv4-mapped (::ffff:a.b.c.d). */
+} pmtu_entry_t;
+
+typedef struct {
+	pmtu_entry_t way[PMTU_WAYS];
+} ODP_ALIGNED_CACHE pmtu_bucket_t;
+
+static pmtu_bucket_t* table;
+static uint32_t       table_mask;
+
+void fastnet_pmtu_init(){
+	odp_shm_t shm;
+	uint32_t i,j,n;
+	
+	n = fastnet_conf.pmtu_buckets;
+	shm = odp_shm_reserve("pmtu_cache",n*sizeof(pmtu_bucket_t),ODP_CACHE_LINE_SIZE,0);
+	if(shm==ODP_SHM_INVALID) fastnet_abort();
+	table = odp_shm_addr(shm);
+	memset(table,0,n*sizeof(pmtu_bucket_t));
+	for(i=0;i<n;++i)
+		for(j=0;j<PMTU_WAYS;++j)
+			odp_atomic_init_u32(&(table[i].way[j].seq),0);
+	table_mask = n-1;
+}
+
+static inline
+uint64_t now_ns(){
+	return odp_time_to_ns(odp_time_global());
+}
+
+static inline
+void map4(ipv6_addr_t* addr,ipv4_addr_t v4){
+	addr->addr32[0] = 0;
+	addr->addr32[1] = 0;
+	addr->addr32[2] = odp_cpu_to_be_32(0xffff);
+	addr->addr32[3] = v4;
+}
+
+static inline
+pmtu_bucket_t* get_bucket(const ipv6_addr_t* addr){
+	uint32_t hash = fastnet_fnv1a(fastnet_fnv1a_init(),addr->addr,sizeof(ipv6_addr_t));
+	return &table[hash&table_mask];
+}
+
+/*
+ * Reads an entry consistently. Returns 1, if it belongs to 'addr', 0 if not, and -1 if it is
+ * being written (then 'mtu' and 'expire' are not read).
+ */
+static inline
+int entry_read(pmtu_entry_t* e,const ipv6_addr_t* addr,uint32_t* mtu,uint64_t* expire){
+	uint32_t seq;
+	int eq;
+	
+	do{
+		seq = odp_atomic_load_acq_u32(&(e->seq));
+		
+		if(odp_unlikely(seq&1)) return -1;
+		
+		eq      = IP6ADDR_EQ(e->addr,*addr);
+		*mtu    = e->mtu;
+		*expire = e->expire;
+		odp_mb_acquire();
+	}while(odp_unlikely(odp_atomic_load_u32(&(e->seq))!=seq));
+	return eq;
+}
+
+static
+uint32_t lookup(const ipv6_addr_t* addr){
+	pmtu_bucket_t* b;
+	uint64_t expire;
+	uint32_t mtu;
+	int i;
+	
+	if(odp_unlikely(table==NULL)) return 0;
+	b = get_bucket(addr);
+	for(i=0;i<PMTU_WAYS;++i){
+		/* Being written: A miss. */
+		if(entry_read(&(b->way[i]),addr,&mtu,&expire)<=0) continue;
+		if(mtu && expire>now_ns()) return mtu;
+		return 0;
+	}
+	return 0;
+}
+
+static
+void update(const ipv6_addr_t* addr,uint32_t mtu){
+	pmtu_bucket_t* b;
+	pmtu_entry_t* e;
+	pmtu_entry_t* victim = NULL;
+	uint64_t now,expire,victim_expire = ~0ULL;
+	uint32_t seq,old;
+	int i,r;
+	
+	if(odp_unlikely(table==NULL)) return;
+	b = get_bucket(addr);
+	now = now_ns();
+	
+	/*
+	 * The entry of the address, otherwise an unused or expired one, otherwise the one,
+	 * that expires first.
+	 */
+	for(i=0;i<PMTU_WAYS;++i){
+		e = &(b->way[i]);
+		r = entry_read(e,addr,&old,&expire);
+		
+		/* Being written: Not a candidate. */
+		if(odp_unlikely(r<0)) continue;
+		if(r){
+			/* Never raise the path MTU. */
+			if(old && old<=mtu && expire>now) return;
+			victim = e;
+			break;
+		}
+		if(!old || expire<=now) expire = 0;
+		if(expire<victim_expire){
+			victim = e;
+			victim_expire = expire;
+		}
+	}
+	
+	if(odp_unlikely(victim==NULL)) return;
+	
+	seq = odp_atomic_load_u32(&(victim->seq));
+	if(odp_unlikely(seq&1)) return;
+	if(odp_unlikely(!odp_atomic_cas_u32(&(victim->seq),&seq,seq+1))) return;
+	odp_mb_full();
+	
+	victim->addr   = *addr;
+	victim->mtu    = mtu;
+	victim->expire = now+((uint64_t)fastnet_conf.pmtu_expire)*NS_PER_SEC;
+	
+	odp_atomic_store_rel_u32(&(victim->seq),seq+2);
+	FASTNET_STAT_INC(pmtu_updates);
+}
+
+uint32_t fastnet_pmtu_lookup4(ipv4_addr_t dst){
+	ipv6_addr_t addr;
+	map4(&addr,dst);
+	return lookup(&addr);
+}
+
+uint32_t fastnet_pmtu_lookup6(const ipv6_addr_t* dst){
+	return lookup(dst);
+}
+
+void fastnet_pmtu_update4(ipv4_addr_t dst,uint32_t mtu){
+	ipv6_addr_t addr;
+	if(mtu<FASTNET_PMTU_MIN4) mtu = FASTNET_PMTU_MIN4;
+	map4(&addr,dst);
+	update(&addr,mtu);
+}
+
+void fastnet_pmtu_update6(const ipv6_addr_t* dst,uint32_t mtu){
+	/* RFC 8201 4: A node MUST NOT reduce its estimate of the Path MTU below the IPv6 minimum link MTU. */
+	if(mtu<IP6_DEFAULT_MTU) mtu = IP6_DEFAULT_MTU;
+	update(dst,mtu);
+}
+
+uint32_t fastnet_link_mtu4(nif_t* nif){
+	if(nif && nif->ipv4 && nif->ipv4->mtu) return nif->ipv4->mtu;
+	return FASTNET_PMTU_DEFAULT4;
+}
+
+uint32_t fastnet_link_mtu6(nif_t* nif){
+	if(nif && nif->ipv6 && nif->ipv6->mtu) return nif->ipv6->mtu;
+	return FASTNET_PMTU_DEFAULT6;
+}
+
+uint32_t fastnet_pmtu4(nif_t* nif,ipv4_addr_t dst){
+	uint32_t link,mtu;
+	
+	link = fastnet_link_mtu4(nif);
+	mtu = fastnet_pmtu_lookup4(dst);
+	return (mtu && mtu<link) ? mtu : link;
+}
+
+uint32_t fastnet_pmtu6(nif_t* nif,const ipv6_addr_t* dst){
+	uint32_t link,mtu;
+	
+	link = fastnet_link_mtu6(nif);
+	if(nif && nif->ipv6 && !nif->ipv6->pmtu_on) return link;
+	mtu = fastnet_pmtu_lookup6(dst);
+	return (mtu && mtu<link) ? mtu : link;
+}
@@ -0,0 +1,155 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <net/prof.h>
+
+#ifdef NET_PROF
+
+fastnet_prof_block_t fastnet_prof_blocks[FASTNET_THREAD_SLOTS];
+
+static const char* stage_names[FASTNET_PROF_NUM_STAGES] = {
+	"ip_input",
+	"ip6_input",
+	"arp_input",
+	"flowdir_input",
+	"checksum",
+	"tcp_input",
+	"udp_input",
+	"icmp_input",
+	"l4_other",
+	"flowdir_steer",
+	"socket_lookup",
+	"tcp_process",
+	"ip_output",
+	"ip6_output",
+	"neigh_lookup",
+	"queue_enq",
+};
+
+/*
+ * Open addressing, linear probing. If the table is full, the stack is not recorded.
+ */
+static fastnet_prof_folded_t* fold_find(fastnet_prof_folded_t* table,uint32_t size,uint64_t stack){
+	uint32_t i,n,mod = size-1;
+	i = (uint32_t)((stack*0x9e3779b97f4a7c15ULL)>>32);
+	for(n=0;n<size;++n,++i){
+		if(table[i&mod].stack==stack) return &table[i&mod];
+		if(table[i&mod].stack==0){
+			table[i&mod].stack = stack;
+			return &table[i&mod];
+		}
+	}
+	return NULL;
+}
+
+void fastnet_prof_account(fastnet_prof_block_t* b,uint64_t stack,uint32_t stage,uint64_t cycles,uint64_t self){
+	fastnet_prof_folded_t* fold;
+	
+	b->count[stage]++;
+	b->sum[stage] += cycles;
+	if(b->max[stage]<cycles) b->max[stage] = cycles;
+	b->hist[stage][fastnet_hist_bucket(cycles)]++;
+	
+	fold = fold_find(b->folded,FASTNET_PROF_FOLDED,stack);
+	if(odp_likely(fold!=NULL)){
+		fold->cycles += self;
+		fold->count++;
+	}
+}
+
+/*
+ * The counters are read, while the workers keep on counting, so the output is not a
+ * consistent snapshot.
+ */
+void fastnet_prof_print(FILE* f){
+	uint64_t* hist;
+	uint64_t count,sum,max;
+	int s,w,i;
+	
+	hist = malloc(sizeof(uint64_t)*FASTNET_HIST_BUCKETS);
+	if(!hist) return;
+	
+	fprintf(f,"%-16s %12s %8s %8s %8s %8s %8s %10s\n","stage","count","mean","p50","p90","p99","p99.9","max");
+	for(s=0;s<FASTNET_PROF_NUM_STAGES;++s){
+		memset(hist,0,sizeof(uint64_t)*FASTNET_HIST_BUCKETS);
+		count = sum = max = 0;
+		for(w=0;w<FASTNET_THREAD_SLOTS;++w){
+			count += fastnet_prof_blocks[w].count[s];
+			sum   += fastnet_prof_blocks[w].sum[s];
+			if(max<fastnet_prof_blocks[w].max[s]) max = fastnet_prof_blocks[w].max[s];
+			for(i=0;i<FASTNET_HIST_BUCKETS;++i)
+				hist[i] += fastnet_prof_blocks[w].hist[s][i];
+		}
+		if(!count) continue;
+		fprintf(f,"%-16s %12llu %8llu %8llu %8llu %8llu %8llu %10llu\n",stage_names[s],
+			(unsigned long long)count,
+			(unsigned long long)(sum/count),
+			(unsigned long long)fastnet_hist_percentile(hist,count,0.5),
+			(unsigned long long)fastnet_hist_percentile(hist,count,0.9),
+			(unsigned long long)fastnet_hist_percentile(hist,count,0.99),
+			(unsigned long long)fastnet_hist_percentile(hist,count,0.999),
+			(unsigned long long)max);
+	}
+	free(hist);
+}
+
+static void print_stack(FILE* f,uint64_t stack){
+	uint32_t stage;
+	if(!stack) return;
+	stage = (stack&((1<<FASTNET_PROF_STAGE_BITS)-1))-1;
+	if(stack>>FASTNET_PROF_STAGE_BITS){
+		print_stack(f,stack>>FASTNET_PROF_STAGE_BITS);
+		fputc(';',f);
+	}
+	fputs(stage<FASTNET_PROF_NUM_STAGES ? stage_names[stage] : "?",f);
+}
+
+void fastnet_prof_folded(FILE* f){
+	fastnet_prof_folded_t* total;
+	fastnet_prof_folded_t* src;
+	fastnet_prof_folded_t* dst;
+	uint32_t size = FASTNET_PROF_FOLDED*4;
+	uint32_t i;
+	int w;
+	
+	total = calloc(sizeof(fastnet_prof_folded_t),size);
+	if(!total) return;
+	
+	for(w=0;w<FASTNET_THREAD_SLOTS;++w){
+		for(i=0;i<FASTNET_PROF_FOLDED;++i){
+			src = &(fastnet_prof_blocks[w].folded[i]);
+			if(!src->stack) continue;
+			dst = fold_find(total,size,src->stack);
+			if(!dst) continue;
+			dst->cycles += src->cycles;
+			dst->count  += src->count;
+		}
+	}
+	for(i=0;i<size;++i){
+		if(!total[i].stack) continue;
+		print_stack(f,total[i].stack);
+		fprintf(f," %llu\n",(unsigned long long)total[i].cycles);
+	}
+	free(total);
+}
+
+#else
+
+void fastnet_prof_print(FILE* f){ (void)f; }
+void fastnet_prof_folded(FILE* f){ (void)f; }
+
+#endif
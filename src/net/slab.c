@@ -0,0 +1,222 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdio.h>
+#include <net/slab.h>
+#include <net/numa.h>
+#include <net/lockprof.h>
+
+__thread fastnet_magazine_t fastnet_magazines[FASTNET_SLAB_MAX];
+
+/* Slabs are initialized at startup, by one thread. */
+static int next_id = 0;
+static fastnet_slab_t* slabs[FASTNET_SLAB_MAX];
+
+/*
+ * Creates a chunk. The memory is placed onto the calling thread's NUMA node by first-touch.
+ * Must be called with slab->lock held, or during initialization.
+ */
+static int add_chunk(fastnet_slab_t* slab,int node){
+	odp_pool_param_t p;
+	char pname[ODP_POOL_NAME_LEN];
+	uint32_t i;
+	
+	if(odp_atomic_load_u32(&(slab->nchunks))>=slab->max_chunks) return -1;
+	
+	for(i=0;i<FASTNET_SLAB_MAX_CHUNKS;++i)
+		if(slab->chunks[i].pool==ODP_POOL_INVALID) break;
+	if(i>=FASTNET_SLAB_MAX_CHUNKS) return -1;
+	
+	p = slab->params;
+	if(p.type==ODP_POOL_PACKET) p.pkt.num = slab->chunk_num;
+	else                        p.buf.num = slab->chunk_num;
+	
+	snprintf(pname,sizeof pname,"%s.%u",slab->name,slab->seq++);
+	slab->chunks[i].pool = odp_pool_create(pname,&p);
+	if(slab->chunks[i].pool==ODP_POOL_INVALID) return -1;
+	
+	odp_atomic_init_u32(&(slab->chunks[i].used),0);
+	slab->chunks[i].capacity = slab->chunk_num;
+	slab->chunks[i].node     = node;
+	odp_atomic_inc_u32(&(slab->nchunks));
+	return (int)i;
+}
+
+int fastnet_slab_init(fastnet_slab_t* slab,const char* name,odp_pool_param_t* params,uint32_t chunk_num,uint32_t limit){
+	uint32_t i;
+	int node,nodes,chunk;
+	
+	slab->id = next_id++;
+	if(slab->id>=FASTNET_SLAB_MAX) return 0;
+	slabs[slab->id] = slab;
+	
+	if(!chunk_num) chunk_num = 1;
+	if(limit<chunk_num) limit = chunk_num;
+	
+	/* If the limit can't be reached with FASTNET_SLAB_MAX_CHUNKS chunks, make the chunks bigger. */
+	if(((limit+chunk_num-1)/chunk_num)>FASTNET_SLAB_MAX_CHUNKS)
+		chunk_num = (limit+FASTNET_SLAB_MAX_CHUNKS-1)/FASTNET_SLAB_MAX_CHUNKS;
+	
+	slab->name       = name;
+	slab->params     = *params;
+	slab->chunk_num  = chunk_num;
+	slab->max_chunks = (limit+chunk_num-1)/chunk_num;
+	slab->seq        = 0;
+	odp_spinlock_init(&(slab->lock));
+	odp_atomic_init_u32(&(slab->nchunks),0);
+	for(i=0;i<FASTNET_SLAB_MAX_CHUNKS;++i)
+		slab->chunks[i].pool = ODP_POOL_INVALID;
+	
+	/* One initial chunk per NUMA node. */
+	nodes = fastnet_numa_num_nodes();
+	for(node=0;node<nodes;++node){
+		fastnet_numa_enter(node);
+		chunk = add_chunk(slab,node);
+		fastnet_numa_leave();
+		if(chunk<0 && node==0) return 0;
+	}
+	return 1;
+}
+
+/*
+ * Allocates up to 'num' elements from a chunk into the magazine.
+ */
+static int chunk_alloc(fastnet_slab_t* slab,fastnet_slab_chunk_t* chunk,fastnet_magazine_t* mag,int num){
+	union {
+		odp_buffer_t buf[FASTNET_MAG_BATCH];
+		odp_packet_t pkt[FASTNET_MAG_BATCH];
+	} tmp;
+	int i,n;
+	
+	if(slab->params.type==ODP_POOL_PACKET){
+		n = odp_packet_alloc_multi(chunk->pool,slab->params.pkt.len,tmp.pkt,num);
+		for(i=0;i<n;++i) mag->items[mag->num++] = odp_packet_to_event(tmp.pkt[i]);
+	}else{
+		n = odp_buffer_alloc_multi(chunk->pool,tmp.buf,num);
+		for(i=0;i<n;++i) mag->items[mag->num++] = odp_buffer_to_event(tmp.buf[i]);
+	}
+	if(n<1) return 0;
+	odp_atomic_add_u32(&(chunk->used),n);
+	return n;
+}
+
+odp_event_t fastnet_slab_refill(fastnet_slab_t* slab){
+	fastnet_magazine_t* mag = &fastnet_magazines[slab->id];
+	fastnet_slab_chunk_t* chunk;
+	int i,pass,n = 0,node;
+	
+	node = fastnet_numa_node();
+	
+	FASTNET_SPIN_LOCK(FASTNET_LOCK_SLAB,&(slab->lock));
+	
+	/* Local chunks first, then the remote ones. */
+	for(pass=0;pass<2 && !n;++pass){
+		for(i=0;i<FASTNET_SLAB_MAX_CHUNKS && !n;++i){
+			chunk = &(slab->chunks[i]);
+			if(chunk->pool==ODP_POOL_INVALID) continue;
+			if((chunk->node==node)!=(pass==0)) continue;
+			n = chunk_alloc(slab,chunk,mag,FASTNET_MAG_BATCH);
+		}
+		if(n) fastnet_numa_count(pass ? 0 : n,pass ? n : 0);
+	}
+	
+	/* All chunks are exhausted: grow. */
+	if(!n){
+		i = add_chunk(slab,node);
+		if(i>=0){
+			n = chunk_alloc(slab,&(slab->chunks[i]),mag,FASTNET_MAG_BATCH);
+			fastnet_numa_count(n,0);
+		}
+	}
+	
+	FASTNET_SPIN_UNLOCK(FASTNET_LOCK_SLAB,&(slab->lock));
+	
+	if(odp_unlikely(!mag->num)) return ODP_EVENT_INVALID;
+	return mag->items[--(mag->num)];
+}
+
+/*
+ * Destroys an empty chunk, if the other chunks have at least half a chunk of free elements.
+ * Otherwise, the chunk would likely be recreated soon.
+ */
+static void reclaim(fastnet_slab_t* slab,int idx){
+	fastnet_slab_chunk_t* chunk = &(slab->chunks[idx]);
+	uint64_t spare = 0;
+	int i;
+	
+	FASTNET_SPIN_LOCK(FASTNET_LOCK_SLAB,&(slab->lock));
+	if(chunk->pool==ODP_POOL_INVALID) goto done;
+	if(odp_atomic_load_u32(&(chunk->used))) goto done;
+	if(odp_atomic_load_u32(&(slab->nchunks))<2) goto done;
+	
+	for(i=0;i<FASTNET_SLAB_MAX_CHUNKS;++i){
+		if(i==idx || slab->chunks[i].pool==ODP_POOL_INVALID) continue;
+		spare += slab->chunks[i].capacity-odp_atomic_load_u32(&(slab->chunks[i].used));
+	}
+	if(spare<(slab->chunk_num/2)) goto done;
+	
+	if(odp_pool_destroy(chunk->pool)==0){
+		chunk->pool = ODP_POOL_INVALID;
+		odp_atomic_dec_u32(&(slab->nchunks));
+	}
+done:
+	FASTNET_SPIN_UNLOCK(FASTNET_LOCK_SLAB,&(slab->lock));
+}
+
+void fastnet_slab_flush(fastnet_slab_t* slab,uint32_t keep){
+	fastnet_magazine_t* mag = &fastnet_magazines[slab->id];
+	odp_event_t ev;
+	odp_pool_t pool;
+	int i,empty = -1;
+	
+	while(mag->num>keep){
+		ev = mag->items[--(mag->num)];
+		if(slab->params.type==ODP_POOL_PACKET){
+			pool = odp_packet_pool(odp_packet_from_event(ev));
+			odp_packet_free(odp_packet_from_event(ev));
+		}else{
+			pool = odp_buffer_pool(odp_buffer_from_event(ev));
+			odp_buffer_free(odp_buffer_from_event(ev));
+		}
+		for(i=0;i<FASTNET_SLAB_MAX_CHUNKS;++i){
+			if(slab->chunks[i].pool!=pool) continue;
+			if(odp_atomic_fetch_dec_u32(&(slab->chunks[i].used))==1) empty = i;
+			break;
+		}
+	}
+	
+	/* Watermark-based reclaim: only on flush, never on the allocation path. */
+	if(odp_unlikely(empty>=0)) reclaim(slab,empty);
+}
+
+void fastnet_slab_flush_all_thread(){
+	int i;
+	for(i=0;i<FASTNET_SLAB_MAX;++i)
+		if(slabs[i] && fastnet_magazines[i].num) fastnet_slab_flush(slabs[i],0);
+}
+
+void fastnet_slab_stats(fastnet_slab_t* slab,uint32_t* chunks,uint64_t* capacity,uint64_t* used){
+	uint64_t c = 0,u = 0;
+	int i;
+	for(i=0;i<FASTNET_SLAB_MAX_CHUNKS;++i){
+		if(slab->chunks[i].pool==ODP_POOL_INVALID) continue;
+		c += slab->chunks[i].capacity;
+		u += odp_atomic_load_u32(&(slab->chunks[i].used));
+	}
+	*chunks   = odp_atomic_load_u32(&(slab->nchunks));
+	*capacity = c;
+	*used     = u;
+}
+
@@ -17,66 +17,67 @@
 #include <net/header/iphdr.h>
 #include <net/header/ip6hdr.h>
 #include <net/safe_packet.h>
+#include <net/requirement.h>
+#include <net/header/layer4.h>
 
 typedef struct ODP_PACKED {
 	uint16_t src;
 	uint16_t dst;
 } PORTS_T;
 
-/*
- * Obtains the IP-level fields of the socket key.
- *
- * The fields src_port, dst_port and layer4_version are left to be filled by the callee.
- */
-netpp_retcode_t fastnet_socket_key_obtain_ip(odp_packet_t pkt, socket_key_t *key){
+static inline
+netpp_retcode_t key_obtain_ip(odp_packet_t pkt, socket_key_t *key){
 	fnet_ip_header_t*  ip;
 	fnet_ip6_header_t* ip6;
+	nif_t* nif;
 	
-	key->nif = odp_packet_user_ptr(pkt);
+	nif = odp_packet_user_ptr(pkt);
+	key->ifindex = nif ? nif->ifindex : SOCKET_KEY_NO_IFINDEX;
 	
+	/* The key type is selected here, once per packet. */
 	if(odp_packet_has_ipv4(pkt)){
 		ip = fastnet_safe_l3(pkt,sizeof(fnet_ip_header_t));
 		if(odp_unlikely(ip==NULL)) return NETPP_DROP;
-		key->src_ip = (ipv6_addr_t){.addr32 = {0,0,0,ip->source_addr}};
-		key->dst_ip = (ipv6_addr_t){.addr32 = {0,0,0,ip->destination_addr}};
+		key->v4.src_ip = ip->source_addr;
+		key->v4.dst_ip = ip->destination_addr;
 		key->layer3_version = 0x44;
 	}else{
 		ip6 = fastnet_safe_l3(pkt,sizeof(fnet_ip6_header_t));
 		if(odp_unlikely(ip6==NULL)) return NETPP_DROP;
-		key->src_ip = ip6->source_addr;
-		key->dst_ip = ip6->destination_addr;
+		key->v6.src_ip = ip6->source_addr;
+		key->v6.dst_ip = ip6->destination_addr;
 		key->layer3_version = 0x66;
 	}
 	
 	return NETPP_CONTINUE;
 }
 
+/*
+ * Obtains the IP-level fields of the socket key.
+ *
+ * The fields src_port, dst_port and layer4_version are left to be filled by the callee.
+ */
+netpp_retcode_t fastnet_socket_key_obtain_ip(odp_packet_t pkt, socket_key_t *key){
+	return key_obtain_ip(pkt,key);
+}
+
 /*
  * Obtains the IP-level fields of the socket key, and the ports.
  *
  * The field layer4_version is left to be filled by the callee.
  */
 netpp_retcode_t fastnet_socket_key_obtain(odp_packet_t pkt, socket_key_t *key){
-	fnet_ip_header_t*  ip;
-	fnet_ip6_header_t* ip6;
 	PORTS_T ports;
+	PORTS_T* pp;
+	uint32_t seglen;
 	
-	key->nif = odp_packet_user_ptr(pkt);
+	if(odp_unlikely(key_obtain_ip(pkt,key)!=NETPP_CONTINUE)) return NETPP_DROP;
 	
-	if(odp_packet_has_ipv4(pkt)){
-		ip = fastnet_safe_l3(pkt,sizeof(fnet_ip_header_t));
-		if(odp_unlikely(ip==NULL)) return NETPP_DROP;
-		key->src_ip = (ipv6_addr_t){.addr32 = {0,0,0,ip->source_addr}};
-		key->dst_ip = (ipv6_addr_t){.addr32 = {0,0,0,ip->destination_addr}};
-		key->layer3_version = 0x44;
-	}else{
-		ip6 = fastnet_safe_l3(pkt,sizeof(fnet_ip6_header_t));
-		if(odp_unlikely(ip6==NULL)) return NETPP_DROP;
-		key->src_ip = ip6->source_addr;
-		key->dst_ip = ip6->destination_addr;
-		key->layer3_version = 0x66;
-	}
-	if(odp_packet_copy_to_mem(pkt,odp_packet_l4_offset(pkt),sizeof(ports),&ports)) {
+	/* The ports are almost always in the first segment. */
+	pp = odp_packet_l4_ptr(pkt,&seglen);
+	if(odp_likely(pp!=NULL && seglen>=sizeof(ports))) {
+		ports = *pp;
+	}else if(odp_packet_copy_to_mem(pkt,odp_packet_l4_offset(pkt),sizeof(ports),&ports)) {
 		ports = (PORTS_T){0,0};
 	}
 	key->src_port = ports.src;
@@ -85,15 +86,71 @@ netpp_retcode_t fastnet_socket_key_obtain(odp_packet_t pkt, socket_key_t *key){
 	return NETPP_CONTINUE;
 }
 
-int fastnet_socket_key_eq(socket_key_t *a,socket_key_t *b){
-	return
-		IP6ADDR_EQ(a->src_ip,b->src_ip) &&
-		IP6ADDR_EQ(a->dst_ip,b->dst_ip) &&
-		(a->src_port == b->src_port) &&
-		(a->dst_port == b->dst_port) &&
-		(a->nif == b->nif) &&
-		(a->layer3_version == b->layer3_version) &&
-		(a->layer4_version == b->layer4_version);
+netpp_retcode_t fastnet_socket_key_obtain_hash(odp_packet_t pkt, socket_key_t *key, uint8_t layer4_version, uint32_t *hash){
+	fastnet_pkt_uarea_t* ua = FASTNET_PACKET_UAREA(pkt);
+	
+	if(odp_likely((ua->flags & FASTNET_PKTF_KEY) && ua->key.layer4_version==layer4_version)){
+		*key  = ua->key;
+		*hash = ua->key_hash;
+		return NETPP_CONTINUE;
+	}
+	
+	if(odp_unlikely(fastnet_socket_key_obtain(pkt,key)!=NETPP_CONTINUE)) return NETPP_DROP;
+	key->layer4_version = layer4_version;
+	*hash = fastnet_socket_key_hash(key);
+	return NETPP_CONTINUE;
+}
+
+/*
+ * Reads the ports into the user area's key, and finishes it.
+ *
+ * If the ports are not in the first segment, the key is left invalid, and the transport
+ * layer falls back to fastnet_socket_key_obtain().
+ */
+static inline
+void key_parse_finish(odp_packet_t pkt, fastnet_pkt_uarea_t* ua, uint8_t proto){
+	PORTS_T* pp;
+	uint32_t seglen;
+	nif_t* nif;
+	
+	pp = odp_packet_l4_ptr(pkt,&seglen);
+	if(odp_unlikely(pp==NULL || seglen<sizeof(PORTS_T))) return;
+	
+	nif = odp_packet_user_ptr(pkt);
+	ua->key.ifindex        = nif ? nif->ifindex : SOCKET_KEY_NO_IFINDEX;
+	ua->key.layer4_version = proto;
+	ua->key.src_port       = pp->src;
+	ua->key.dst_port       = pp->dst;
+	ua->key_hash           = fastnet_socket_key_hash(&(ua->key));
+	ua->flags |= FASTNET_PKTF_KEY;
+}
+
+void fastnet_socket_key_parse4(odp_packet_t pkt, fnet_ip_header_t *ip, uint8_t proto){
+	fastnet_pkt_uarea_t* ua;
+	
+	/* Only TCP looks the key up (fastnet_socket_key_obtain_hash()); UDP has no sockets yet. */
+	if(proto!=IP_PROTOCOL_TCP) return;
+	
+	/* Fragments (other than the first one) carry no ports. */
+	if(odp_unlikely(odp_be_to_cpu_16(ip->flags_fragment_offset) & ~FNET_IP_DF)) return;
+	
+	ua = FASTNET_PACKET_UAREA(pkt);
+	ua->key.v4.src_ip      = ip->source_addr;
+	ua->key.v4.dst_ip      = ip->destination_addr;
+	ua->key.layer3_version = 0x44;
+	key_parse_finish(pkt,ua,proto);
 }
 
+void fastnet_socket_key_parse6(odp_packet_t pkt, fnet_ip6_header_t *ip6, uint8_t proto){
+	fastnet_pkt_uarea_t* ua;
+	
+	/* Extension headers are not parsed here: The transport layer falls back. */
+	if(proto!=IP_PROTOCOL_TCP) return;
+	
+	ua = FASTNET_PACKET_UAREA(pkt);
+	ua->key.v6.src_ip      = ip6->source_addr;
+	ua->key.v6.dst_ip      = ip6->destination_addr;
+	ua->key.layer3_version = 0x66;
+	key_parse_finish(pkt,ua,proto);
+}
 
@@ -15,32 +15,46 @@
  */
 #include <net/socket_key.h>
 #include <net/std_lib.h>
-#include <net/fnv1a.h>
+#include <net/conf.h>
+#include <net/lockprof.h>
 
-/* Must be power of 2 */
+/* Must be power of 2, the number of buckets is configured at runtime (fastnet_conf.socket_buckets). */
 
-#define HASHTAB_SZ           0x4000
-#define HASHTAB_SZ_MOD(x)    x&0x3fff
+#define HASHTAB_SZ_MOD(x)    ((x)&hashtab_mask)
 
 #define HASHTAB_LOCKS        0x1000
 #define HASHTAB_LOCKS_MOD(x) x&0xfff
 
-static odp_shm_t  hashtab;
+static uint32_t   hashtab_mask;
 
 typedef struct {
-	fastnet_socket_t   entries[HASHTAB_SZ];
 	odp_spinlock_t     locks[HASHTAB_LOCKS];
+	fastnet_socket_t   entries[];
 } socket_table_t;
 
-void fastnet_socket_init() {
-	int i;
-	hashtab = odp_shm_reserve("socket_table",sizeof(socket_table_t),8,0);
-	if(hashtab==ODP_SHM_INVALID) fastnet_abort();
-	socket_table_t* h = odp_shm_addr(hashtab);
-	for(i=0;i<HASHTAB_SZ;++i)
+/* IPv4 sockets, and IPv6 (and IN_ANY) sockets. */
+static socket_table_t* table4;
+static socket_table_t* table6;
+
+static socket_table_t* table_create(const char* name,uint32_t n){
+	uint32_t i;
+	socket_table_t* h;
+	odp_shm_t shm = odp_shm_reserve(name,sizeof(socket_table_t)+(n*sizeof(fastnet_socket_t)),8,0);
+	if(shm==ODP_SHM_INVALID) fastnet_abort();
+	h = odp_shm_addr(shm);
+	for(i=0;i<n;++i)
 		h->entries[i] = ODP_BUFFER_INVALID;
 	for(i=0;i<HASHTAB_LOCKS;++i)
 		odp_spinlock_init(&(h->locks[i]));
+	return h;
+}
+
+void fastnet_socket_init() {
+	uint32_t n;
+	n = fastnet_conf.socket_buckets;
+	hashtab_mask = n-1;
+	table4 = table_create("socket_table4",n);
+	table6 = table_create("socket_table6",n);
 }
 
 void fastnet_socket_put(fastnet_socket_t sock) {
@@ -53,7 +67,8 @@ void fastnet_socket_put(fastnet_socket_t sock) {
 	 */
 	if(odp_unlikely(odp_atomic_fetch_dec_u32(&(sockinst->refc))==1)) {
 		sockinst->finalizer(sock);
-		odp_buffer_free(sock);
+		if(sockinst->slab) fastnet_slab_buffer_free(sockinst->slab,sock);
+		else               odp_buffer_free(sock);
 	}
 }
 
@@ -64,10 +79,7 @@ void fastnet_socket_grab(fastnet_socket_t sock) {
 	odp_atomic_inc_u32(&(sockinst->refc));
 }
 
-static
-uint32_t ht_hash(socket_key_t *key){
-	return fastnet_fnv1a(fastnet_fnv1a_init(),(uint8_t*)key,sizeof(socket_key_t));
-}
+#define ht_hash fastnet_socket_key_hash
 
 static
 void fastnet_socket_finalizer_def(fastnet_socket_t sock){}
@@ -85,24 +97,30 @@ void fastnet_socket_construct(fastnet_socket_t sock,fastnet_socket_finalizer_t f
 		sockinst->finalizer = fastnet_socket_finalizer_def;
 }
 
-static
-fastnet_socket_t ht_lookup(socket_key_t *key,uint32_t hash){
+/*
+ * 'is4' is a constant in every caller, so the key comparison is specialized.
+ */
+static inline
+fastnet_socket_t ht_lookup(socket_table_t* h,socket_key_t *key,uint32_t hash,int grab,int is4){
 	fastnet_socket_t sock;
 	fastnet_sockstruct_t* sockinst;
 	uint32_t lock  = HASHTAB_LOCKS_MOD(hash);
 	uint32_t index = HASHTAB_SZ_MOD(hash);
+	int eq;
 	
-	socket_table_t* h = odp_shm_addr(hashtab);
-	odp_spinlock_lock(&(h->locks[lock]));
+	FASTNET_SPIN_LOCK(FASTNET_LOCK_SOCKET_TABLE,&(h->locks[lock]));
 	
 	sock = h->entries[index];
 	
 	while(sock!=ODP_BUFFER_INVALID){
 		sockinst = odp_buffer_addr(sock);
 		if(sockinst->hash==hash){
+			if(is4) eq = fastnet_socket_key4_eq(&(key->v4),&(sockinst->key.v4));
+			else    eq = fastnet_socket_key6_eq(&(key->v6),&(sockinst->key.v6));
+			
 			/* We found the socket. */
-			if(odp_likely(fastnet_socket_key_eq(key,&(sockinst->key) ))){
-				odp_atomic_inc_u32(&(sockinst->refc));
+			if(odp_likely(eq)){
+				if(grab) odp_atomic_inc_u32(&(sockinst->refc));
 				
 				/* True: sock != ODP_BUFFER_INVALID */
 				break;
@@ -111,25 +129,32 @@ fastnet_socket_t ht_lookup(socket_key_t *key,uint32_t hash){
 		sock = sockinst->next_ht;
 	}
 	/*
-	 * Lemma:
+	 * Lemma (if grab is true):
 	 *  IF( sock != ODP_BUFFER_INVALID ) THEN   odp_atomic_inc_u32()  was called.
 	 *  IF( sock == ODP_BUFFER_INVALID ) THEN   odp_atomic_inc_u32()  was not called.
 	 */
 	
-	odp_spinlock_unlock(&(h->locks[lock]));
+	FASTNET_SPIN_UNLOCK(FASTNET_LOCK_SOCKET_TABLE,&(h->locks[lock]));
 	return sock;
 }
 
+static inline
+socket_table_t* ht_table(fastnet_sockstruct_t* sockinst){
+	return fastnet_socket_key_is4(&(sockinst->key)) ? table4 : table6;
+}
+
 static
 fastnet_socket_t ht_insert(fastnet_socket_t sock,uint32_t hash){
 	fastnet_sockstruct_t* sockinst;
 	uint32_t lock  = HASHTAB_LOCKS_MOD(hash);
 	uint32_t index = HASHTAB_SZ_MOD(hash);
 	
-	socket_table_t* h = odp_shm_addr(hashtab);
-	odp_spinlock_lock(&(h->locks[lock]));
+	socket_table_t* h;
 	
 	sockinst = odp_buffer_addr(sock);
+	h = ht_table(sockinst);
+	FASTNET_SPIN_LOCK(FASTNET_LOCK_SOCKET_TABLE,&(h->locks[lock]));
+	
 	if(!sockinst->is_ht) {
 		sockinst->next_ht = h->entries[index];
 		h->entries[index] = sock;
@@ -137,7 +162,7 @@ fastnet_socket_t ht_insert(fastnet_socket_t sock,uint32_t hash){
 		sockinst->is_ht = 0xffffff;
 	}
 	
-	odp_spinlock_unlock(&(h->locks[lock]));
+	FASTNET_SPIN_UNLOCK(FASTNET_LOCK_SOCKET_TABLE,&(h->locks[lock]));
 	return sock;
 }
 
@@ -148,10 +173,12 @@ fastnet_socket_t ht_remove(fastnet_socket_t sock,uint32_t hash){
 	uint32_t lock  = HASHTAB_LOCKS_MOD(hash);
 	uint32_t index = HASHTAB_SZ_MOD(hash);
 	
-	socket_table_t* h = odp_shm_addr(hashtab);
-	odp_spinlock_lock(&(h->locks[lock]));
+	socket_table_t* h;
 	
 	sockinst = odp_buffer_addr(sock);
+	h = ht_table(sockinst);
+	FASTNET_SPIN_LOCK(FASTNET_LOCK_SOCKET_TABLE,&(h->locks[lock]));
+	
 	if(sockinst->is_ht) {
 	
 		elemptr = &(h->entries[index]);
@@ -168,32 +195,81 @@ fastnet_socket_t ht_remove(fastnet_socket_t sock,uint32_t hash){
 		sockinst->is_ht = 0;
 	}
 	
-	odp_spinlock_unlock(&(h->locks[lock]));
+	FASTNET_SPIN_UNLOCK(FASTNET_LOCK_SOCKET_TABLE,&(h->locks[lock]));
 	return sock;
 }
 
-fastnet_socket_t fastnet_socket_lookup(socket_key_t *key) {
+/*
+ * IN_ANY: Listening on any address, of both versions. Such sockets are in the IPv6 table.
+ */
+static inline
+fastnet_socket_t socket_lookup_any(socket_key_t *key,int grab) {
+	socket_key_t any_key;
+	
+	any_key.v6 = (socket_key6_t){ .w = {0,0,0,0,0} };
+	any_key.layer4_version = key->layer4_version;
+	any_key.ifindex        = key->ifindex;
+	any_key.dst_port       = key->dst_port;
+	
+	return ht_lookup(table6,&any_key,fastnet_socket_key6_hash(&(any_key.v6)),grab,0);
+}
+
+static
+fastnet_socket_t socket_lookup4(socket_key_t *key,uint32_t hash,int grab) {
 	fastnet_socket_t   sock;
 	socket_key_t       listen_key;
 	
-	sock = ht_lookup(key,ht_hash(key));
+	sock = ht_lookup(table4,key,hash,grab,1);
 	if(sock!=ODP_BUFFER_INVALID) return sock;
 	
 	/* Listening Socket. (no source address) */
-	listen_key = *key;
-	listen_key.src_ip = (ipv6_addr_t){.addr32={0,0,0,0}};
+	listen_key.v4 = key->v4;
+	listen_key.v4.src_ip = 0;
 	listen_key.src_port = 0;
 	listen_key.layer3_version &= 0xF;
 	
-	sock = ht_lookup(&listen_key,ht_hash(&listen_key));
+	sock = ht_lookup(table4,&listen_key,fastnet_socket_key4_hash(&(listen_key.v4)),grab,1);
 	if(sock!=ODP_BUFFER_INVALID) return sock;
 	
-	/* IN_ANY */
-	listen_key.dst_ip = (ipv6_addr_t){.addr32={0,0,0,0}};
-	listen_key.layer3_version = 0;
+	return socket_lookup_any(key,grab);
+}
+
+static
+fastnet_socket_t socket_lookup6(socket_key_t *key,uint32_t hash,int grab) {
+	fastnet_socket_t   sock;
+	socket_key_t       listen_key;
 	
-	sock = ht_lookup(&listen_key,ht_hash(&listen_key));
-	return sock;
+	sock = ht_lookup(table6,key,hash,grab,0);
+	if(sock!=ODP_BUFFER_INVALID) return sock;
+	
+	/* Listening Socket. (no source address) */
+	listen_key.v6 = key->v6;
+	listen_key.v6.src_ip = (ipv6_addr_t){.addr32={0,0,0,0}};
+	listen_key.src_port = 0;
+	listen_key.layer3_version &= 0xF;
+	
+	sock = ht_lookup(table6,&listen_key,fastnet_socket_key6_hash(&(listen_key.v6)),grab,0);
+	if(sock!=ODP_BUFFER_INVALID) return sock;
+	
+	return socket_lookup_any(key,grab);
+}
+
+static inline
+fastnet_socket_t socket_lookup(socket_key_t *key,uint32_t hash,int grab) {
+	if(fastnet_socket_key_is4(key)) return socket_lookup4(key,hash,grab);
+	return socket_lookup6(key,hash,grab);
+}
+
+fastnet_socket_t fastnet_socket_lookup(socket_key_t *key) {
+	return socket_lookup(key,ht_hash(key),1);
+}
+
+fastnet_socket_t fastnet_socket_lookup_hash(socket_key_t *key,uint32_t hash) {
+	return socket_lookup(key,hash,1);
+}
+
+fastnet_socket_t fastnet_socket_lookup_owned(socket_key_t *key,uint32_t hash) {
+	return socket_lookup(key,hash,0);
 }
 
 void fastnet_socket_insert(fastnet_socket_t sock) {
@@ -0,0 +1,129 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stddef.h>
+#include <string.h>
+#include <net/stats.h>
+
+fastnet_stats_block_t fastnet_stats_blocks[FASTNET_THREAD_SLOTS];
+
+#define NUM_COUNTERS (sizeof(fastnet_stats_t)/sizeof(uint64_t))
+
+typedef struct {
+	const char* name;
+	size_t      offset;
+} stat_name_t;
+
+#define VAR(n) { #n, offsetof(fastnet_stats_t,n) }
+
+static const stat_name_t names[] = {
+	VAR(ip_in_receives),
+	VAR(ip_in_hdr_errors),
+	VAR(ip_in_addr_errors),
+	VAR(ip_in_truncated_pkts),
+	VAR(ip_in_delivers),
+	VAR(ip_reasm_fails),
+	VAR(ip_out_requests),
+	VAR(ip_out_discards),
+	VAR(ip6_in_receives),
+	VAR(ip6_in_hdr_errors),
+	VAR(ip6_in_addr_errors),
+	VAR(ip6_in_truncated_pkts),
+	VAR(ip6_in_delivers),
+	VAR(ip6_out_requests),
+	VAR(ip6_out_discards),
+	VAR(tcp_in_segs),
+	VAR(tcp_in_errs),
+	VAR(tcp_no_ports),
+	VAR(tcp_out_segs),
+	VAR(tcp_passive_opens),
+	VAR(tcp_out_rsts),
+	VAR(tcp_rst_ratelimited),
+	VAR(udp_in_datagrams),
+	VAR(udp_no_ports),
+	VAR(udp_out_datagrams),
+	VAR(icmp_in_msgs),
+	VAR(icmp_in_errors),
+	VAR(icmp_out_msgs),
+	VAR(icmp6_in_msgs),
+	VAR(icmp6_in_errors),
+	VAR(icmp6_out_msgs),
+	VAR(icmp_out_ratelimited),
+	VAR(icmp6_out_ratelimited),
+	VAR(pmtu_updates),
+	VAR(arp_in_pkts),
+	VAR(arp_in_errors),
+	VAR(arp_out_requests),
+	VAR(arp_out_replies),
+	VAR(nd6_in_msgs),
+	VAR(nd6_in_errors),
+	VAR(drop_ip_checksum),
+	VAR(drop_ip_header),
+	VAR(drop_ip_length),
+	VAR(drop_ip_not_ours),
+	VAR(drop_ip_fragment),
+	VAR(drop_ip6_header),
+	VAR(drop_ip6_length),
+	VAR(drop_ip6_not_ours),
+	VAR(drop_tcp_checksum),
+	VAR(drop_tcp_no_socket),
+	VAR(drop_tcp_seqcheck),
+	VAR(drop_udp_no_socket),
+	VAR(drop_arp_pool),
+	VAR(drop_arp_unresolved),
+	VAR(drop_no_protocol),
+	VAR(drop_flowdir_full),
+	VAR(drop_flowdir_nonworker),
+	VAR(drop_tx_queue_full),
+	VAR(drop_total),
+};
+
+#define NUM_NAMES (sizeof(names)/sizeof(names[0]))
+
+_Static_assert(NUM_NAMES==NUM_COUNTERS,"every counter needs a name");
+
+void fastnet_stats_sum(fastnet_stats_t* total){
+	uint64_t* t = (uint64_t*)total;
+	const volatile uint64_t* c;
+	size_t i;
+	int w;
+	memset(total,0,sizeof(*total));
+	for(w=0;w<FASTNET_THREAD_SLOTS;++w){
+		c = (const volatile uint64_t*)&(fastnet_stats_blocks[w].s);
+		for(i=0;i<NUM_COUNTERS;++i) t[i] += c[i];
+	}
+}
+
+void fastnet_stats_worker(int worker,fastnet_stats_t* stats){
+	uint64_t* t = (uint64_t*)stats;
+	const volatile uint64_t* c;
+	size_t i;
+	if(worker<0 || worker>=FASTNET_THREAD_SLOTS){
+		memset(stats,0,sizeof(*stats));
+		return;
+	}
+	c = (const volatile uint64_t*)&(fastnet_stats_blocks[worker].s);
+	for(i=0;i<NUM_COUNTERS;++i) t[i] = c[i];
+}
+
+void fastnet_stats_print(FILE* f,const fastnet_stats_t* stats,int all){
+	size_t i;
+	uint64_t v;
+	for(i=0;i<NUM_NAMES;++i){
+		v = *((const uint64_t*)(((const char*)stats)+names[i].offset));
+		if(!v && !all) continue;
+		fprintf(f,"%-24s %llu\n",names[i].name,(unsigned long long)v);
+	}
+}
@@ -17,9 +17,11 @@
 #include <net/std_lib.h>
 #include <net/ipv4_mac_cache.h>
 #include <net/nd6_cache.h>
+#include <net/pmtu.h>
 #include <net/std_defs.h>
 #include <net/header/layer4.h>
 #include <net/socket_key.h>
+#include <net/conf.h>
 
 #if 1
 #define ASSERT(i) if(!(i)) fastnet_abort()
@@ -118,9 +120,11 @@ static void init(){
 
 
 void fastnet_tlp_init(){
+	fastnet_conf_finalize(&fastnet_conf);
 	fastnet_socket_init();
 	fastnet_initialize_ipmac_cache();
 	fastnet_nd6_cache_init();
+	fastnet_pmtu_init();
 	init();
 }
 
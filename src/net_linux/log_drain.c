@@ -0,0 +1,62 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <net/log.h>
+
+/*
+ * The drain thread is the only thread, that writes to the log file, so the workers never
+ * contend on the stdio lock.
+ */
+
+typedef struct {
+	FILE*    f;
+	uint32_t interval_ms;
+} drain_t;
+
+static void* drain_thread(void* arg){
+	drain_t* d = arg;
+	struct timespec ts;
+	
+	ts.tv_sec  = d->interval_ms/1000;
+	ts.tv_nsec = (d->interval_ms%1000)*1000000L;
+	for(;;){
+		/* Drain until empty, then sleep. */
+		while(fastnet_log_drain(d->f)>0);
+		nanosleep(&ts,NULL);
+	}
+	return NULL;
+}
+
+int fastnet_log_start(FILE* f,uint32_t interval_ms){
+	pthread_t thread;
+	drain_t* d;
+	
+	if(!interval_ms) interval_ms = 100;
+	
+	d = calloc(sizeof(*d),1);
+	if(!d) return 1;
+	d->f = f;
+	d->interval_ms = interval_ms;
+	
+	if(pthread_create(&thread,NULL,drain_thread,d)){
+		free(d);
+		return 1;
+	}
+	pthread_detach(thread);
+	return 0;
+}
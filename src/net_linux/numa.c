@@ -0,0 +1,124 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/numa.h>
+
+#define SYSFS_NODE "/sys/devices/system/node"
+#define SYSFS_CPU  "/sys/devices/system/cpu"
+
+static int num_nodes = 0;
+
+static cpu_set_t saved_affinity;
+static int       saved_valid = 0;
+static int       saved_node  = 0;
+
+int fastnet_numa_num_nodes(){
+	char path[128];
+	int n;
+	if(num_nodes) return num_nodes;
+	for(n=0;n<NET_MAXNODES;++n){
+		snprintf(path,sizeof path,SYSFS_NODE "/node%d",n);
+		if(access(path,F_OK)) break;
+	}
+	if(n<1) n = 1;
+	num_nodes = n;
+	return n;
+}
+
+int fastnet_numa_cpu_node(int cpu){
+	char path[128];
+	int node,n = fastnet_numa_num_nodes();
+	if(n<2 || cpu<0) return 0;
+	for(node=0;node<n;++node){
+		snprintf(path,sizeof path,SYSFS_CPU "/cpu%d/node%d",cpu,node);
+		if(!access(path,F_OK)) return node;
+	}
+	return 0;
+}
+
+int fastnet_numa_dev_node(const char* dev){
+	char path[128];
+	const char* name;
+	FILE* f;
+	int node = -1;
+	
+	/* Strip the pktio type prefix, eg. "tap:" or "pcap:". */
+	name = strchr(dev,':');
+	name = name ? name+1 : dev;
+	
+	snprintf(path,sizeof path,"/sys/class/net/%s/device/numa_node",name);
+	f = fopen(path,"r");
+	if(!f) return 0;
+	if(fscanf(f,"%d",&node)!=1) node = -1;
+	fclose(f);
+	
+	if(node<0 || node>=fastnet_numa_num_nodes()) return 0;
+	return node;
+}
+
+/*
+ * Parses a cpulist like "0-3,8-11".
+ */
+static int read_cpulist(int node,cpu_set_t* set){
+	char path[128];
+	FILE* f;
+	int a,b,c;
+	
+	snprintf(path,sizeof path,SYSFS_NODE "/node%d/cpulist",node);
+	f = fopen(path,"r");
+	if(!f) return 0;
+	CPU_ZERO(set);
+	for(;;){
+		if(fscanf(f,"%d",&a)!=1) break;
+		b = a;
+		c = fgetc(f);
+		if(c=='-'){
+			if(fscanf(f,"%d",&b)!=1) break;
+			c = fgetc(f);
+		}
+		for(;a<=b && a<CPU_SETSIZE;++a) CPU_SET(a,set);
+		if(c!=',') break;
+	}
+	fclose(f);
+	return CPU_COUNT(set)>0;
+}
+
+void fastnet_numa_enter(int node){
+	cpu_set_t set;
+	if(fastnet_numa_num_nodes()<2) return;
+	if(!read_cpulist(node,&set)) return;
+	if(sched_getaffinity(0,sizeof(saved_affinity),&saved_affinity)) return;
+	if(sched_setaffinity(0,sizeof(set),&set)) return;
+	saved_valid = 1;
+	saved_node  = fastnet_numa_node_idx;
+	fastnet_numa_node_idx = node;
+}
+
+void fastnet_numa_leave(){
+	if(!saved_valid) return;
+	sched_setaffinity(0,sizeof(saved_affinity),&saved_affinity);
+	fastnet_numa_node_idx = saved_node;
+	saved_valid = 0;
+}
+
+void fastnet_numa_thread_init(){
+	fastnet_numa_node_idx = fastnet_numa_cpu_node(sched_getcpu());
+}
+
@@ -27,21 +27,31 @@
 #endif
 
 void fastnet_runthreads(nif_table_t* table){
+	fastnet_runworkers(table,table->workers,fastnet_eventlist,table);
+}
+
+void fastnet_runworkers(nif_table_t* table,int workers,int (*start)(void*),void* arg){
 	int i,p,n;
 	odp_cpumask_t TM;
 	odph_odpthread_t threads[NET_MAXTHREAD];
 	odph_odpthread_params_t tpar;
 	
-	tpar.start = fastnet_eventlist;
-	tpar.arg = table;
+	tpar.start = start;
+	tpar.arg = arg;
 	tpar.instance = table->instance;
 	tpar.thr_type = ODP_THREAD_WORKER;
 	
-	n = table->workers;
-	DEBUG(table->workers);
+	n = workers;
+	if(n>table->workers) n = table->workers;
+	odp_atomic_store_u32(&(table->worker_seq),0);
+	DEBUG(n);
 	DBGPF("Start IO Threads!\n");
 	p = odp_cpumask_first(&(table->cpumask));
 	for (i = 0; i < n; ++i) {
+		/*
+		 * Every worker is pinned onto exactly one CPU, so it stays on its NUMA node
+		 * (see fastnet_numa_thread_init()).
+		 */
 		odp_cpumask_zero(&TM);
 		odp_cpumask_set(&TM,p);
 		odph_odpthreads_create(&threads[i],&TM,&tpar);
@@ -0,0 +1,169 @@
+/*
+ *   Copyright 2017 Simon Schmidt
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <net/stats.h>
+#include <net/prof.h>
+#include <net/latency.h>
+#include <net/lockprof.h>
+#include <net/conf.h>
+#include <net/std_lib.h>
+
+/*
+ * The export thread only reads the counter blocks, so it needs no ODP thread context.
+ *
+ * With NET_PROF, the cycle accounting (see <net/prof.h>) is written next to the counters,
+ * into "<path>.prof" (histograms) and "<path>.folded" (folded stacks, for flamegraph.pl).
+ * With NET_LOCKPROF, the lock contention (see <net/lockprof.h>) goes into "<path>.locks".
+ *
+ * With latency sampling on (lat_sample), the latency histograms (see <net/latency.h>) go into
+ * "<path>.latency".
+ */
+
+typedef struct {
+	const char* path;
+	const char* tmp;
+} export_file_t;
+
+typedef struct {
+	export_file_t stats;
+	export_file_t latency;
+#ifdef NET_PROF
+	export_file_t prof;
+	export_file_t folded;
+#endif
+#ifdef NET_LOCKPROF
+	export_file_t locks;
+#endif
+	uint32_t      interval_ms;
+} export_t;
+
+static int file_init(export_file_t* ef,const char* path,const char* suffix){
+	ef->path = fastnet_dup_concat3(path,suffix,"");
+	ef->tmp  = fastnet_dup_concat3(path,suffix,".tmp");
+	return ef->path && ef->tmp;
+}
+
+static void file_free(export_file_t* ef){
+	free((void*)ef->path);
+	free((void*)ef->tmp);
+}
+
+static void write_stats(FILE* f){
+	fastnet_stats_t total;
+	
+	fastnet_stats_sum(&total);
+	fastnet_stats_print(f,&total,1);
+}
+
+/*
+ * The file is written under a temporary name, and then renamed, so a reader never sees
+ * a partially written file.
+ */
+static void export_once(export_file_t* ef,void (*write)(FILE* f)){
+	FILE* f;
+	
+	f = fopen(ef->tmp,"w");
+	if(!f) return;
+	write(f);
+	if(fclose(f)) return;
+	rename(ef->tmp,ef->path);
+}
+
+static void* export_thread(void* arg){
+	export_t* ex = arg;
+	struct timespec ts;
+	
+	ts.tv_sec  = ex->interval_ms/1000;
+	ts.tv_nsec = (ex->interval_ms%1000)*1000000L;
+	for(;;){
+		nanosleep(&ts,NULL);
+		export_once(&(ex->stats),write_stats);
+		if(fastnet_conf.lat_sample)
+			export_once(&(ex->latency),fastnet_lat_print);
+#ifdef NET_PROF
+		export_once(&(ex->prof),fastnet_prof_print);
+		export_once(&(ex->folded),fastnet_prof_folded);
+#endif
+#ifdef NET_LOCKPROF
+		export_once(&(ex->locks),fastnet_lockprof_print);
+#endif
+	}
+	return NULL;
+}
+
+void fastnet_stats_report(FILE* f){
+	fastnet_stats_t total;
+	
+	fastnet_stats_sum(&total);
+	fastnet_stats_print(f,&total,0);
+	
+#ifdef NET_PROF
+	fprintf(f,"\ncycles per stage (inclusive):\n");
+	fastnet_prof_print(f);
+	fprintf(f,"\nfolded stacks (exclusive cycles):\n");
+	fastnet_prof_folded(f);
+#endif
+	
+#ifdef NET_LOCKPROF
+	fprintf(f,"\nlock contention (cycles):\n");
+	fastnet_lockprof_print(f);
+#endif
+	
+	if(fastnet_conf.lat_sample){
+		fprintf(f,"\nlatency (1 in %u packets):\n",(unsigned)fastnet_conf.lat_sample);
+		fastnet_lat_print(f);
+	}
+}
+
+int fastnet_stats_export_start(const char* path,uint32_t interval_ms){
+	pthread_t thread;
+	export_t* ex;
+	
+	if(!interval_ms) interval_ms = 1000;
+	
+	ex = calloc(sizeof(*ex),1);
+	if(!ex) return 1;
+	if(!file_init(&(ex->stats),path,"")) goto fail;
+	if(!file_init(&(ex->latency),path,".latency")) goto fail;
+#ifdef NET_PROF
+	if(!file_init(&(ex->prof),path,".prof")) goto fail;
+	if(!file_init(&(ex->folded),path,".folded")) goto fail;
+#endif
+#ifdef NET_LOCKPROF
+	if(!file_init(&(ex->locks),path,".locks")) goto fail;
+#endif
+	ex->interval_ms = interval_ms;
+	
+	if(pthread_create(&thread,NULL,export_thread,ex)) goto fail;
+	pthread_detach(thread);
+	return 0;
+fail:
+	file_free(&(ex->stats));
+	file_free(&(ex->latency));
+#ifdef NET_PROF
+	file_free(&(ex->prof));
+	file_free(&(ex->folded));
+#endif
+#ifdef NET_LOCKPROF
+	file_free(&(ex->locks));
+#endif
+	free(ex);
+	return 1;
+}